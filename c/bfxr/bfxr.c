@@ -0,0 +1,692 @@
+// bfxr.c - Bfxr sound effect generator.
+#include "c/bfxr/bfxr.h"
+
+#include "c/bfxr/impl.h"
+#include "c/io/error.h"
+#include "c/ops/ops.h"
+
+#include <limits.h>
+#include <math.h>
+#include <string.h>
+
+enum {
+    // Oversampling factor of the oscillator and filters.
+    kBfxrOversample = 8,
+    // Number of output samples computed at a time.
+    kBfxrChunk = 64,
+    // Number of oversampled samples computed at a time.
+    kBfxrSubchunk = kBfxrChunk * kBfxrOversample,
+    // Minimum oscillator period, in oversampled samples.
+    kBfxrMinPeriod = 8,
+    // Number of rows in the pink noise generator.
+    kBfxrPinkRows = 5,
+};
+
+// Minimum total envelope time, in parameter units.
+static const double kBfxrMinLength = 0.18;
+
+// Waveform shapes evaluated with SIMD.
+typedef enum {
+    kBfxrShapeSquare,
+    kBfxrShapeSaw,
+    kBfxrShapeTriangle,
+    kBfxrShapeBreaker,
+    // Correction applied to the output of ufxr_sin1_2.
+    kBfxrShapeSine,
+} bfxr_shapetype;
+
+// Parameters for each output sample in a chunk, computed before the
+// oscillator runs.
+struct bfxr_control {
+    // Oscillator period, in oversampled samples.
+    int period[kBfxrChunk];
+    float duty[kBfxrChunk];
+    // Output gain, from the envelope and master volume.
+    double gain[kBfxrChunk];
+    // Flanger delay, in oversampled samples.
+    int flanger[kBfxrChunk];
+    double hpcutoff[kBfxrChunk];
+    bool muted[kBfxrChunk];
+};
+
+// AVX version.
+#if !HAVE_FUNC && USE_AVX
+#define HAVE_FUNC 1
+#include <immintrin.h>
+
+// Compute the phase of a harmonic of the oscillator, relative to its period,
+// from 0 to 1. This is exact integer arithmetic, computed in floating point.
+// The count must be a multiple of 8.
+static void bfxr_relphase(int n, float *restrict outs,
+                          const int32_t *restrict phases,
+                          const int32_t *restrict periods, int harmonic) {
+    const __m256 h = _mm256_set1_ps((float)harmonic);
+    const __m256 zero = _mm256_setzero_ps();
+    for (int i = 0; i < n; i += 8) {
+        __m256 x = _mm256_mul_ps(
+            _mm256_cvtepi32_ps(
+                _mm256_loadu_si256((const __m256i *)(phases + i))),
+            h);
+        __m256 p = _mm256_cvtepi32_ps(
+            _mm256_loadu_si256((const __m256i *)(periods + i)));
+        __m256 q = _mm256_cvtepi32_ps(
+            _mm256_cvttps_epi32(_mm256_div_ps(x, p)));
+        // The remainder is exact, but the quotient may be off by one.
+        __m256 r = _mm256_sub_ps(x, _mm256_mul_ps(q, p));
+        r = _mm256_add_ps(
+            r, _mm256_and_ps(_mm256_cmp_ps(r, zero, _CMP_LT_OQ), p));
+        r = _mm256_sub_ps(
+            r, _mm256_and_ps(_mm256_cmp_ps(r, p, _CMP_GE_OQ), p));
+        _mm256_storeu_ps(outs + i, _mm256_div_ps(r, p));
+    }
+}
+
+// Add a waveform, scaled, to the output. The count must be a multiple of 8.
+static void bfxr_shape(int n, float *restrict outs, const float *restrict xs,
+                       const float *restrict duty, bfxr_shapetype shape,
+                       float scale) {
+    const __m256 abs = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+    const __m256 one = _mm256_set1_ps(1.0f), two = _mm256_set1_ps(2.0f);
+    const __m256 vscale = _mm256_set1_ps(scale);
+    switch (shape) {
+    case kBfxrShapeSquare: {
+        const __m256 hi = _mm256_set1_ps(0.5f * scale),
+                     lo = _mm256_set1_ps(-0.5f * scale);
+        for (int i = 0; i < n; i += 8) {
+            __m256 m = _mm256_cmp_ps(_mm256_loadu_ps(xs + i),
+                                     _mm256_loadu_ps(duty + i), _CMP_LT_OQ);
+            __m256 y = _mm256_blendv_ps(lo, hi, m);
+            _mm256_storeu_ps(outs + i,
+                             _mm256_add_ps(_mm256_loadu_ps(outs + i), y));
+        }
+    } break;
+    case kBfxrShapeSaw:
+        for (int i = 0; i < n; i += 8) {
+            __m256 x = _mm256_loadu_ps(xs + i);
+            __m256 y = _mm256_sub_ps(one, _mm256_mul_ps(x, two));
+            _mm256_storeu_ps(outs + i,
+                             _mm256_add_ps(_mm256_loadu_ps(outs + i),
+                                           _mm256_mul_ps(y, vscale)));
+        }
+        break;
+    case kBfxrShapeTriangle:
+        for (int i = 0; i < n; i += 8) {
+            __m256 x = _mm256_loadu_ps(xs + i);
+            __m256 y = _mm256_sub_ps(
+                _mm256_and_ps(_mm256_sub_ps(one, _mm256_mul_ps(x, two)), abs),
+                one);
+            _mm256_storeu_ps(outs + i,
+                             _mm256_add_ps(_mm256_loadu_ps(outs + i),
+                                           _mm256_mul_ps(y, vscale)));
+        }
+        break;
+    case kBfxrShapeBreaker:
+        for (int i = 0; i < n; i += 8) {
+            __m256 x = _mm256_loadu_ps(xs + i);
+            __m256 y = _mm256_sub_ps(
+                one, _mm256_mul_ps(two, _mm256_mul_ps(x, x)));
+            y = _mm256_sub_ps(_mm256_and_ps(y, abs), one);
+            _mm256_storeu_ps(outs + i,
+                             _mm256_add_ps(_mm256_loadu_ps(outs + i),
+                                           _mm256_mul_ps(y, vscale)));
+        }
+        break;
+    case kBfxrShapeSine: {
+        const __m256 c = _mm256_set1_ps(0.225f);
+        for (int i = 0; i < n; i += 8) {
+            __m256 x = _mm256_loadu_ps(xs + i);
+            __m256 ax = _mm256_and_ps(x, abs);
+            __m256 y = _mm256_sub_ps(
+                x, _mm256_mul_ps(c, _mm256_add_ps(_mm256_mul_ps(x, ax), ax)));
+            _mm256_storeu_ps(outs + i,
+                             _mm256_add_ps(_mm256_loadu_ps(outs + i),
+                                           _mm256_mul_ps(y, vscale)));
+        }
+    } break;
+    }
+}
+#endif
+
+// SSE2 version.
+#if !HAVE_FUNC && USE_SSE2
+#define HAVE_FUNC 1
+#include <emmintrin.h>
+
+static void bfxr_relphase(int n, float *restrict outs,
+                          const int32_t *restrict phases,
+                          const int32_t *restrict periods, int harmonic) {
+    const __m128 h = _mm_set1_ps((float)harmonic);
+    const __m128 zero = _mm_setzero_ps();
+    for (int i = 0; i < n; i += 4) {
+        __m128 x = _mm_mul_ps(
+            _mm_cvtepi32_ps(_mm_loadu_si128((const __m128i *)(phases + i))),
+            h);
+        __m128 p =
+            _mm_cvtepi32_ps(_mm_loadu_si128((const __m128i *)(periods + i)));
+        __m128 q = _mm_cvtepi32_ps(_mm_cvttps_epi32(_mm_div_ps(x, p)));
+        __m128 r = _mm_sub_ps(x, _mm_mul_ps(q, p));
+        r = _mm_add_ps(r, _mm_and_ps(_mm_cmplt_ps(r, zero), p));
+        r = _mm_sub_ps(r, _mm_and_ps(_mm_cmpge_ps(r, p), p));
+        _mm_storeu_ps(outs + i, _mm_div_ps(r, p));
+    }
+}
+
+static void bfxr_shape(int n, float *restrict outs, const float *restrict xs,
+                       const float *restrict duty, bfxr_shapetype shape,
+                       float scale) {
+    const __m128 abs = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    const __m128 one = _mm_set1_ps(1.0f), two = _mm_set1_ps(2.0f);
+    const __m128 vscale = _mm_set1_ps(scale);
+    switch (shape) {
+    case kBfxrShapeSquare: {
+        const __m128 hi = _mm_set1_ps(0.5f * scale),
+                     lo = _mm_set1_ps(-0.5f * scale);
+        for (int i = 0; i < n; i += 4) {
+            __m128 m =
+                _mm_cmplt_ps(_mm_loadu_ps(xs + i), _mm_loadu_ps(duty + i));
+            __m128 y = _mm_or_ps(_mm_and_ps(m, hi), _mm_andnot_ps(m, lo));
+            _mm_storeu_ps(outs + i, _mm_add_ps(_mm_loadu_ps(outs + i), y));
+        }
+    } break;
+    case kBfxrShapeSaw:
+        for (int i = 0; i < n; i += 4) {
+            __m128 x = _mm_loadu_ps(xs + i);
+            __m128 y = _mm_sub_ps(one, _mm_mul_ps(x, two));
+            _mm_storeu_ps(outs + i, _mm_add_ps(_mm_loadu_ps(outs + i),
+                                               _mm_mul_ps(y, vscale)));
+        }
+        break;
+    case kBfxrShapeTriangle:
+        for (int i = 0; i < n; i += 4) {
+            __m128 x = _mm_loadu_ps(xs + i);
+            __m128 y = _mm_sub_ps(
+                _mm_and_ps(_mm_sub_ps(one, _mm_mul_ps(x, two)), abs), one);
+            _mm_storeu_ps(outs + i, _mm_add_ps(_mm_loadu_ps(outs + i),
+                                               _mm_mul_ps(y, vscale)));
+        }
+        break;
+    case kBfxrShapeBreaker:
+        for (int i = 0; i < n; i += 4) {
+            __m128 x = _mm_loadu_ps(xs + i);
+            __m128 y = _mm_sub_ps(one, _mm_mul_ps(two, _mm_mul_ps(x, x)));
+            y = _mm_sub_ps(_mm_and_ps(y, abs), one);
+            _mm_storeu_ps(outs + i, _mm_add_ps(_mm_loadu_ps(outs + i),
+                                               _mm_mul_ps(y, vscale)));
+        }
+        break;
+    case kBfxrShapeSine: {
+        const __m128 c = _mm_set1_ps(0.225f);
+        for (int i = 0; i < n; i += 4) {
+            __m128 x = _mm_loadu_ps(xs + i);
+            __m128 ax = _mm_and_ps(x, abs);
+            __m128 y = _mm_sub_ps(
+                x, _mm_mul_ps(c, _mm_add_ps(_mm_mul_ps(x, ax), ax)));
+            _mm_storeu_ps(outs + i, _mm_add_ps(_mm_loadu_ps(outs + i),
+                                               _mm_mul_ps(y, vscale)));
+        }
+    } break;
+    }
+}
+#endif
+
+// Scalar version.
+#if !HAVE_FUNC
+static void bfxr_relphase(int n, float *restrict outs,
+                          const int32_t *restrict phases,
+                          const int32_t *restrict periods, int harmonic) {
+    for (int i = 0; i < n; i++) {
+        outs[i] =
+            (float)(phases[i] * harmonic % periods[i]) / (float)periods[i];
+    }
+}
+
+static void bfxr_shape(int n, float *restrict outs, const float *restrict xs,
+                       const float *restrict duty, bfxr_shapetype shape,
+                       float scale) {
+    for (int i = 0; i < n; i++) {
+        const float x = xs[i];
+        float y;
+        switch (shape) {
+        case kBfxrShapeSquare:
+            y = x < duty[i] ? 0.5f : -0.5f;
+            break;
+        case kBfxrShapeSaw:
+            y = 1.0f - x * 2.0f;
+            break;
+        case kBfxrShapeTriangle:
+            y = fabsf(1.0f - x * 2.0f) - 1.0f;
+            break;
+        case kBfxrShapeBreaker:
+            y = fabsf(1.0f - 2.0f * (x * x)) - 1.0f;
+            break;
+        case kBfxrShapeSine:
+        default:
+            y = x - 0.225f * (x * fabsf(x) + fabsf(x));
+            break;
+        }
+        outs[i] += y * scale;
+    }
+}
+#endif
+
+// Generate the next value from the pink noise generator.
+static float bfxr_pink(struct ufxr_bfxr *restrict g) {
+    const unsigned last = g->pinkkey;
+    g->pinkkey = (g->pinkkey + 1) & ((1u << kBfxrPinkRows) - 1);
+    const unsigned diff = g->pinkkey ^ last;
+    int sum = 0;
+    for (int i = 0; i < kBfxrPinkRows; i++) {
+        if ((diff & (1u << i)) != 0) {
+            g->pinkvalues[i] =
+                (int)(ufxr_bfxr_random(&g->seed) * (128.0 / kBfxrPinkRows));
+        }
+        sum += g->pinkvalues[i];
+    }
+    return (float)sum / 64.0f - 1.0f;
+}
+
+// Fill the noise wavetable with new values.
+static void bfxr_noise(struct ufxr_bfxr *restrict g) {
+    if (g->wave == kUFXRBfxrNoise) {
+        for (int i = 0; i < UFXR_BFXR_NOISE; i++) {
+            g->noise[i] = 2.0f * (float)ufxr_bfxr_random(&g->seed) - 1.0f;
+        }
+    } else if (g->wave == kUFXRBfxrPink) {
+        for (int i = 0; i < UFXR_BFXR_NOISE; i++) {
+            g->noise[i] = bfxr_pink(g);
+        }
+    }
+}
+
+bool ufxr_bfxr_init(struct ufxr_bfxr *restrict g,
+                    const struct ufxr_bfxrparams *restrict p, uint32_t seed,
+                    struct ufxr_error *err) {
+    if (!ufxr_bfxrparams_valid(p)) {
+        ufxr_error_setcode(err, kUFXRErrorInvalidArgument);
+        return false;
+    }
+    *g = (struct ufxr_bfxr){
+        .wave = p->wave,
+        .mastervolume = p->mastervolume * p->mastervolume,
+        .sustainpunch = p->sustainpunch,
+        .hasminfrequency = p->minfrequency > 0.0,
+        .overtones = (int)(p->overtones * 10),
+        .overtonefalloff = p->overtonefalloff,
+        .bitcrushfreq = 1.0 - pow(p->bitcrush, 1.0 / 3.0),
+        .bitcrushsweep = -0.000015 * p->bitcrushsweep,
+        .compression = 1.0 / (1.0 + 4.0 * p->compression),
+        .filters = p->lpfiltercutoff != 1.0 || p->hpfiltercutoff != 0.0,
+        .lpfilteron = p->lpfiltercutoff != 1.0,
+        .lpcutoff = 0.1 * p->lpfiltercutoff * p->lpfiltercutoff *
+                    p->lpfiltercutoff,
+        .lpdeltacutoff = 1.0 + 0.0001 * p->lpfiltercutoffsweep,
+        .hpcutoff = 0.1 * p->hpfiltercutoff * p->hpfiltercutoff,
+        .hpdeltacutoff = 1.0 + 0.0003 * p->hpfiltercutoffsweep,
+        .vibratospeed = 0.01 * p->vibratospeed * p->vibratospeed,
+        .vibratoamplitude = 0.5 * p->vibratodepth,
+        .flanger = p->flangeroffset != 0.0 || p->flangersweep != 0.0,
+        .flangeroffset = 1020.0 * p->flangeroffset * p->flangeroffset *
+                         (p->flangeroffset > 0.0 ? 1.0 : -1.0),
+        .flangerdeltaoffset =
+            0.2 * p->flangersweep * p->flangersweep * p->flangersweep,
+        .repeatlimit =
+            p->repeatspeed == 0.0
+                ? 0
+                : (int)((1.0 - p->repeatspeed) * (1.0 - p->repeatspeed) *
+                        20000) +
+                      32,
+        .seed = ufxr_bfxr_hash(seed),
+    };
+    g->lpdamping = 1.0 - 5.0 /
+                             (1.0 + 20.0 * p->lpfilterresonance *
+                                        p->lpfilterresonance) *
+                             (0.01 + g->lpcutoff);
+
+    // Pitch.
+    struct ufxr_bfxrpitch *restrict s = &g->pitch;
+    s->period = 100.0 / (p->startfrequency * p->startfrequency + 0.001);
+    s->maxperiod = 100.0 / (p->minfrequency * p->minfrequency + 0.001);
+    s->slide = 1.0 - 0.01 * p->slide * p->slide * p->slide;
+    s->deltaslide = -0.000001 * p->deltaslide * p->deltaslide * p->deltaslide;
+    if (p->wave == kUFXRBfxrSquare) {
+        s->squareduty = 0.5 - 0.5 * p->squareduty;
+        s->dutysweep = -0.00005 * p->dutysweep;
+    }
+    s->changeperiod = (int)((1.1 - p->changerepeat) * (20000 / 1.1) + 32);
+    const double amounts[2] = {p->changeamount, p->changeamount2};
+    const double speeds[2] = {p->changespeed, p->changespeed2};
+    for (int k = 0; k < 2; k++) {
+        const double a = amounts[k], v = 1.0 - speeds[k];
+        s->changeamount[k] = a > 0.0 ? 1.0 - 0.9 * a * a : 1.0 + 10.0 * a * a;
+        s->changelimit[k] =
+            speeds[k] == 1.0
+                ? 0
+                : (int)((v * v * 20000 + 32) * (1.0 - p->changerepeat + 0.1) /
+                        1.1);
+    }
+    g->initpitch = *s;
+
+    // Envelope.
+    double attack = p->attacktime > 0.0 ? p->attacktime : 0.0;
+    double sustain = p->sustaintime > 0.01 ? p->sustaintime : 0.01;
+    double decay = p->decaytime > 0.0 ? p->decaytime : 0.0;
+    const double total = attack + sustain + decay;
+    if (total < kBfxrMinLength) {
+        const double scale = kBfxrMinLength / total;
+        attack *= scale;
+        sustain *= scale;
+        decay *= scale;
+    }
+    g->envlengths[0] = (int)(100000 * attack * attack);
+    g->envlengths[1] = (int)(100000 * sustain * sustain);
+    g->envlengths[2] = (int)(100000 * decay * decay + 10);
+    g->envlength = g->envlengths[0];
+    g->envfulllength = g->envlengths[0] + g->envlengths[1] + g->envlengths[2];
+    for (int k = 0; k < 3; k++) {
+        g->envinvlengths[k] =
+            g->envlengths[k] > 0 ? 1.0 / g->envlengths[k] : 0.0;
+    }
+
+    if (g->wave == kUFXRBfxrPink) {
+        for (int i = 0; i < kBfxrPinkRows; i++) {
+            g->pinkvalues[i] =
+                (int)(ufxr_bfxr_random(&g->seed) * (128.0 / kBfxrPinkRows));
+        }
+    }
+    bfxr_noise(g);
+    return true;
+}
+
+int ufxr_bfxr_length(const struct ufxr_bfxr *restrict g) {
+    return g->envfulllength;
+}
+
+// Update the pitch, envelope, and effect parameters for up to n samples.
+// Returns the number of samples, which is less than n if the sound finishes.
+static int bfxr_control(struct ufxr_bfxr *restrict g, int n,
+                        struct bfxr_control *restrict c) {
+    struct ufxr_bfxrpitch *restrict s = &g->pitch;
+    int i = 0;
+    while (i < n && !g->finished) {
+        if (g->repeatlimit != 0 && ++g->repeattime >= g->repeatlimit) {
+            g->repeattime = 0;
+            *s = g->initpitch;
+        }
+
+        // Pitch jumps.
+        if (++s->changeperiodtime >= s->changeperiod) {
+            s->changeperiodtime = 0;
+            for (int k = 0; k < 2; k++) {
+                s->changetime[k] = 0;
+                if (s->changereached[k]) {
+                    s->period /= s->changeamount[k];
+                    s->changereached[k] = false;
+                }
+            }
+        }
+        for (int k = 0; k < 2; k++) {
+            if (!s->changereached[k] &&
+                ++s->changetime[k] >= s->changelimit[k]) {
+                s->changereached[k] = true;
+                s->period *= s->changeamount[k];
+            }
+        }
+
+        // Slide and vibrato.
+        s->slide += s->deltaslide;
+        s->period *= s->slide;
+        if (s->period >= s->maxperiod) {
+            s->period = s->maxperiod;
+            if (g->hasminfrequency) {
+                g->muted = true;
+            }
+        }
+        double period = s->period;
+        if (g->vibratoamplitude > 0.0) {
+            g->vibratophase += g->vibratospeed;
+            period =
+                s->period * (1.0 + sin(g->vibratophase) * g->vibratoamplitude);
+        }
+        c->period[i] = period > kBfxrMinPeriod ? (int)period : kBfxrMinPeriod;
+
+        if (g->wave == kUFXRBfxrSquare) {
+            double duty = s->squareduty + s->dutysweep;
+            duty = duty > 0.0 ? duty : 0.0;
+            s->squareduty = duty < 0.5 ? duty : 0.5;
+        }
+        c->duty[i] = (float)s->squareduty;
+
+        // Envelope.
+        if (++g->envtime >= g->envlength) {
+            g->envtime = 0;
+            g->envstage++;
+            g->envlength =
+                g->envstage < 3 ? g->envlengths[g->envstage] : INT_MAX;
+        }
+        double env;
+        switch (g->envstage) {
+        case 0:
+            env = g->envtime * g->envinvlengths[0];
+            break;
+        case 1:
+            env = 1.0 + (1.0 - g->envtime * g->envinvlengths[1]) * 2.0 *
+                            g->sustainpunch;
+            break;
+        case 2:
+            env = 1.0 - g->envtime * g->envinvlengths[2];
+            break;
+        default:
+            env = 0.0;
+            g->finished = true;
+            break;
+        }
+        c->gain[i] = g->mastervolume * env * 0.125;
+
+        // Effects.
+        int flanger = 0;
+        if (g->flanger) {
+            g->flangeroffset += g->flangerdeltaoffset;
+            const double offset = fabs(g->flangeroffset);
+            flanger = offset < UFXR_BFXR_FLANGER - 1 ? (int)offset
+                                                     : UFXR_BFXR_FLANGER - 1;
+        }
+        c->flanger[i] = flanger;
+        if (g->filters && g->hpdeltacutoff != 0.0) {
+            double cutoff = g->hpcutoff * g->hpdeltacutoff;
+            cutoff = cutoff < 0.1 ? cutoff : 0.1;
+            g->hpcutoff = cutoff > 0.00001 ? cutoff : 0.00001;
+        }
+        c->hpcutoff[i] = g->hpcutoff;
+        c->muted[i] = g->muted;
+        i++;
+    }
+    return i;
+}
+
+// Advance the oscillator for n output samples, and store the phase, period,
+// and square duty for each oversampled sample. Noise is evaluated here, since
+// the noise table is refilled every time the phase wraps.
+static void bfxr_phase(struct ufxr_bfxr *restrict g, int n,
+                       const struct bfxr_control *restrict c,
+                       int32_t *restrict phases, int32_t *restrict periods,
+                       float *restrict duty, float *restrict outs) {
+    const bool noise =
+        g->wave == kUFXRBfxrNoise || g->wave == kUFXRBfxrPink;
+    int phase = g->phase;
+    for (int i = 0; i < n; i++) {
+        const int period = c->period[i];
+        for (int j = 0; j < kBfxrOversample; j++) {
+            const int m = i * kBfxrOversample + j;
+            if (++phase >= period) {
+                phase -= period;
+                if (noise) {
+                    bfxr_noise(g);
+                }
+            }
+            phases[m] = phase;
+            periods[m] = period;
+            duty[m] = c->duty[i];
+            if (noise) {
+                double sample = 0.0, strength = 1.0;
+                for (int k = 0; k <= g->overtones; k++) {
+                    const double rel =
+                        (double)(phase * (k + 1) % period) / (double)period;
+                    sample += strength * (double)g->noise[(int)(
+                                             rel * UFXR_BFXR_NOISE)];
+                    strength *= 1.0 - g->overtonefalloff;
+                }
+                outs[m] = sample;
+            }
+        }
+    }
+    g->phase = phase;
+}
+
+// Evaluate the waveform and its overtones for n oversampled samples.
+static void bfxr_oscillate(struct ufxr_bfxr *restrict g, int n,
+                           float *restrict outs,
+                           const int32_t *restrict phases,
+                           const int32_t *restrict periods,
+                           const float *restrict duty, float *restrict rel,
+                           float *restrict temp) {
+    const double pi = 4.0 * atan(1.0);
+    memset(outs, 0, sizeof(float) * n);
+    double strength = 1.0;
+    for (int k = 0; k <= g->overtones; k++) {
+        const float scale = strength;
+        bfxr_relphase(n, rel, phases, periods, k + 1);
+        switch (g->wave) {
+        case kUFXRBfxrSquare:
+            bfxr_shape(n, outs, rel, duty, kBfxrShapeSquare, scale);
+            break;
+        case kUFXRBfxrSaw:
+            bfxr_shape(n, outs, rel, duty, kBfxrShapeSaw, scale);
+            break;
+        case kUFXRBfxrTriangle:
+            bfxr_shape(n, outs, rel, duty, kBfxrShapeTriangle, scale);
+            break;
+        case kUFXRBfxrBreaker:
+            bfxr_shape(n, outs, rel, duty, kBfxrShapeBreaker, scale);
+            break;
+        case kUFXRBfxrSine:
+            ufxr_sin1_2(n, temp, rel);
+            bfxr_shape(n, outs, temp, duty, kBfxrShapeSine, scale);
+            break;
+        case kUFXRBfxrWhistle:
+            ufxr_sin1_2(n, temp, rel);
+            bfxr_shape(n, outs, temp, duty, kBfxrShapeSine, scale);
+            for (int i = 0; i < n; i++) {
+                rel[i] *= 20.0f;
+            }
+            ufxr_sin1_2(n, temp, rel);
+            bfxr_shape(n, outs, temp, duty, kBfxrShapeSine, 0.25f * scale);
+            break;
+        case kUFXRBfxrTan:
+            // Tan is evaluated in double precision, since it is steep near
+            // its poles.
+            for (int i = 0; i < n; i++) {
+                const double r = (double)(phases[i] * (k + 1) % periods[i]) /
+                                 (double)periods[i];
+                outs[i] = (double)outs[i] + (double)scale * tan(pi * r);
+            }
+            break;
+        default:
+            break;
+        }
+        strength *= 1.0 - g->overtonefalloff;
+    }
+}
+
+// Filter the oversampled oscillator output for n output samples, and apply the
+// flanger, envelope, bit crush, and compression.
+static void bfxr_filter(struct ufxr_bfxr *restrict g, int n,
+                        const struct bfxr_control *restrict c,
+                        float *restrict outs, const float *restrict xs) {
+    const int mask = UFXR_BFXR_FLANGER - 1;
+    for (int i = 0; i < n; i++) {
+        const double hpcutoff = c->hpcutoff[i];
+        const int flanger = c->flanger[i];
+        double supersample = 0.0;
+        for (int j = 0; j < kBfxrOversample; j++) {
+            double sample = (double)xs[i * kBfxrOversample + j];
+            if (g->filters) {
+                const double oldpos = g->lppos;
+                double cutoff = g->lpcutoff * g->lpdeltacutoff;
+                cutoff = cutoff < 0.1 ? cutoff : 0.1;
+                g->lpcutoff = cutoff > 0.0 ? cutoff : 0.0;
+                if (g->lpfilteron) {
+                    g->lpdeltapos =
+                        (g->lpdeltapos + (sample - g->lppos) * g->lpcutoff) *
+                        g->lpdamping;
+                } else {
+                    g->lppos = sample;
+                    g->lpdeltapos = 0.0;
+                }
+                g->lppos += g->lpdeltapos;
+                g->hppos = (g->hppos + g->lppos - oldpos) * (1.0 - hpcutoff);
+                sample = g->hppos;
+            }
+            if (g->flanger) {
+                g->flangerbuf[g->flangerpos & mask] = sample;
+                sample += (double)g->flangerbuf[(g->flangerpos - flanger +
+                                                 UFXR_BFXR_FLANGER) &
+                                                mask];
+                g->flangerpos = (g->flangerpos + 1) & mask;
+            }
+            supersample += sample;
+        }
+        supersample = supersample < 8.0 ? supersample : 8.0;
+        supersample = supersample > -8.0 ? supersample : -8.0;
+        supersample *= c->gain[i];
+
+        g->bitcrushphase += g->bitcrushfreq;
+        if (g->bitcrushphase > 1.0) {
+            g->bitcrushphase = 0.0;
+            g->bitcrushlast = supersample;
+        }
+        double freq = g->bitcrushfreq + g->bitcrushsweep;
+        freq = freq < 1.0 ? freq : 1.0;
+        g->bitcrushfreq = freq > 0.0 ? freq : 0.0;
+        outs[i] = c->muted[i] ? 0.0f : (float)g->bitcrushlast;
+    }
+
+    // Compression is computed in single precision, which is about twice as
+    // fast, and the output is single precision anyway.
+    if (g->compression != 1.0) {
+        const float compression = g->compression;
+        for (int i = 0; i < n; i++) {
+            outs[i] = copysignf(powf(fabsf(outs[i]), compression), outs[i]);
+        }
+    }
+}
+
+int ufxr_bfxr_render(struct ufxr_bfxr *restrict g, int n,
+                     float *restrict outs) {
+    struct bfxr_control c;
+    _Alignas(32) int32_t phases[kBfxrSubchunk];
+    _Alignas(32) int32_t periods[kBfxrSubchunk];
+    _Alignas(32) float duty[kBfxrSubchunk];
+    _Alignas(32) float osc[kBfxrSubchunk];
+    _Alignas(32) float rel[kBfxrSubchunk];
+    _Alignas(32) float temp[kBfxrSubchunk];
+    const bool noise =
+        g->wave == kUFXRBfxrNoise || g->wave == kUFXRBfxrPink;
+    // Filter and envelope tails decay into subnormals, which are very slow.
+    struct ufxr_fpstate fp;
+    ufxr_fpstate_ftz(&fp);
+    int pos = 0;
+    while (pos < n && !g->finished) {
+        int count = n - pos < kBfxrChunk ? n - pos : kBfxrChunk;
+        count = bfxr_control(g, count, &c);
+        bfxr_phase(g, count, &c, phases, periods, duty, osc);
+        if (!noise) {
+            bfxr_oscillate(g, count * kBfxrOversample, osc, phases, periods,
+                           duty, rel, temp);
+        }
+        bfxr_filter(g, count, &c, outs + pos, osc);
+        pos += count;
+    }
+    ufxr_fpstate_restore(&fp);
+    memset(outs + pos, 0, sizeof(float) * (n - pos));
+    return pos;
+}
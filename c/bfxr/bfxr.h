@@ -0,0 +1,196 @@
+// c/bfxr/bfxr.h - Bfxr sound effect generator.
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+struct ufxr_error;
+
+// Sample rate of Bfxr audio, in Hz. Times and frequencies in the parameters
+// are defined relative to this rate.
+#define UFXR_BFXR_SAMPLERATE 44100
+
+// Bfxr waveforms, in the order used by serialized parameters.
+typedef enum {
+    kUFXRBfxrSquare,
+    kUFXRBfxrSaw,
+    kUFXRBfxrSine,
+    kUFXRBfxrNoise,
+    kUFXRBfxrTriangle,
+    kUFXRBfxrPink,
+    kUFXRBfxrTan,
+    kUFXRBfxrWhistle,
+    kUFXRBfxrBreaker,
+} ufxr_bfxrwave;
+
+// Random preset categories.
+typedef enum {
+    kUFXRBfxrPickupCoin,
+    kUFXRBfxrLaserShoot,
+    kUFXRBfxrExplosion,
+    kUFXRBfxrPowerup,
+    kUFXRBfxrHitHurt,
+    kUFXRBfxrJump,
+    kUFXRBfxrBlipSelect,
+} ufxr_bfxrpreset;
+
+// Parameters for a Bfxr sound, with the same meaning and range as the Bfxr
+// tool. Ranges are 0 to 1 unless noted.
+struct ufxr_bfxrparams {
+    ufxr_bfxrwave wave;
+    double mastervolume;
+    // Envelope.
+    double attacktime;
+    double sustaintime;
+    double sustainpunch;
+    double decaytime;
+    double compression;
+    // Pitch. Slide and delta slide are -1 to 1. A nonzero minimum frequency
+    // mutes the sound when the pitch slides below it.
+    double startfrequency;
+    double minfrequency;
+    double slide;
+    double deltaslide;
+    double vibratodepth;
+    double vibratospeed;
+    double overtones;
+    double overtonefalloff;
+    // Pitch jumps. Amounts are -1 to 1.
+    double changerepeat;
+    double changeamount;
+    double changespeed;
+    double changeamount2;
+    double changespeed2;
+    // Square duty, and duty sweep from -1 to 1.
+    double squareduty;
+    double dutysweep;
+    double repeatspeed;
+    // Flanger offset and sweep, -1 to 1.
+    double flangeroffset;
+    double flangersweep;
+    // Filters. Sweeps are -1 to 1.
+    double lpfiltercutoff;
+    double lpfiltercutoffsweep;
+    double lpfilterresonance;
+    double hpfiltercutoff;
+    double hpfiltercutoffsweep;
+    // Bit crush, and sweep from -1 to 1.
+    double bitcrush;
+    double bitcrushsweep;
+};
+
+// Set parameters to the Bfxr defaults.
+void ufxr_bfxrparams_default(struct ufxr_bfxrparams *restrict p);
+
+// Parse parameters serialized by the Bfxr tool, as comma-separated values in
+// the order of the fields in ufxr_bfxrparams. Missing or empty values are set
+// to the default, and values out of range are clamped. Returns
+// kUFXRErrorBadBfxr if a value is not a number.
+bool ufxr_bfxrparams_parse(struct ufxr_bfxrparams *restrict p,
+                           const char *text, struct ufxr_error *err);
+
+// Generate random parameters from a preset category. The same seed always
+// generates the same parameters.
+void ufxr_bfxrparams_preset(struct ufxr_bfxrparams *restrict p,
+                            ufxr_bfxrpreset preset, uint32_t seed);
+
+// Pitch state which is restored when the sound repeats.
+struct ufxr_bfxrpitch {
+    double period;
+    double maxperiod;
+    double slide;
+    double deltaslide;
+    double squareduty;
+    double dutysweep;
+    int changeperiod;
+    int changeperiodtime;
+    double changeamount[2];
+    int changetime[2];
+    int changelimit[2];
+    bool changereached[2];
+};
+
+// Length of the flanger delay line.
+#define UFXR_BFXR_FLANGER 1024
+
+// Length of the noise wavetable.
+#define UFXR_BFXR_NOISE 32
+
+// A Bfxr sound generator. This produces the same output as the C# generator,
+// within rounding error, except for noise, which uses a different random
+// number generator.
+//
+// Bfxr runs its oscillator and filters at 8x the output rate. Pitch,
+// envelope, and effect parameters change every output sample, so these are
+// computed first for a block of samples. The oscillator phases for the block
+// are computed next, and the waveforms and overtones are then evaluated for
+// the whole block at once with SIMD. Only the filters, which are recursive,
+// run one sample at a time.
+//
+// The generator does not allocate memory, and there is nothing to destroy.
+//
+// All fields are private. Do not access them.
+struct ufxr_bfxr {
+    struct ufxr_bfxrpitch pitch;
+    struct ufxr_bfxrpitch initpitch;
+    ufxr_bfxrwave wave;
+    double mastervolume;
+    double sustainpunch;
+    bool hasminfrequency;
+    bool muted;
+    bool finished;
+    // Oscillator phase, in oversampled samples.
+    int phase;
+    int overtones;
+    double overtonefalloff;
+    double bitcrushfreq;
+    double bitcrushsweep;
+    double bitcrushphase;
+    double bitcrushlast;
+    double compression;
+    bool filters;
+    bool lpfilteron;
+    double lppos;
+    double lpdeltapos;
+    double lpcutoff;
+    double lpdeltacutoff;
+    double lpdamping;
+    double hppos;
+    double hpcutoff;
+    double hpdeltacutoff;
+    double vibratophase;
+    double vibratospeed;
+    double vibratoamplitude;
+    int envstage;
+    int envtime;
+    int envlength;
+    int envlengths[3];
+    int envfulllength;
+    double envinvlengths[3];
+    bool flanger;
+    double flangeroffset;
+    double flangerdeltaoffset;
+    int flangerpos;
+    int repeattime;
+    int repeatlimit;
+    // Random number state, and pink noise generator state.
+    uint32_t seed;
+    unsigned pinkkey;
+    int pinkvalues[5];
+    float noise[UFXR_BFXR_NOISE];
+    float flangerbuf[UFXR_BFXR_FLANGER];
+};
+
+// Initialize a generator for a sound. Noise waveforms are generated from the
+// seed. Returns kUFXRErrorInvalidArgument if the parameters are out of range.
+bool ufxr_bfxr_init(struct ufxr_bfxr *restrict g,
+                    const struct ufxr_bfxrparams *restrict p, uint32_t seed,
+                    struct ufxr_error *err);
+
+// Return the length of the sound, in samples.
+int ufxr_bfxr_length(const struct ufxr_bfxr *restrict g);
+
+// Generate up to n samples of audio. Returns the number of samples generated,
+// which is less than n if the sound finishes. The rest of the output is set to
+// zero.
+int ufxr_bfxr_render(struct ufxr_bfxr *restrict g, int n, float *restrict outs);
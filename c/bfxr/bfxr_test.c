@@ -0,0 +1,442 @@
+#include "c/bfxr/bfxr.h"
+#include "c/io/error.h"
+#include "c/util/defs.h"
+#include "c/util/util.h"
+
+#include <limits.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Maximum RMS error, relative to the RMS level of the sound, in dB. The
+// oscillator is evaluated in single precision, and compression raises the
+// rounding error near zero crossings.
+static const double kMaxError = -70.0;
+
+// Number of random presets rendered for each category.
+static const int kPresetCount = 20;
+
+static double ref_sine(double phase) {
+    const double pi = 4.0 * atan(1.0);
+    double x = (phase > 0.5 ? phase - 1.0 : phase) * (2.0 * pi);
+    double y = x < 0 ? 1.27323954 * x + 0.405284735 * x * x
+                     : 1.27323954 * x - 0.405284735 * x * x;
+    return y < 0 ? 0.225 * (y * y + y) + y : 0.225 * (-y * y - y) + y;
+}
+
+struct ref_pitch {
+    double period, maxperiod, slide, deltaslide, duty, dutysweep;
+    int changeperiod, changeperiodtime;
+    double amount[2];
+    int time[2], limit[2];
+    bool reached[2];
+};
+
+// Reference generator, transcribed from the C# generator one sample at a
+// time, for waveforms without noise. This is not supposed to be fast, it is
+// supposed to be obviously correct. Returns the length of the sound.
+static int reference(const struct ufxr_bfxrparams *restrict p, int n,
+                     float *restrict outs) {
+    const double pi = 4.0 * atan(1.0);
+    struct ref_pitch s = {
+        .period = 100.0 / (p->startfrequency * p->startfrequency + 0.001),
+        .maxperiod = 100.0 / (p->minfrequency * p->minfrequency + 0.001),
+        .slide = 1.0 - 0.01 * p->slide * p->slide * p->slide,
+        .deltaslide =
+            -0.000001 * p->deltaslide * p->deltaslide * p->deltaslide,
+        .changeperiod = (int)((1.1 - p->changerepeat) * (20000 / 1.1) + 32),
+    };
+    if (p->wave == kUFXRBfxrSquare) {
+        s.duty = 0.5 - 0.5 * p->squareduty;
+        s.dutysweep = -0.00005 * p->dutysweep;
+    }
+    const double amounts[2] = {p->changeamount, p->changeamount2};
+    const double speeds[2] = {p->changespeed, p->changespeed2};
+    for (int k = 0; k < 2; k++) {
+        s.amount[k] = amounts[k] > 0 ? 1.0 - 0.9 * amounts[k] * amounts[k]
+                                     : 1.0 + 10.0 * amounts[k] * amounts[k];
+        s.limit[k] = speeds[k] == 1.0
+                         ? 0
+                         : (int)(((1.0 - speeds[k]) * (1.0 - speeds[k]) *
+                                      20000 +
+                                  32) *
+                                 (1.0 - p->changerepeat + 0.1) / 1.1);
+    }
+    const struct ref_pitch init = s;
+    const double mastervolume = p->mastervolume * p->mastervolume;
+    double attack = fmax(0, p->attacktime);
+    double sustain = fmax(0.01, p->sustaintime);
+    double decay = fmax(0, p->decaytime);
+    double total = attack + sustain + decay;
+    if (total < 0.18) {
+        attack *= 0.18 / total;
+        sustain *= 0.18 / total;
+        decay *= 0.18 / total;
+    }
+    int envlen[3] = {
+        (int)(100000 * attack * attack),
+        (int)(100000 * sustain * sustain),
+        (int)(100000 * decay * decay + 10),
+    };
+    const int overtones = (int)(p->overtones * 10);
+    double bitcrushfreq = 1 - pow(p->bitcrush, 1.0 / 3.0);
+    const double bitcrushsweep = -0.000015 * p->bitcrushsweep;
+    double bitcrushphase = 0, bitcrushlast = 0;
+    const double compression = 1 / (1 + 4 * p->compression);
+    const bool filters = p->lpfiltercutoff != 1.0 || p->hpfiltercutoff != 0.0;
+    const bool lpon = p->lpfiltercutoff != 1.0;
+    double lppos = 0, lpdeltapos = 0;
+    double lpcutoff = 0.1 * p->lpfiltercutoff * p->lpfiltercutoff *
+                      p->lpfiltercutoff;
+    const double lpdelta = 1.0 + 0.0001 * p->lpfiltercutoffsweep;
+    const double lpdamping =
+        1.0 - 5.0 /
+                  (1.0 + 20 * p->lpfilterresonance * p->lpfilterresonance) *
+                  (0.01 + lpcutoff);
+    double hppos = 0, hpcutoff = 0.1 * p->hpfiltercutoff * p->hpfiltercutoff;
+    const double hpdelta = 1.0 + 0.0003 * p->hpfiltercutoffsweep;
+    double vibratophase = 0;
+    const double vibratospeed = 0.01 * p->vibratospeed * p->vibratospeed;
+    const double vibratoamp = 0.5 * p->vibratodepth;
+    const bool hasflanger = p->flangeroffset != 0.0 || p->flangersweep != 0.0;
+    double flangeroffset = 1020.0 * p->flangeroffset * p->flangeroffset *
+                           (p->flangeroffset > 0 ? 1 : -1);
+    const double flangerdelta =
+        0.2 * p->flangersweep * p->flangersweep * p->flangersweep;
+    float flangerbuf[1024] = {0};
+    int flangerpos = 0;
+    const int repeatlimit =
+        p->repeatspeed == 0.0
+            ? 0
+            : (int)((1.0 - p->repeatspeed) * (1.0 - p->repeatspeed) * 20000) +
+                  32;
+    int repeattime = 0, phase = 0, stage = 0, envtime = 0,
+        envlength = envlen[0];
+    bool muted = false, finished = false;
+    int i;
+    for (i = 0; i < n && !finished; i++) {
+        if (repeatlimit != 0 && ++repeattime >= repeatlimit) {
+            repeattime = 0;
+            s = init;
+        }
+        if (++s.changeperiodtime >= s.changeperiod) {
+            s.time[0] = s.time[1] = s.changeperiodtime = 0;
+            for (int k = 0; k < 2; k++) {
+                if (s.reached[k]) {
+                    s.period /= s.amount[k];
+                    s.reached[k] = false;
+                }
+            }
+        }
+        for (int k = 0; k < 2; k++) {
+            if (!s.reached[k] && ++s.time[k] >= s.limit[k]) {
+                s.reached[k] = true;
+                s.period *= s.amount[k];
+            }
+        }
+        s.slide += s.deltaslide;
+        s.period *= s.slide;
+        if (s.period >= s.maxperiod) {
+            s.period = s.maxperiod;
+            if (p->minfrequency > 0) {
+                muted = true;
+            }
+        }
+        double pp = s.period;
+        if (vibratoamp > 0.0) {
+            vibratophase += vibratospeed;
+            pp = s.period * (1.0 + sin(vibratophase) * vibratoamp);
+        }
+        int period = (int)pp;
+        period = period > 8 ? period : 8;
+        if (p->wave == kUFXRBfxrSquare) {
+            s.duty = fmax(0, fmin(0.5, s.duty + s.dutysweep));
+        }
+        if (++envtime >= envlength) {
+            envtime = 0;
+            stage++;
+            envlength = stage < 3 ? envlen[stage] : INT_MAX;
+        }
+        double env = 0.0;
+        switch (stage) {
+        case 0:
+            env = envtime * (1.0 / envlen[0]);
+            break;
+        case 1:
+            env = 1.0 + (1.0 - envtime * (1.0 / envlen[1])) * 2.0 *
+                            p->sustainpunch;
+            break;
+        case 2:
+            env = 1.0 - envtime * (1.0 / envlen[2]);
+            break;
+        default:
+            finished = true;
+            break;
+        }
+        int flangerint = 0;
+        if (hasflanger) {
+            flangeroffset += flangerdelta;
+            flangerint = (int)fmin(1023, fabs(flangeroffset));
+        }
+        if (filters && hpdelta != 0) {
+            hpcutoff = fmax(0.00001, fmin(0.1, hpcutoff * hpdelta));
+        }
+        double supersample = 0.0;
+        for (int j = 0; j < 8; j++) {
+            if (++phase >= period) {
+                phase -= period;
+            }
+            double sample = 0.0, strength = 1.0;
+            for (int k = 0; k <= overtones; k++) {
+                double rel = (double)(phase * (k + 1) % period) / period;
+                double x = 0.0;
+                switch (p->wave) {
+                case kUFXRBfxrSquare:
+                    x = rel < s.duty ? 0.5 : -0.5;
+                    break;
+                case kUFXRBfxrSaw:
+                    x = 1.0 - rel * 2.0;
+                    break;
+                case kUFXRBfxrSine:
+                    x = ref_sine(rel);
+                    break;
+                case kUFXRBfxrTriangle:
+                    x = fabs(1.0 - rel * 2.0) - 1.0;
+                    break;
+                case kUFXRBfxrTan:
+                    x = tan(pi * rel);
+                    break;
+                case kUFXRBfxrWhistle:
+                    x = ref_sine(rel) + 0.25 * ref_sine(fmod(20 * rel, 1.0));
+                    break;
+                case kUFXRBfxrBreaker:
+                    x = fabs(1 - 2 * rel * rel) - 1;
+                    break;
+                default:
+                    break;
+                }
+                sample += strength * x;
+                strength *= 1 - p->overtonefalloff;
+            }
+            if (filters) {
+                double old = lppos;
+                lpcutoff = fmax(0, fmin(0.1, lpcutoff * lpdelta));
+                if (lpon) {
+                    lpdeltapos =
+                        (lpdeltapos + (sample - lppos) * lpcutoff) * lpdamping;
+                } else {
+                    lppos = sample;
+                    lpdeltapos = 0;
+                }
+                lppos += lpdeltapos;
+                hppos = (hppos + lppos - old) * (1 - hpcutoff);
+                sample = hppos;
+            }
+            if (hasflanger) {
+                flangerbuf[flangerpos & 1023] = (float)sample;
+                sample +=
+                    (double)flangerbuf[(flangerpos - flangerint + 1024) & 1023];
+                flangerpos = (flangerpos + 1) & 1023;
+            }
+            supersample += sample;
+        }
+        supersample = fmax(-8.0, fmin(8.0, supersample));
+        supersample *= mastervolume * env * 0.125;
+        bitcrushphase += bitcrushfreq;
+        if (bitcrushphase > 1) {
+            bitcrushphase = 0;
+            bitcrushlast = supersample;
+        }
+        bitcrushfreq = fmax(0, fmin(1, bitcrushfreq + bitcrushsweep));
+        supersample = bitcrushlast;
+        supersample =
+            pow(fabs(supersample), compression) * (supersample > 0 ? 1 : -1);
+        outs[i] = muted ? 0.0f : (float)supersample;
+    }
+    for (int j = i; j < n; j++) {
+        outs[j] = 0.0f;
+    }
+    return i;
+}
+
+struct test_case {
+    const char *name;
+    const char *params;
+};
+
+// Parameters in the Bfxr serialized format, covering each deterministic
+// waveform and effect.
+static const struct test_case kCases[] = {
+    {"square", "0,0.5,0,0.3,0,0.4,0.3,0.3,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,"
+               "0,1,0,0,0,0,0,0"},
+    {"duty", "0,0.5,0.1,0.2,0.4,0.3,0,0.5,0,0.2,0,0,0,0,0,0,0,0,0,0,0.6,-0.4,"
+             "0,0,0,1,0,0,0,0,0,0"},
+    {"saw", "1,0.4,0,0.25,0.2,0.5,0.6,0.4,0.1,-0.3,0.2,0.3,0.5,0.3,0.2,0,0,0,"
+            "0,0,0,0,0,0,0,1,0,0,0,0,0,0"},
+    {"sine", "2,0.5,0.05,0.2,0,0.3,0.2,0.25,0,0.1,0,0.4,0.2,0,0,0,0,0,0,0,0,0,"
+             "0,0,0,1,0,0,0,0,0,0"},
+    {"triangle", "4,0.5,0,0.3,0.3,0.3,0.1,0.5,0,0,0,0,0,0,0,0.5,0.4,0.6,-0.3,"
+                 "0.7,0,0,0,0,0,1,0,0,0,0,0,0"},
+    {"tan", "6,0.3,0,0.2,0,0.2,0.5,0.6,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0.7,"
+            "0,0.4,0.1,0,0,0"},
+    {"whistle", "7,0.5,0,0.2,0,0.3,0.3,0.4,0,0.2,0,0,0,0.3,0.5,0,0,0,0,0,0,0,"
+                "0.5,0,0,1,0,0,0,0,0,0"},
+    {"breaker", "8,0.5,0,0.2,0.1,0.3,0.3,0.5,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0.3,"
+                "0.2,1,0,0,0,0,0,0"},
+    {"filters", "1,0.5,0,0.3,0,0.4,0.3,0.5,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,"
+                "0.4,0.3,0.6,0.2,-0.5,0,0"},
+    {"bitcrush", "0,0.5,0,0.3,0,0.3,0.3,0.4,0,0.3,0,0,0,0,0,0,0,0,0,0,0,0,0,0,"
+                 "0,1,0,0,0,0,0.5,-0.4"},
+    {"minfreq", "1,0.5,0,0.3,0,0.5,0.3,0.6,0.4,0.5,0,0,0,0,0,0,0,0,0,0,0,0,0,0,"
+                "0,1,0,0,0,0,0,0"},
+};
+
+static bool test_reference(const struct test_case *t) {
+    struct ufxr_bfxrparams p;
+    struct ufxr_bfxr g;
+    struct ufxr_error err;
+    if (!ufxr_bfxrparams_parse(&p, t->params, &err)) {
+        die(0, "ufxr_bfxrparams_parse");
+    }
+    if (!ufxr_bfxr_init(&g, &p, 1, &err)) {
+        die(0, "ufxr_bfxr_init");
+    }
+    const int length = ufxr_bfxr_length(&g);
+    // Render in odd sized pieces, to test state carried across calls.
+    const int n = length + 1000;
+    float *outs = xmalloc(sizeof(float) * n);
+    float *ref = xmalloc(sizeof(float) * n);
+    int count = 0, pos = 0;
+    while (pos < n) {
+        const int size = n - pos < 333 ? n - pos : 333;
+        count += ufxr_bfxr_render(&g, size, outs + pos);
+        pos += size;
+    }
+    const int refcount = reference(&p, n, ref);
+    double signal = 0.0, error = 0.0;
+    for (int i = 0; i < n; i++) {
+        const double x = ref[i], e = (double)outs[i] - x;
+        signal += x * x;
+        error += e * e;
+    }
+    const double db = 10.0 * log10(error / signal);
+    printf("%-10s length %6d, error %7.1f dB\n", t->name, count, db);
+    bool success = true;
+    if (count != refcount || count > length + 1) {
+        printf("Length mismatch: got %d, expect %d\n", count, refcount);
+        success = false;
+    }
+    if (!(db <= kMaxError)) {
+        success = false;
+    }
+    free(outs);
+    free(ref);
+    return success;
+}
+
+static bool test_parse(void) {
+    struct ufxr_bfxrparams p, def;
+    struct ufxr_error err;
+    ufxr_bfxrparams_default(&def);
+    bool success = true;
+    if (!ufxr_bfxrparams_parse(&p, "3,,0.1,5,-1", &err)) {
+        puts("Parse failed");
+        success = false;
+    } else if (p.wave != kUFXRBfxrNoise || p.mastervolume != def.mastervolume ||
+               p.attacktime != 0.1 || p.sustaintime != 1.0 ||
+               p.sustainpunch != 0.0 || p.decaytime != def.decaytime) {
+        puts("Wrong values");
+        success = false;
+    }
+    if (ufxr_bfxrparams_parse(&p, "0,0.5,abc", &err)) {
+        puts("Parse should fail");
+        success = false;
+    } else if (err.code != kUFXRErrorBadBfxr) {
+        puts("Wrong error code");
+        success = false;
+    }
+    p = def;
+    p.slide = 2.0;
+    struct ufxr_bfxr g;
+    if (ufxr_bfxr_init(&g, &p, 0, &err)) {
+        puts("Init should fail");
+        success = false;
+    }
+    return success;
+}
+
+static const char *const kPresetNames[] = {
+    "pickupcoin", "lasershoot", "explosion", "powerup",
+    "hithurt",    "jump",       "blipselect",
+};
+
+static bool test_presets(void) {
+    bool success = true;
+    for (size_t k = 0; k < ARRAY_SIZE(kPresetNames); k++) {
+        double peak = 0.0;
+        int maxlength = 0;
+        for (int seed = 0; seed < kPresetCount; seed++) {
+            struct ufxr_bfxrparams p, q;
+            struct ufxr_bfxr g;
+            struct ufxr_error err;
+            // Clear padding, so the parameters can be compared.
+            memset(&p, 0, sizeof(p));
+            memset(&q, 0, sizeof(q));
+            ufxr_bfxrparams_preset(&p, k, seed);
+            ufxr_bfxrparams_preset(&q, k, seed);
+            if (memcmp(&p, &q, sizeof(p)) != 0) {
+                printf("%s %d: not deterministic\n", kPresetNames[k], seed);
+                success = false;
+            }
+            if (!ufxr_bfxr_init(&g, &p, seed, &err)) {
+                printf("%s %d: invalid parameters\n", kPresetNames[k], seed);
+                success = false;
+                continue;
+            }
+            const int length = ufxr_bfxr_length(&g);
+            float *outs = xmalloc(sizeof(float) * length);
+            const int count = ufxr_bfxr_render(&g, length, outs);
+            for (int i = 0; i < count; i++) {
+                const double x = fabs((double)outs[i]);
+                if (!isfinite(x)) {
+                    printf("%s %d: not finite\n", kPresetNames[k], seed);
+                    success = false;
+                    break;
+                }
+                peak = x > peak ? x : peak;
+            }
+            maxlength = count > maxlength ? count : maxlength;
+            free(outs);
+        }
+        printf("%-10s peak %.3f, max length %d\n", kPresetNames[k], peak,
+               maxlength);
+    }
+    return success;
+}
+
+int main(int argc, char **argv) {
+    (void)argc;
+    (void)argv;
+    bool success = true;
+    puts("Testing: bfxr");
+    for (size_t i = 0; i < ARRAY_SIZE(kCases); i++) {
+        if (!test_reference(&kCases[i])) {
+            puts("****FAIL****");
+            success = false;
+        }
+    }
+    if (!test_parse()) {
+        puts("****FAIL****");
+        success = false;
+    }
+    if (!test_presets()) {
+        puts("****FAIL****");
+        success = false;
+    }
+    if (!success) {
+        puts("****FAIL****");
+        exit(1);
+    }
+    return 0;
+}
@@ -0,0 +1,181 @@
+#include "c/bfxr/bfxr.h"
+#include "c/io/error.h"
+#include "c/io/wave.h"
+#include "c/util/defs.h"
+#include "c/util/flag.h"
+#include "c/util/util.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static const char *const kPresetNames[] = {
+    [kUFXRBfxrPickupCoin] = "pickupcoin", [kUFXRBfxrLaserShoot] = "lasershoot",
+    [kUFXRBfxrExplosion] = "explosion",   [kUFXRBfxrPowerup] = "powerup",
+    [kUFXRBfxrHitHurt] = "hithurt",       [kUFXRBfxrJump] = "jump",
+    [kUFXRBfxrBlipSelect] = "blipselect",
+};
+
+static void help(const char *name) {
+    xprintf(stdout, "\nUsage: %s [<option>...]\n", name);
+    xputs(stdout,
+          "\n"
+          "Render a Bfxr sound from a parameter file, or a batch of random\n"
+          "sounds from a preset.\n"
+          "\n"
+          "Options:\n"
+          "  -in <file>       Read serialized Bfxr parameters from <file>\n"
+          "  -preset <name>   Generate random parameters from a preset:\n"
+          "                   pickupcoin, lasershoot, explosion, powerup,\n"
+          "                   hithurt, jump, or blipselect\n"
+          "  -count <count>   Number of random sounds to render\n"
+          "  -seed <seed>     Seed for the first random sound\n"
+          "  -out <path>      Output wave file, or output directory if count\n"
+          "                   is more than 1\n"
+          "  -bits <bits>     Bits per sample: 8, 16, 24, or 32\n");
+}
+
+// Render a sound and write it to a wave file, if a path is given. Returns the
+// length of the sound, in samples.
+static int render(const struct ufxr_bfxrparams *restrict p, uint32_t seed,
+                  ufxr_format format, const char *path, float **buffer,
+                  int *buffer_size) {
+    struct ufxr_bfxr g;
+    struct ufxr_error err;
+    if (!ufxr_bfxr_init(&g, p, seed, &err)) {
+        die(0, "invalid Bfxr parameters");
+    }
+    const int length = ufxr_bfxr_length(&g);
+    if (length > *buffer_size) {
+        free(*buffer);
+        *buffer = xmalloc(sizeof(float) * length);
+        *buffer_size = length;
+    }
+    const int count = ufxr_bfxr_render(&g, length, *buffer);
+    if (path != NULL) {
+        struct ufxr_wavewriter w;
+        const struct ufxr_waveinfo info = {
+            .samplerate = UFXR_BFXR_SAMPLERATE,
+            .channels = 1,
+            .format = format,
+            .length = count,
+        };
+        if (!ufxr_wavewriter_create(&w, path, &info, &err)) {
+            dief(0, "could not create %s", quote_str(path));
+        }
+        if (!ufxr_wavewriter_write(&w, *buffer, count, &err) ||
+            !ufxr_wavewriter_finish(&w, &err)) {
+            dief(0, "could not write %s", quote_str(path));
+        }
+        ufxr_wavewriter_destroy(&w);
+    }
+    return count;
+}
+
+int main(int argc, char **argv) {
+    const char *inpath = NULL;
+    const char *preset = NULL;
+    const char *outpath = NULL;
+    int count = 1;
+    int seed = 0;
+    int bits = 16;
+    flag_string(&inpath, "in", "input parameter file");
+    flag_string(&preset, "preset", "random preset");
+    flag_int(&count, "count", "number of sounds");
+    flag_int(&seed, "seed", "random seed");
+    flag_string(&outpath, "out", "output file or directory");
+    flag_int(&bits, "bits", "bits per sample");
+    argc = flag_parse(argc, argv);
+    if (argc != 0) {
+        if (strcmp(argv[0], "help") == 0) {
+            help("bfxrrun");
+            return 0;
+        }
+        die_usagef("unexpected argument %s", quote_str(argv[0]));
+    }
+    if ((inpath == NULL) == (preset == NULL)) {
+        die_usage("exactly one of -in and -preset is required");
+    }
+    if (count < 1) {
+        die_usagef("invalid count %d", count);
+    }
+    if (inpath != NULL && count != 1) {
+        die_usage("-count cannot be used with -in");
+    }
+    ufxr_format format;
+    switch (bits) {
+    case 8:
+        format = kUFXRFormatU8;
+        break;
+    case 16:
+        format = kUFXRFormatS16;
+        break;
+    case 24:
+        format = kUFXRFormatS24;
+        break;
+    case 32:
+        format = kUFXRFormatF32;
+        break;
+    default:
+        die_usagef("unsupported bits per sample %d (must be 8, 16, 24, or 32)",
+                   bits);
+    }
+
+    struct ufxr_bfxrparams p;
+    float *buffer = NULL;
+    int buffer_size = 0;
+    if (inpath != NULL) {
+        struct data data = {0};
+        read_file(&data, inpath);
+        data.ptr = xrealloc(data.ptr, data.size + 1);
+        ((char *)data.ptr)[data.size] = '\0';
+        struct ufxr_error err;
+        if (!ufxr_bfxrparams_parse(&p, data.ptr, &err)) {
+            dief(0, "could not parse %s", quote_str(inpath));
+        }
+        free(data.ptr);
+        const int length = render(&p, seed, format, outpath, &buffer,
+                                  &buffer_size);
+        printf("Length: %.3f s\n", (double)length / UFXR_BFXR_SAMPLERATE);
+        free(buffer);
+        return 0;
+    }
+
+    ufxr_bfxrpreset kind = 0;
+    bool found = false;
+    for (size_t i = 0; i < ARRAY_SIZE(kPresetNames); i++) {
+        if (strcmp(kPresetNames[i], preset) == 0) {
+            kind = i;
+            found = true;
+        }
+    }
+    if (!found) {
+        die_usagef("unknown preset %s", quote_str(preset));
+    }
+
+    // Render the batch. When there is no output, this only measures the
+    // speed of the generator.
+    double samples = 0.0, seconds = 0.0;
+    for (int i = 0; i < count; i++) {
+        const uint32_t s = (uint32_t)seed + i;
+        char path[1024];
+        const char *out = outpath;
+        if (outpath != NULL && count > 1) {
+            xsprintf(path, sizeof(path), "%s/%s_%d.wav", outpath, preset,
+                     seed + i);
+            out = path;
+        }
+        ufxr_bfxrparams_preset(&p, kind, s);
+        struct timespec t0, t1;
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        samples += render(&p, s, format, out, &buffer, &buffer_size);
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        seconds += (t1.tv_sec - t0.tv_sec) + 1e-9 * (t1.tv_nsec - t0.tv_nsec);
+    }
+    const double duration = samples / UFXR_BFXR_SAMPLERATE;
+    printf("Rendered %d sounds, %.1f s of audio in %.3f s (%.0fx real time)\n",
+           count, duration, seconds, duration / seconds);
+    free(buffer);
+    return 0;
+}
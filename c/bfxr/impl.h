@@ -0,0 +1,28 @@
+// c/bfxr/impl.h - Definitions for the Bfxr implementation.
+#pragma once
+
+#include "c/config/config.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+struct ufxr_bfxrparams;
+
+// Return true if all parameters are within their ranges.
+bool ufxr_bfxrparams_valid(const struct ufxr_bfxrparams *restrict p);
+
+// Scramble a seed, so nearby seeds give unrelated random numbers.
+inline uint32_t ufxr_bfxr_hash(uint32_t x) {
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return x;
+}
+
+// Return a random number in [0, 1) and advance the random number state.
+inline double ufxr_bfxr_random(uint32_t *seed) {
+    *seed = *seed * 1664525u + 1013904223u;
+    return (double)(*seed >> 8) * (1.0 / 16777216.0);
+}
@@ -0,0 +1,345 @@
+// params.c - Bfxr parameters and presets.
+#include "c/bfxr/bfxr.h"
+
+#include "c/bfxr/impl.h"
+#include "c/io/error.h"
+#include "c/util/defs.h"
+
+#include <ctype.h>
+#include <stddef.h>
+#include <stdlib.h>
+
+// Instantiate inline functions.
+uint32_t ufxr_bfxr_hash(uint32_t x);
+double ufxr_bfxr_random(uint32_t *seed);
+
+// A continuous parameter, in serialized order.
+struct bfxr_paraminfo {
+    size_t offset;
+    double init;
+    double min;
+    double max;
+};
+
+#define P(field, init, min, max) \
+    { offsetof(struct ufxr_bfxrparams, field), init, min, max }
+// clang-format off
+static const struct bfxr_paraminfo kParams[] = {
+    P(mastervolume, 0.5, 0.0, 1.0),
+    P(attacktime, 0.0, 0.0, 1.0),
+    P(sustaintime, 0.3, 0.0, 1.0),
+    P(sustainpunch, 0.0, 0.0, 1.0),
+    P(decaytime, 0.4, 0.0, 1.0),
+    P(compression, 0.3, 0.0, 1.0),
+    P(startfrequency, 0.3, 0.0, 1.0),
+    P(minfrequency, 0.0, 0.0, 1.0),
+    P(slide, 0.0, -1.0, 1.0),
+    P(deltaslide, 0.0, -1.0, 1.0),
+    P(vibratodepth, 0.0, 0.0, 1.0),
+    P(vibratospeed, 0.0, 0.0, 1.0),
+    P(overtones, 0.0, 0.0, 1.0),
+    P(overtonefalloff, 0.0, 0.0, 1.0),
+    P(changerepeat, 0.0, 0.0, 1.0),
+    P(changeamount, 0.0, -1.0, 1.0),
+    P(changespeed, 0.0, 0.0, 1.0),
+    P(changeamount2, 0.0, -1.0, 1.0),
+    P(changespeed2, 0.0, 0.0, 1.0),
+    P(squareduty, 0.0, 0.0, 1.0),
+    P(dutysweep, 0.0, -1.0, 1.0),
+    P(repeatspeed, 0.0, 0.0, 1.0),
+    P(flangeroffset, 0.0, -1.0, 1.0),
+    P(flangersweep, 0.0, -1.0, 1.0),
+    P(lpfiltercutoff, 1.0, 0.0, 1.0),
+    P(lpfiltercutoffsweep, 0.0, -1.0, 1.0),
+    P(lpfilterresonance, 0.0, 0.0, 1.0),
+    P(hpfiltercutoff, 0.0, 0.0, 1.0),
+    P(hpfiltercutoffsweep, 0.0, -1.0, 1.0),
+    P(bitcrush, 0.0, 0.0, 1.0),
+    P(bitcrushsweep, 0.0, -1.0, 1.0),
+};
+// clang-format on
+#undef P
+
+static inline double *bfxr_field(struct ufxr_bfxrparams *restrict p,
+                                 const struct bfxr_paraminfo *info) {
+    return (double *)((char *)p + info->offset);
+}
+
+bool ufxr_bfxrparams_valid(const struct ufxr_bfxrparams *restrict p) {
+    if (p->wave < kUFXRBfxrSquare || p->wave > kUFXRBfxrBreaker) {
+        return false;
+    }
+    for (size_t i = 0; i < ARRAY_SIZE(kParams); i++) {
+        const struct bfxr_paraminfo *info = &kParams[i];
+        const double value =
+            *(const double *)((const char *)p + info->offset);
+        if (!(value >= info->min && value <= info->max)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void ufxr_bfxrparams_default(struct ufxr_bfxrparams *restrict p) {
+    p->wave = kUFXRBfxrSquare;
+    for (size_t i = 0; i < ARRAY_SIZE(kParams); i++) {
+        *bfxr_field(p, &kParams[i]) = kParams[i].init;
+    }
+}
+
+// Parse one comma-separated value. Returns false if the value is not a number.
+// Sets empty to true if the value is empty. Advances the text pointer past the
+// comma.
+static bool bfxr_parsevalue(const char **text, double *value, bool *empty) {
+    const char *ptr = *text;
+    while (*ptr == ' ' || *ptr == '\t') {
+        ptr++;
+    }
+    bool ok = true;
+    *empty = *ptr == ',' || *ptr == '\0' || *ptr == '\r' || *ptr == '\n';
+    if (!*empty) {
+        char *end;
+        *value = strtod(ptr, &end);
+        ok = end != ptr;
+        ptr = end;
+        while (isspace((unsigned char)*ptr)) {
+            ptr++;
+        }
+        ok = ok && (*ptr == ',' || *ptr == '\0');
+    }
+    while (*ptr != ',' && *ptr != '\0') {
+        ptr++;
+    }
+    if (*ptr == ',') {
+        ptr++;
+    }
+    *text = ptr;
+    return ok;
+}
+
+bool ufxr_bfxrparams_parse(struct ufxr_bfxrparams *restrict p,
+                           const char *text, struct ufxr_error *err) {
+    ufxr_bfxrparams_default(p);
+    double value;
+    bool empty;
+    if (!bfxr_parsevalue(&text, &value, &empty)) {
+        ufxr_error_setcode(err, kUFXRErrorBadBfxr);
+        return false;
+    }
+    if (!empty) {
+        int wave = value > 0.0 ? (int)(value < 8.0 ? value : 8.0) : 0;
+        p->wave = (ufxr_bfxrwave)wave;
+    }
+    for (size_t i = 0; i < ARRAY_SIZE(kParams) && *text != '\0'; i++) {
+        const struct bfxr_paraminfo *info = &kParams[i];
+        if (!bfxr_parsevalue(&text, &value, &empty)) {
+            ufxr_error_setcode(err, kUFXRErrorBadBfxr);
+            return false;
+        }
+        if (!empty) {
+            value = value > info->min ? value : info->min;
+            value = value < info->max ? value : info->max;
+            *bfxr_field(p, info) = value;
+        }
+    }
+    return true;
+}
+
+// Return a random number in [min, max).
+static double bfxr_uniform(uint32_t *seed, double min, double max) {
+    return min + ufxr_bfxr_random(seed) * (max - min);
+}
+
+// Return a random integer in [min, max).
+static int bfxr_int(uint32_t *seed, int min, int max) {
+    return min + (int)(ufxr_bfxr_random(seed) * (max - min));
+}
+
+// Return true with the given probability.
+static bool bfxr_chance(uint32_t *seed, double probability) {
+    return ufxr_bfxr_random(seed) < probability;
+}
+
+static void bfxr_pickupcoin(struct ufxr_bfxrparams *restrict p,
+                            uint32_t *seed) {
+    p->startfrequency = bfxr_uniform(seed, 0.4, 0.9);
+    p->sustaintime = bfxr_uniform(seed, 0.0, 0.1);
+    p->decaytime = bfxr_uniform(seed, 0.1, 0.5);
+    p->sustainpunch = bfxr_uniform(seed, 0.3, 0.6);
+    if (bfxr_chance(seed, 0.5)) {
+        p->changespeed = bfxr_uniform(seed, 0.5, 0.7);
+        int numer = bfxr_int(seed, 1, 8);
+        int denom = numer + bfxr_int(seed, 2, 9);
+        p->changeamount = (double)numer / (double)denom;
+    }
+}
+
+static void bfxr_lasershoot(struct ufxr_bfxrparams *restrict p,
+                            uint32_t *seed) {
+    static const ufxr_bfxrwave kWaves[] = {
+        kUFXRBfxrSquare,
+        kUFXRBfxrSaw,
+        kUFXRBfxrSine,
+    };
+    p->wave = kWaves[bfxr_int(seed, 0, 12) / 5];
+    p->startfrequency = bfxr_uniform(seed, 0.5, 1.0);
+    const double minfrequency =
+        p->startfrequency - bfxr_uniform(seed, 0.2, 0.8);
+    p->minfrequency = minfrequency > 0.2 ? minfrequency : 0.2;
+    p->slide = bfxr_uniform(seed, -0.35, -0.15);
+    if (bfxr_chance(seed, 0.33)) {
+        p->startfrequency = bfxr_uniform(seed, 0.0, 0.6);
+        p->minfrequency = bfxr_uniform(seed, 0.0, 0.1);
+        p->slide = bfxr_uniform(seed, -0.65, -0.35);
+    }
+    if (p->wave == kUFXRBfxrSquare) {
+        if (bfxr_chance(seed, 0.5)) {
+            p->squareduty = bfxr_uniform(seed, 0.0, 0.5);
+            p->dutysweep = bfxr_uniform(seed, 0.0, 0.2);
+        } else {
+            p->squareduty = bfxr_uniform(seed, 0.4, 0.9);
+            p->dutysweep = bfxr_uniform(seed, -0.7, 0.0);
+        }
+    }
+    p->sustaintime = bfxr_uniform(seed, 0.1, 0.3);
+    p->decaytime = bfxr_uniform(seed, 0.0, 0.4);
+    if (bfxr_chance(seed, 0.5)) {
+        p->sustainpunch = bfxr_uniform(seed, 0.0, 0.3);
+    }
+    if (bfxr_chance(seed, 0.33)) {
+        p->flangeroffset = bfxr_uniform(seed, 0.0, 0.2);
+        p->flangersweep = bfxr_uniform(seed, -0.2, 0.0);
+    }
+    if (bfxr_chance(seed, 0.5)) {
+        p->hpfiltercutoff = bfxr_uniform(seed, 0.0, 0.3);
+    }
+}
+
+static void bfxr_explosion(struct ufxr_bfxrparams *restrict p,
+                           uint32_t *seed) {
+    p->wave = kUFXRBfxrNoise;
+    if (bfxr_chance(seed, 0.5)) {
+        p->startfrequency = bfxr_uniform(seed, 0.1, 0.4);
+        p->slide = bfxr_uniform(seed, -0.5, -0.1);
+    } else {
+        p->startfrequency = bfxr_uniform(seed, 0.2, 0.7);
+        p->slide = bfxr_uniform(seed, -0.4, -0.2);
+    }
+    p->startfrequency *= p->startfrequency;
+    if (bfxr_chance(seed, 0.2)) {
+        p->slide = 0.0;
+    }
+    if (bfxr_chance(seed, 0.33)) {
+        p->repeatspeed = bfxr_uniform(seed, 0.3, 0.8);
+    }
+    p->sustaintime = bfxr_uniform(seed, 0.1, 0.4);
+    p->decaytime = bfxr_uniform(seed, 0.0, 0.5);
+    p->sustainpunch = bfxr_uniform(seed, 0.2, 0.8);
+    if (bfxr_chance(seed, 0.5)) {
+        p->flangeroffset = bfxr_uniform(seed, -0.3, 0.6);
+        p->flangersweep = bfxr_uniform(seed, -0.3, 0.0);
+    }
+    if (bfxr_chance(seed, 0.33)) {
+        p->changespeed = bfxr_uniform(seed, 0.6, 0.9);
+        p->changeamount = bfxr_uniform(seed, -0.8, 0.8);
+    }
+}
+
+// The remaining presets are not finished in the C# generator. These follow
+// the original sfxr generators.
+
+static void bfxr_powerup(struct ufxr_bfxrparams *restrict p, uint32_t *seed) {
+    if (bfxr_chance(seed, 0.5)) {
+        p->wave = kUFXRBfxrSaw;
+    } else {
+        p->squareduty = bfxr_uniform(seed, 0.0, 0.6);
+    }
+    p->startfrequency = bfxr_uniform(seed, 0.2, 0.5);
+    if (bfxr_chance(seed, 0.5)) {
+        p->slide = bfxr_uniform(seed, 0.1, 0.5);
+        p->repeatspeed = bfxr_uniform(seed, 0.4, 0.8);
+    } else {
+        p->slide = bfxr_uniform(seed, 0.05, 0.25);
+        if (bfxr_chance(seed, 0.5)) {
+            p->vibratodepth = bfxr_uniform(seed, 0.0, 0.7);
+            p->vibratospeed = bfxr_uniform(seed, 0.0, 0.6);
+        }
+    }
+    p->sustaintime = bfxr_uniform(seed, 0.0, 0.4);
+    p->decaytime = bfxr_uniform(seed, 0.1, 0.5);
+}
+
+static void bfxr_hithurt(struct ufxr_bfxrparams *restrict p, uint32_t *seed) {
+    static const ufxr_bfxrwave kWaves[] = {
+        kUFXRBfxrSquare,
+        kUFXRBfxrSaw,
+        kUFXRBfxrNoise,
+    };
+    p->wave = kWaves[bfxr_int(seed, 0, 3)];
+    if (p->wave == kUFXRBfxrSquare) {
+        p->squareduty = bfxr_uniform(seed, 0.0, 0.6);
+    }
+    p->startfrequency = bfxr_uniform(seed, 0.2, 0.8);
+    p->slide = bfxr_uniform(seed, -0.7, -0.3);
+    p->sustaintime = bfxr_uniform(seed, 0.0, 0.1);
+    p->decaytime = bfxr_uniform(seed, 0.1, 0.3);
+    if (bfxr_chance(seed, 0.5)) {
+        p->hpfiltercutoff = bfxr_uniform(seed, 0.0, 0.3);
+    }
+}
+
+static void bfxr_jump(struct ufxr_bfxrparams *restrict p, uint32_t *seed) {
+    p->squareduty = bfxr_uniform(seed, 0.0, 0.6);
+    p->startfrequency = bfxr_uniform(seed, 0.3, 0.6);
+    p->slide = bfxr_uniform(seed, 0.1, 0.3);
+    p->sustaintime = bfxr_uniform(seed, 0.1, 0.4);
+    p->decaytime = bfxr_uniform(seed, 0.1, 0.3);
+    if (bfxr_chance(seed, 0.5)) {
+        p->hpfiltercutoff = bfxr_uniform(seed, 0.0, 0.3);
+    }
+    if (bfxr_chance(seed, 0.5)) {
+        p->lpfiltercutoff = bfxr_uniform(seed, 0.4, 1.0);
+    }
+}
+
+static void bfxr_blipselect(struct ufxr_bfxrparams *restrict p,
+                            uint32_t *seed) {
+    if (bfxr_chance(seed, 0.5)) {
+        p->wave = kUFXRBfxrSaw;
+    } else {
+        p->squareduty = bfxr_uniform(seed, 0.0, 0.6);
+    }
+    p->startfrequency = bfxr_uniform(seed, 0.2, 0.6);
+    p->sustaintime = bfxr_uniform(seed, 0.1, 0.2);
+    p->decaytime = bfxr_uniform(seed, 0.0, 0.2);
+    p->hpfiltercutoff = 0.1;
+}
+
+void ufxr_bfxrparams_preset(struct ufxr_bfxrparams *restrict p,
+                            ufxr_bfxrpreset preset, uint32_t seed) {
+    ufxr_bfxrparams_default(p);
+    seed = ufxr_bfxr_hash(seed);
+    switch (preset) {
+    case kUFXRBfxrPickupCoin:
+        bfxr_pickupcoin(p, &seed);
+        break;
+    case kUFXRBfxrLaserShoot:
+        bfxr_lasershoot(p, &seed);
+        break;
+    case kUFXRBfxrExplosion:
+        bfxr_explosion(p, &seed);
+        break;
+    case kUFXRBfxrPowerup:
+        bfxr_powerup(p, &seed);
+        break;
+    case kUFXRBfxrHitHurt:
+        bfxr_hithurt(p, &seed);
+        break;
+    case kUFXRBfxrJump:
+        bfxr_jump(p, &seed);
+        break;
+    case kUFXRBfxrBlipSelect:
+        bfxr_blipselect(p, &seed);
+        break;
+    }
+}
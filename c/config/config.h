@@ -1,6 +1,10 @@
 #if !USE_SCALAR
 
 #define USE_SSE2 __SSE2__
+#define USE_SSSE3 __SSSE3__
 #define USE_SSE4_1 __SSE4_1__
+#define USE_AVX __AVX__
+#define USE_AVX2 __AVX2__
+#define USE_F16C __F16C__
 
 #endif
\ No newline at end of file
@@ -1,7 +1,10 @@
 // c/ops/convert.h - Sample type conversions.
+#pragma once
 
-// These functions convert aligned floating-point data to and from various
-// unaligned types.
+#include <stdint.h>
+
+// These functions convert aligned floating-point data to various unaligned
+// types.
 
 // Quantize to unsigned 8-bit integer.
 void ufxr_to_u8(int n, void *restrict out, const float *restrict xs);
@@ -14,3 +17,96 @@ void ufxr_to_les24(int n, void *restrict out, const float *restrict xs);
 
 // Convert to 32-bit little-endian float.
 void ufxr_to_lef32(int n, void *restrict out, const float *restrict xs);
+
+// These functions convert unaligned data in various types to floating-point.
+// The output must be aligned to UFXR_ALIGN, as for the functions in
+// c/ops/ops.h, but n does not need to be a multiple of UFXR_QUANTUM.
+
+// Convert from unsigned 8-bit integer.
+void ufxr_from_u8(int n, float *restrict outs, const void *restrict data);
+
+// Convert from signed 16-bit little-endian integer.
+void ufxr_from_les16(int n, float *restrict outs, const void *restrict data);
+
+// Convert from signed 24-bit little-endian integer.
+void ufxr_from_les24(int n, float *restrict outs, const void *restrict data);
+
+// Convert from 32-bit little-endian float.
+void ufxr_from_lef32(int n, float *restrict outs, const void *restrict data);
+
+// These functions convert planar stereo to interleaved stereo. The input is
+// two arrays of n samples, one per channel, which do not need to be aligned.
+// The output is n frames.
+
+// Quantize stereo to unsigned 8-bit integer.
+void ufxr_to_u8_stereo(int n, void *restrict out, const float *restrict xs0,
+                       const float *restrict xs1);
+
+// Quantize stereo to signed 16-bit little-endian integer.
+void ufxr_to_les16_stereo(int n, void *restrict out, const float *restrict xs0,
+                          const float *restrict xs1);
+
+// Quantize stereo to signed 24-bit little-endian integer.
+void ufxr_to_les24_stereo(int n, void *restrict out, const float *restrict xs0,
+                          const float *restrict xs1);
+
+// Convert stereo to 32-bit little-endian float.
+void ufxr_to_lef32_stereo(int n, void *restrict out, const float *restrict xs0,
+                          const float *restrict xs1);
+
+// Dither added when quantizing.
+typedef enum {
+    // Round to nearest, without dither.
+    kUFXRDitherNone,
+    // Triangular (TPDF) dither, 2 LSB peak to peak. This makes the
+    // quantization error independent of the signal, at the cost of raising
+    // the noise floor by 4.8 dB.
+    kUFXRDitherTPDF,
+    // TPDF dither with second-order noise shaping. The quantization error is
+    // fed back through the filter 1 - 2z^-1 + z^-2, which moves the noise
+    // away from low frequencies, where it is most audible, towards Nyquist.
+    kUFXRDitherShaped,
+} ufxr_dithermode;
+
+// State for quantizing one stream of interleaved audio with dither.
+//
+// All fields are private. Do not access them.
+struct ufxr_dither {
+    // Random number generator state, one for each SIMD lane.
+    uint32_t seed[8];
+    ufxr_dithermode mode;
+    int channels;
+    // Channel of the next sample.
+    int channel;
+    // Previous two quantization errors for each channel, in LSB.
+    float error[2][2];
+};
+
+// Initialize dither state for audio with 1 or 2 channels. The same seed always
+// produces the same output.
+void ufxr_dither_init(struct ufxr_dither *restrict d, ufxr_dithermode mode,
+                      int channels, uint32_t seed);
+
+// Quantize to unsigned 8-bit integer, with dither. Successive calls continue
+// the same stream.
+void ufxr_to_u8_dither(int n, void *restrict out, const float *restrict xs,
+                       struct ufxr_dither *restrict d);
+
+// Quantize to signed 16-bit little-endian integer, with dither. Successive
+// calls continue the same stream.
+void ufxr_to_les16_dither(int n, void *restrict out, const float *restrict xs,
+                          struct ufxr_dither *restrict d);
+
+// Quantize stereo to unsigned 8-bit integer, with dither. The dither state
+// must be for 2 channels.
+void ufxr_to_u8_dither_stereo(int n, void *restrict out,
+                              const float *restrict xs0,
+                              const float *restrict xs1,
+                              struct ufxr_dither *restrict d);
+
+// Quantize stereo to signed 16-bit little-endian integer, with dither. The
+// dither state must be for 2 channels.
+void ufxr_to_les16_dither_stereo(int n, void *restrict out,
+                                 const float *restrict xs0,
+                                 const float *restrict xs1,
+                                 struct ufxr_dither *restrict d);
@@ -0,0 +1,479 @@
+#include "c/convert/convert.h"
+#include "c/util/defs.h"
+#include "c/util/util.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+enum {
+    // Largest array tested. Sizes from 0 up to this are all tested, so every
+    // combination of head, body, and tail is covered.
+    kMaxSize = 100,
+    // Input arrays are tested at every offset up to this many floats, so the
+    // input is not always aligned.
+    kMaxOffset = 8,
+    // Bytes after the output which must not be written.
+    kGuard = 32,
+};
+
+// Reference quantizer. This is not supposed to be fast, it is supposed to be
+// obviously correct.
+static long quantize(float x, float scale, float offset, long min, long max) {
+    float y = x * scale + offset;
+    if (!(y > (float)min)) {
+        return min;
+    }
+    if (!(y < (float)max)) {
+        return max;
+    }
+    return lrintf(y);
+}
+
+static void ref_u8(int n, unsigned char *restrict out,
+                   const float *restrict xs) {
+    for (int i = 0; i < n; i++) {
+        out[i] = quantize(xs[i], 128.0f, 128.0f, 0, 255);
+    }
+}
+
+static void ref_les16(int n, unsigned char *restrict out,
+                      const float *restrict xs) {
+    for (int i = 0; i < n; i++) {
+        long y = quantize(xs[i], 32768.0f, 0.0f, -32768, 32767);
+        out[i * 2] = y;
+        out[i * 2 + 1] = y >> 8;
+    }
+}
+
+static void ref_les24(int n, unsigned char *restrict out,
+                      const float *restrict xs) {
+    for (int i = 0; i < n; i++) {
+        long y = quantize(xs[i], 8388608.0f, 0.0f, -8388608, 8388607);
+        out[i * 3] = y;
+        out[i * 3 + 1] = y >> 8;
+        out[i * 3 + 2] = y >> 16;
+    }
+}
+
+static void ref_lef32(int n, unsigned char *restrict out,
+                      const float *restrict xs) {
+    for (int i = 0; i < n; i++) {
+        unsigned u;
+        memcpy(&u, &xs[i], 4);
+        for (int j = 0; j < 4; j++) {
+            out[i * 4 + j] = u >> (8 * j);
+        }
+    }
+}
+
+struct test_info {
+    const char *name;
+    int size;
+    void (*func)(int n, void *restrict out, const float *restrict xs);
+    void (*ref)(int n, unsigned char *restrict out, const float *restrict xs);
+    void (*stereo)(int n, void *restrict out, const float *restrict xs0,
+                   const float *restrict xs1);
+};
+
+static const struct test_info kTests[] = {
+    {"to_u8", 1, ufxr_to_u8, ref_u8, ufxr_to_u8_stereo},
+    {"to_les16", 2, ufxr_to_les16, ref_les16, ufxr_to_les16_stereo},
+    {"to_les24", 3, ufxr_to_les24, ref_les24, ufxr_to_les24_stereo},
+    {"to_lef32", 4, ufxr_to_lef32, ref_lef32, ufxr_to_lef32_stereo},
+};
+
+// Fill an array with test input: values out of range, values at the limits,
+// values halfway between output steps, and random values.
+static void fill_input(int n, float *xs) {
+    static const float kSpecial[] = {
+        0.0f,   -0.0f,  1.0f,         -1.0f, 2.0f, -2.0f, 1e10f, -1e10f,
+        0.5f,   -0.5f,  0.999999f,    1.0f / 256.0f,  -1.0f / 256.0f,
+        1.5f / 256.0f, 0.5f / 32768.0f, -0.5f / 32768.0f, 1.5f / 32768.0f,
+        0.5f / 8388608.0f, 2.5f / 8388608.0f,
+    };
+    unsigned state = 1;
+    for (int i = 0; i < n; i++) {
+        state = state * 1103515245u + 12345u;
+        if ((state >> 28) < 4) {
+            xs[i] = kSpecial[(state >> 8) % ARRAY_SIZE(kSpecial)];
+        } else {
+            xs[i] = (float)(state >> 8) * (3.0f / 16777216.0f) - 1.5f;
+        }
+    }
+}
+
+static bool test_to(const struct test_info *t) {
+    float *xs = xmalloc(sizeof(float) * (kMaxSize + kMaxOffset));
+    const size_t outsize = (size_t)t->size * kMaxSize + kGuard;
+    unsigned char *out = xmalloc(outsize + 1);
+    unsigned char *ref = xmalloc(outsize);
+    fill_input(kMaxSize + kMaxOffset, xs);
+    int failures = 0;
+    for (int offset = 0; offset < kMaxOffset; offset++) {
+        for (int n = 0; n <= kMaxSize; n++) {
+            // Also test unaligned output.
+            for (int oofs = 0; oofs < 2; oofs++) {
+                const size_t len = (size_t)t->size * n;
+                memset(out, 0xa5, outsize + 1);
+                memset(ref, 0xa5, outsize);
+                t->func(n, out + oofs, xs + offset);
+                t->ref(n, ref, xs + offset);
+                bool ok = out[0] == 0xa5 || oofs == 0;
+                ok = ok && memcmp(out + oofs, ref, len) == 0;
+                for (size_t i = len; i < len + kGuard; i++) {
+                    ok = ok && out[oofs + i] == 0xa5;
+                }
+                if (!ok) {
+                    if (failures < 10) {
+                        printf("%s: size %d, input offset %d, output offset "
+                               "%d: incorrect output\n",
+                               t->name, n, offset, oofs);
+                    }
+                    failures++;
+                }
+            }
+        }
+    }
+    printf("%s: %d failures\n", t->name, failures);
+    free(xs);
+    free(out);
+    free(ref);
+    return failures == 0;
+}
+
+// Test the stereo version against the reference, applied to interleaved
+// input. The two channels are at different offsets.
+static bool test_to_stereo(const struct test_info *t) {
+    float *xs = xmalloc(sizeof(float) * (kMaxSize * 2 + kMaxOffset));
+    float *inter = xmalloc(sizeof(float) * kMaxSize * 2);
+    const size_t outsize = (size_t)t->size * kMaxSize * 2 + kGuard;
+    unsigned char *out = xmalloc(outsize);
+    unsigned char *ref = xmalloc(outsize);
+    fill_input(kMaxSize * 2 + kMaxOffset, xs);
+    int failures = 0;
+    for (int offset = 0; offset < kMaxOffset; offset++) {
+        const float *xs0 = xs + offset, *xs1 = xs + kMaxSize + 1;
+        for (int n = 0; n <= kMaxSize; n++) {
+            const size_t len = (size_t)t->size * n * 2;
+            for (int i = 0; i < n; i++) {
+                inter[i * 2] = xs0[i];
+                inter[i * 2 + 1] = xs1[i];
+            }
+            memset(out, 0xa5, outsize);
+            memset(ref, 0xa5, outsize);
+            t->stereo(n, out, xs0, xs1);
+            t->ref(n * 2, ref, inter);
+            bool ok = memcmp(out, ref, len) == 0;
+            for (size_t i = len; i < len + kGuard; i++) {
+                ok = ok && out[i] == 0xa5;
+            }
+            if (!ok) {
+                if (failures < 10) {
+                    printf("%s_stereo: size %d, input offset %d: incorrect "
+                           "output\n",
+                           t->name, n, offset);
+                }
+                failures++;
+            }
+        }
+    }
+    printf("%s_stereo: %d failures\n", t->name, failures);
+    free(xs);
+    free(inter);
+    free(out);
+    free(ref);
+    return failures == 0;
+}
+
+struct from_info {
+    const char *name;
+    int size;
+    void (*func)(int n, float *restrict outs, const void *restrict data);
+    float (*ref)(const unsigned char *p);
+    // Function which converts back, or NULL.
+    void (*to)(int n, void *restrict out, const float *restrict xs);
+};
+
+static float ref_from_u8(const unsigned char *p) {
+    return (float)((int)p[0] - 128) / 128.0f;
+}
+
+static float ref_from_les16(const unsigned char *p) {
+    long x = (long)p[0] | (long)p[1] << 8;
+    return (float)(x >= 32768 ? x - 65536 : x) / 32768.0f;
+}
+
+static float ref_from_les24(const unsigned char *p) {
+    long x = (long)p[0] | (long)p[1] << 8 | (long)p[2] << 16;
+    return (float)(x >= 8388608 ? x - 16777216 : x) / 8388608.0f;
+}
+
+static float ref_from_lef32(const unsigned char *p) {
+    unsigned u = 0;
+    for (int j = 0; j < 4; j++) {
+        u |= (unsigned)p[j] << (8 * j);
+    }
+    float x;
+    memcpy(&x, &u, 4);
+    return x;
+}
+
+static const struct from_info kFromTests[] = {
+    {"from_u8", 1, ufxr_from_u8, ref_from_u8, ufxr_to_u8},
+    {"from_les16", 2, ufxr_from_les16, ref_from_les16, ufxr_to_les16},
+    {"from_les24", 3, ufxr_from_les24, ref_from_les24, ufxr_to_les24},
+    {"from_lef32", 4, ufxr_from_lef32, ref_from_lef32, NULL},
+};
+
+// Test conversion from random bytes at every input offset. Integer formats
+// must also convert back to the same bytes.
+static bool test_from(const struct from_info *t) {
+    const size_t insize = (size_t)t->size * kMaxSize + kMaxOffset;
+    unsigned char *in = xmalloc(insize);
+    unsigned char *back = xmalloc((size_t)t->size * kMaxSize);
+    float *out = xmalloc(sizeof(float) * (kMaxSize + kGuard));
+    unsigned state = 1;
+    for (size_t i = 0; i < insize; i++) {
+        state = state * 1103515245u + 12345u;
+        in[i] = state >> 24;
+    }
+    if (t->to == NULL) {
+        // Avoid NaN, which does not compare equal to itself, at every offset.
+        for (size_t i = 0; i < insize; i++) {
+            in[i] &= 0xbf;
+        }
+    }
+    int failures = 0;
+    for (int offset = 0; offset < kMaxOffset; offset++) {
+        const unsigned char *data = in + offset;
+        for (int n = 0; n <= kMaxSize; n++) {
+            for (int i = 0; i < kMaxSize + kGuard; i++) {
+                out[i] = -99.0f;
+            }
+            t->func(n, out, data);
+            bool ok = true;
+            for (int i = 0; i < n; i++) {
+                ok = ok && out[i] == t->ref(data + i * t->size);
+            }
+            for (int i = n; i < kMaxSize + kGuard; i++) {
+                ok = ok && out[i] == -99.0f;
+            }
+            if (ok && t->to != NULL) {
+                t->to(n, back, out);
+                ok = memcmp(back, data, (size_t)t->size * n) == 0;
+            }
+            if (!ok) {
+                if (failures < 10) {
+                    printf("%s: size %d, input offset %d: incorrect output\n",
+                           t->name, n, offset);
+                }
+                failures++;
+            }
+        }
+    }
+    printf("%s: %d failures\n", t->name, failures);
+    free(in);
+    free(back);
+    free(out);
+    return failures == 0;
+}
+
+static bool test_dither_guard(const struct test_info *t,
+                              ufxr_dithermode mode) {
+    float *xs = xmalloc(sizeof(float) * (kMaxSize + kMaxOffset));
+    const size_t outsize = (size_t)t->size * kMaxSize + kGuard;
+    unsigned char *out = xmalloc(outsize);
+    fill_input(kMaxSize + kMaxOffset, xs);
+    struct ufxr_dither d;
+    ufxr_dither_init(&d, mode, 2, 1);
+    bool success = true;
+    for (int offset = 0; offset < kMaxOffset; offset++) {
+        for (int n = 0; n <= kMaxSize; n++) {
+            const size_t len = (size_t)t->size * n;
+            memset(out, 0xa5, outsize);
+            if (t->size == 1) {
+                ufxr_to_u8_dither(n, out, xs + offset, &d);
+            } else {
+                ufxr_to_les16_dither(n, out, xs + offset, &d);
+            }
+            for (size_t i = len; i < len + kGuard; i++) {
+                if (out[i] != 0xa5) {
+                    printf("%s: size %d, offset %d: wrote past end\n",
+                           t->name, n, offset);
+                    success = false;
+                    break;
+                }
+            }
+        }
+    }
+    free(xs);
+    free(out);
+    return success;
+}
+
+enum {
+    // Length of the dither test signal, in frames.
+    kDitherLength = 1 << 16,
+    // Length of the average used to measure low frequency noise. The shaped
+    // noise is a second difference, so its average falls with the square of
+    // the length, rather than the length.
+    kDitherAverage = 256,
+};
+
+// Quantize a stereo signal which is a constant 0.25 LSB in the left channel
+// and -0.25 LSB in the right channel, in pieces of different sizes. Check
+// that dither preserves the signal level, which rounding alone would lose, and
+// measure the noise.
+static bool test_dither_mode(const struct test_info *t, ufxr_dithermode mode,
+                             const char *name) {
+    const int n = kDitherLength * 2;
+    const float lsb = t->size == 1 ? 1.0f / 128.0f : 1.0f / 32768.0f;
+    const double offset = t->size == 1 ? 128.0 : 0.0;
+    float *xs = xmalloc(sizeof(float) * n);
+    unsigned char *out = xmalloc((size_t)t->size * n);
+    for (int i = 0; i < n; i++) {
+        xs[i] = (i & 1) == 0 ? 0.25f * lsb : -0.25f * lsb;
+    }
+    struct ufxr_dither d;
+    ufxr_dither_init(&d, mode, 2, 1);
+    for (int pos = 0, size = 1; pos < n; size = size * 3 % 97 + 1) {
+        const int m = n - pos < size ? n - pos : size;
+        if (t->size == 1) {
+            ufxr_to_u8_dither(m, out + pos, xs + pos, &d);
+        } else {
+            ufxr_to_les16_dither(m, out + pos * 2, xs + pos, &d);
+        }
+        pos += m;
+    }
+    double mean[2] = {0.0, 0.0}, power = 0.0, lowpower = 0.0;
+    double sum[2] = {0.0, 0.0};
+    for (int i = 0; i < n; i++) {
+        double y;
+        if (t->size == 1) {
+            y = (double)out[i] - offset;
+        } else {
+            y = (double)(short)(out[i * 2] | (out[i * 2 + 1] << 8));
+        }
+        const double e = y - ((i & 1) == 0 ? 0.25 : -0.25);
+        mean[i & 1] += y;
+        power += e * e;
+        sum[i & 1] += e;
+        if ((i >> 1) % kDitherAverage == kDitherAverage - 1) {
+            const double a = sum[i & 1] / kDitherAverage;
+            lowpower += a * a;
+            sum[i & 1] = 0.0;
+        }
+    }
+    mean[0] /= kDitherLength;
+    mean[1] /= kDitherLength;
+    power /= n;
+    lowpower /= n / kDitherAverage;
+    printf("%s %-6s: mean %+.3f %+.3f LSB, noise %5.1f dB, "
+           "low frequency noise %6.1f dB\n",
+           t->name, name, mean[0], mean[1], 10.0 * log10(power),
+           10.0 * log10(lowpower));
+    bool success = true;
+    if (fabs(mean[0] - 0.25) > 0.02 || fabs(mean[1] + 0.25) > 0.02) {
+        puts("Wrong signal level");
+        success = false;
+    }
+    // TPDF dither has a noise power of 1/4 LSB^2. Noise shaping raises the
+    // total, but should put much less of it at low frequencies.
+    if (mode == kUFXRDitherTPDF && fabs(10.0 * log10(power) + 6.02) > 0.5) {
+        puts("Wrong noise level");
+        success = false;
+    }
+    if (mode == kUFXRDitherShaped &&
+        10.0 * log10(lowpower * kDitherAverage / 0.25) > -10.0) {
+        puts("Noise is not shaped");
+        success = false;
+    }
+    free(xs);
+    free(out);
+    return success;
+}
+
+// Planar stereo with dither must give exactly the same output as interleaved
+// stereo with the same seed.
+static bool test_dither_stereo(const struct test_info *t,
+                               ufxr_dithermode mode) {
+    const int n = kMaxSize * 2;
+    float *xs = xmalloc(sizeof(float) * n * 2);
+    unsigned char *out = xmalloc((size_t)t->size * n * 2);
+    unsigned char *ref = xmalloc((size_t)t->size * n * 2);
+    fill_input(n, xs);
+    for (int i = 0; i < n / 2; i++) {
+        xs[n + i * 2] = xs[i];
+        xs[n + i * 2 + 1] = xs[n / 2 + i];
+    }
+    struct ufxr_dither d, dref;
+    ufxr_dither_init(&d, mode, 2, 1);
+    ufxr_dither_init(&dref, mode, 2, 1);
+    for (int pos = 0, size = 1; pos < n / 2; size = size * 3 % 37 + 1) {
+        const int m = n / 2 - pos < size ? n / 2 - pos : size;
+        const size_t opos = (size_t)t->size * pos * 2;
+        if (t->size == 1) {
+            ufxr_to_u8_dither_stereo(m, out + opos, xs + pos, xs + n / 2 + pos,
+                                     &d);
+            ufxr_to_u8_dither(m * 2, ref + opos, xs + n + pos * 2, &dref);
+        } else {
+            ufxr_to_les16_dither_stereo(m, out + opos, xs + pos,
+                                        xs + n / 2 + pos, &d);
+            ufxr_to_les16_dither(m * 2, ref + opos, xs + n + pos * 2, &dref);
+        }
+        pos += m;
+    }
+    bool success = memcmp(out, ref, (size_t)t->size * n) == 0;
+    if (!success) {
+        printf("%s: stereo dither does not match interleaved\n", t->name);
+    }
+    free(xs);
+    free(out);
+    free(ref);
+    return success;
+}
+
+static bool test_dither(const struct test_info *t) {
+    bool success = true;
+    success = test_dither_guard(t, kUFXRDitherTPDF) && success;
+    success = test_dither_guard(t, kUFXRDitherShaped) && success;
+    success = test_dither_mode(t, kUFXRDitherTPDF, "tpdf") && success;
+    success = test_dither_mode(t, kUFXRDitherShaped, "shaped") && success;
+    success = test_dither_stereo(t, kUFXRDitherTPDF) && success;
+    success = test_dither_stereo(t, kUFXRDitherShaped) && success;
+    return success;
+}
+
+int main(int argc, char **argv) {
+    (void)argc;
+    (void)argv;
+    bool success = true;
+    puts("Testing: convert");
+    for (size_t i = 0; i < ARRAY_SIZE(kTests); i++) {
+        if (!test_to(&kTests[i]) || !test_to_stereo(&kTests[i])) {
+            puts("****FAIL****");
+            success = false;
+        }
+    }
+    for (size_t i = 0; i < ARRAY_SIZE(kFromTests); i++) {
+        if (!test_from(&kFromTests[i])) {
+            puts("****FAIL****");
+            success = false;
+        }
+    }
+    // Dither is implemented for the 8-bit and 16-bit formats.
+    for (size_t i = 0; i < 2; i++) {
+        if (!test_dither(&kTests[i])) {
+            puts("****FAIL****");
+            success = false;
+        }
+    }
+    if (!success) {
+        puts("****FAIL****");
+        exit(1);
+    }
+    return 0;
+}
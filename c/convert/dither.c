@@ -0,0 +1,349 @@
+// dither.c - Quantize with dither and noise shaping.
+#include "c/convert/convert.h"
+
+#include "c/config/config.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Each SIMD lane has its own random number generator. Samples are processed
+// in blocks of 8, with sample i of each block using generator i, so all
+// versions produce the same output.
+enum {
+    kDitherLanes = 8,
+};
+
+// Largest quantization error fed back, in LSB. The error is normally at most
+// 1.5 LSB, but it is unbounded when the output clips, and feeding that back
+// would make the shaping filter ring.
+static const float kDitherMaxError = 1.5f;
+
+// Quantization parameters for an output format.
+struct dither_format {
+    float scale;
+    float offset;
+    float min;
+    float max;
+    // Size of a sample, in bytes.
+    int size;
+};
+
+static const struct dither_format kDitherU8 = {
+    .scale = 128.0f,
+    .offset = 128.0f,
+    .min = 0.0f,
+    .max = 255.0f,
+    .size = 1,
+};
+
+static const struct dither_format kDitherS16 = {
+    .scale = 32768.0f,
+    .offset = 0.0f,
+    .min = -32768.0f,
+    .max = 32767.0f,
+    .size = 2,
+};
+
+void ufxr_dither_init(struct ufxr_dither *restrict d, ufxr_dithermode mode,
+                      int channels, uint32_t seed) {
+    *d = (struct ufxr_dither){
+        .mode = mode,
+        .channels = channels == 2 ? 2 : 1,
+    };
+    for (int i = 0; i < kDitherLanes; i++) {
+        uint32_t x = seed * 0x9e3779b9u + (uint32_t)(i + 1) * 0x85ebca6bu;
+        x ^= x >> 16;
+        x *= 0x7feb352du;
+        x ^= x >> 15;
+        // The generator is stuck at zero if it starts there.
+        d->seed[i] = x != 0 ? x : 1;
+    }
+}
+
+// Advance a xorshift generator.
+static inline uint32_t dither_next(uint32_t *restrict seed) {
+    uint32_t x = *seed;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *seed = x;
+    return x;
+}
+
+// Convert a random number to TPDF dither, in LSB. The difference of the two
+// 16-bit halves is the sum of two uniform distributions.
+static inline float dither_tpdf(uint32_t r) {
+    return (float)((int)(r & 0xffff) - (int)(r >> 16)) * (1.0f / 65536.0f);
+}
+
+static inline int dither_round(float x, const struct dither_format *f) {
+    return lrintf(x > f->min ? (x < f->max ? x : f->max) : f->min);
+}
+
+static inline void dither_store(unsigned char *restrict out, int q,
+                                const struct dither_format *f) {
+    out[0] = q;
+    if (f->size == 2) {
+        out[1] = q >> 8;
+    }
+}
+
+// Quantize samples one at a time, with error feedback. The inputs are the
+// scaled samples and the dither, in LSB.
+static void dither_shape(int n, unsigned char *restrict out,
+                         const float *restrict us, const float *restrict ds,
+                         struct ufxr_dither *restrict d,
+                         const struct dither_format *f) {
+    int channel = d->channel;
+    for (int i = 0; i < n; i++) {
+        float *restrict e = d->error[channel];
+        const float v = us[i] - (2.0f * e[0] - e[1]);
+        const int q = dither_round(v + ds[i], f);
+        float error = (float)q - v;
+        error = error < kDitherMaxError ? error : kDitherMaxError;
+        error = error > -kDitherMaxError ? error : -kDitherMaxError;
+        e[1] = e[0];
+        e[0] = error;
+        dither_store(out + i * f->size, q, f);
+        if (++channel == d->channels) {
+            channel = 0;
+        }
+    }
+    d->channel = channel;
+}
+
+// Get input sample i. If there is a second channel, the input is planar
+// stereo, and is read as if it were interleaved.
+static inline float dither_load(const float *restrict xs0,
+                                const float *restrict xs1, int i) {
+    if (xs1 == NULL) {
+        return xs0[i];
+    }
+    return (i & 1) == 0 ? xs0[i >> 1] : xs1[i >> 1];
+}
+
+// Quantize up to one block of samples, one at a time.
+static void dither_block(int n, unsigned char *restrict out,
+                         const float *restrict xs0,
+                         const float *restrict xs1,
+                         struct ufxr_dither *restrict d,
+                         const struct dither_format *f) {
+    float us[kDitherLanes], ds[kDitherLanes];
+    for (int i = 0; i < n; i++) {
+        us[i] = dither_load(xs0, xs1, i) * f->scale + f->offset;
+        ds[i] = dither_tpdf(dither_next(&d->seed[i]));
+    }
+    if (d->mode == kUFXRDitherShaped) {
+        dither_shape(n, out, us, ds, d, f);
+    } else {
+        for (int i = 0; i < n; i++) {
+            dither_store(out + i * f->size, dither_round(us[i] + ds[i], f), f);
+        }
+        d->channel = (d->channel + n) % d->channels;
+    }
+}
+
+// Quantize up to one block of samples, starting at sample i.
+static inline void dither_tail(int n, unsigned char *restrict out,
+                               const float *restrict xs0,
+                               const float *restrict xs1, int i,
+                               struct ufxr_dither *restrict d,
+                               const struct dither_format *f) {
+    if (xs1 == NULL) {
+        dither_block(n, out, xs0 + i, NULL, d, f);
+    } else {
+        dither_block(n, out, xs0 + i / 2, xs1 + i / 2, d, f);
+    }
+}
+
+// AVX2 version.
+#if !HAVE_FUNC && USE_AVX2
+#define HAVE_FUNC 1
+#include <immintrin.h>
+static void dither_quantize(int n, unsigned char *restrict out,
+                            const float *restrict xs0,
+                            const float *restrict xs1,
+                            struct ufxr_dither *restrict d,
+                            const struct dither_format *f) {
+    const __m256 scale = _mm256_set1_ps(f->scale);
+    const __m256 offset = _mm256_set1_ps(f->offset);
+    const __m256 min = _mm256_set1_ps(f->min);
+    const __m256 max = _mm256_set1_ps(f->max);
+    const __m256 k = _mm256_set1_ps(1.0f / 65536.0f);
+    const __m256i mask = _mm256_set1_epi32(0xffff);
+    const bool shaped = d->mode == kUFXRDitherShaped;
+    __m256i s = _mm256_loadu_si256((const __m256i *)d->seed);
+    int i = 0;
+    for (; n - i >= kDitherLanes; i += kDitherLanes) {
+        s = _mm256_xor_si256(s, _mm256_slli_epi32(s, 13));
+        s = _mm256_xor_si256(s, _mm256_srli_epi32(s, 17));
+        s = _mm256_xor_si256(s, _mm256_slli_epi32(s, 5));
+        __m256 dv = _mm256_mul_ps(
+            _mm256_cvtepi32_ps(_mm256_sub_epi32(_mm256_and_si256(s, mask),
+                                                _mm256_srli_epi32(s, 16))),
+            k);
+        __m256 u;
+        if (xs1 == NULL) {
+            u = _mm256_loadu_ps(xs0 + i);
+        } else {
+            __m128 x = _mm_loadu_ps(xs0 + i / 2), y = _mm_loadu_ps(xs1 + i / 2);
+            u = _mm256_insertf128_ps(
+                _mm256_castps128_ps256(_mm_unpacklo_ps(x, y)),
+                _mm_unpackhi_ps(x, y), 1);
+        }
+        u = _mm256_add_ps(_mm256_mul_ps(u, scale), offset);
+        if (shaped) {
+            _Alignas(32) float us[kDitherLanes], ds[kDitherLanes];
+            _mm256_store_ps(us, u);
+            _mm256_store_ps(ds, dv);
+            dither_shape(kDitherLanes, out + i * f->size, us, ds, d, f);
+            continue;
+        }
+        __m256 v = _mm256_min_ps(_mm256_max_ps(_mm256_add_ps(u, dv), min), max);
+        __m256i q = _mm256_cvtps_epi32(v);
+        __m128i p = _mm_packs_epi32(_mm256_castsi256_si128(q),
+                                    _mm256_extracti128_si256(q, 1));
+        if (f->size == 2) {
+            _mm_storeu_si128((void *)(out + i * 2), p);
+        } else {
+            _mm_storel_epi64((void *)(out + i), _mm_packus_epi16(p, p));
+        }
+    }
+    _mm256_storeu_si256((__m256i *)d->seed, s);
+    if (!shaped) {
+        d->channel = (d->channel + i) % d->channels;
+    }
+    dither_tail(n - i, out + i * f->size, xs0, xs1, i, d, f);
+}
+#endif
+
+// SSE2 version.
+#if !HAVE_FUNC && USE_SSE2
+#define HAVE_FUNC 1
+#include <emmintrin.h>
+
+static inline __m128i dither_next4(__m128i s) {
+    s = _mm_xor_si128(s, _mm_slli_epi32(s, 13));
+    s = _mm_xor_si128(s, _mm_srli_epi32(s, 17));
+    return _mm_xor_si128(s, _mm_slli_epi32(s, 5));
+}
+
+static void dither_quantize(int n, unsigned char *restrict out,
+                            const float *restrict xs0,
+                            const float *restrict xs1,
+                            struct ufxr_dither *restrict d,
+                            const struct dither_format *f) {
+    const __m128 scale = _mm_set1_ps(f->scale);
+    const __m128 offset = _mm_set1_ps(f->offset);
+    const __m128 min = _mm_set1_ps(f->min);
+    const __m128 max = _mm_set1_ps(f->max);
+    const __m128 k = _mm_set1_ps(1.0f / 65536.0f);
+    const __m128i mask = _mm_set1_epi32(0xffff);
+    const bool shaped = d->mode == kUFXRDitherShaped;
+    __m128i s0 = _mm_loadu_si128((const __m128i *)d->seed);
+    __m128i s1 = _mm_loadu_si128((const __m128i *)(d->seed + 4));
+    int i = 0;
+    for (; n - i >= kDitherLanes; i += kDitherLanes) {
+        s0 = dither_next4(s0);
+        s1 = dither_next4(s1);
+        __m128 d0 = _mm_mul_ps(
+            _mm_cvtepi32_ps(_mm_sub_epi32(_mm_and_si128(s0, mask),
+                                          _mm_srli_epi32(s0, 16))),
+            k);
+        __m128 d1 = _mm_mul_ps(
+            _mm_cvtepi32_ps(_mm_sub_epi32(_mm_and_si128(s1, mask),
+                                          _mm_srli_epi32(s1, 16))),
+            k);
+        __m128 u0, u1;
+        if (xs1 == NULL) {
+            u0 = _mm_loadu_ps(xs0 + i);
+            u1 = _mm_loadu_ps(xs0 + i + 4);
+        } else {
+            __m128 x = _mm_loadu_ps(xs0 + i / 2), y = _mm_loadu_ps(xs1 + i / 2);
+            u0 = _mm_unpacklo_ps(x, y);
+            u1 = _mm_unpackhi_ps(x, y);
+        }
+        u0 = _mm_add_ps(_mm_mul_ps(u0, scale), offset);
+        u1 = _mm_add_ps(_mm_mul_ps(u1, scale), offset);
+        if (shaped) {
+            _Alignas(16) float us[kDitherLanes], ds[kDitherLanes];
+            _mm_store_ps(us, u0);
+            _mm_store_ps(us + 4, u1);
+            _mm_store_ps(ds, d0);
+            _mm_store_ps(ds + 4, d1);
+            dither_shape(kDitherLanes, out + i * f->size, us, ds, d, f);
+            continue;
+        }
+        __m128 v0 = _mm_min_ps(_mm_max_ps(_mm_add_ps(u0, d0), min), max);
+        __m128 v1 = _mm_min_ps(_mm_max_ps(_mm_add_ps(u1, d1), min), max);
+        __m128i p = _mm_packs_epi32(_mm_cvtps_epi32(v0), _mm_cvtps_epi32(v1));
+        if (f->size == 2) {
+            _mm_storeu_si128((void *)(out + i * 2), p);
+        } else {
+            _mm_storel_epi64((void *)(out + i), _mm_packus_epi16(p, p));
+        }
+    }
+    _mm_storeu_si128((__m128i *)d->seed, s0);
+    _mm_storeu_si128((__m128i *)(d->seed + 4), s1);
+    if (!shaped) {
+        d->channel = (d->channel + i) % d->channels;
+    }
+    dither_tail(n - i, out + i * f->size, xs0, xs1, i, d, f);
+}
+#endif
+
+// Scalar version.
+#if !HAVE_FUNC
+static void dither_quantize(int n, unsigned char *restrict out,
+                            const float *restrict xs0,
+                            const float *restrict xs1,
+                            struct ufxr_dither *restrict d,
+                            const struct dither_format *f) {
+    for (int i = 0; i < n; i += kDitherLanes) {
+        const int m = n - i < kDitherLanes ? n - i : kDitherLanes;
+        dither_tail(m, out + i * f->size, xs0, xs1, i, d, f);
+    }
+}
+#endif
+
+void ufxr_to_u8_dither(int n, void *restrict out, const float *restrict xs,
+                       struct ufxr_dither *restrict d) {
+    if (d->mode == kUFXRDitherNone) {
+        ufxr_to_u8(n, out, xs);
+        return;
+    }
+    dither_quantize(n, out, xs, NULL, d, &kDitherU8);
+}
+
+void ufxr_to_les16_dither(int n, void *restrict out, const float *restrict xs,
+                          struct ufxr_dither *restrict d) {
+    if (d->mode == kUFXRDitherNone) {
+        ufxr_to_les16(n, out, xs);
+        return;
+    }
+    dither_quantize(n, out, xs, NULL, d, &kDitherS16);
+}
+
+void ufxr_to_u8_dither_stereo(int n, void *restrict out,
+                              const float *restrict xs0,
+                              const float *restrict xs1,
+                              struct ufxr_dither *restrict d) {
+    if (d->mode == kUFXRDitherNone) {
+        ufxr_to_u8_stereo(n, out, xs0, xs1);
+        return;
+    }
+    dither_quantize(n * 2, out, xs0, xs1, d, &kDitherU8);
+}
+
+void ufxr_to_les16_dither_stereo(int n, void *restrict out,
+                                 const float *restrict xs0,
+                                 const float *restrict xs1,
+                                 struct ufxr_dither *restrict d) {
+    if (d->mode == kUFXRDitherNone) {
+        ufxr_to_les16_stereo(n, out, xs0, xs1);
+        return;
+    }
+    dither_quantize(n * 2, out, xs0, xs1, d, &kDitherS16);
+}
@@ -0,0 +1,22 @@
+// from_lef32.c - Convert from little-endian 32-bit float.
+#include "c/convert/convert.h"
+
+#include <string.h>
+
+#if __BYTE_ORDER__ && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+void ufxr_from_lef32(int n, float *restrict outs, const void *restrict data) {
+    memcpy(outs, data, n * sizeof(float));
+}
+#elif __BYTE_ORDER__ && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+void ufxr_from_lef32(int n, float *restrict outs, const void *restrict data) {
+    const char *iptr = data;
+    for (int i = 0; i < n; i++) {
+        unsigned u;
+        memcpy(&u, iptr + i * 4, 4);
+        u = __builtin_bswap32(u);
+        memcpy(outs + i, &u, 4);
+    }
+}
+#else
+#error "unknown endian"
+#endif
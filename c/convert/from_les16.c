@@ -0,0 +1,68 @@
+// from_les16.c - Convert from little-endian signed 16-bit.
+#include "c/convert/convert.h"
+
+#include "c/config/config.h"
+
+// AVX2 version.
+#if !HAVE_FUNC && USE_AVX2
+#define HAVE_FUNC 1
+#include <immintrin.h>
+static inline float from_les16_1(const unsigned char *restrict p) {
+    return (float)(short)(p[0] | p[1] << 8) * (1.0f / 32768.0f);
+}
+
+void ufxr_from_les16(int n, float *restrict outs, const void *restrict data) {
+    const unsigned char *iptr = data;
+    const __m256 scale = _mm256_set1_ps(1.0f / 32768.0f);
+    int i = 0;
+    for (; n - i >= 16; i += 16) {
+        __m128i s0 = _mm_loadu_si128((const void *)(iptr + i * 2));
+        __m128i s1 = _mm_loadu_si128((const void *)(iptr + i * 2 + 16));
+        __m256 x0 = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(s0));
+        __m256 x1 = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(s1));
+        _mm256_storeu_ps(outs + i, _mm256_mul_ps(x0, scale));
+        _mm256_storeu_ps(outs + i + 8, _mm256_mul_ps(x1, scale));
+    }
+    for (; i < n; i++) {
+        outs[i] = from_les16_1(iptr + i * 2);
+    }
+}
+#endif
+
+// SSE2 version.
+#if !HAVE_FUNC && USE_SSE2
+#define HAVE_FUNC 1
+#include <emmintrin.h>
+static inline float from_les16_1(const unsigned char *restrict p) {
+    return (float)(short)(p[0] | p[1] << 8) * (1.0f / 32768.0f);
+}
+
+void ufxr_from_les16(int n, float *restrict outs, const void *restrict data) {
+    const unsigned char *iptr = data;
+    const __m128i zero = _mm_setzero_si128();
+    const __m128 scale = _mm_set1_ps(1.0f / 32768.0f);
+    int i = 0;
+    for (; n - i >= 8; i += 8) {
+        __m128i s = _mm_loadu_si128((const void *)(iptr + i * 2));
+        // Sign extend by placing each sample in the high half.
+        __m128i t0 = _mm_srai_epi32(_mm_unpacklo_epi16(zero, s), 16);
+        __m128i t1 = _mm_srai_epi32(_mm_unpackhi_epi16(zero, s), 16);
+        _mm_store_ps(outs + i, _mm_mul_ps(_mm_cvtepi32_ps(t0), scale));
+        _mm_store_ps(outs + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(t1), scale));
+    }
+    for (; i < n; i++) {
+        outs[i] = from_les16_1(iptr + i * 2);
+    }
+}
+#endif
+
+// Scalar version.
+#if !HAVE_FUNC
+void ufxr_from_les16(int n, float *restrict outs, const void *restrict data) {
+    const unsigned char *iptr = data;
+    for (int i = 0; i < n; i++) {
+        const unsigned char *p = iptr + i * 2;
+        outs[i] = (float)(short)(p[0] | p[1] << 8) * (1.0f / 32768.0f);
+    }
+}
+#endif
@@ -0,0 +1,81 @@
+// from_les24.c - Convert from little-endian signed 24-bit.
+#include "c/convert/convert.h"
+
+#include "c/config/config.h"
+
+#include <stdint.h>
+
+// Samples are placed in the high 24 bits of a 32-bit integer and then shifted
+// down, which sign extends them.
+static inline float from_les24_1(const unsigned char *restrict p) {
+    const int32_t x = (int32_t)((uint32_t)p[0] << 8 | (uint32_t)p[1] << 16 |
+                                (uint32_t)p[2] << 24);
+    return (float)(x >> 8) * (1.0f / 8388608.0f);
+}
+
+// AVX2 version.
+#if !HAVE_FUNC && USE_AVX2
+#define HAVE_FUNC 1
+#include <immintrin.h>
+void ufxr_from_les24(int n, float *restrict outs, const void *restrict data) {
+    const unsigned char *iptr = data;
+    const __m256 scale = _mm256_set1_ps(1.0f / 8388608.0f);
+    // Move each sample into the high 24 bits of a 32-bit lane.
+    const __m256i shuf = _mm256_setr_epi8(
+        -1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11,
+        -1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11);
+    int i = 0;
+    // Each load reads 16 bytes, of which 12 are used. The last load reads 4
+    // bytes past the block, so at least 2 samples must follow it.
+    for (; n - i >= 8 + 2; i += 8) {
+        const unsigned char *p = iptr + i * 3;
+        __m256i s = _mm256_inserti128_si256(
+            _mm256_castsi128_si256(_mm_loadu_si128((const void *)p)),
+            _mm_loadu_si128((const void *)(p + 12)), 1);
+        s = _mm256_srai_epi32(_mm256_shuffle_epi8(s, shuf), 8);
+        _mm256_storeu_ps(outs + i,
+                         _mm256_mul_ps(_mm256_cvtepi32_ps(s), scale));
+    }
+    for (; i < n; i++) {
+        outs[i] = from_les24_1(iptr + i * 3);
+    }
+}
+#endif
+
+// SSSE3 version.
+#if !HAVE_FUNC && USE_SSSE3
+#define HAVE_FUNC 1
+#include <tmmintrin.h>
+void ufxr_from_les24(int n, float *restrict outs, const void *restrict data) {
+    const unsigned char *iptr = data;
+    const __m128 scale = _mm_set1_ps(1.0f / 8388608.0f);
+    // Move each sample into the high 24 bits of a 32-bit lane.
+    const __m128i shuf =
+        _mm_setr_epi8(-1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11);
+    int i = 0;
+    // Each load reads 16 bytes, of which 12 are used, so at least 2 samples
+    // must follow each block.
+    for (; n - i >= 8 + 2; i += 8) {
+        const unsigned char *p = iptr + i * 3;
+        __m128i s0 = _mm_loadu_si128((const void *)p);
+        __m128i s1 = _mm_loadu_si128((const void *)(p + 12));
+        s0 = _mm_srai_epi32(_mm_shuffle_epi8(s0, shuf), 8);
+        s1 = _mm_srai_epi32(_mm_shuffle_epi8(s1, shuf), 8);
+        _mm_store_ps(outs + i, _mm_mul_ps(_mm_cvtepi32_ps(s0), scale));
+        _mm_store_ps(outs + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(s1), scale));
+    }
+    for (; i < n; i++) {
+        outs[i] = from_les24_1(iptr + i * 3);
+    }
+}
+#endif
+
+// Scalar version.
+#if !HAVE_FUNC
+void ufxr_from_les24(int n, float *restrict outs, const void *restrict data) {
+    const unsigned char *iptr = data;
+    for (int i = 0; i < n; i++) {
+        outs[i] = from_les24_1(iptr + i * 3);
+    }
+}
+#endif
@@ -0,0 +1,70 @@
+// from_u8.c - Convert from unsigned 8-bit.
+#include "c/convert/convert.h"
+
+#include "c/config/config.h"
+
+// AVX2 version.
+#if !HAVE_FUNC && USE_AVX2
+#define HAVE_FUNC 1
+#include <immintrin.h>
+void ufxr_from_u8(int n, float *restrict outs, const void *restrict data) {
+    const unsigned char *iptr = data;
+    const __m256 offset = _mm256_set1_ps(128.0f);
+    const __m256 scale = _mm256_set1_ps(1.0f / 128.0f);
+    int i = 0;
+    for (; n - i >= 16; i += 16) {
+        __m128i s = _mm_loadu_si128((const void *)(iptr + i));
+        __m256 x0 = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(s));
+        __m256 x1 =
+            _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_srli_si128(s, 8)));
+        x0 = _mm256_mul_ps(_mm256_sub_ps(x0, offset), scale);
+        x1 = _mm256_mul_ps(_mm256_sub_ps(x1, offset), scale);
+        _mm256_storeu_ps(outs + i, x0);
+        _mm256_storeu_ps(outs + i + 8, x1);
+    }
+    for (; i < n; i++) {
+        outs[i] = (float)((int)iptr[i] - 128) * (1.0f / 128.0f);
+    }
+}
+#endif
+
+// SSE2 version.
+#if !HAVE_FUNC && USE_SSE2
+#define HAVE_FUNC 1
+#include <emmintrin.h>
+void ufxr_from_u8(int n, float *restrict outs, const void *restrict data) {
+    const unsigned char *iptr = data;
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i offset = _mm_set1_epi16(128);
+    const __m128 scale = _mm_set1_ps(1.0f / 128.0f);
+    int i = 0;
+    for (; n - i >= 16; i += 16) {
+        __m128i s = _mm_loadu_si128((const void *)(iptr + i));
+        // Widen to 16 bits and remove the offset, then sign extend to 32 bits
+        // by placing each value in the high half.
+        __m128i s0 = _mm_sub_epi16(_mm_unpacklo_epi8(s, zero), offset);
+        __m128i s1 = _mm_sub_epi16(_mm_unpackhi_epi8(s, zero), offset);
+        __m128i t0 = _mm_srai_epi32(_mm_unpacklo_epi16(zero, s0), 16);
+        __m128i t1 = _mm_srai_epi32(_mm_unpackhi_epi16(zero, s0), 16);
+        __m128i t2 = _mm_srai_epi32(_mm_unpacklo_epi16(zero, s1), 16);
+        __m128i t3 = _mm_srai_epi32(_mm_unpackhi_epi16(zero, s1), 16);
+        _mm_store_ps(outs + i, _mm_mul_ps(_mm_cvtepi32_ps(t0), scale));
+        _mm_store_ps(outs + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(t1), scale));
+        _mm_store_ps(outs + i + 8, _mm_mul_ps(_mm_cvtepi32_ps(t2), scale));
+        _mm_store_ps(outs + i + 12, _mm_mul_ps(_mm_cvtepi32_ps(t3), scale));
+    }
+    for (; i < n; i++) {
+        outs[i] = (float)((int)iptr[i] - 128) * (1.0f / 128.0f);
+    }
+}
+#endif
+
+// Scalar version.
+#if !HAVE_FUNC
+void ufxr_from_u8(int n, float *restrict outs, const void *restrict data) {
+    const unsigned char *iptr = data;
+    for (int i = 0; i < n; i++) {
+        outs[i] = (float)((int)iptr[i] - 128) * (1.0f / 128.0f);
+    }
+}
+#endif
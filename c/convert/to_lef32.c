@@ -1,4 +1,4 @@
-// to_les24.c - Convert to little-endian signed 24-bit.
+// to_lef32.c - Convert to little-endian 32-bit float.
 #include "c/convert/convert.h"
 
 #include "c/config/config.h"
@@ -8,6 +8,64 @@
 void ufxr_to_lef32(int n, void *restrict out, const float *restrict xs) {
     memcpy(out, xs, n * sizeof(float));
 }
+
+// AVX version.
+#if !HAVE_FUNC && USE_AVX
+#define HAVE_FUNC 1
+#include <immintrin.h>
+void ufxr_to_lef32_stereo(int n, void *restrict out, const float *restrict xs0,
+                          const float *restrict xs1) {
+    float *optr = out;
+    int i = 0;
+    for (; n - i >= 8; i += 8) {
+        __m256 x = _mm256_loadu_ps(xs0 + i), y = _mm256_loadu_ps(xs1 + i);
+        __m256 lo = _mm256_unpacklo_ps(x, y), hi = _mm256_unpackhi_ps(x, y);
+        _mm256_storeu_ps(optr, _mm256_permute2f128_ps(lo, hi, 0x20));
+        _mm256_storeu_ps(optr + 8, _mm256_permute2f128_ps(lo, hi, 0x31));
+        optr += 16;
+    }
+    for (; i < n; i++) {
+        memcpy(optr, xs0 + i, 4);
+        memcpy(optr + 1, xs1 + i, 4);
+        optr += 2;
+    }
+}
+#endif
+
+// SSE2 version.
+#if !HAVE_FUNC && USE_SSE2
+#define HAVE_FUNC 1
+#include <emmintrin.h>
+void ufxr_to_lef32_stereo(int n, void *restrict out, const float *restrict xs0,
+                          const float *restrict xs1) {
+    float *optr = out;
+    int i = 0;
+    for (; n - i >= 4; i += 4) {
+        __m128 x = _mm_loadu_ps(xs0 + i), y = _mm_loadu_ps(xs1 + i);
+        _mm_storeu_ps(optr, _mm_unpacklo_ps(x, y));
+        _mm_storeu_ps(optr + 4, _mm_unpackhi_ps(x, y));
+        optr += 8;
+    }
+    for (; i < n; i++) {
+        memcpy(optr, xs0 + i, 4);
+        memcpy(optr + 1, xs1 + i, 4);
+        optr += 2;
+    }
+}
+#endif
+
+// Scalar version.
+#if !HAVE_FUNC
+void ufxr_to_lef32_stereo(int n, void *restrict out, const float *restrict xs0,
+                          const float *restrict xs1) {
+    char *optr = out;
+    for (int i = 0; i < n; i++) {
+        memcpy(optr, xs0 + i, 4);
+        memcpy(optr + 4, xs1 + i, 4);
+        optr += 8;
+    }
+}
+#endif
 #elif __BYTE_ORDER__ && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
 void ufxr_to_lef32(int n, void *restrict out, const float *restrict xs) {
     char *optr = out;
@@ -22,6 +80,16 @@ void ufxr_to_lef32(int n, void *restrict out, const float *restrict xs) {
         optr += 4;
     }
 }
+
+void ufxr_to_lef32_stereo(int n, void *restrict out, const float *restrict xs0,
+                          const float *restrict xs1) {
+    char *optr = out;
+    for (int i = 0; i < n; i++) {
+        ufxr_to_lef32(1, optr, xs0 + i);
+        ufxr_to_lef32(1, optr + 4, xs1 + i);
+        optr += 8;
+    }
+}
 #else
 #error "unknown endian"
 #endif
@@ -3,54 +3,74 @@
 
 #include "c/config/config.h"
 
+#include <stdint.h>
+
 // SSE2 version.
 #if !HAVE_FUNC && USE_SSE2
 #define HAVE_FUNC 1
 #include <string.h>
-#include <xmmintrin.h>
-void ufxr_to_les16(int n, void *restrict out, const float *restrict xs) {
-    char *optr = out;
-    const float *iptr = xs, *iend = xs + n;
+#include <emmintrin.h>
+static inline void to_les16_1(char *restrict optr, const float *restrict iptr) {
+    __m128 x = _mm_load_ss(iptr);
+    x = _mm_mul_ss(x, _mm_set_ss(32768.0f));
+    x = _mm_max_ss(x, _mm_set_ss(-32768.0f));
+    x = _mm_min_ss(x, _mm_set_ss(32767.0f));
+    int s = _mm_cvt_ss2si(x);
+    memcpy(optr, &s, 2);
+}
+
+// Quantize 8 samples.
+static inline void to_les16_8(char *restrict optr, __m128 x0, __m128 x1) {
     const __m128 scale = _mm_set1_ps(32768.0f);
     const __m128 max = _mm_set1_ps(32767.0f);
     const __m128 min = _mm_set1_ps(-32768.0f);
-    while (((uintptr_t)iptr & 15) != 0) {
-        __m128 x = _mm_load_ss(iptr);
-        x = _mm_mul_ss(x, scale);
-        x = _mm_max_ss(x, min);
-        x = _mm_min_ss(x, max);
-        int s = _mm_cvt_ss2si(x);
-        memcpy(optr, &s, 2);
+    x0 = _mm_mul_ps(x0, scale);
+    x1 = _mm_mul_ps(x1, scale);
+    x0 = _mm_max_ps(x0, min);
+    x1 = _mm_max_ps(x1, min);
+    x0 = _mm_min_ps(x0, max);
+    x1 = _mm_min_ps(x1, max);
+    __m128i s0 = _mm_cvtps_epi32(x0);
+    __m128i s1 = _mm_cvtps_epi32(x1);
+    __m128i s = _mm_packs_epi32(s0, s1);
+    _mm_storeu_si128((void *)optr, s);
+}
+
+void ufxr_to_les16(int n, void *restrict out, const float *restrict xs) {
+    char *optr = out;
+    const float *iptr = xs, *iend = xs + n;
+    while (((uintptr_t)iptr & 15) != 0 && iptr != iend) {
+        to_les16_1(optr, iptr);
         iptr += 1;
         optr += 2;
     }
     while (iend - iptr >= 8) {
-        __m128 x0 = _mm_load_ps(iptr);
-        __m128 x1 = _mm_load_ps(iptr + 4);
-        x0 = _mm_mul_ps(x0, scale);
-        x1 = _mm_mul_ps(x1, scale);
-        x0 = _mm_max_ps(x0, min);
-        x1 = _mm_max_ps(x1, min);
-        x0 = _mm_min_ps(x0, max);
-        x1 = _mm_min_ps(x1, max);
-        __m128i s0 = _mm_cvtps_epi32(x0);
-        __m128i s1 = _mm_cvtps_epi32(x1);
-        __m128i s = _mm_packs_epi32(s0, s1);
-        _mm_storeu_si128((void *)optr, s);
+        to_les16_8(optr, _mm_load_ps(iptr), _mm_load_ps(iptr + 4));
         iptr += 8;
         optr += 16;
     }
     while (iptr != iend) {
-        __m128 x = _mm_load_ss(iptr);
-        x = _mm_mul_ss(x, scale);
-        x = _mm_max_ss(x, min);
-        x = _mm_min_ss(x, max);
-        int s = _mm_cvt_ss2si(x);
-        memcpy(optr, &s, 2);
+        to_les16_1(optr, iptr);
         iptr += 1;
         optr += 2;
     }
 }
+
+void ufxr_to_les16_stereo(int n, void *restrict out, const float *restrict xs0,
+                          const float *restrict xs1) {
+    char *optr = out;
+    int i = 0;
+    for (; n - i >= 4; i += 4) {
+        __m128 x = _mm_loadu_ps(xs0 + i), y = _mm_loadu_ps(xs1 + i);
+        to_les16_8(optr, _mm_unpacklo_ps(x, y), _mm_unpackhi_ps(x, y));
+        optr += 16;
+    }
+    for (; i < n; i++) {
+        to_les16_1(optr, xs0 + i);
+        to_les16_1(optr + 2, xs1 + i);
+        optr += 4;
+    }
+}
 #endif
 
 // Scalar version.
@@ -70,23 +90,35 @@ static inline unsigned short le16(unsigned short x) {
 #error "unknown byte order"
 #endif
 
+static inline void to_les16_1(char *restrict pos, float x) {
+    x *= 32768.0f;
+    short y;
+    if (x < 32767.0f) {
+        if (x > -32768.0f) {
+            y = lrintf(x);
+        } else {
+            y = -32768;
+        }
+    } else {
+        y = 32767;
+    }
+    y = le16(y);
+    memcpy(pos, &y, 2);
+}
+
 void ufxr_to_les16(int n, void *restrict out, const float *restrict xs) {
     char *pos = out;
     for (int i = 0; i < n; i++) {
-        float x = xs[i] * 32768.0f;
-        short y;
-        if (x < 32767.0f) {
-            if (x > -32768.0f) {
-                y = lrintf(x);
-            } else {
-                y = -32768;
-            }
-        } else {
-            y = 32767;
-        }
-        y = le16(y);
-        memcpy(pos, &y, 2);
-        pos += 2;
+        to_les16_1(pos + i * 2, xs[i]);
+    }
+}
+
+void ufxr_to_les16_stereo(int n, void *restrict out, const float *restrict xs0,
+                          const float *restrict xs1) {
+    char *pos = out;
+    for (int i = 0; i < n; i++) {
+        to_les16_1(pos + i * 4, xs0[i]);
+        to_les16_1(pos + i * 4 + 2, xs1[i]);
     }
 }
 #endif
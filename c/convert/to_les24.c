@@ -3,6 +3,152 @@
 
 #include "c/config/config.h"
 
+#include <stdint.h>
+
+// AVX2 version.
+#if !HAVE_FUNC && USE_AVX2
+#define HAVE_FUNC 1
+#include <immintrin.h>
+#include <string.h>
+static inline void to_les24_1(char *restrict optr, const float *restrict iptr) {
+    __m128 x = _mm_load_ss(iptr);
+    x = _mm_mul_ss(x, _mm_set_ss(8388608.0f));
+    x = _mm_max_ss(x, _mm_set_ss(-8388608.0f));
+    x = _mm_min_ss(x, _mm_set_ss(8388607.0f));
+    int s = _mm_cvt_ss2si(x);
+    memcpy(optr, &s, 3);
+}
+
+// Quantize 8 samples. This writes 32 bytes, of which the first 24 are valid.
+static inline void to_les24_8(char *restrict optr, __m256 x) {
+    const __m256 scale = _mm256_set1_ps(8388608.0f);
+    const __m256 max = _mm256_set1_ps(8388607.0f);
+    const __m256 min = _mm256_set1_ps(-8388608.0f);
+    // Pack the low three bytes of each 32-bit lane into the low 12 bytes of
+    // each 128-bit half, then move the halves together.
+    const __m256i shuf = _mm256_setr_epi8(
+        0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+        0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+    const __m256i perm = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 7, 7);
+    x = _mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(x, scale), min), max);
+    __m256i s = _mm256_cvtps_epi32(x);
+    s = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(s, shuf), perm);
+    _mm256_storeu_si256((void *)optr, s);
+}
+
+void ufxr_to_les24(int n, void *restrict out, const float *restrict xs) {
+    char *optr = out;
+    const float *iptr = xs, *iend = xs + n;
+    while (((uintptr_t)iptr & 31) != 0 && iptr != iend) {
+        to_les24_1(optr, iptr);
+        iptr += 1;
+        optr += 3;
+    }
+    // The remaining 8 bytes of each store are overwritten by later samples,
+    // so at least 3 samples must follow each block.
+    while (iend - iptr >= 16 + 3) {
+        to_les24_8(optr, _mm256_load_ps(iptr));
+        to_les24_8(optr + 24, _mm256_load_ps(iptr + 8));
+        iptr += 16;
+        optr += 48;
+    }
+    while (iptr != iend) {
+        to_les24_1(optr, iptr);
+        iptr += 1;
+        optr += 3;
+    }
+}
+
+void ufxr_to_les24_stereo(int n, void *restrict out, const float *restrict xs0,
+                          const float *restrict xs1) {
+    char *optr = out;
+    int i = 0;
+    // At least 3 samples, or 2 frames, must follow each block.
+    for (; n - i >= 8 + 2; i += 8) {
+        __m256 x = _mm256_loadu_ps(xs0 + i), y = _mm256_loadu_ps(xs1 + i);
+        __m256 lo = _mm256_unpacklo_ps(x, y), hi = _mm256_unpackhi_ps(x, y);
+        to_les24_8(optr, _mm256_permute2f128_ps(lo, hi, 0x20));
+        to_les24_8(optr + 24, _mm256_permute2f128_ps(lo, hi, 0x31));
+        optr += 48;
+    }
+    for (; i < n; i++) {
+        to_les24_1(optr, xs0 + i);
+        to_les24_1(optr + 3, xs1 + i);
+        optr += 6;
+    }
+}
+#endif
+
+// SSSE3 version.
+#if !HAVE_FUNC && USE_SSSE3
+#define HAVE_FUNC 1
+#include <string.h>
+#include <tmmintrin.h>
+static inline void to_les24_1(char *restrict optr, const float *restrict iptr) {
+    __m128 x = _mm_load_ss(iptr);
+    x = _mm_mul_ss(x, _mm_set_ss(8388608.0f));
+    x = _mm_max_ss(x, _mm_set_ss(-8388608.0f));
+    x = _mm_min_ss(x, _mm_set_ss(8388607.0f));
+    int s = _mm_cvt_ss2si(x);
+    memcpy(optr, &s, 3);
+}
+
+// Quantize 4 samples. This writes 16 bytes, of which the first 12 are valid.
+static inline void to_les24_4(char *restrict optr, __m128 x) {
+    const __m128 scale = _mm_set1_ps(8388608.0f);
+    const __m128 max = _mm_set1_ps(8388607.0f);
+    const __m128 min = _mm_set1_ps(-8388608.0f);
+    // Pack the low three bytes of each 32-bit lane into the low 12 bytes.
+    const __m128i shuf =
+        _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+    x = _mm_min_ps(_mm_max_ps(_mm_mul_ps(x, scale), min), max);
+    __m128i s = _mm_shuffle_epi8(_mm_cvtps_epi32(x), shuf);
+    _mm_storeu_si128((void *)optr, s);
+}
+
+void ufxr_to_les24(int n, void *restrict out, const float *restrict xs) {
+    char *optr = out;
+    const float *iptr = xs, *iend = xs + n;
+    while (((uintptr_t)iptr & 15) != 0 && iptr != iend) {
+        to_les24_1(optr, iptr);
+        iptr += 1;
+        optr += 3;
+    }
+    // The remaining 4 bytes of each store are overwritten by later samples,
+    // so at least 2 samples must follow each block.
+    while (iend - iptr >= 8 + 2) {
+        to_les24_4(optr, _mm_load_ps(iptr));
+        to_les24_4(optr + 12, _mm_load_ps(iptr + 4));
+        iptr += 8;
+        optr += 24;
+    }
+    while (iptr != iend) {
+        to_les24_1(optr, iptr);
+        iptr += 1;
+        optr += 3;
+    }
+}
+
+void ufxr_to_les24_stereo(int n, void *restrict out, const float *restrict xs0,
+                          const float *restrict xs1) {
+    char *optr = out;
+    int i = 0;
+    // At least 2 samples, or 1 frame, must follow each block.
+    for (; n - i >= 4 + 1; i += 4) {
+        __m128 x = _mm_loadu_ps(xs0 + i), y = _mm_loadu_ps(xs1 + i);
+        to_les24_4(optr, _mm_unpacklo_ps(x, y));
+        to_les24_4(optr + 12, _mm_unpackhi_ps(x, y));
+        optr += 24;
+    }
+    for (; i < n; i++) {
+        to_les24_1(optr, xs0 + i);
+        to_les24_1(optr + 3, xs1 + i);
+        optr += 6;
+    }
+}
+#endif
+
+// Scalar version.
 #if !HAVE_FUNC
 #include <math.h>
 #include <string.h>
@@ -19,23 +165,35 @@ static inline unsigned le32(unsigned x) {
 #error "unknown byte order"
 #endif
 
+static inline void to_les24_1(char *restrict pos, float x) {
+    x *= 8388608.0f;
+    int y;
+    if (x < 8388607.0f) {
+        if (x > -8388608.0f) {
+            y = lrintf(x);
+        } else {
+            y = -8388608;
+        }
+    } else {
+        y = 8388607;
+    }
+    y = le32(y);
+    memcpy(pos, &y, 3);
+}
+
 void ufxr_to_les24(int n, void *restrict out, const float *restrict xs) {
     char *pos = out;
     for (int i = 0; i < n; i++) {
-        float x = xs[i] * 8388608.0f;
-        int y;
-        if (x < 8388607.0f) {
-            if (x > -8388608.0f) {
-                y = lrintf(x);
-            } else {
-                y = -8388608;
-            }
-        } else {
-            y = 8388607;
-        }
-        y = le32(y);
-        memcpy(pos, &y, 3);
-        pos += 3;
+        to_les24_1(pos + i * 3, xs[i]);
+    }
+}
+
+void ufxr_to_les24_stereo(int n, void *restrict out, const float *restrict xs0,
+                          const float *restrict xs1) {
+    char *pos = out;
+    for (int i = 0; i < n; i++) {
+        to_les24_1(pos + i * 6, xs0[i]);
+        to_les24_1(pos + i * 6 + 3, xs1[i]);
     }
 }
 #endif
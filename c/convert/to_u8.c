@@ -3,24 +3,184 @@
 
 #include "c/config/config.h"
 
+#include <stdint.h>
+
+// AVX2 version.
+#if !HAVE_FUNC && USE_AVX2
+#define HAVE_FUNC 1
+#include <immintrin.h>
+static inline unsigned char to_u8_1(const float *restrict iptr) {
+    __m128 x = _mm_load_ss(iptr);
+    x = _mm_add_ss(_mm_mul_ss(x, _mm_set_ss(128.0f)), _mm_set_ss(128.0f));
+    x = _mm_max_ss(x, _mm_setzero_ps());
+    x = _mm_min_ss(x, _mm_set_ss(255.0f));
+    return _mm_cvt_ss2si(x);
+}
+
+// Quantize 32 samples.
+static inline void to_u8_32(unsigned char *restrict optr, __m256 x0, __m256 x1,
+                            __m256 x2, __m256 x3) {
+    const __m256 scale = _mm256_set1_ps(128.0f);
+    const __m256 max = _mm256_set1_ps(255.0f);
+    const __m256 min = _mm256_setzero_ps();
+    // Packing works within each 128-bit half, which interleaves the groups of
+    // four samples. This puts them back in order.
+    const __m256i perm = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    x0 = _mm256_add_ps(_mm256_mul_ps(x0, scale), scale);
+    x1 = _mm256_add_ps(_mm256_mul_ps(x1, scale), scale);
+    x2 = _mm256_add_ps(_mm256_mul_ps(x2, scale), scale);
+    x3 = _mm256_add_ps(_mm256_mul_ps(x3, scale), scale);
+    x0 = _mm256_min_ps(_mm256_max_ps(x0, min), max);
+    x1 = _mm256_min_ps(_mm256_max_ps(x1, min), max);
+    x2 = _mm256_min_ps(_mm256_max_ps(x2, min), max);
+    x3 = _mm256_min_ps(_mm256_max_ps(x3, min), max);
+    __m256i s01 =
+        _mm256_packs_epi32(_mm256_cvtps_epi32(x0), _mm256_cvtps_epi32(x1));
+    __m256i s23 =
+        _mm256_packs_epi32(_mm256_cvtps_epi32(x2), _mm256_cvtps_epi32(x3));
+    __m256i s = _mm256_packus_epi16(s01, s23);
+    s = _mm256_permutevar8x32_epi32(s, perm);
+    _mm256_storeu_si256((void *)optr, s);
+}
+
+// Interleave 8 samples from each channel.
+static inline void interleave(__m256 *restrict y0, __m256 *restrict y1,
+                              __m256 x0, __m256 x1) {
+    __m256 lo = _mm256_unpacklo_ps(x0, x1), hi = _mm256_unpackhi_ps(x0, x1);
+    *y0 = _mm256_permute2f128_ps(lo, hi, 0x20);
+    *y1 = _mm256_permute2f128_ps(lo, hi, 0x31);
+}
+
+void ufxr_to_u8(int n, void *restrict out, const float *restrict xs) {
+    unsigned char *optr = out;
+    const float *iptr = xs, *iend = xs + n;
+    while (((uintptr_t)iptr & 31) != 0 && iptr != iend) {
+        *optr++ = to_u8_1(iptr++);
+    }
+    while (iend - iptr >= 32) {
+        to_u8_32(optr, _mm256_load_ps(iptr), _mm256_load_ps(iptr + 8),
+                 _mm256_load_ps(iptr + 16), _mm256_load_ps(iptr + 24));
+        iptr += 32;
+        optr += 32;
+    }
+    while (iptr != iend) {
+        *optr++ = to_u8_1(iptr++);
+    }
+}
+
+void ufxr_to_u8_stereo(int n, void *restrict out, const float *restrict xs0,
+                       const float *restrict xs1) {
+    unsigned char *optr = out;
+    int i = 0;
+    for (; n - i >= 16; i += 16) {
+        __m256 x0, x1, x2, x3;
+        interleave(&x0, &x1, _mm256_loadu_ps(xs0 + i),
+                   _mm256_loadu_ps(xs1 + i));
+        interleave(&x2, &x3, _mm256_loadu_ps(xs0 + i + 8),
+                   _mm256_loadu_ps(xs1 + i + 8));
+        to_u8_32(optr, x0, x1, x2, x3);
+        optr += 32;
+    }
+    for (; i < n; i++) {
+        *optr++ = to_u8_1(xs0 + i);
+        *optr++ = to_u8_1(xs1 + i);
+    }
+}
+#endif
+
+// SSE2 version.
+#if !HAVE_FUNC && USE_SSE2
+#define HAVE_FUNC 1
+#include <emmintrin.h>
+static inline unsigned char to_u8_1(const float *restrict iptr) {
+    __m128 x = _mm_load_ss(iptr);
+    x = _mm_add_ss(_mm_mul_ss(x, _mm_set_ss(128.0f)), _mm_set_ss(128.0f));
+    x = _mm_max_ss(x, _mm_setzero_ps());
+    x = _mm_min_ss(x, _mm_set_ss(255.0f));
+    return _mm_cvt_ss2si(x);
+}
+
+// Quantize 16 samples.
+static inline void to_u8_16(unsigned char *restrict optr, __m128 x0, __m128 x1,
+                            __m128 x2, __m128 x3) {
+    const __m128 scale = _mm_set1_ps(128.0f);
+    const __m128 max = _mm_set1_ps(255.0f);
+    const __m128 min = _mm_setzero_ps();
+    x0 = _mm_add_ps(_mm_mul_ps(x0, scale), scale);
+    x1 = _mm_add_ps(_mm_mul_ps(x1, scale), scale);
+    x2 = _mm_add_ps(_mm_mul_ps(x2, scale), scale);
+    x3 = _mm_add_ps(_mm_mul_ps(x3, scale), scale);
+    x0 = _mm_min_ps(_mm_max_ps(x0, min), max);
+    x1 = _mm_min_ps(_mm_max_ps(x1, min), max);
+    x2 = _mm_min_ps(_mm_max_ps(x2, min), max);
+    x3 = _mm_min_ps(_mm_max_ps(x3, min), max);
+    __m128i s01 = _mm_packs_epi32(_mm_cvtps_epi32(x0), _mm_cvtps_epi32(x1));
+    __m128i s23 = _mm_packs_epi32(_mm_cvtps_epi32(x2), _mm_cvtps_epi32(x3));
+    _mm_storeu_si128((void *)optr, _mm_packus_epi16(s01, s23));
+}
+
+void ufxr_to_u8(int n, void *restrict out, const float *restrict xs) {
+    unsigned char *optr = out;
+    const float *iptr = xs, *iend = xs + n;
+    while (((uintptr_t)iptr & 15) != 0 && iptr != iend) {
+        *optr++ = to_u8_1(iptr++);
+    }
+    while (iend - iptr >= 16) {
+        to_u8_16(optr, _mm_load_ps(iptr), _mm_load_ps(iptr + 4),
+                 _mm_load_ps(iptr + 8), _mm_load_ps(iptr + 12));
+        iptr += 16;
+        optr += 16;
+    }
+    while (iptr != iend) {
+        *optr++ = to_u8_1(iptr++);
+    }
+}
+
+void ufxr_to_u8_stereo(int n, void *restrict out, const float *restrict xs0,
+                       const float *restrict xs1) {
+    unsigned char *optr = out;
+    int i = 0;
+    for (; n - i >= 8; i += 8) {
+        __m128 x0 = _mm_loadu_ps(xs0 + i), y0 = _mm_loadu_ps(xs1 + i);
+        __m128 x1 = _mm_loadu_ps(xs0 + i + 4), y1 = _mm_loadu_ps(xs1 + i + 4);
+        to_u8_16(optr, _mm_unpacklo_ps(x0, y0), _mm_unpackhi_ps(x0, y0),
+                 _mm_unpacklo_ps(x1, y1), _mm_unpackhi_ps(x1, y1));
+        optr += 16;
+    }
+    for (; i < n; i++) {
+        *optr++ = to_u8_1(xs0 + i);
+        *optr++ = to_u8_1(xs1 + i);
+    }
+}
+#endif
+
 // Scalar version.
 #if !HAVE_FUNC
 #include <math.h>
+static inline unsigned char to_u8_1(float x) {
+    x = x * 128.0f + 128.0f;
+    if (x < 255.0f) {
+        if (x > 0.0f) {
+            return lrintf(x);
+        }
+        return 0;
+    }
+    return 255;
+}
+
 void ufxr_to_u8(int n, void *restrict out, const float *restrict xs) {
-    char *pos = out;
+    unsigned char *pos = out;
     for (int i = 0; i < n; i++) {
-        float x = xs[i] * 128.0f + 128.0f;
-        unsigned char y;
-        if (x < 255.0f) {
-            if (x > 0.0f) {
-                y = lrintf(x);
-            } else {
-                y = 0;
-            }
-        } else {
-            y = 255;
-        }
-        *pos++ = y;
+        pos[i] = to_u8_1(xs[i]);
+    }
+}
+
+void ufxr_to_u8_stereo(int n, void *restrict out, const float *restrict xs0,
+                       const float *restrict xs1) {
+    unsigned char *pos = out;
+    for (int i = 0; i < n; i++) {
+        pos[i * 2] = to_u8_1(xs0[i]);
+        pos[i * 2 + 1] = to_u8_1(xs1[i]);
     }
 }
 #endif
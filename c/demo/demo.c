@@ -1,3 +1,6 @@
+#include "c/dsp/limiter.h"
+#include "c/dsp/loudness.h"
+#include "c/dsp/resample.h"
 #include "c/io/error.h"
 #include "c/io/wave.h"
 #include "c/ops/ops.h"
@@ -6,26 +9,109 @@
 
 #include <limits.h>
 #include <math.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 enum {
     kRateMin = 8000,
     kRateMax = 192000,
+    // Number of samples to process at a time when writing.
+    kBlock = 4096,
 };
 
+// Resample and limit audio as requested, and write it to the wave file. If a
+// meter is given, it measures the audio as it is written.
+static void write_output(struct ufxr_wavewriter *restrict w, int inrate,
+                         int outrate, const struct ufxr_limiterparams *limit,
+                         struct ufxr_loudness *meter, int n,
+                         const float *restrict xs) {
+    struct ufxr_resampler r;
+    struct ufxr_limiter l;
+    struct ufxr_error err;
+    const bool resample = inrate != outrate;
+    int flush = 0, skip = 0, maxout = kBlock;
+    if (resample) {
+        if (!ufxr_resampler_create(&r, inrate, outrate, &err)) {
+            die(0, "could not create resampler");
+        }
+        flush += ufxr_resampler_latency(&r);
+        maxout = ufxr_resampler_maxout(&r, kBlock);
+    }
+    if (limit != NULL) {
+        if (!ufxr_limiter_create(&l, limit, &err)) {
+            die(0, "could not create limiter");
+        }
+        // The limiter delays its output. Skip the delay at the start, and flush
+        // it at the end. The limiter runs at the output rate, so the flush is
+        // scaled to the input rate.
+        skip = ufxr_limiter_latency(&l);
+        flush += (int)((long long)skip * inrate / outrate) + 1;
+    }
+    float *buf = xmalloc(sizeof(float) * maxout);
+    float *limited = xmalloc(sizeof(float) * maxout);
+    float *zeros = xmalloc(sizeof(float) * kBlock);
+    for (int i = 0; i < kBlock; i++) {
+        zeros[i] = 0.0f;
+    }
+    for (int pos = 0; pos < n + flush;) {
+        const float *in = pos < n ? xs + pos : zeros;
+        int end = pos < n ? n : n + flush;
+        int count = end - pos < kBlock ? end - pos : kBlock;
+        const float *out = in;
+        int outcount = count;
+        if (resample) {
+            outcount = ufxr_resampler_process(&r, count, buf, in);
+            out = buf;
+        }
+        if (limit != NULL) {
+            ufxr_limiter_process(&l, outcount, limited, out);
+            int amt = skip < outcount ? skip : outcount;
+            skip -= amt;
+            out = limited + amt;
+            outcount -= amt;
+        }
+        if (meter != NULL) {
+            ufxr_loudness_process(meter, out, outcount);
+        }
+        if (!ufxr_wavewriter_write(w, out, outcount, &err)) {
+            die(0, "error");
+        }
+        pos += count;
+    }
+    if (resample) {
+        ufxr_resampler_destroy(&r);
+    }
+    if (limit != NULL) {
+        ufxr_limiter_destroy(&l);
+    }
+    free(buf);
+    free(limited);
+    free(zeros);
+}
+
 int main(int argc, char **argv) {
     // Parse arguments.
     float f0 = 100.0f, f1 = 5000.0f;
-    int samplerate = 48000;
+    int samplerate = 48000, outrate = 0;
     float length = 1.0f;
     const char *outpath = NULL;
+    const char *dither = "none";
     int bits = 16;
+    float gain = 0.0f, ceiling = -1.0f, loudness = 0.0f;
+    bool limit = false;
     flag_float(&f0, "f0", "starting frequency, Hz");
     flag_float(&f1, "f1", "ending frequency, Hz");
     flag_int(&samplerate, "rate", "sample rate, Hz");
+    flag_int(&outrate, "outrate", "output sample rate, Hz");
     flag_float(&length, "length", "audio length in seconds");
     flag_string(&outpath, "out", "output wav file");
     flag_int(&bits, "bits", "bits per sample");
+    flag_string(&dither, "dither", "dither: none, tpdf, or shaped");
+    flag_float(&gain, "gain", "output gain, dB");
+    flag_bool(&limit, "limit", "limit peaks before writing");
+    flag_float(&ceiling, "ceiling", "limiter ceiling, dBFS");
+    flag_float(&loudness, "loudness", "normalize to loudness, LUFS");
     argc = flag_parse(argc, argv);
     if (argc != 0) {
         die_usagef("unexpected argument %s", quote_str(argv[0]));
@@ -37,6 +123,12 @@ int main(int argc, char **argv) {
         die_usagef("sample rate %d is too large, must be in the range %d-%d",
                    samplerate, kRateMin, kRateMax);
     }
+    if (outrate == 0) {
+        outrate = samplerate;
+    } else if (outrate < kRateMin || outrate > kRateMax) {
+        die_usagef("output sample rate %d is out of range, must be %d-%d",
+                   outrate, kRateMin, kRateMax);
+    }
     float nsamplef = rintf((float)samplerate * length);
     if (nsamplef < 1.0f) {
         die_usagef("length %fs is too short", (double)length);
@@ -66,6 +158,17 @@ int main(int argc, char **argv) {
         die_usagef("unsupported bits per sample %d (must be 8, 16, 24, or 32)",
                    bits);
     }
+    ufxr_dithermode dithermode;
+    if (strcmp(dither, "none") == 0) {
+        dithermode = kUFXRDitherNone;
+    } else if (strcmp(dither, "tpdf") == 0) {
+        dithermode = kUFXRDitherTPDF;
+    } else if (strcmp(dither, "shaped") == 0) {
+        dithermode = kUFXRDitherShaped;
+    } else {
+        die_usagef("unknown dither %s (must be none, tpdf, or shaped)",
+                   quote_str(dither));
+    }
 
     // Generate samples.
     float *x1 = xmalloc(sizeof(float) * n);
@@ -76,22 +179,61 @@ int main(int argc, char **argv) {
     ufxr_exp2_3(n, x2, x1);
     ufxr_osc(n, x1, x2);
     ufxr_sin1_2(n, x2, x1);
+    if (gain != 0.0f) {
+        float scale = powf(10.0f, 0.05f * gain);
+        for (int i = 0; i < n; i++) {
+            x2[i] *= scale;
+        }
+    }
+
+    // Normalize loudness. The audio is measured, then scaled in place.
+    struct ufxr_loudness meter;
+    struct ufxr_error err;
+    if (loudness != 0.0f) {
+        if (!ufxr_loudness_create(&meter, samplerate, 1, &err)) {
+            die(0, "could not create loudness meter");
+        }
+        ufxr_loudness_process(&meter, x2, n);
+        printf("Input: %.1f LUFS, %.1f dBTP\n",
+               ufxr_loudness_integrated(&meter),
+               ufxr_loudness_truepeak(&meter));
+        ufxr_loudness_normalize(&meter, loudness, x2, n);
+        ufxr_loudness_destroy(&meter);
+    }
+    if (!ufxr_loudness_create(&meter, outrate, 1, &err)) {
+        die(0, "could not create loudness meter");
+    }
 
     // Write output.
     struct ufxr_wavewriter w;
-    struct ufxr_error err;
     struct ufxr_waveinfo info = {
-        .samplerate = samplerate,
+        .samplerate = outrate,
         .channels = 1,
         .format = format,
-        .length = n,
+        .length = (long long)n * outrate / samplerate,
     };
     if (!ufxr_wavewriter_create(&w, outpath, &info, &err)) {
         die(0, "error");
     }
-    if (!ufxr_wavewriter_write(&w, x2, n, &err)) {
-        die(0, "error");
+    ufxr_wavewriter_setdither(&w, dithermode);
+    if (outrate == samplerate && !limit) {
+        ufxr_loudness_process(&meter, x2, n);
+        if (!ufxr_wavewriter_write(&w, x2, n, &err)) {
+            die(0, "error");
+        }
+    } else {
+        const struct ufxr_limiterparams lp = {
+            .samplerate = outrate,
+            .ceiling = ceiling,
+            .lookahead = 0.002f,
+            .release = 0.05f,
+        };
+        write_output(&w, samplerate, outrate, limit ? &lp : NULL, &meter, n,
+                     x2);
     }
+    printf("Output: %.1f LUFS, %.1f dBTP\n", ufxr_loudness_integrated(&meter),
+           ufxr_loudness_truepeak(&meter));
+    ufxr_loudness_destroy(&meter);
     if (!ufxr_wavewriter_finish(&w, &err)) {
         die(0, "error");
     }
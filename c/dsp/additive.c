@@ -0,0 +1,234 @@
+// additive.c - Additive synthesis.
+#include "c/dsp/additive.h"
+
+#include "c/dsp/impl.h"
+#include "c/io/error.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Per-partial state. The state is stored as structure of arrays.
+enum {
+    kAdditiveK,     // Recurrence coefficient, 2 cos(w).
+    kAdditiveY1,    // Previous output, at the start of the period.
+    kAdditiveY2,    // Output before previous, at the start of the period.
+    kAdditiveAmp,   // Amplitude at the start of the period.
+    kAdditiveDelta, // Amplitude increment per sample.
+    kAdditiveFieldCount,
+};
+
+enum {
+    // Arrays are padded to a multiple of this many partials. Padding partials
+    // have zero amplitude and stay silent.
+    kAdditiveGroup = 8,
+    kAdditiveMaxPeriod = 4096,
+};
+
+static inline float *additive_field(const struct ufxr_additive *restrict a,
+                                    int field) {
+    return a->state + field * a->capacity;
+}
+
+// AVX version.
+#if !HAVE_FUNC && USE_AVX
+#define HAVE_FUNC 1
+#include <immintrin.h>
+
+// Generate one control period of audio. Each group of partials is run for the
+// whole period with its state in registers, and accumulated into a temporary
+// buffer with one vector per sample. The vectors are summed at the end.
+static void additive_run(struct ufxr_additive *restrict a,
+                         float *restrict outs) {
+    const int cap = a->capacity, period = a->period;
+    const float *restrict ks = additive_field(a, kAdditiveK),
+                          *restrict y1s = additive_field(a, kAdditiveY1),
+                          *restrict y2s = additive_field(a, kAdditiveY2),
+                          *restrict amps = additive_field(a, kAdditiveAmp),
+                          *restrict deltas = additive_field(a, kAdditiveDelta);
+    float *restrict temp = a->temp;
+    memset(temp, 0, sizeof(float) * 8 * period);
+    for (int i = 0; i < cap; i += 8) {
+        const __m256 k = _mm256_load_ps(ks + i);
+        const __m256 delta = _mm256_load_ps(deltas + i);
+        __m256 y1 = _mm256_load_ps(y1s + i), y2 = _mm256_load_ps(y2s + i);
+        __m256 amp = _mm256_load_ps(amps + i);
+        for (int j = 0; j < period; j++) {
+            __m256 y = _mm256_sub_ps(_mm256_mul_ps(k, y1), y2);
+            y2 = y1;
+            y1 = y;
+            amp = _mm256_add_ps(amp, delta);
+            _mm256_store_ps(temp + 8 * j,
+                            _mm256_add_ps(_mm256_load_ps(temp + 8 * j),
+                                          _mm256_mul_ps(amp, y)));
+        }
+    }
+    for (int j = 0; j < period; j += 4) {
+        __m128 v[4];
+        for (int r = 0; r < 4; r++) {
+            __m256 x = _mm256_load_ps(temp + 8 * (j + r));
+            v[r] = _mm_add_ps(_mm256_castps256_ps128(x),
+                              _mm256_extractf128_ps(x, 1));
+        }
+        _MM_TRANSPOSE4_PS(v[0], v[1], v[2], v[3]);
+        _mm_store_ps(outs + j, _mm_add_ps(_mm_add_ps(v[0], v[1]),
+                                          _mm_add_ps(v[2], v[3])));
+    }
+}
+#endif
+
+// SSE2 version.
+#if !HAVE_FUNC && USE_SSE2
+#define HAVE_FUNC 1
+#include <xmmintrin.h>
+
+static void additive_run(struct ufxr_additive *restrict a,
+                         float *restrict outs) {
+    const int cap = a->capacity, period = a->period;
+    const float *restrict ks = additive_field(a, kAdditiveK),
+                          *restrict y1s = additive_field(a, kAdditiveY1),
+                          *restrict y2s = additive_field(a, kAdditiveY2),
+                          *restrict amps = additive_field(a, kAdditiveAmp),
+                          *restrict deltas = additive_field(a, kAdditiveDelta);
+    float *restrict temp = a->temp;
+    memset(temp, 0, sizeof(float) * 4 * period);
+    for (int i = 0; i < cap; i += 4) {
+        const __m128 k = _mm_load_ps(ks + i);
+        const __m128 delta = _mm_load_ps(deltas + i);
+        __m128 y1 = _mm_load_ps(y1s + i), y2 = _mm_load_ps(y2s + i);
+        __m128 amp = _mm_load_ps(amps + i);
+        for (int j = 0; j < period; j++) {
+            __m128 y = _mm_sub_ps(_mm_mul_ps(k, y1), y2);
+            y2 = y1;
+            y1 = y;
+            amp = _mm_add_ps(amp, delta);
+            _mm_store_ps(temp + 4 * j, _mm_add_ps(_mm_load_ps(temp + 4 * j),
+                                                  _mm_mul_ps(amp, y)));
+        }
+    }
+    for (int j = 0; j < period; j += 4) {
+        __m128 v0 = _mm_load_ps(temp + 4 * j);
+        __m128 v1 = _mm_load_ps(temp + 4 * j + 4);
+        __m128 v2 = _mm_load_ps(temp + 4 * j + 8);
+        __m128 v3 = _mm_load_ps(temp + 4 * j + 12);
+        _MM_TRANSPOSE4_PS(v0, v1, v2, v3);
+        _mm_store_ps(outs + j, _mm_add_ps(_mm_add_ps(v0, v1),
+                                          _mm_add_ps(v2, v3)));
+    }
+}
+#endif
+
+// Scalar version.
+#if !HAVE_FUNC
+static void additive_run(struct ufxr_additive *restrict a,
+                         float *restrict outs) {
+    const int count = a->partials, period = a->period;
+    const float *restrict ks = additive_field(a, kAdditiveK),
+                          *restrict y1s = additive_field(a, kAdditiveY1),
+                          *restrict y2s = additive_field(a, kAdditiveY2),
+                          *restrict amps = additive_field(a, kAdditiveAmp),
+                          *restrict deltas = additive_field(a, kAdditiveDelta);
+    memset(outs, 0, sizeof(float) * period);
+    for (int i = 0; i < count; i++) {
+        const float k = ks[i], delta = deltas[i];
+        float y1 = y1s[i], y2 = y2s[i], amp = amps[i];
+        for (int j = 0; j < period; j++) {
+            float y = k * y1 - y2;
+            y2 = y1;
+            y1 = y;
+            amp += delta;
+            outs[j] += amp * y;
+        }
+    }
+}
+#endif
+
+bool ufxr_additive_create(struct ufxr_additive *restrict a, int samplerate,
+                          int partials, int period, struct ufxr_error *err) {
+    if (samplerate <= 0 || partials < 1 ||
+        partials > UFXR_ADDITIVE_MAXPARTIALS || period < UFXR_QUANTUM ||
+        period % UFXR_QUANTUM != 0 || period > kAdditiveMaxPeriod) {
+        ufxr_error_setcode(err, kUFXRErrorInvalidArgument);
+        return false;
+    }
+    const int capacity =
+        (partials + kAdditiveGroup - 1) & ~(kAdditiveGroup - 1);
+    *a = (struct ufxr_additive){
+        .samplerate = samplerate,
+        .partials = partials,
+        .capacity = capacity,
+        .period = period,
+    };
+    a->state = ufxr_alloc(sizeof(float) * kAdditiveFieldCount * capacity);
+    a->phase = ufxr_alloc(sizeof(double) * capacity);
+    a->omega = ufxr_alloc(sizeof(double) * capacity);
+    a->temp = ufxr_alloc(sizeof(float) * kAdditiveGroup * period);
+    if (a->state == NULL || a->phase == NULL || a->omega == NULL ||
+        a->temp == NULL) {
+        ufxr_error_seterrno(err);
+        ufxr_additive_destroy(a);
+        return false;
+    }
+    return true;
+}
+
+void ufxr_additive_destroy(struct ufxr_additive *restrict a) {
+    free(a->state);
+    free(a->phase);
+    free(a->omega);
+    free(a->temp);
+    a->state = NULL;
+    a->phase = NULL;
+    a->omega = NULL;
+    a->temp = NULL;
+}
+
+void ufxr_additive_reset(struct ufxr_additive *restrict a) {
+    memset(a->phase, 0, sizeof(double) * a->capacity);
+    memset(additive_field(a, kAdditiveAmp), 0, sizeof(float) * a->capacity);
+}
+
+void ufxr_additive_setfreqs(struct ufxr_additive *restrict a,
+                            const float *restrict freqs) {
+    const double pi = 4.0 * atan(1.0);
+    const double scale = 2.0 * pi / a->samplerate;
+    float *restrict ks = additive_field(a, kAdditiveK);
+    for (int i = 0; i < a->partials; i++) {
+        double w = scale * (double)freqs[i];
+        if (!(w > 0.0 && w < pi)) {
+            // Silent. The phase stays at zero, so the recurrence stays at
+            // zero.
+            w = 0.0;
+            a->phase[i] = 0.0;
+        }
+        a->omega[i] = w;
+        ks[i] = 2.0 * cos(w);
+    }
+}
+
+void ufxr_additive_process(struct ufxr_additive *restrict a, int n,
+                           float *restrict outs, const float *restrict amps) {
+    const double pi = 4.0 * atan(1.0);
+    const int count = a->partials, period = a->period;
+    const float rperiod = 1.0f / (float)period;
+    float *restrict y1s = additive_field(a, kAdditiveY1),
+                    *restrict y2s = additive_field(a, kAdditiveY2),
+                    *restrict curamps = additive_field(a, kAdditiveAmp),
+                    *restrict deltas = additive_field(a, kAdditiveDelta);
+    double *restrict phase = a->phase;
+    const double *restrict omega = a->omega;
+    for (int pos = 0; pos < n; pos += period) {
+        // Restart each recurrence so that its next output is sin(phase).
+        const float *restrict target = amps + (size_t)(pos / period) * count;
+        for (int i = 0; i < count; i++) {
+            double p = phase[i], w = omega[i];
+            y1s[i] = sin(p - w);
+            y2s[i] = sin(p - 2.0 * w);
+            deltas[i] = (target[i] - curamps[i]) * rperiod;
+            p = fmod(p + period * w, 2.0 * pi);
+            phase[i] = p;
+        }
+        additive_run(a, outs + pos);
+        memcpy(curamps, target, sizeof(float) * count);
+    }
+}
@@ -0,0 +1,62 @@
+// c/dsp/additive.h - Additive synthesis.
+#pragma once
+
+#include <stdbool.h>
+
+struct ufxr_error;
+
+// Maximum number of partials in an additive oscillator.
+#define UFXR_ADDITIVE_MAXPARTIALS 1024
+
+// An additive oscillator, which sums many sine wave partials with individual
+// frequencies and amplitude envelopes.
+//
+// Each partial is generated with the recurrence s[n] = 2 cos(w) s[n-1] -
+// s[n-2], so a partial costs a few arithmetic operations per sample and no
+// polynomial evaluation. Partials are processed in parallel, several per
+// vector. To keep rounding errors from accumulating, the recurrence is
+// restarted from a double-precision phase at the start of every control
+// period.
+//
+// Amplitudes and frequencies change at control rate. Amplitudes are ramped
+// linearly over each control period.
+//
+// All fields are private. Do not access them.
+struct ufxr_additive {
+    int samplerate;
+    int partials;
+    int capacity;
+    int period;
+    float *state;
+    double *phase;
+    double *omega;
+    float *temp;
+};
+
+// Create an additive oscillator. The number of partials must be in the range 1
+// to UFXR_ADDITIVE_MAXPARTIALS. The control period, in samples, must be a
+// positive multiple of UFXR_QUANTUM, at most 4096. All partials start with
+// zero frequency and zero amplitude. If successful, destroy() must be called
+// to release resources. This is the only function which allocates memory.
+bool ufxr_additive_create(struct ufxr_additive *restrict a, int samplerate,
+                          int partials, int period, struct ufxr_error *err);
+
+// Destroy an additive oscillator and release any resources.
+void ufxr_additive_destroy(struct ufxr_additive *restrict a);
+
+// Reset the phase and amplitude of every partial to zero. Frequencies are
+// unchanged.
+void ufxr_additive_reset(struct ufxr_additive *restrict a);
+
+// Set the frequency of each partial, in Hz. The array has one element per
+// partial. Partials at or above the Nyquist frequency are silent. Takes effect
+// at the start of the next control period.
+void ufxr_additive_setfreqs(struct ufxr_additive *restrict a,
+                            const float *restrict freqs);
+
+// Generate audio. The size must be a multiple of the control period. The
+// amplitude array has one row for each control period, and each row has one
+// element per partial. The amplitude of each partial ramps linearly from its
+// previous value to the value in the row over the control period.
+void ufxr_additive_process(struct ufxr_additive *restrict a, int n,
+                           float *restrict outs, const float *restrict amps);
@@ -0,0 +1,26 @@
+// alloc.c - Memory allocation.
+#include "c/dsp/impl.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Instantiate inline functions
+
+unsigned ufxr_pow2(unsigned n);
+
+void *ufxr_alloc(size_t size) {
+    size_t asize = (size + UFXR_DSP_ALIGN - 1) & ~(size_t)(UFXR_DSP_ALIGN - 1);
+    if (asize < size) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    if (asize == 0) {
+        asize = UFXR_DSP_ALIGN;
+    }
+    void *ptr = aligned_alloc(UFXR_DSP_ALIGN, asize);
+    if (ptr != NULL) {
+        memset(ptr, 0, asize);
+    }
+    return ptr;
+}
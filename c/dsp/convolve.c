@@ -0,0 +1,165 @@
+// convolve.c - Partitioned convolution.
+#include "c/dsp/convolve.h"
+
+#include "c/dsp/impl.h"
+#include "c/io/error.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// SSE2 version.
+#if !HAVE_FUNC && USE_SSE2
+#define HAVE_FUNC 1
+#include <xmmintrin.h>
+
+// Multiply and accumulate spectra in split format: acc += x * h. The first
+// vector contains the DC and Nyquist bins, which are real, so it is done
+// separately.
+static void convolver_macc(int n, float *restrict acc, const float *restrict x,
+                           const float *restrict h) {
+    const int m = n / 2;
+    acc[0] += x[0] * h[0];
+    acc[m] += x[m] * h[m];
+    for (int k = 1; k < 4; k++) {
+        float xr = x[k], xi = x[m + k], hr = h[k], hi = h[m + k];
+        acc[k] += xr * hr - xi * hi;
+        acc[m + k] += xr * hi + xi * hr;
+    }
+    for (int k = 4; k < m; k += 4) {
+        __m128 xr = _mm_load_ps(x + k), xi = _mm_load_ps(x + m + k);
+        __m128 hr = _mm_load_ps(h + k), hi = _mm_load_ps(h + m + k);
+        __m128 ar = _mm_load_ps(acc + k), ai = _mm_load_ps(acc + m + k);
+        ar = _mm_add_ps(ar, _mm_sub_ps(_mm_mul_ps(xr, hr), _mm_mul_ps(xi, hi)));
+        ai = _mm_add_ps(ai, _mm_add_ps(_mm_mul_ps(xr, hi), _mm_mul_ps(xi, hr)));
+        _mm_store_ps(acc + k, ar);
+        _mm_store_ps(acc + m + k, ai);
+    }
+}
+#endif
+
+// Scalar version.
+#if !HAVE_FUNC
+static void convolver_macc(int n, float *restrict acc, const float *restrict x,
+                           const float *restrict h) {
+    const int m = n / 2;
+    acc[0] += x[0] * h[0];
+    acc[m] += x[m] * h[m];
+    for (int k = 1; k < m; k++) {
+        float xr = x[k], xi = x[m + k], hr = h[k], hi = h[m + k];
+        acc[k] += xr * hr - xi * hi;
+        acc[m + k] += xr * hi + xi * hr;
+    }
+}
+#endif
+
+bool ufxr_convolver_create(struct ufxr_convolver *restrict c, int blocksize,
+                           int irlen, const float *restrict ir,
+                           struct ufxr_error *err) {
+    if (blocksize < 4 || (blocksize & (blocksize - 1)) != 0 || irlen < 1 ||
+        blocksize > (1 << 24)) {
+        ufxr_error_setcode(err, kUFXRErrorInvalidArgument);
+        return false;
+    }
+    const int nb = blocksize, nfft = 2 * blocksize;
+    const int np = irlen / nb + (irlen % nb != 0);
+    *c = (struct ufxr_convolver){
+        .blocksize = nb,
+        .partitions = np,
+    };
+    if (!ufxr_fft_create(&c->fft, nfft, err)) {
+        return false;
+    }
+    const size_t specsize = sizeof(float) * (size_t)np * nfft;
+    c->irspec = ufxr_alloc(specsize);
+    c->fdl = ufxr_alloc(specsize);
+    c->input = ufxr_alloc(sizeof(float) * nfft);
+    c->output = ufxr_alloc(sizeof(float) * nb);
+    c->accum = ufxr_alloc(sizeof(float) * nfft);
+    c->temp = ufxr_alloc(sizeof(float) * nfft);
+    if (c->irspec == NULL || c->fdl == NULL || c->input == NULL ||
+        c->output == NULL || c->accum == NULL || c->temp == NULL) {
+        ufxr_error_seterrno(err);
+        ufxr_convolver_destroy(c);
+        return false;
+    }
+
+    // Transform each partition of the impulse response. The normalization of
+    // the inverse FFT is folded in here.
+    const float scale = 1.0f / (float)nfft;
+    float *restrict temp = c->temp;
+    for (int p = 0; p < np; p++) {
+        int pos = p * nb, len = irlen - pos < nb ? irlen - pos : nb;
+        for (int i = 0; i < len; i++) {
+            temp[i] = ir[pos + i] * scale;
+        }
+        for (int i = len; i < nfft; i++) {
+            temp[i] = 0.0f;
+        }
+        ufxr_fft_forward(&c->fft, c->irspec + (size_t)p * nfft, temp);
+    }
+    return true;
+}
+
+void ufxr_convolver_destroy(struct ufxr_convolver *restrict c) {
+    ufxr_fft_destroy(&c->fft);
+    free(c->irspec);
+    free(c->fdl);
+    free(c->input);
+    free(c->output);
+    free(c->accum);
+    free(c->temp);
+    c->irspec = NULL;
+    c->fdl = NULL;
+    c->input = NULL;
+    c->output = NULL;
+    c->accum = NULL;
+    c->temp = NULL;
+}
+
+void ufxr_convolver_reset(struct ufxr_convolver *restrict c) {
+    const int nb = c->blocksize, nfft = 2 * nb;
+    memset(c->fdl, 0, sizeof(float) * (size_t)c->partitions * nfft);
+    memset(c->input, 0, sizeof(float) * nfft);
+    memset(c->output, 0, sizeof(float) * nb);
+    c->fill = 0;
+    c->current = 0;
+}
+
+// Process one full block of input.
+static void convolver_block(struct ufxr_convolver *restrict c) {
+    const int nb = c->blocksize, nfft = 2 * nb, np = c->partitions;
+    int current = c->current == 0 ? np - 1 : c->current - 1;
+    c->current = current;
+    float *restrict fdl = c->fdl, *restrict accum = c->accum;
+    const float *restrict irspec = c->irspec;
+    ufxr_fft_forward(&c->fft, fdl + (size_t)current * nfft, c->input);
+    memset(accum, 0, sizeof(float) * nfft);
+    for (int p = 0, slot = current; p < np; p++) {
+        convolver_macc(nfft, accum, fdl + (size_t)slot * nfft,
+                       irspec + (size_t)p * nfft);
+        slot = slot + 1 == np ? 0 : slot + 1;
+    }
+    // Overlap-save: the first half of the result is aliased, and the second
+    // half is the output.
+    ufxr_fft_inverse(&c->fft, c->temp, accum);
+    memcpy(c->output, c->temp + nb, sizeof(float) * nb);
+    memcpy(c->input, c->input + nb, sizeof(float) * nb);
+}
+
+void ufxr_convolver_process(struct ufxr_convolver *restrict c, int n,
+                            float *restrict outs, const float *restrict xs) {
+    const int nb = c->blocksize;
+    int fill = c->fill;
+    for (int i = 0; i < n;) {
+        int count = nb - fill < n - i ? nb - fill : n - i;
+        memcpy(c->input + nb + fill, xs + i, sizeof(float) * count);
+        memcpy(outs + i, c->output + fill, sizeof(float) * count);
+        fill += count;
+        i += count;
+        if (fill == nb) {
+            convolver_block(c);
+            fill = 0;
+        }
+    }
+    c->fill = fill;
+}
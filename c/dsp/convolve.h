@@ -0,0 +1,54 @@
+// c/dsp/convolve.h - Partitioned convolution.
+#pragma once
+
+#include "c/fft/fft.h"
+
+#include <stdbool.h>
+
+struct ufxr_error;
+
+// A convolution engine for long impulse responses.
+//
+// The impulse response is split into partitions equal to the block size, and
+// each partition is convolved in the frequency domain using an FFT twice the
+// block size (uniformly partitioned overlap-save). Spectra of past input blocks
+// are kept in a frequency-domain delay line, so each block costs one forward
+// FFT, one inverse FFT, and one complex multiply-accumulate per partition,
+// regardless of where it falls in the impulse response.
+//
+// Latency is equal to the block size.
+//
+// All fields are private. Do not access them.
+struct ufxr_convolver {
+    struct ufxr_fft fft;
+    int blocksize;
+    int partitions;
+    int fill;
+    int current;
+    float *irspec;
+    float *fdl;
+    float *input;
+    float *output;
+    float *accum;
+    float *temp;
+};
+
+// Create a convolution engine for the given impulse response. The block size
+// must be a power of two, at least 4. If successful, destroy() must be called
+// to release resources. This is the only function which allocates memory.
+bool ufxr_convolver_create(struct ufxr_convolver *restrict c, int blocksize,
+                           int irlen, const float *restrict ir,
+                           struct ufxr_error *err);
+
+// Destroy a convolution engine and release any resources.
+void ufxr_convolver_destroy(struct ufxr_convolver *restrict c);
+
+// Clear the convolution state, silencing the tail.
+void ufxr_convolver_reset(struct ufxr_convolver *restrict c);
+
+// Process audio. Output is delayed by the block size. The state is preserved
+// between calls, so a long signal can be processed in blocks of any size,
+// although the work is done one full block at a time. Does not allocate
+// memory.
+void ufxr_convolver_process(struct ufxr_convolver *restrict c, int n,
+                            float *restrict outs, const float *restrict xs);
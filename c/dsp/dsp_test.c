@@ -0,0 +1,1326 @@
+#include "c/dsp/additive.h"
+#include "c/dsp/convolve.h"
+#include "c/dsp/granular.h"
+#include "c/dsp/limiter.h"
+#include "c/dsp/loudness.h"
+#include "c/dsp/modal.h"
+#include "c/dsp/oversample.h"
+#include "c/dsp/pm.h"
+#include "c/dsp/resample.h"
+#include "c/dsp/reverb.h"
+#include "c/dsp/sampler.h"
+#include "c/dsp/waveguide.h"
+#include "c/dsp/wsola.h"
+#include "c/io/error.h"
+#include "c/io/wave.h"
+#include "c/util/defs.h"
+#include "c/util/util.h"
+
+#include <errno.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+enum {
+    kSampleRate = 48000,
+};
+
+// Return the level of a signal in dB, relative to full scale, as RMS.
+static float level_db(int n, const float *restrict xs) {
+    double sum = 0.0;
+    for (int i = 0; i < n; i++) {
+        sum += (double)xs[i] * (double)xs[i];
+    }
+    return 10.0 * log10(sum / n + 1e-30);
+}
+
+static bool all_finite(int n, const float *restrict xs) {
+    for (int i = 0; i < n; i++) {
+        if (!isfinite(xs[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool test_reverb_lines(int lines) {
+    struct ufxr_reverbparams p = {
+        .samplerate = kSampleRate,
+        .lines = lines,
+        .delay = 0.05f,
+        .decay = 1.0f,
+        .damping = 20000.0f,
+        .moddepth = 0.0005f,
+        .modrate = 0.5f,
+    };
+    struct ufxr_reverb r;
+    struct ufxr_error err;
+    if (!ufxr_reverb_create(&r, &p, &err)) {
+        die(0, "ufxr_reverb_create");
+    }
+    int n = 2 * kSampleRate;
+    float *xs = xmalloc(n * sizeof(float));
+    float *ys = xmalloc(n * sizeof(float));
+    float *zs = xmalloc(n * sizeof(float));
+    memset(xs, 0, n * sizeof(float));
+    xs[0] = 1.0f;
+    ufxr_reverb_process(&r, n, ys, xs);
+    bool success = true;
+    if (!all_finite(n, ys)) {
+        puts("Output is not finite");
+        success = false;
+    }
+
+    // Energy should fall by 60 dB over the decay time. The damping filter is
+    // almost transparent here, so this is mostly a check of the gains.
+    int w = kSampleRate / 10;
+    float l0 = level_db(w, ys + kSampleRate / 10);
+    float l1 = level_db(w, ys + kSampleRate / 10 + kSampleRate);
+    printf("Decay over 1s: %.1f dB\n", (double)(l0 - l1));
+    if (fabsf(l0 - l1 - 60.0f) > 6.0f) {
+        puts("Wrong decay time");
+        success = false;
+    }
+
+    // Output must not depend on how the input is split into blocks.
+    ufxr_reverb_destroy(&r);
+    if (!ufxr_reverb_create(&r, &p, &err)) {
+        die(0, "ufxr_reverb_create");
+    }
+    for (int pos = 0, block = 1; pos < n; block = block * 3 + 1) {
+        int count = n - pos < block ? n - pos : block;
+        ufxr_reverb_process(&r, count, zs + pos, xs + pos);
+        pos += count;
+    }
+    if (memcmp(ys, zs, n * sizeof(float)) != 0) {
+        puts("Output depends on block size");
+        success = false;
+    }
+    ufxr_reverb_destroy(&r);
+    free(xs);
+    free(ys);
+    free(zs);
+    return success;
+}
+
+static bool test_reverb8(void) {
+    return test_reverb_lines(8);
+}
+
+static bool test_reverb16(void) {
+    return test_reverb_lines(16);
+}
+
+static bool test_additive(void) {
+    // More partials than fit in one group, so padding is exercised.
+    enum {
+        kPartials = 11,
+        kPeriod = 64,
+        kLen = 4800,
+    };
+    const double pi = 4.0 * atan(1.0);
+    struct ufxr_additive a;
+    struct ufxr_error err;
+    if (!ufxr_additive_create(&a, kSampleRate, kPartials, kPeriod, &err)) {
+        die(0, "ufxr_additive_create");
+    }
+    float freqs[kPartials];
+    for (int i = 0; i < kPartials; i++) {
+        freqs[i] = 110.0f * (float)(i + 1) * (1.0f + 0.003f * (float)i);
+    }
+    // The last partial is above Nyquist and should be silent.
+    freqs[kPartials - 1] = 25000.0f;
+    ufxr_additive_setfreqs(&a, freqs);
+    const int periods = kLen / kPeriod;
+    float *amps = xmalloc(sizeof(float) * periods * kPartials);
+    float *ys = xmalloc(sizeof(float) * kLen);
+    for (int p = 0; p < periods; p++) {
+        for (int i = 0; i < kPartials; i++) {
+            amps[p * kPartials + i] =
+                expf(-0.05f * (float)(p * (i + 1))) / (float)(i + 1);
+        }
+    }
+    // Process in two calls, to check that state carries over.
+    const int split = 11 * kPeriod;
+    ufxr_additive_process(&a, split, ys, amps);
+    ufxr_additive_process(&a, kLen - split, ys + split,
+                          amps + (split / kPeriod) * kPartials);
+    ufxr_additive_destroy(&a);
+
+    // Compare with sine waves with linear amplitude ramps.
+    double maxerr = 0.0;
+    for (int t = 0; t < kLen; t++) {
+        int p = t / kPeriod;
+        double frac = (double)(t % kPeriod + 1) / kPeriod;
+        double y = 0.0;
+        for (int i = 0; i < kPartials - 1; i++) {
+            double a0 = p == 0 ? 0.0 : (double)amps[(p - 1) * kPartials + i];
+            double a1 = (double)amps[p * kPartials + i];
+            double w = 2.0 * pi * (double)freqs[i] / kSampleRate;
+            y += (a0 + (a1 - a0) * frac) * sin(w * t);
+        }
+        double e = fabs(y - (double)ys[t]);
+        maxerr = e > maxerr ? e : maxerr;
+    }
+    printf("Error: %.2e\n", maxerr);
+    free(amps);
+    free(ys);
+    return maxerr < 1e-4;
+}
+
+static bool test_convolve(void) {
+    // Impulse response which is not a multiple of the block size.
+    enum {
+        kBlock = 64,
+        kIRLen = 1000,
+        kLen = 5000,
+    };
+    float *ir = xmalloc(sizeof(float) * kIRLen);
+    float *xs = xmalloc(sizeof(float) * kLen);
+    float *ys = xmalloc(sizeof(float) * kLen);
+    unsigned state = 1;
+    for (int i = 0; i < kIRLen; i++) {
+        state = state * 1103515245u + 12345u;
+        ir[i] = ((float)(state >> 8) * (1.0f / 16777216.0f) - 0.5f) *
+                expf(-0.005f * (float)i);
+    }
+    for (int i = 0; i < kLen; i++) {
+        state = state * 1103515245u + 12345u;
+        xs[i] = (float)(state >> 8) * (1.0f / 16777216.0f) - 0.5f;
+    }
+    struct ufxr_convolver c;
+    struct ufxr_error err;
+    if (!ufxr_convolver_create(&c, kBlock, kIRLen, ir, &err)) {
+        die(0, "ufxr_convolver_create");
+    }
+    for (int pos = 0, block = 1; pos < kLen; block = block * 3 + 1) {
+        int count = kLen - pos < block ? kLen - pos : block;
+        ufxr_convolver_process(&c, count, ys + pos, xs + pos);
+        pos += count;
+    }
+    ufxr_convolver_destroy(&c);
+
+    // Compare with direct convolution, delayed by the block size.
+    double maxerr = 0.0;
+    for (int i = 0; i < kLen; i++) {
+        double y = 0.0;
+        for (int j = 0; j < kIRLen && j <= i - kBlock; j++) {
+            y += (double)ir[j] * (double)xs[i - kBlock - j];
+        }
+        double e = fabs(y - (double)ys[i]);
+        maxerr = e > maxerr ? e : maxerr;
+    }
+    printf("Error: %.2e\n", maxerr);
+    free(ir);
+    free(xs);
+    free(ys);
+    return maxerr < 1e-4;
+}
+
+static void copy_op(int n, float *restrict outs, const float *restrict xs) {
+    memcpy(outs, xs, sizeof(float) * n);
+}
+
+// Return the RMS error of a signal compared to a sine wave with the given
+// frequency, in cycles per sample, and delay, in samples, in dB relative to the
+// sine wave. The start of the signal is skipped.
+static float sine_error_db(int n, const float *restrict xs, double freq,
+                           double delay, int skip) {
+    const double pi = 4.0 * atan(1.0);
+    double err = 0.0, sig = 0.0;
+    for (int i = skip; i < n; i++) {
+        double y = sin(2.0 * pi * freq * ((double)i - delay));
+        double e = (double)xs[i] - y;
+        err += e * e;
+        sig += y * y;
+    }
+    return 10.0 * log10(err / sig + 1e-30);
+}
+
+static bool test_granular(void) {
+    enum {
+        kSrcLen = 10000,
+        kLen = 9600,
+        kGrains = 2000,
+    };
+    const double pi = 4.0 * atan(1.0);
+    float *src = xmalloc(sizeof(float) * kSrcLen);
+    for (int i = 0; i < kSrcLen; i++) {
+        src[i] = sin(2.0 * pi * 0.01 * i);
+    }
+    struct ufxr_granular g;
+    struct ufxr_error err;
+    if (!ufxr_granular_create(&g, kGrains, kSrcLen, src, &err)) {
+        die(0, "ufxr_granular_create");
+    }
+    float *outs = xmalloc(sizeof(float) * 4 * kLen);
+    float *l1 = outs, *r1 = outs + kLen, *l2 = outs + 2 * kLen,
+          *r2 = outs + 3 * kLen;
+
+    // Schedule a cloud of grains, with some reading outside the source.
+    unsigned state = 1;
+    struct ufxr_grain grains[kGrains];
+    for (int i = 0; i < kGrains; i++) {
+        unsigned r[4];
+        for (int k = 0; k < 4; k++) {
+            state = state * 1103515245u + 12345u;
+            r[k] = state >> 8;
+        }
+        grains[i] = (struct ufxr_grain){
+            .delay = r[0] % (kLen - 1000),
+            .length = 50 + r[1] % 950,
+            .position = (double)(r[2] % (kSrcLen + 200)) - 100.0,
+            .rate = (float)(r[3] % 1000) * 0.003f - 1.0f,
+            .gain = 0.01f,
+            .pan = (float)(i % 21) * 0.1f - 1.0f,
+            .window = i % kUFXRGrainWindowCount,
+        };
+        if (!ufxr_granular_add(&g, &grains[i])) {
+            die(0, "ufxr_granular_add");
+        }
+    }
+    ufxr_granular_process(&g, kLen, l1, r1);
+    bool success = true;
+    if (ufxr_granular_count(&g) != 0) {
+        puts("Grains did not finish");
+        success = false;
+    }
+
+    // The same grains in blocks of different sizes.
+    for (int i = 0; i < kGrains; i++) {
+        ufxr_granular_add(&g, &grains[i]);
+    }
+    for (int pos = 0, block = 1; pos < kLen; block = block * 3 + 1) {
+        int count = kLen - pos < block ? kLen - pos : block;
+        ufxr_granular_process(&g, count, l2 + pos, r2 + pos);
+        pos += count;
+    }
+    double maxerr = 0.0;
+    for (int i = 0; i < 2 * kLen; i++) {
+        double e = fabs((double)l1[i] - (double)l2[i]);
+        maxerr = e > maxerr ? e : maxerr;
+    }
+    printf("Block size difference: %.2e\n", maxerr);
+    if (maxerr > 1e-5) {
+        success = false;
+    }
+
+    // A single Hann grain at unit rate on a constant source with center pan
+    // sums to half its length, times the pan gain.
+    float one[16];
+    for (int i = 0; i < 16; i++) {
+        one[i] = 1.0f;
+    }
+    ufxr_granular_destroy(&g);
+    if (!ufxr_granular_create(&g, 1, 16, one, &err)) {
+        die(0, "ufxr_granular_create");
+    }
+    if (!ufxr_granular_add(&g, &(struct ufxr_grain){
+                                   .delay = 3,
+                                   .length = 14,
+                                   .position = 0.0,
+                                   .rate = 1.0f,
+                                   .gain = 1.0f,
+                                   .pan = 0.0f,
+                                   .window = kUFXRGrainHann,
+                               })) {
+        die(0, "ufxr_granular_add");
+    }
+    ufxr_granular_process(&g, 20, l1, r1);
+    double sum = 0.0;
+    for (int i = 0; i < 20; i++) {
+        sum += (double)l1[i];
+    }
+    double expect = 7.0 * sqrt(0.5);
+    printf("Grain sum: %.4f, expected %.4f\n", sum, expect);
+    if (fabs(sum - expect) > 1e-3 || l1[2] != 0.0f || l1[17] != 0.0f ||
+        l1[8] != r1[8]) {
+        success = false;
+    }
+    ufxr_granular_destroy(&g);
+    free(src);
+    free(outs);
+    return success;
+}
+
+static bool test_limiter(void) {
+    enum {
+        kLen = kSampleRate / 2,
+    };
+    const double pi = 4.0 * atan(1.0);
+    const struct ufxr_limiterparams p = {
+        .samplerate = kSampleRate,
+        .ceiling = -1.0f,
+        .lookahead = 0.002f,
+        .release = 0.05f,
+    };
+    const float ceiling = pow(10.0, -0.05);
+    struct ufxr_limiter l;
+    struct ufxr_error err;
+    if (!ufxr_limiter_create(&l, &p, &err)) {
+        die(0, "ufxr_limiter_create");
+    }
+    const int delay = ufxr_limiter_latency(&l);
+    float *xs = xmalloc(sizeof(float) * kLen);
+    float *ys = xmalloc(sizeof(float) * kLen);
+    bool success = true;
+
+    // Quiet audio passes through unchanged.
+    for (int i = 0; i < kLen; i++) {
+        xs[i] = 0.8 * sin(2.0 * pi * 0.0123 * i);
+    }
+    ufxr_limiter_process(&l, kLen, ys, xs);
+    for (int i = 0; i < kLen; i++) {
+        float x = i < delay ? 0.0f : xs[i - delay];
+        if (ys[i] != x) {
+            printf("Quiet output changed at %d\n", i);
+            success = false;
+            break;
+        }
+    }
+
+    // A burst of loud audio after silence does not exceed the ceiling at any
+    // sample, even at the start of the burst.
+    ufxr_limiter_reset(&l);
+    for (int i = 0; i < kLen; i++) {
+        xs[i] = i < kLen / 4 ? 0.0 : 4.0 * sin(2.0 * pi * 0.0211 * i);
+    }
+    for (int pos = 0, block = 1; pos < kLen; block = block * 3 + 1) {
+        int count = kLen - pos < block ? kLen - pos : block;
+        ufxr_limiter_process(&l, count, ys + pos, xs + pos);
+        pos += count;
+    }
+    float peak = 0.0f;
+    for (int i = 0; i < kLen; i++) {
+        peak = fabsf(ys[i]) > peak ? fabsf(ys[i]) : peak;
+    }
+    printf("Burst peak: %.4f, ceiling %.4f\n", (double)peak, (double)ceiling);
+    if (peak > ceiling || peak < 0.9f * ceiling) {
+        success = false;
+    }
+
+    // A sine at a quarter of the sample rate, sampled 45 degrees from its
+    // peaks, has a true peak which is 3 dB above the sample peak.
+    ufxr_limiter_reset(&l);
+    for (int i = 0; i < kLen; i++) {
+        xs[i] = 1.2 * sin(0.5 * pi * i + 0.25 * pi);
+    }
+    ufxr_limiter_process(&l, kLen, ys, xs);
+    peak = 0.0f;
+    for (int i = kLen / 2; i < kLen; i++) {
+        peak = fabsf(ys[i]) > peak ? fabsf(ys[i]) : peak;
+    }
+    const double truepeak = (double)peak * sqrt(2.0);
+    printf("Intersample true peak: %.4f\n", truepeak);
+    if (truepeak > 1.01 * (double)ceiling ||
+        truepeak < 0.95 * (double)ceiling) {
+        success = false;
+    }
+    ufxr_limiter_destroy(&l);
+    free(xs);
+    free(ys);
+    return success;
+}
+
+// Fill a stereo buffer with a sine wave in both channels.
+static void loudness_sine(int n, float *restrict xs, double freq, double amp,
+                          double phase) {
+    for (int i = 0; i < n; i++) {
+        float x = amp * sin(freq * i + phase);
+        xs[i * 2] = x;
+        xs[i * 2 + 1] = x;
+    }
+}
+
+static bool test_loudness_rate(int samplerate) {
+    const double pi = 4.0 * atan(1.0);
+    const int n = samplerate * 5;
+    float *xs = xmalloc(sizeof(float) * 4 * n);
+    struct ufxr_loudness m;
+    struct ufxr_error err;
+    if (!ufxr_loudness_create(&m, samplerate, 2, &err)) {
+        die(0, "ufxr_loudness_create");
+    }
+    bool success = true;
+
+    // A 997 Hz sine at -20 dBFS in both channels measures -20 LUFS. Process
+    // it in blocks of varying size.
+    loudness_sine(n, xs, 2.0 * pi * 997.0 / samplerate, 0.1, 0.0);
+    for (int pos = 0, block = 1; pos < n; block = block * 3 + 1) {
+        int count = n - pos < block ? n - pos : block;
+        ufxr_loudness_process(&m, xs + pos * 2, count * 2);
+        pos += count;
+    }
+    double lufs = ufxr_loudness_integrated(&m);
+    printf("Rate %d: sine %.3f LUFS\n", samplerate, lufs);
+    if (!(fabs(lufs + 20.0) < 0.05)) {
+        success = false;
+    }
+
+    // Quiet audio more than 10 LU below the rest is gated out. The three
+    // blocks which overlap the change in level are above the gate, and lower
+    // the result by about 0.13 LU.
+    ufxr_loudness_reset(&m);
+    loudness_sine(n, xs + 2 * n, 2.0 * pi * 997.0 / samplerate, 0.001, 0.0);
+    ufxr_loudness_process(&m, xs, 4 * n);
+    lufs = ufxr_loudness_integrated(&m);
+    printf("Rate %d: gated %.3f LUFS\n", samplerate, lufs);
+    if (!(fabs(lufs + 20.13) < 0.02)) {
+        success = false;
+    }
+
+    // A sine at a quarter of the sample rate, sampled 45 degrees from its
+    // peaks, has a true peak which is 3 dB above the sample peak.
+    ufxr_loudness_reset(&m);
+    loudness_sine(n, xs, 0.5 * pi, 1.0, 0.25 * pi);
+    ufxr_loudness_process(&m, xs, 2 * n);
+    double peak = ufxr_loudness_truepeak(&m);
+    printf("Rate %d: true peak %.3f dBTP\n", samplerate, peak);
+    if (!(fabs(peak) < 0.05)) {
+        success = false;
+    }
+
+    // Two-pass normalization.
+    ufxr_loudness_reset(&m);
+    loudness_sine(n, xs, 2.0 * pi * 440.0 / samplerate, 0.5, 0.0);
+    ufxr_loudness_process(&m, xs, 2 * n);
+    ufxr_loudness_normalize(&m, -23.0, xs, 2 * n);
+    ufxr_loudness_reset(&m);
+    ufxr_loudness_process(&m, xs, 2 * n);
+    lufs = ufxr_loudness_integrated(&m);
+    printf("Rate %d: normalized %.3f LUFS\n", samplerate, lufs);
+    if (!(fabs(lufs + 23.0) < 0.01)) {
+        success = false;
+    }
+
+    // Silence has no loudness.
+    ufxr_loudness_reset(&m);
+    for (int i = 0; i < 2 * n; i++) {
+        xs[i] = 0.0f;
+    }
+    ufxr_loudness_process(&m, xs, 2 * n);
+    if (ufxr_loudness_integrated(&m) != -HUGE_VAL ||
+        ufxr_loudness_gain(&m, -23.0) != 1.0) {
+        printf("Rate %d: silence has loudness\n", samplerate);
+        success = false;
+    }
+    ufxr_loudness_destroy(&m);
+    free(xs);
+    return success;
+}
+
+static bool test_loudness(void) {
+    bool success = true;
+    success = test_loudness_rate(48000) && success;
+    success = test_loudness_rate(44100) && success;
+    return success;
+}
+
+static bool test_modal(void) {
+    // More modes than fit in one group, so padding is exercised.
+    enum {
+        kModes = 21,
+        kLen = 4800,
+    };
+    const double pi = 4.0 * atan(1.0);
+    struct ufxr_mode modes[kModes];
+    for (int i = 0; i < kModes; i++) {
+        modes[i] = (struct ufxr_mode){
+            .freq = 200.0f * (float)(i + 1) * (1.0f + 0.01f * (float)i),
+            .decay = 0.05f + 0.01f * (float)i,
+            .gain = 1.0f / (float)(i + 1),
+        };
+    }
+    // The last mode is above Nyquist and should be silent.
+    modes[kModes - 1].freq = 30000.0f;
+    struct ufxr_modalbank m;
+    struct ufxr_error err;
+    if (!ufxr_modalbank_create(&m, kSampleRate, kModes, modes, &err)) {
+        die(0, "ufxr_modalbank_create");
+    }
+    float *xs = xmalloc(sizeof(float) * kLen);
+    float *ys = xmalloc(sizeof(float) * kLen);
+    memset(xs, 0, sizeof(float) * kLen);
+    xs[0] = 1.0f;
+    for (int pos = 0, block = 1; pos < kLen; block = block * 3 + 1) {
+        int count = kLen - pos < block ? kLen - pos : block;
+        ufxr_modalbank_process(&m, count, ys + pos, xs + pos);
+        pos += count;
+    }
+    ufxr_modalbank_destroy(&m);
+
+    // Compare with the analytic impulse response of each mode.
+    double maxerr = 0.0;
+    for (int i = 0; i < kLen; i++) {
+        double y = 0.0;
+        for (int j = 0; j < kModes - 1; j++) {
+            double w = 2.0 * pi * (double)modes[j].freq / kSampleRate;
+            double decay = (double)modes[j].decay * kSampleRate;
+            y += (double)modes[j].gain * pow(10.0, -3.0 * i / decay) *
+                 sin((i + 1) * w);
+        }
+        double e = fabs(y - (double)ys[i]);
+        maxerr = e > maxerr ? e : maxerr;
+    }
+    printf("Error: %.2e\n", maxerr);
+    free(xs);
+    free(ys);
+    return maxerr < 1e-3;
+}
+
+static bool test_oversample_factor(int factor) {
+    enum {
+        kBlock = 64,
+        kLen = 4096,
+    };
+    const double freq = 1000.0 / kSampleRate;
+    struct ufxr_oversampler o;
+    struct ufxr_error err;
+    if (!ufxr_oversampler_create(&o, factor, kBlock, &err)) {
+        die(0, "ufxr_oversampler_create");
+    }
+    float *xs = xmalloc(sizeof(float) * kLen);
+    float *ys = xmalloc(sizeof(float) * kLen);
+    float *hs = xmalloc(sizeof(float) * kBlock * factor);
+    const double pi = 4.0 * atan(1.0);
+    for (int i = 0; i < kLen; i++) {
+        xs[i] = sin(2.0 * pi * freq * i);
+    }
+    bool success = true;
+
+    // Upsampled signal should contain the same sine wave and nothing else.
+    // Latency of upsampling is half the total latency.
+    double latency = ufxr_oversampler_latency(&o);
+    ufxr_oversampler_up(&o, kBlock, hs, xs);
+    ufxr_oversampler_up(&o, kBlock, hs, xs + kBlock);
+    float e = sine_error_db(kBlock * factor, hs, freq / factor,
+                            0.5 * latency * factor - kBlock * factor, 0);
+    printf("Upsampling error: %.1f dB\n", (double)e);
+    if (e > -60.0f) {
+        puts("Too much error after upsampling");
+        success = false;
+    }
+
+    // Round trip, processed in several blocks.
+    ufxr_oversampler_reset(&o);
+    ufxr_oversampler_process(&o, kLen, ys, xs, copy_op);
+    e = sine_error_db(kLen, ys, freq, latency, 64);
+    printf("Round trip latency: %.2f, error: %.1f dB\n", latency, (double)e);
+    if (e > -60.0f) {
+        puts("Too much error after round trip");
+        success = false;
+    }
+    ufxr_oversampler_destroy(&o);
+    free(xs);
+    free(ys);
+    free(hs);
+    return success;
+}
+
+static bool test_oversample2(void) {
+    return test_oversample_factor(2);
+}
+
+static bool test_oversample4(void) {
+    return test_oversample_factor(4);
+}
+
+static bool test_oversample8(void) {
+    return test_oversample_factor(8);
+}
+
+// Compute sin(2 pi x) with the ufxr_sin1_2 approximation, in double precision.
+static double ref_sin1_2(double x) {
+    x -= rint(x);
+    return x * (8.0 - 16.0 * fabs(x));
+}
+
+static bool test_pm(void) {
+    // Six voices: one group of four with feedback in one voice, then one
+    // voice with feedback and one without.
+    enum {
+        kVoices = 6,
+        kLen = 4800,
+        kHalf = kLen / 2,
+    };
+    const double pi = 4.0 * atan(1.0);
+    static const struct ufxr_pmparams params[kVoices] = {
+        {.ratio = 1.0f, .index = 1.0f},
+        {.ratio = 2.0f, .index = 3.0f},
+        {.ratio = 1.5f, .index = 2.0f, .feedback = 0.8f},
+        {.ratio = 3.5f, .index = 0.5f},
+        {.ratio = 1.0f, .index = 1.0f, .feedback = 1.5f},
+        {.ratio = 0.5f, .index = 4.0f},
+    };
+    struct ufxr_pm pm;
+    struct ufxr_error err;
+    if (!ufxr_pm_create(&pm, kVoices, &err)) {
+        die(0, "ufxr_pm_create");
+    }
+    for (int v = 0; v < kVoices; v++) {
+        ufxr_pm_set(&pm, v, &params[v]);
+    }
+    // Process in two halves, to check that state carries over.
+    float *xs = xmalloc(sizeof(float) * kVoices * kLen);
+    float *ys = xmalloc(sizeof(float) * kVoices * kLen);
+    float *xh = xmalloc(sizeof(float) * kVoices * kHalf);
+    float *yh = xmalloc(sizeof(float) * kVoices * kHalf);
+    for (int v = 0; v < kVoices; v++) {
+        for (int i = 0; i < kLen; i++) {
+            xs[v * kLen + i] = (100.0f + 50.0f * (float)v +
+                                0.01f * (float)i) / (float)kSampleRate;
+        }
+    }
+    for (int half = 0; half < 2; half++) {
+        for (int v = 0; v < kVoices; v++) {
+            memcpy(xh + v * kHalf, xs + v * kLen + half * kHalf,
+                   sizeof(float) * kHalf);
+        }
+        ufxr_pm_process(&pm, kHalf, yh, xh);
+        for (int v = 0; v < kVoices; v++) {
+            memcpy(ys + v * kLen + half * kHalf, yh + v * kHalf,
+                   sizeof(float) * kHalf);
+        }
+    }
+    ufxr_pm_destroy(&pm);
+
+    // Compare with the same algorithm in double precision.
+    double maxerr = 0.0;
+    for (int v = 0; v < kVoices; v++) {
+        double cp = 0.0, mp = 0.0, y1 = 0.0, y2 = 0.0;
+        double index = (double)params[v].index / (2.0 * pi);
+        double feedback = 0.5 * (double)params[v].feedback / (2.0 * pi);
+        for (int i = 0; i < kLen; i++) {
+            double f = (double)xs[v * kLen + i];
+            cp += f;
+            mp += f * (double)params[v].ratio;
+            double m = ref_sin1_2(mp + feedback * (y1 + y2));
+            y2 = y1;
+            y1 = m;
+            double y = ref_sin1_2(cp + index * m);
+            double e = fabs(y - (double)ys[v * kLen + i]);
+            maxerr = e > maxerr ? e : maxerr;
+        }
+    }
+    printf("Error: %.2e\n", maxerr);
+    free(xs);
+    free(ys);
+    free(xh);
+    free(yh);
+    return maxerr < 1e-3;
+}
+
+static bool test_resample_rates(int inrate, int outrate) {
+    enum {
+        kLen = 20000,
+    };
+    const double freq = 1000.0, pi = 4.0 * atan(1.0);
+    struct ufxr_resampler r;
+    struct ufxr_error err;
+    if (!ufxr_resampler_create(&r, inrate, outrate, &err)) {
+        die(0, "ufxr_resampler_create");
+    }
+    const int latency = ufxr_resampler_latency(&r);
+    const int inlen = kLen + latency;
+    const int maxout = ufxr_resampler_maxout(&r, inlen);
+    float *xs = xmalloc(sizeof(float) * inlen);
+    float *ys = xmalloc(sizeof(float) * maxout);
+    for (int i = 0; i < inlen; i++) {
+        xs[i] = i < kLen ? sin(2.0 * pi * freq * i / inrate) : 0.0;
+    }
+    int outlen = 0;
+    for (int pos = 0, block = 1; pos < inlen; block = block * 3 + 1) {
+        int count = inlen - pos < block ? inlen - pos : block;
+        outlen += ufxr_resampler_process(&r, count, ys + outlen, xs + pos);
+        pos += count;
+    }
+    ufxr_resampler_destroy(&r);
+
+    // Every input sample should be accounted for once flushed.
+    bool success = true;
+    int expect = (int)(((long long)kLen * outrate + inrate - 1) / inrate);
+    if (outlen < expect || outlen > maxout) {
+        printf("Output length: %d, expected %d\n", outlen, expect);
+        success = false;
+    }
+    // Skip the transient at either end.
+    const int skip = 2 * latency * outrate / inrate + 1;
+    float e = sine_error_db(expect - skip, ys, freq / outrate, 0.0, skip);
+    printf("Error: %.1f dB\n", (double)e);
+    if (e > -60.0f) {
+        success = false;
+    }
+    free(xs);
+    free(ys);
+    return success;
+}
+
+static bool test_resample_down(void) {
+    return test_resample_rates(48000, 44100);
+}
+
+static bool test_resample_up(void) {
+    return test_resample_rates(22050, 48000);
+}
+
+static bool test_resample_inexact(void) {
+    return test_resample_rates(48000, 44101);
+}
+
+// Return the frequency, in cycles per sample, with the largest magnitude in
+// the spectrum of a signal, searching between two frequencies.
+static double find_peak(int n, const float *restrict xs, double f0,
+                        double f1) {
+    const double pi = 4.0 * atan(1.0);
+    double best = -1.0, bestf = f0;
+    for (int k = 0; k <= 1000; k++) {
+        double f = f0 + (f1 - f0) * k / 1000;
+        double re = 0.0, im = 0.0;
+        for (int i = 0; i < n; i++) {
+            double win = 0.5 - 0.5 * cos(2.0 * pi * i / n);
+            re += win * (double)xs[i] * cos(2.0 * pi * f * i);
+            im += win * (double)xs[i] * sin(2.0 * pi * f * i);
+        }
+        double mag = re * re + im * im;
+        if (mag > best) {
+            best = mag;
+            bestf = f;
+        }
+    }
+    return bestf;
+}
+
+static double sampler_source(int channel, int i) {
+    const double pi = 4.0 * atan(1.0);
+    return channel == 0 ? 0.5 * sin(2.0 * pi * 0.01 * i)
+                        : 0.25 * cos(2.0 * pi * 0.003 * i);
+}
+
+static bool test_sampler_format(ufxr_format format, double tolerance) {
+    enum {
+        kLen = 3000,
+        kOutLen = 5000,
+    };
+    // Write a stereo test file.
+    const char *dir = getenv("TEST_TMPDIR");
+    char path[256];
+    snprintf(path, sizeof(path), "%s/sampler_XXXXXX", dir ? dir : "/tmp");
+    int fd = mkstemp(path);
+    if (fd == -1) {
+        die(errno, "mkstemp");
+    }
+    close(fd);
+    // The first half is written interleaved, and the second half planar.
+    float *xs = xmalloc(sizeof(float) * 2 * kLen);
+    float *planar[2] = {xs + kLen, xs + kLen + kLen / 2};
+    for (int i = 0; i < kLen; i++) {
+        if (i < kLen / 2) {
+            xs[i * 2] = sampler_source(0, i);
+            xs[i * 2 + 1] = sampler_source(1, i);
+        } else {
+            planar[0][i - kLen / 2] = sampler_source(0, i);
+            planar[1][i - kLen / 2] = sampler_source(1, i);
+        }
+    }
+    struct ufxr_waveinfo info = {
+        .samplerate = kSampleRate,
+        .channels = 2,
+        .format = format,
+        .length = kLen,
+    };
+    struct ufxr_wavewriter w;
+    struct ufxr_error err;
+    if (!ufxr_wavewriter_create(&w, path, &info, &err) ||
+        !ufxr_wavewriter_write(&w, xs, kLen / 2 * 2, &err) ||
+        !ufxr_wavewriter_writeplanar(&w, (const float *const *)planar,
+                                     kLen - kLen / 2, &err) ||
+        !ufxr_wavewriter_finish(&w, &err)) {
+        die(0, "could not write wave file");
+    }
+    ufxr_wavewriter_destroy(&w);
+    free(xs);
+
+    struct ufxr_wavereader r;
+    if (!ufxr_wavereader_create(&r, path, &err)) {
+        die(0, "ufxr_wavereader_create");
+    }
+    unlink(path);
+    bool success = true;
+    struct ufxr_waveinfo rinfo = ufxr_wavereader_info(&r);
+    if (rinfo.samplerate != kSampleRate || rinfo.channels != 2 ||
+        rinfo.format != format || rinfo.length != kLen) {
+        puts("Wrong wave info");
+        success = false;
+    }
+
+    // Streaming reads, in blocks of varying size, decode the whole file.
+    float *decoded = xmalloc(sizeof(float) * 2 * kLen);
+    size_t pos = 0;
+    for (size_t block = 4;; block = block * 3 + 4) {
+        size_t n = ufxr_wavereader_read(&r, decoded + pos, block);
+        pos += n;
+        if (n < block) {
+            break;
+        }
+    }
+    double maxerr = 0.0;
+    for (int i = 0; i < kLen; i++) {
+        double l = decoded[i * 2], r = decoded[i * 2 + 1];
+        double e = fmax(fabs(l - sampler_source(0, i)),
+                        fabs(r - sampler_source(1, i)));
+        maxerr = e > maxerr ? e : maxerr;
+    }
+    printf("Read error: %.2e\n", maxerr);
+    if (pos != 2 * kLen || maxerr > tolerance) {
+        success = false;
+    }
+    free(decoded);
+
+    struct ufxr_wavespan span = ufxr_wavereader_span(&r);
+    struct ufxr_sampler s;
+    if (!ufxr_sampler_init(&s, &span, &err)) {
+        die(0, "ufxr_sampler_init");
+    }
+    float *left = xmalloc(sizeof(float) * kOutLen);
+    float *right = xmalloc(sizeof(float) * kOutLen);
+    float *rates = xmalloc(sizeof(float) * kOutLen);
+
+    // At unit rate without a loop, the file plays once and stops.
+    for (int i = 0; i < kOutLen; i++) {
+        rates[i] = 1.0f;
+    }
+    ufxr_sampler_start(&s, 0.0);
+    ufxr_sampler_process(&s, kOutLen, left, right, rates);
+    maxerr = 0.0;
+    for (int i = 0; i < kOutLen; i++) {
+        double l = i < kLen ? sampler_source(0, i) : 0.0,
+               r = i < kLen ? sampler_source(1, i) : 0.0;
+        double e = fmax(fabs((double)left[i] - l), fabs((double)right[i] - r));
+        maxerr = e > maxerr ? e : maxerr;
+    }
+    printf("Unit rate error: %.2e\n", maxerr);
+    if (maxerr > tolerance || ufxr_sampler_playing(&s)) {
+        success = false;
+    }
+
+    // At half rate, odd samples fall halfway between frames.
+    for (int i = 0; i < kOutLen; i++) {
+        rates[i] = 0.5f;
+    }
+    ufxr_sampler_start(&s, 0.0);
+    ufxr_sampler_process(&s, kOutLen, left, right, rates);
+    maxerr = 0.0;
+    for (int i = 1; i < kOutLen; i += 2) {
+        double l = 0.5 * (sampler_source(0, i / 2) +
+                          sampler_source(0, i / 2 + 1));
+        double e = fabs((double)left[i] - l);
+        maxerr = e > maxerr ? e : maxerr;
+    }
+    printf("Half rate error: %.2e\n", maxerr);
+    if (maxerr > tolerance) {
+        success = false;
+    }
+
+    // A loop of exactly ten cycles plays forever.
+    if (!ufxr_sampler_setloop(&s, 1000, 2000)) {
+        die(0, "ufxr_sampler_setloop");
+    }
+    for (int i = 0; i < kOutLen; i++) {
+        rates[i] = 1.0f;
+    }
+    ufxr_sampler_start(&s, 0.0);
+    for (int pos = 0, block = 1; pos < kOutLen; block = block * 3 + 1) {
+        int count = kOutLen - pos < block ? kOutLen - pos : block;
+        ufxr_sampler_process(&s, count, left + pos, right + pos, rates + pos);
+        pos += count;
+    }
+    maxerr = 0.0;
+    for (int i = 0; i < kOutLen; i++) {
+        int j = i < 1000 ? i : 1000 + (i - 1000) % 1000;
+        double e = fabs((double)left[i] - sampler_source(0, j));
+        maxerr = e > maxerr ? e : maxerr;
+    }
+    printf("Loop error: %.2e\n", maxerr);
+    if (maxerr > tolerance || !ufxr_sampler_playing(&s)) {
+        success = false;
+    }
+
+    ufxr_wavereader_destroy(&r);
+    free(left);
+    free(right);
+    free(rates);
+    return success;
+}
+
+// Write a wave file with the given header followed by samples, and read it
+// back. The header ends with the data chunk size.
+static bool test_wavereader_header(const char *name, const void *header,
+                                   size_t header_size) {
+    enum {
+        kLen = 1000,
+    };
+    printf("Header: %s\n", name);
+    const char *dir = getenv("TEST_TMPDIR");
+    char path[256];
+    snprintf(path, sizeof(path), "%s/wavereader_XXXXXX", dir ? dir : "/tmp");
+    int fd = mkstemp(path);
+    if (fd == -1) {
+        die(errno, "mkstemp");
+    }
+    unsigned char *file = xmalloc(header_size + 4 * kLen);
+    memcpy(file, header, header_size);
+    for (int i = 0; i < 2 * kLen; i++) {
+        int x = (int)lrint(sampler_source(i & 1, i >> 1) * 32768.0);
+        file[header_size + i * 2] = x & 0xff;
+        file[header_size + i * 2 + 1] = (x >> 8) & 0xff;
+    }
+    if (write(fd, file, header_size + 4 * kLen) !=
+        (ssize_t)(header_size + 4 * kLen)) {
+        die(errno, "write");
+    }
+    close(fd);
+    free(file);
+
+    struct ufxr_wavereader r;
+    struct ufxr_error err;
+    if (!ufxr_wavereader_create(&r, path, &err)) {
+        unlink(path);
+        puts("Could not read file");
+        return false;
+    }
+    unlink(path);
+    bool success = true;
+    struct ufxr_waveinfo info = ufxr_wavereader_info(&r);
+    if (info.samplerate != kSampleRate || info.channels != 2 ||
+        info.format != kUFXRFormatS16 || info.length != kLen) {
+        puts("Wrong wave info");
+        success = false;
+    }
+    // Seek to the second half and read past the end.
+    float *decoded = xmalloc(sizeof(float) * 2 * kLen);
+    ufxr_wavereader_seek(&r, kLen / 2);
+    size_t n = ufxr_wavereader_read(&r, decoded, 2 * kLen);
+    if (n != kLen || ufxr_wavereader_read(&r, decoded, 4) != 0) {
+        puts("Wrong read size");
+        success = false;
+    }
+    for (int i = 0; i < kLen && success; i++) {
+        double x = sampler_source(i & 1, kLen / 2 + (i >> 1));
+        if (fabs((double)decoded[i] - x) > 1.0 / 32768.0) {
+            printf("Wrong sample %d\n", i);
+            success = false;
+        }
+    }
+    free(decoded);
+    ufxr_wavereader_destroy(&r);
+    return success;
+}
+
+// Test RF64 and WAVE_FORMAT_EXTENSIBLE headers, with 16-bit stereo data.
+static bool test_wavereader(void) {
+    // clang-format off
+    static const unsigned char kExtensible[] = {
+        'R', 'I', 'F', 'F', 0xa0, 0x0f, 0, 0, 'W', 'A', 'V', 'E',
+        // Unknown chunks with odd sizes are skipped, with padding.
+        'L', 'I', 'S', 'T', 3, 0, 0, 0, 1, 2, 3, 0,
+        'f', 'm', 't', ' ', 40, 0, 0, 0,
+        0xfe, 0xff, 2, 0, 0x80, 0xbb, 0, 0, 0x00, 0xee, 2, 0, 4, 0, 16, 0,
+        22, 0, 16, 0, 3, 0, 0, 0,
+        1, 0, 0, 0, 0, 0, 0x10, 0, 0x80, 0, 0, 0xaa, 0, 0x38, 0x9b, 0x71,
+        'd', 'a', 't', 'a', 0xa0, 0x0f, 0, 0,
+    };
+    static const unsigned char kRF64[] = {
+        'R', 'F', '6', '4', 0xff, 0xff, 0xff, 0xff, 'W', 'A', 'V', 'E',
+        // RIFF size, data size, sample count, and a table with one entry.
+        'd', 's', '6', '4', 40, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0xa0, 0x0f, 0, 0, 0, 0, 0, 0,
+        0xe8, 0x03, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0,
+        'L', 'I', 'S', 'T', 2, 0, 0, 0, 0, 0, 0, 0,
+        // The LIST chunk size in the table is used instead of 0xffffffff.
+        'L', 'I', 'S', 'T', 0xff, 0xff, 0xff, 0xff, 1, 2,
+        'f', 'm', 't', ' ', 16, 0, 0, 0,
+        1, 0, 2, 0, 0x80, 0xbb, 0, 0, 0x00, 0xee, 2, 0, 4, 0, 16, 0,
+        'd', 'a', 't', 'a', 0xff, 0xff, 0xff, 0xff,
+    };
+    // clang-format on
+    bool success = true;
+    if (!test_wavereader_header("extensible", kExtensible,
+                                sizeof(kExtensible))) {
+        success = false;
+    }
+    if (!test_wavereader_header("rf64", kRF64, sizeof(kRF64))) {
+        success = false;
+    }
+    return success;
+}
+
+static bool test_sampler_u8(void) {
+    return test_sampler_format(kUFXRFormatU8, 1.0 / 128.0);
+}
+
+static bool test_sampler_s16(void) {
+    return test_sampler_format(kUFXRFormatS16, 1.0 / 32768.0);
+}
+
+static bool test_sampler_s24(void) {
+    return test_sampler_format(kUFXRFormatS24, 1e-6);
+}
+
+static bool test_sampler_f32(void) {
+    return test_sampler_format(kUFXRFormatF32, 1e-6);
+}
+
+static bool test_waveguide(void) {
+    struct ufxr_waveguideparams p = {
+        .samplerate = kSampleRate,
+        .minfreq = 50.0f,
+        .freq = 441.0f,
+        .decay = 1.0f,
+        .brightness = 1.0f,
+    };
+    struct ufxr_waveguide w;
+    struct ufxr_error err;
+    if (!ufxr_waveguide_create(&w, &p, &err)) {
+        die(0, "ufxr_waveguide_create");
+    }
+    const int n = kSampleRate;
+    float *xs = xmalloc(sizeof(float) * n);
+    float *ys = xmalloc(sizeof(float) * n);
+    memset(xs, 0, sizeof(float) * n);
+    ufxr_waveguide_pluck(&w, 0.5f);
+    for (int pos = 0, block = 1; pos < n; block = block * 3 + 1) {
+        int count = n - pos < block ? n - pos : block;
+        ufxr_waveguide_process(&w, count, ys + pos, xs + pos);
+        pos += count;
+    }
+    bool success = true;
+    if (!all_finite(n, ys)) {
+        puts("Output is not finite");
+        success = false;
+    }
+
+    // The period is not an integer number of samples. Rounding it would be
+    // off by several Hz.
+    const double freq = (double)p.freq;
+    double peak = kSampleRate * find_peak(kSampleRate / 4, ys,
+                                          (freq - 5.0) / kSampleRate,
+                                          (freq + 5.0) / kSampleRate);
+    printf("Frequency: %.2f, expected %.2f\n", peak, freq);
+    if (fabs(peak - freq) > 0.5) {
+        puts("Wrong tuning");
+        success = false;
+    }
+
+    // With full brightness, every harmonic decays at the same rate.
+    int win = kSampleRate / 10;
+    float l0 = level_db(win, ys);
+    float l1 = level_db(win, ys + kSampleRate / 2);
+    printf("Decay over 0.5s: %.1f dB\n", (double)(l0 - l1));
+    if (fabsf(l0 - l1 - 30.0f) > 3.0f) {
+        puts("Wrong decay time");
+        success = false;
+    }
+
+    // Exciting the string with an input signal.
+    ufxr_waveguide_reset(&w);
+    xs[0] = 1.0f;
+    p.brightness = 0.0f;
+    if (!ufxr_waveguide_set(&w, &p, &err)) {
+        die(0, "ufxr_waveguide_set");
+    }
+    ufxr_waveguide_process(&w, n, ys, xs);
+    if (ys[0] != 1.0f || !all_finite(n, ys)) {
+        puts("Bad impulse response");
+        success = false;
+    }
+    ufxr_waveguide_destroy(&w);
+    free(xs);
+    free(ys);
+    return success;
+}
+
+// Run a time stretcher over the input, in blocks of different sizes, and
+// flush it. Returns the output length.
+static int run_wsola(struct ufxr_wsola *restrict w, int n, float *restrict ys,
+                     const float *restrict xs) {
+    const int latency = ufxr_wsola_latency(w);
+    float *zeros = xmalloc(sizeof(float) * latency);
+    memset(zeros, 0, sizeof(float) * latency);
+    int count = 0;
+    for (int pos = 0, block = 1; pos < n; block = block * 3 + 1) {
+        int amt = n - pos < block ? n - pos : block;
+        count += ufxr_wsola_process(w, amt, ys + count, xs + pos);
+        pos += amt;
+    }
+    count += ufxr_wsola_process(w, latency, ys + count, zeros);
+    free(zeros);
+    return count;
+}
+
+static bool test_wsola_identity(void) {
+    enum {
+        kLen = 20000,
+    };
+    struct ufxr_wsola w;
+    struct ufxr_error err;
+    if (!ufxr_wsola_create(&w, kSampleRate, 1.0, 1.0, &err)) {
+        die(0, "ufxr_wsola_create");
+    }
+    const int maxout = ufxr_wsola_maxout(&w, kLen + ufxr_wsola_latency(&w));
+    float *xs = xmalloc(sizeof(float) * kLen);
+    float *ys = xmalloc(sizeof(float) * maxout);
+    unsigned state = 1;
+    for (int i = 0; i < kLen; i++) {
+        state = state * 1103515245u + 12345u;
+        xs[i] = (float)(state >> 8) * (1.0f / 8388608.0f) - 1.0f;
+    }
+    const int count = run_wsola(&w, kLen, ys, xs);
+    ufxr_wsola_destroy(&w);
+    bool success = true;
+    if (count < kLen) {
+        printf("Output length: %d, expected at least %d\n", count, kLen);
+        success = false;
+    } else {
+        // Without stretching, every frame is found at its nominal position,
+        // and the windows sum to one.
+        double maxerr = 0.0;
+        for (int i = 0; i < kLen; i++) {
+            double e = fabs((double)ys[i] - (double)xs[i]);
+            maxerr = e > maxerr ? e : maxerr;
+        }
+        printf("Error: %.2e\n", maxerr);
+        if (maxerr > 1e-5) {
+            success = false;
+        }
+    }
+    free(xs);
+    free(ys);
+    return success;
+}
+
+static bool test_wsola_ratio(double stretch, double pitch) {
+    enum {
+        kLen = kSampleRate,
+    };
+    const double freq = 441.0, pi = 4.0 * atan(1.0);
+    struct ufxr_wsola w;
+    struct ufxr_error err;
+    if (!ufxr_wsola_create(&w, kSampleRate, stretch, pitch, &err)) {
+        die(0, "ufxr_wsola_create");
+    }
+    const int maxout = ufxr_wsola_maxout(&w, kLen + ufxr_wsola_latency(&w));
+    float *xs = xmalloc(sizeof(float) * kLen);
+    float *ys = xmalloc(sizeof(float) * maxout);
+    for (int i = 0; i < kLen; i++) {
+        xs[i] = sin(2.0 * pi * freq * i / kSampleRate);
+    }
+    const int count = run_wsola(&w, kLen, ys, xs);
+    ufxr_wsola_destroy(&w);
+    bool success = true;
+    const int expect = (int)(stretch * kLen);
+    printf("Output length: %d, expected %d\n", count, expect);
+    if (count < expect || count > maxout) {
+        success = false;
+    }
+
+    // Measure the pitch and the level away from the ends.
+    const int skip = kSampleRate / 10, len = expect - 2 * skip;
+    const double target = freq * pitch;
+    double peak = kSampleRate * find_peak(len, ys + skip,
+                                          (target - 5.0) / kSampleRate,
+                                          (target + 5.0) / kSampleRate);
+    printf("Frequency: %.2f, expected %.2f\n", peak, target);
+    if (fabs(peak - target) > 0.5) {
+        success = false;
+    }
+    float level = level_db(len, ys + skip);
+    printf("Level: %.2f dB\n", (double)level);
+    if (fabsf(level + 3.01f) > 0.5f) {
+        success = false;
+    }
+
+    // Splices which are out of phase make the output deviate from the sine
+    // recurrence y[n+1] + y[n-1] = 2 cos(w) y[n].
+    const double k = 2.0 * cos(2.0 * pi * target / kSampleRate);
+    double res = 0.0, sig = 0.0;
+    for (int i = skip; i < skip + len; i++) {
+        double r = (double)ys[i + 1] + (double)ys[i - 1] - k * (double)ys[i];
+        res += r * r;
+        sig += (double)ys[i] * (double)ys[i];
+    }
+    double resdb = 10.0 * log10(res / sig + 1e-30);
+    printf("Discontinuity: %.1f dB\n", resdb);
+    if (resdb > -50.0) {
+        success = false;
+    }
+    free(xs);
+    free(ys);
+    return success;
+}
+
+static bool test_wsola_stretch(void) {
+    return test_wsola_ratio(1.5, 1.0);
+}
+
+static bool test_wsola_shrink(void) {
+    return test_wsola_ratio(0.7, 1.0);
+}
+
+static bool test_wsola_pitch(void) {
+    return test_wsola_ratio(1.0, 1.5);
+}
+
+struct test_info {
+    const char *name;
+    bool (*func)(void);
+};
+
+static const struct test_info kTests[] = {
+    {"additive", test_additive},
+    {"convolve", test_convolve},
+    {"granular", test_granular},
+    {"limiter", test_limiter},
+    {"loudness", test_loudness},
+    {"modal", test_modal},
+    {"oversample2", test_oversample2},
+    {"oversample4", test_oversample4},
+    {"oversample8", test_oversample8},
+    {"pm", test_pm},
+    {"resample_down", test_resample_down},
+    {"resample_up", test_resample_up},
+    {"resample_inexact", test_resample_inexact},
+    {"reverb8", test_reverb8},
+    {"reverb16", test_reverb16},
+    {"sampler_f32", test_sampler_f32},
+    {"sampler_s16", test_sampler_s16},
+    {"sampler_s24", test_sampler_s24},
+    {"sampler_u8", test_sampler_u8},
+    {"wavereader", test_wavereader},
+    {"waveguide", test_waveguide},
+    {"wsola_identity", test_wsola_identity},
+    {"wsola_pitch", test_wsola_pitch},
+    {"wsola_shrink", test_wsola_shrink},
+    {"wsola_stretch", test_wsola_stretch},
+};
+
+int main(int argc, char **argv) {
+    (void)argc;
+    (void)argv;
+    bool success = true;
+    for (size_t i = 0; i < ARRAY_SIZE(kTests); i++) {
+        printf("Testing: %s\n", kTests[i].name);
+        fflush(stdout);
+        if (!kTests[i].func()) {
+            puts("****FAIL****");
+            success = false;
+        }
+        putc('\n', stdout);
+        fflush(stdout);
+    }
+    if (!success) {
+        puts("****FAIL****");
+        exit(1);
+    }
+    return 0;
+}
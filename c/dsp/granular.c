@@ -0,0 +1,258 @@
+// granular.c - Granular synthesis.
+#include "c/dsp/granular.h"
+
+#include "c/dsp/impl.h"
+#include "c/io/error.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+enum {
+    // Number of segments in each window table. Each table has one extra entry
+    // so interpolation never reads past the end.
+    kGrainTableSize = 1024,
+    // Maximum grain length. Longer grains would lose precision in the window
+    // table position.
+    kGrainMaxLength = 1 << 20,
+};
+
+// State of a playing grain.
+struct ufxr_grainvoice {
+    int delay;
+    int elapsed;
+    int length;
+    double pos;
+    float rate;
+    float left;
+    float right;
+    // Window table index increment per output sample.
+    float wscale;
+    const float *window;
+};
+
+// Read a source sample, returning zero outside the source.
+static inline float grain_fetch(const float *restrict src, int len, long i) {
+    return i >= 0 && i < len ? src[i] : 0.0f;
+}
+
+// SSE2 version.
+#if !HAVE_FUNC && USE_SSE2
+#define HAVE_FUNC 1
+#include <emmintrin.h>
+
+// Split x into integer and fractional parts, rounding toward negative
+// infinity.
+static inline __m128i grain_floor(__m128 x, __m128 *restrict frac) {
+    __m128i i = _mm_cvttps_epi32(x);
+    __m128 f = _mm_cvtepi32_ps(i);
+    i = _mm_add_epi32(i, _mm_castps_si128(_mm_cmplt_ps(x, f)));
+    *frac = _mm_sub_ps(x, _mm_cvtepi32_ps(i));
+    return i;
+}
+
+// Add count samples of one grain to the output, four at a time. Interpolation
+// is vectorized, but the table and source lookups are scalar because SSE2 has
+// no gather.
+static void grain_run(const struct ufxr_granular *restrict g,
+                      struct ufxr_grainvoice *restrict v, int count,
+                      float *restrict left, float *restrict right) {
+    const float *restrict src = g->source, *restrict win = v->window;
+    const int srclen = g->srclen;
+    const __m128 ramp = _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f);
+    const __m128 wscale = _mm_set1_ps(v->wscale);
+    const __m128 rate = _mm_set1_ps(v->rate);
+    const __m128 gl = _mm_set1_ps(v->left), gr = _mm_set1_ps(v->right);
+    double pos = v->pos;
+    int elapsed = v->elapsed, i = 0;
+    for (; i + 4 <= count; i += 4) {
+        // Window.
+        __m128 wfrac;
+        __m128 wpos = _mm_mul_ps(
+            _mm_add_ps(_mm_set1_ps((float)(elapsed + i)), ramp), wscale);
+        __m128i widx = grain_floor(wpos, &wfrac);
+        // Source position.
+        const double base = floor(pos);
+        __m128 sfrac;
+        __m128 spos = _mm_add_ps(_mm_set1_ps((float)(pos - base)),
+                                 _mm_mul_ps(ramp, rate));
+        __m128i sidx = grain_floor(spos, &sfrac);
+        int wi[4], si[4];
+        _mm_storeu_si128((__m128i *)wi, widx);
+        _mm_storeu_si128((__m128i *)si, sidx);
+        float w0[4], w1[4], s0[4], s1[4];
+        const long lbase = (long)base;
+        for (int k = 0; k < 4; k++) {
+            w0[k] = win[wi[k]];
+            w1[k] = win[wi[k] + 1];
+            s0[k] = grain_fetch(src, srclen, lbase + si[k]);
+            s1[k] = grain_fetch(src, srclen, lbase + si[k] + 1);
+        }
+        __m128 a = _mm_loadu_ps(w0), b = _mm_loadu_ps(w1);
+        __m128 w = _mm_add_ps(a, _mm_mul_ps(wfrac, _mm_sub_ps(b, a)));
+        a = _mm_loadu_ps(s0);
+        b = _mm_loadu_ps(s1);
+        __m128 s = _mm_add_ps(a, _mm_mul_ps(sfrac, _mm_sub_ps(b, a)));
+        __m128 y = _mm_mul_ps(w, s);
+        _mm_storeu_ps(left + i,
+                      _mm_add_ps(_mm_loadu_ps(left + i), _mm_mul_ps(y, gl)));
+        _mm_storeu_ps(right + i,
+                      _mm_add_ps(_mm_loadu_ps(right + i), _mm_mul_ps(y, gr)));
+        pos += 4.0 * (double)v->rate;
+    }
+    for (; i < count; i++) {
+        float wpos = (float)(elapsed + i) * v->wscale;
+        int wi = (int)wpos;
+        float wf = wpos - (float)wi;
+        float w = win[wi] + wf * (win[wi + 1] - win[wi]);
+        double base = floor(pos);
+        long si = (long)base;
+        float sf = (float)(pos - base);
+        float s0 = grain_fetch(src, srclen, si),
+              s1 = grain_fetch(src, srclen, si + 1);
+        float y = w * (s0 + sf * (s1 - s0));
+        left[i] += y * v->left;
+        right[i] += y * v->right;
+        pos += (double)v->rate;
+    }
+    v->pos = pos;
+}
+#endif
+
+// Scalar version.
+#if !HAVE_FUNC
+static void grain_run(const struct ufxr_granular *restrict g,
+                      struct ufxr_grainvoice *restrict v, int count,
+                      float *restrict left, float *restrict right) {
+    const float *restrict src = g->source, *restrict win = v->window;
+    const int srclen = g->srclen;
+    double pos = v->pos;
+    for (int i = 0; i < count; i++) {
+        float wpos = (float)(v->elapsed + i) * v->wscale;
+        int wi = (int)wpos;
+        float wf = wpos - (float)wi;
+        float w = win[wi] + wf * (win[wi + 1] - win[wi]);
+        double base = floor(pos);
+        long si = (long)base;
+        float sf = (float)(pos - base);
+        float s0 = grain_fetch(src, srclen, si),
+              s1 = grain_fetch(src, srclen, si + 1);
+        float y = w * (s0 + sf * (s1 - s0));
+        left[i] += y * v->left;
+        right[i] += y * v->right;
+        pos += (double)v->rate;
+    }
+    v->pos = pos;
+}
+#endif
+
+// Fill the window tables.
+static void grain_windows(float *restrict windows) {
+    const double pi = 4.0 * atan(1.0);
+    const int stride = kGrainTableSize + 1;
+    float *restrict hann = windows + kUFXRGrainHann * stride,
+                    *restrict triangle = windows + kUFXRGrainTriangle * stride,
+                    *restrict tukey = windows + kUFXRGrainTukey * stride;
+    for (int i = 0; i <= kGrainTableSize; i++) {
+        double x = (double)i / kGrainTableSize;
+        hann[i] = 0.5 - 0.5 * cos(2.0 * pi * x);
+        triangle[i] = 1.0 - fabs(2.0 * x - 1.0);
+        // Tapers over the first and last quarter.
+        double t = x < 0.25 ? x : x > 0.75 ? 1.0 - x : 0.25;
+        tukey[i] = 0.5 - 0.5 * cos(4.0 * pi * t);
+    }
+}
+
+bool ufxr_granular_create(struct ufxr_granular *restrict g, int maxgrains,
+                          int srclen, const float *source,
+                          struct ufxr_error *err) {
+    if (maxgrains < 1 || maxgrains > UFXR_GRANULAR_MAXGRAINS || srclen < 0 ||
+        (srclen > 0 && source == NULL)) {
+        ufxr_error_setcode(err, kUFXRErrorInvalidArgument);
+        return false;
+    }
+    *g = (struct ufxr_granular){
+        .source = source,
+        .srclen = srclen,
+        .maxgrains = maxgrains,
+    };
+    g->grains = ufxr_alloc(sizeof(*g->grains) * maxgrains);
+    g->windows = ufxr_alloc(sizeof(float) * kUFXRGrainWindowCount *
+                            (kGrainTableSize + 1));
+    if (g->grains == NULL || g->windows == NULL) {
+        ufxr_error_seterrno(err);
+        ufxr_granular_destroy(g);
+        return false;
+    }
+    grain_windows(g->windows);
+    return true;
+}
+
+void ufxr_granular_destroy(struct ufxr_granular *restrict g) {
+    free(g->grains);
+    free(g->windows);
+    g->grains = NULL;
+    g->windows = NULL;
+}
+
+void ufxr_granular_reset(struct ufxr_granular *restrict g) {
+    g->count = 0;
+}
+
+int ufxr_granular_count(const struct ufxr_granular *restrict g) {
+    return g->count;
+}
+
+bool ufxr_granular_add(struct ufxr_granular *restrict g,
+                       const struct ufxr_grain *restrict grain) {
+    if (g->count >= g->maxgrains || grain->delay < 0 || grain->length < 1 ||
+        grain->length > kGrainMaxLength ||
+        !isfinite(grain->position) || !isfinite(grain->rate) ||
+        !isfinite(grain->gain) || !(grain->pan >= -1.0f) ||
+        !(grain->pan <= 1.0f) || grain->window < 0 ||
+        grain->window >= kUFXRGrainWindowCount) {
+        return false;
+    }
+    const double pi = 4.0 * atan(1.0);
+    const double angle = 0.25 * pi * ((double)grain->pan + 1.0);
+    g->grains[g->count++] = (struct ufxr_grainvoice){
+        .delay = grain->delay,
+        .elapsed = 0,
+        .length = grain->length,
+        .pos = grain->position,
+        .rate = grain->rate,
+        .left = (double)grain->gain * cos(angle),
+        .right = (double)grain->gain * sin(angle),
+        .wscale = (float)kGrainTableSize / (float)grain->length,
+        .window = g->windows + grain->window * (kGrainTableSize + 1),
+    };
+    return true;
+}
+
+void ufxr_granular_process(struct ufxr_granular *restrict g, int n,
+                           float *restrict left, float *restrict right) {
+    memset(left, 0, sizeof(float) * n);
+    memset(right, 0, sizeof(float) * n);
+    struct ufxr_grainvoice *restrict grains = g->grains;
+    for (int k = 0; k < g->count;) {
+        struct ufxr_grainvoice *restrict v = &grains[k];
+        if (v->delay >= n) {
+            v->delay -= n;
+            k++;
+            continue;
+        }
+        const int start = v->delay;
+        const int remain = v->length - v->elapsed;
+        const int count = remain < n - start ? remain : n - start;
+        v->delay = 0;
+        grain_run(g, v, count, left + start, right + start);
+        v->elapsed += count;
+        if (v->elapsed >= v->length) {
+            // Remove finished grain, and process the grain moved into its
+            // place next.
+            *v = grains[--g->count];
+        } else {
+            k++;
+        }
+    }
+}
@@ -0,0 +1,85 @@
+// c/dsp/granular.h - Granular synthesis.
+#pragma once
+
+#include <stdbool.h>
+
+struct ufxr_error;
+
+// Maximum number of grains which can play at once.
+#define UFXR_GRANULAR_MAXGRAINS 65536
+
+// Grain window shapes.
+typedef enum {
+    kUFXRGrainHann,
+    kUFXRGrainTriangle,
+    // Tukey window, flat in the middle half, with cosine tapers.
+    kUFXRGrainTukey,
+    kUFXRGrainWindowCount,
+} ufxr_grainwindow;
+
+// Parameters for one grain.
+struct ufxr_grain {
+    // Number of output samples before the grain starts, counted from the
+    // start of the next block processed.
+    int delay;
+    // Length of the grain in output samples, at most 2^20.
+    int length;
+    // Starting position in the source, in samples. May be fractional.
+    double position;
+    // Playback rate, in source samples per output sample. 1 plays at the
+    // original pitch, 2 plays an octave higher. May be negative.
+    float rate;
+    // Peak amplitude.
+    float gain;
+    // Stereo position, from -1 (left) to +1 (right), with constant power
+    // panning.
+    float pan;
+    // Window shape.
+    ufxr_grainwindow window;
+};
+
+struct ufxr_grainvoice;
+
+// A granular synthesizer, which plays many short windowed grains read from a
+// source buffer and sums them into a stereo output.
+//
+// Windows are read from precomputed tables with linear interpolation, and the
+// source is read with linear interpolation. Each grain is computed four output
+// samples at a time. Reading the source outside its bounds produces silence.
+//
+// All fields are private. Do not access them.
+struct ufxr_granular {
+    const float *source;
+    int srclen;
+    int maxgrains;
+    int count;
+    struct ufxr_grainvoice *grains;
+    float *windows;
+};
+
+// Create a granular synthesizer which reads from the given source. The source
+// is not copied, and must remain valid until the synthesizer is destroyed. If
+// successful, destroy() must be called to release resources. This is the only
+// function which allocates memory.
+bool ufxr_granular_create(struct ufxr_granular *restrict g, int maxgrains,
+                          int srclen, const float *source,
+                          struct ufxr_error *err);
+
+// Destroy a granular synthesizer and release any resources.
+void ufxr_granular_destroy(struct ufxr_granular *restrict g);
+
+// Stop all grains.
+void ufxr_granular_reset(struct ufxr_granular *restrict g);
+
+// Return the number of grains which are playing or scheduled.
+int ufxr_granular_count(const struct ufxr_granular *restrict g);
+
+// Schedule a grain. Returns false if the grain parameters are invalid or if
+// the maximum number of grains are already scheduled.
+bool ufxr_granular_add(struct ufxr_granular *restrict g,
+                       const struct ufxr_grain *restrict grain);
+
+// Generate a block of audio. The outputs are overwritten with the sum of all
+// grains. Grains which finish are removed. Does not allocate memory.
+void ufxr_granular_process(struct ufxr_granular *restrict g, int n,
+                           float *restrict left, float *restrict right);
@@ -0,0 +1,41 @@
+// c/dsp/impl.h - Definitions for signal processor implementations.
+#pragma once
+
+#include "c/config/config.h"
+#include "c/ops/ops.h"
+
+#include <stddef.h>
+
+// Alignment of memory returned by ufxr_alloc. This is large enough for any
+// vector type we use and keeps state arrays from sharing cache lines.
+#define UFXR_DSP_ALIGN 64
+
+// Allocate zeroed memory aligned to UFXR_DSP_ALIGN. Returns NULL and sets errno
+// on failure. Free with free().
+void *ufxr_alloc(size_t size);
+
+// Return the smallest power of two which is at least n.
+inline unsigned ufxr_pow2(unsigned n) {
+    return n <= 1 ? 1 : 1u << (32 - __builtin_clz(n - 1));
+}
+
+// Evaluate a Kaiser window with shape parameter beta, for x in [-1, 1].
+double ufxr_kaiser(double x, double beta);
+
+// Length of the interpolation filters used to measure true peaks. Peaks for a
+// sample are known once the sample UFXR_TRUEPEAK_TAPS/2 after it is available.
+#define UFXR_TRUEPEAK_TAPS 16
+
+// Number of coefficients used to measure true peaks.
+#define UFXR_TRUEPEAK_COEFFS (3 * UFXR_TRUEPEAK_TAPS)
+
+// Compute the coefficients used to measure true peaks.
+void ufxr_truepeak_init(float *coeffs);
+
+// Measure the true peak level of n samples: the largest absolute value of each
+// sample and three points interpolated between it and the next sample, which
+// is equivalent to 4x oversampling. The input starts UFXR_TRUEPEAK_TAPS/2-1
+// samples before the first sample measured, and ends UFXR_TRUEPEAK_TAPS/2
+// samples after the last one.
+void ufxr_truepeak(int n, float *restrict peaks, const float *restrict xs,
+                   const float *restrict coeffs);
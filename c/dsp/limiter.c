@@ -0,0 +1,239 @@
+// limiter.c - Look-ahead peak limiter.
+#include "c/dsp/limiter.h"
+
+#include "c/dsp/impl.h"
+#include "c/io/error.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+enum {
+    // Delay of the peak measurement.
+    kLimiterPeakDelay = UFXR_TRUEPEAK_TAPS / 2,
+    // Number of samples processed at a time.
+    kLimiterChunk = 256,
+    // Maximum look-ahead, in samples.
+    kLimiterMaxWindow = 1 << 16,
+};
+
+// AVX version.
+#if !HAVE_FUNC && USE_AVX
+#define HAVE_FUNC 1
+#include <immintrin.h>
+
+// Compute outs = max(xs, ys). The count must be a multiple of 8.
+static void limiter_max(int n, float *restrict outs, const float *restrict xs,
+                        const float *restrict ys) {
+    for (int i = 0; i < n; i += 8) {
+        _mm256_storeu_ps(outs + i, _mm256_max_ps(_mm256_loadu_ps(xs + i),
+                                                 _mm256_loadu_ps(ys + i)));
+    }
+}
+
+enum {
+    kLimiterVector = 8,
+};
+#endif
+
+// SSE2 version.
+#if !HAVE_FUNC && USE_SSE2
+#define HAVE_FUNC 1
+#include <emmintrin.h>
+
+static void limiter_max(int n, float *restrict outs, const float *restrict xs,
+                        const float *restrict ys) {
+    for (int i = 0; i < n; i += 4) {
+        _mm_storeu_ps(outs + i,
+                      _mm_max_ps(_mm_loadu_ps(xs + i), _mm_loadu_ps(ys + i)));
+    }
+}
+
+enum {
+    kLimiterVector = 4,
+};
+#endif
+
+// Scalar version.
+#if !HAVE_FUNC
+static void limiter_max(int n, float *restrict outs, const float *restrict xs,
+                        const float *restrict ys) {
+    for (int i = 0; i < n; i++) {
+        outs[i] = xs[i] > ys[i] ? xs[i] : ys[i];
+    }
+}
+
+enum {
+    kLimiterVector = 1,
+};
+#endif
+
+// Round n up to a whole number of vectors.
+static inline int limiter_round(int n) {
+    return (n + kLimiterVector - 1) & ~(kLimiterVector - 1);
+}
+
+// Compute the maximum peak over the window ending at each sample. The stream
+// is divided into blocks one window long. The maximum over any window is the
+// maximum of a suffix of one block and a prefix of the next.
+static void limiter_window(struct ufxr_limiter *restrict l, int n,
+                           float *restrict outs, const float *restrict peaks) {
+    const int window = l->window;
+    float *restrict bpeaks = l->peaks, *restrict prefix = l->prefix,
+                    *restrict suffix = l->suffix;
+    int pos = l->blockpos;
+    float run = l->blockmax;
+    for (int i = 0; i < n;) {
+        const int count = window - pos < n - i ? window - pos : n - i;
+        for (int k = 0; k < count; k++) {
+            const float p = peaks[i + k];
+            bpeaks[pos + k] = p;
+            run = p > run ? p : run;
+            prefix[k] = run;
+        }
+        limiter_max(limiter_round(count), outs + i, prefix, suffix + pos + 1);
+        pos += count;
+        i += count;
+        if (pos == window) {
+            float s = 0.0f;
+            for (int k = window - 1; k >= 0; k--) {
+                s = bpeaks[k] > s ? bpeaks[k] : s;
+                suffix[k] = s;
+            }
+            pos = 0;
+            run = 0.0f;
+        }
+    }
+    l->blockpos = pos;
+    l->blockmax = run;
+}
+
+bool ufxr_limiter_create(struct ufxr_limiter *restrict l,
+                         const struct ufxr_limiterparams *restrict p,
+                         struct ufxr_error *err) {
+    if (p->samplerate < 1 || !(p->ceiling <= 0.0f) ||
+        !(p->ceiling >= -60.0f) || !(p->lookahead >= 0.0f) ||
+        !(p->release > 0.0f)) {
+        ufxr_error_setcode(err, kUFXRErrorInvalidArgument);
+        return false;
+    }
+    const double lookahead = ceil((double)p->lookahead * p->samplerate);
+    if (lookahead >= kLimiterMaxWindow) {
+        ufxr_error_setcode(err, kUFXRErrorInvalidArgument);
+        return false;
+    }
+    const int window = (int)lookahead + 1;
+    const int delay = window - 1 + kLimiterPeakDelay;
+    const int history =
+        delay > UFXR_TRUEPEAK_TAPS ? delay : UFXR_TRUEPEAK_TAPS;
+    *l = (struct ufxr_limiter){
+        .ceiling = pow(10.0, 0.05 * (double)p->ceiling),
+        .release = 1.0 - exp(-1.0 / ((double)p->release * p->samplerate)),
+        .window = window,
+        .delay = delay,
+        .history = history,
+    };
+    // Arrays have an extra vector of space, so vector operations can run past
+    // the end.
+    const size_t pad = 8;
+    l->buffer = ufxr_alloc(sizeof(float) * (history + kLimiterChunk + pad));
+    l->coeffs = ufxr_alloc(sizeof(float) * UFXR_TRUEPEAK_COEFFS);
+    l->peaks = ufxr_alloc(sizeof(float) * window);
+    l->prefix = ufxr_alloc(sizeof(float) * (window + pad));
+    l->suffix = ufxr_alloc(sizeof(float) * (window + 1 + pad));
+    l->gains = ufxr_alloc(sizeof(float) * window);
+    l->temp = ufxr_alloc(sizeof(float) * 2 * (kLimiterChunk + pad));
+    if (l->buffer == NULL || l->coeffs == NULL || l->peaks == NULL ||
+        l->prefix == NULL || l->suffix == NULL || l->gains == NULL ||
+        l->temp == NULL) {
+        ufxr_error_seterrno(err);
+        ufxr_limiter_destroy(l);
+        return false;
+    }
+
+    ufxr_truepeak_init(l->coeffs);
+    ufxr_limiter_reset(l);
+    return true;
+}
+
+void ufxr_limiter_destroy(struct ufxr_limiter *restrict l) {
+    free(l->buffer);
+    free(l->coeffs);
+    free(l->peaks);
+    free(l->prefix);
+    free(l->suffix);
+    free(l->gains);
+    free(l->temp);
+    l->buffer = NULL;
+    l->coeffs = NULL;
+    l->peaks = NULL;
+    l->prefix = NULL;
+    l->suffix = NULL;
+    l->gains = NULL;
+    l->temp = NULL;
+}
+
+void ufxr_limiter_reset(struct ufxr_limiter *restrict l) {
+    const int window = l->window;
+    memset(l->buffer, 0, sizeof(float) * l->history);
+    memset(l->suffix, 0, sizeof(float) * (window + 1));
+    for (int i = 0; i < window; i++) {
+        l->gains[i] = 1.0f;
+    }
+    l->blockpos = 0;
+    l->blockmax = 0.0f;
+    l->gainpos = 0;
+    l->gainsum = window;
+    l->gain = 1.0f;
+}
+
+int ufxr_limiter_latency(const struct ufxr_limiter *restrict l) {
+    return l->delay;
+}
+
+void ufxr_limiter_process(struct ufxr_limiter *restrict l, int n,
+                          float *restrict outs, const float *restrict xs) {
+    const int window = l->window, history = l->history;
+    const float ceiling = l->ceiling, release = l->release;
+    const float scale = 1.0f / (float)window;
+    float *restrict buf = l->buffer, *restrict gains = l->gains;
+    float *restrict peaks = l->temp,
+                    *restrict maxes = l->temp + kLimiterChunk + 8;
+    // The newest sample is at index history + i. Its delayed output is at
+    // history + i - delay, and its peaks are measured by a filter ending on
+    // it.
+    const float *restrict delayed = buf + history - l->delay;
+    const float *restrict filter = buf + history - UFXR_TRUEPEAK_TAPS + 1;
+    float gain = l->gain;
+    int gainpos = l->gainpos;
+    double gainsum = l->gainsum;
+    for (int pos = 0; pos < n;) {
+        int count = n - pos < kLimiterChunk ? n - pos : kLimiterChunk;
+        memcpy(buf + history, xs + pos, sizeof(float) * count);
+        ufxr_truepeak(count, peaks, filter, l->coeffs);
+        // The output arrays have space for a partial vector past the end.
+        limiter_window(l, count, maxes, peaks);
+        for (int i = 0; i < count; i++) {
+            const float peak = maxes[i];
+            const float target = peak > ceiling ? ceiling / peak : 1.0f;
+            gainsum += (double)target - (double)gains[gainpos];
+            gains[gainpos] = target;
+            if (++gainpos == window) {
+                // Recompute the sum, so rounding errors do not accumulate.
+                gainpos = 0;
+                gainsum = 0.0;
+                for (int k = 0; k < window; k++) {
+                    gainsum += (double)gains[k];
+                }
+            }
+            const float avg = (float)gainsum * scale;
+            gain = avg < gain ? avg : gain + (avg - gain) * release;
+            outs[pos + i] = delayed[i] * gain;
+        }
+        memmove(buf, buf + count, sizeof(float) * history);
+        pos += count;
+    }
+    l->gain = gain;
+    l->gainpos = gainpos;
+    l->gainsum = gainsum;
+}
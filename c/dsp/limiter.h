@@ -0,0 +1,92 @@
+// c/dsp/limiter.h - Look-ahead peak limiter.
+#pragma once
+
+#include <stdbool.h>
+
+struct ufxr_error;
+
+// Parameters for a limiter.
+struct ufxr_limiterparams {
+    // Sample rate, in Hz.
+    int samplerate;
+    // Maximum true peak level of the output, in dBFS. Usually slightly below
+    // zero.
+    float ceiling;
+    // Look-ahead time, in seconds. Gain reduction ramps down over this time
+    // before each peak. Usually 1-10 ms.
+    float lookahead;
+    // Release time constant, in seconds.
+    float release;
+};
+
+// A look-ahead true peak limiter, for keeping hot audio from clipping when it
+// is converted to integer samples.
+//
+// Peaks are measured between samples as well as at samples, by interpolating
+// three points between each pair of samples with a short windowed sinc filter.
+// The maximum peak over the look-ahead window is computed with the van Herk /
+// Gil-Werman algorithm, which uses a constant number of operations per sample
+// regardless of the window length. The gain needed for that peak is smoothed
+// with a moving average over the same window, so the gain reaches its target
+// before the peak arrives, and then released exponentially.
+//
+// To use with a wave writer, pass each block of audio to
+// ufxr_limiter_process() just before ufxr_wavewriter_write().
+//
+// All fields are private. Do not access them.
+struct ufxr_limiter {
+    // Linear ceiling.
+    float ceiling;
+    // Release filter coefficient.
+    float release;
+    // Window length for the peak maximum and gain average, equal to the
+    // look-ahead plus one sample.
+    int window;
+    // Total delay, in samples, and number of input samples kept between
+    // chunks.
+    int delay;
+    int history;
+    // Position in the current block of the running maximum, and the maximum
+    // of the block so far.
+    int blockpos;
+    float blockmax;
+    // Position in the gain history.
+    int gainpos;
+    // Sum of the gain history.
+    double gainsum;
+    // Current gain, after release.
+    float gain;
+    // Input history, followed by the current chunk.
+    float *buffer;
+    // Interpolation filters for measuring peaks between samples.
+    float *coeffs;
+    // Peaks in the current block, running maximums of the current block, and
+    // suffix maximums of the previous block. Blocks are one window long.
+    float *peaks;
+    float *prefix;
+    float *suffix;
+    // Gain history, one window long.
+    float *gains;
+    float *temp;
+};
+
+// Create a limiter. If successful, destroy() must be called to release
+// resources. This is the only function which allocates memory.
+bool ufxr_limiter_create(struct ufxr_limiter *restrict l,
+                         const struct ufxr_limiterparams *restrict p,
+                         struct ufxr_error *err);
+
+// Destroy a limiter and release any resources.
+void ufxr_limiter_destroy(struct ufxr_limiter *restrict l);
+
+// Clear the limiter state, and start a new stream.
+void ufxr_limiter_reset(struct ufxr_limiter *restrict l);
+
+// Return the delay of the limiter, in samples. Process this many zeroes after
+// the end of the stream to flush the limiter.
+int ufxr_limiter_latency(const struct ufxr_limiter *restrict l);
+
+// Process n samples. The output is the input delayed by the latency, with gain
+// applied. Does not allocate memory.
+void ufxr_limiter_process(struct ufxr_limiter *restrict l, int n,
+                          float *restrict outs, const float *restrict xs);
@@ -0,0 +1,337 @@
+// loudness.c - Loudness measurement.
+#include "c/dsp/loudness.h"
+
+#include "c/dsp/impl.h"
+#include "c/io/error.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+enum {
+    // Number of frames processed at a time when measuring true peaks.
+    kLoudnessChunk = 256,
+    // Number of input samples kept between chunks for the true peak filters.
+    kLoudnessHistory = UFXR_TRUEPEAK_TAPS - 1,
+    // Number of samples at the end of the history whose true peak has not been
+    // measured yet.
+    kLoudnessPending = UFXR_TRUEPEAK_TAPS / 2,
+    // Number of histogram bins per LU.
+    kLoudnessBinsPerLU = 100,
+    // Number of histogram bins. The histogram covers -70 to +10 LUFS, and
+    // louder blocks are counted in the last bin.
+    kLoudnessBins = 80 * kLoudnessBinsPerLU,
+    // Minimum sample rate.
+    kLoudnessMinRate = 8000,
+};
+
+// Absolute gate, in LUFS.
+static const double kLoudnessAbsoluteGate = -70.0;
+
+// Relative gate, in LU below the loudness of the blocks above the absolute
+// gate.
+static const double kLoudnessRelativeGate = -10.0;
+
+// Convert a sum of mean squares to loudness, in LUFS.
+static inline double loudness_lufs(double energy) {
+    return -0.691 + 10.0 * log10(energy);
+}
+
+// Apply the K-weighting filter to n frames, and return the sum of squares of
+// the result over all channels.
+static double loudness_filter1(struct ufxr_loudness *restrict m, int n,
+                               const float *restrict xs) {
+    const int channels = m->channels;
+    const double *restrict f = m->filter;
+    double sum = 0.0;
+    for (int c = 0; c < channels; c++) {
+        double s11 = m->state[c], s12 = m->state[2 + c];
+        double s21 = m->state[4 + c], s22 = m->state[6 + c];
+        for (int i = 0; i < n; i++) {
+            const double x = (double)xs[i * channels + c];
+            const double y = f[0] * x + s11;
+            s11 = f[1] * x - f[3] * y + s12;
+            s12 = f[2] * x - f[4] * y;
+            const double z = f[5] * y + s21;
+            s21 = f[6] * y - f[8] * z + s22;
+            s22 = f[7] * y - f[9] * z;
+            sum += z * z;
+        }
+        m->state[c] = s11;
+        m->state[2 + c] = s12;
+        m->state[4 + c] = s21;
+        m->state[6 + c] = s22;
+    }
+    return sum;
+}
+
+// SSE2 version.
+#if !HAVE_FUNC && USE_SSE2
+#define HAVE_FUNC 1
+#include <emmintrin.h>
+
+// Stereo is filtered with both channels in one vector.
+static double loudness_filter(struct ufxr_loudness *restrict m, int n,
+                              const float *restrict xs) {
+    if (m->channels != 2) {
+        return loudness_filter1(m, n, xs);
+    }
+    const double *restrict f = m->filter;
+    __m128d c[10];
+    for (int k = 0; k < 10; k++) {
+        c[k] = _mm_set1_pd(f[k]);
+    }
+    __m128d s11 = _mm_loadu_pd(m->state), s12 = _mm_loadu_pd(m->state + 2),
+            s21 = _mm_loadu_pd(m->state + 4), s22 = _mm_loadu_pd(m->state + 6);
+    __m128d sum = _mm_setzero_pd();
+    for (int i = 0; i < n; i++) {
+        const __m128d x = _mm_cvtps_pd(_mm_castsi128_ps(
+            _mm_loadl_epi64((const __m128i *)(xs + i * 2))));
+        const __m128d y = _mm_add_pd(_mm_mul_pd(c[0], x), s11);
+        s11 = _mm_add_pd(_mm_sub_pd(_mm_mul_pd(c[1], x), _mm_mul_pd(c[3], y)),
+                         s12);
+        s12 = _mm_sub_pd(_mm_mul_pd(c[2], x), _mm_mul_pd(c[4], y));
+        const __m128d z = _mm_add_pd(_mm_mul_pd(c[5], y), s21);
+        s21 = _mm_add_pd(_mm_sub_pd(_mm_mul_pd(c[6], y), _mm_mul_pd(c[8], z)),
+                         s22);
+        s22 = _mm_sub_pd(_mm_mul_pd(c[7], y), _mm_mul_pd(c[9], z));
+        sum = _mm_add_pd(sum, _mm_mul_pd(z, z));
+    }
+    _mm_storeu_pd(m->state, s11);
+    _mm_storeu_pd(m->state + 2, s12);
+    _mm_storeu_pd(m->state + 4, s21);
+    _mm_storeu_pd(m->state + 6, s22);
+    return _mm_cvtsd_f64(_mm_add_sd(sum, _mm_unpackhi_pd(sum, sum)));
+}
+#endif
+
+// Scalar version.
+#if !HAVE_FUNC
+static double loudness_filter(struct ufxr_loudness *restrict m, int n,
+                              const float *restrict xs) {
+    return loudness_filter1(m, n, xs);
+}
+#endif
+
+// Finish a 100 ms sub-block, and add the 400 ms block ending with it to the
+// histogram.
+static void loudness_block(struct ufxr_loudness *restrict m) {
+    const double ms = m->blocksum / m->blocklen;
+    if (m->subblocks == 3) {
+        const double energy =
+            0.25 * (m->history[0] + m->history[1] + m->history[2] + ms);
+        const double lufs = loudness_lufs(energy);
+        if (lufs > kLoudnessAbsoluteGate) {
+            double pos = (lufs - kLoudnessAbsoluteGate) * kLoudnessBinsPerLU;
+            int bin = pos < kLoudnessBins - 1 ? (int)pos : kLoudnessBins - 1;
+            m->counts[bin]++;
+            m->energies[bin] += energy;
+        }
+    } else {
+        m->subblocks++;
+    }
+    m->history[0] = m->history[1];
+    m->history[1] = m->history[2];
+    m->history[2] = ms;
+    m->blocksum = 0.0;
+    m->blockpos = 0;
+}
+
+// Compute the K-weighting filter coefficients, from ITU-R BS.1770-4. The
+// reference coefficients are given for 48 kHz. These are the analog
+// prototypes which reproduce them, so other sample rates are exact.
+static void loudness_coeffs(double *restrict f, int samplerate) {
+    const double pi = 4.0 * atan(1.0);
+    // Stage 1: high shelf.
+    {
+        const double f0 = 1681.974450955533, gain = 3.999843853973347,
+                     q = 0.7071752369554196;
+        const double k = tan(pi * f0 / samplerate);
+        const double vh = pow(10.0, gain / 20.0);
+        const double vb = pow(vh, 0.4996667741545416);
+        const double a0 = 1.0 + k / q + k * k;
+        f[0] = (vh + vb * k / q + k * k) / a0;
+        f[1] = 2.0 * (k * k - vh) / a0;
+        f[2] = (vh - vb * k / q + k * k) / a0;
+        f[3] = 2.0 * (k * k - 1.0) / a0;
+        f[4] = (1.0 - k / q + k * k) / a0;
+    }
+    // Stage 2: high pass.
+    {
+        const double f0 = 38.13547087602444, q = 0.5003270373238773;
+        const double k = tan(pi * f0 / samplerate);
+        const double a0 = 1.0 + k / q + k * k;
+        f[5] = 1.0;
+        f[6] = -2.0;
+        f[7] = 1.0;
+        f[8] = 2.0 * (k * k - 1.0) / a0;
+        f[9] = (1.0 - k / q + k * k) / a0;
+    }
+}
+
+bool ufxr_loudness_create(struct ufxr_loudness *restrict m, int samplerate,
+                          int channels, struct ufxr_error *err) {
+    if (samplerate < kLoudnessMinRate || channels < 1 || channels > 2) {
+        ufxr_error_setcode(err, kUFXRErrorInvalidArgument);
+        return false;
+    }
+    *m = (struct ufxr_loudness){
+        .channels = channels,
+        .blocklen = (samplerate + 5) / 10,
+    };
+    loudness_coeffs(m->filter, samplerate);
+    m->counts = ufxr_alloc(sizeof(*m->counts) * kLoudnessBins);
+    m->energies = ufxr_alloc(sizeof(*m->energies) * kLoudnessBins);
+    m->coeffs = ufxr_alloc(sizeof(float) * UFXR_TRUEPEAK_COEFFS);
+    m->buffer = ufxr_alloc(sizeof(float) * channels *
+                           (kLoudnessHistory + kLoudnessChunk));
+    if (m->counts == NULL || m->energies == NULL || m->coeffs == NULL ||
+        m->buffer == NULL) {
+        ufxr_error_seterrno(err);
+        ufxr_loudness_destroy(m);
+        return false;
+    }
+    ufxr_truepeak_init(m->coeffs);
+    ufxr_loudness_reset(m);
+    return true;
+}
+
+void ufxr_loudness_destroy(struct ufxr_loudness *restrict m) {
+    free(m->counts);
+    free(m->energies);
+    free(m->coeffs);
+    free(m->buffer);
+    m->counts = NULL;
+    m->energies = NULL;
+    m->coeffs = NULL;
+    m->buffer = NULL;
+}
+
+void ufxr_loudness_reset(struct ufxr_loudness *restrict m) {
+    m->blockpos = 0;
+    m->blocksum = 0.0;
+    for (int i = 0; i < 3; i++) {
+        m->history[i] = 0.0;
+    }
+    m->subblocks = 0;
+    for (int i = 0; i < 8; i++) {
+        m->state[i] = 0.0;
+    }
+    memset(m->counts, 0, sizeof(*m->counts) * kLoudnessBins);
+    memset(m->energies, 0, sizeof(*m->energies) * kLoudnessBins);
+    m->peak = 0.0f;
+    m->warmup = kLoudnessHistory;
+    memset(m->buffer, 0,
+           sizeof(float) * m->channels * (kLoudnessHistory + kLoudnessChunk));
+}
+
+void ufxr_loudness_process(struct ufxr_loudness *restrict m,
+                           const float *restrict data, size_t count) {
+    const int channels = m->channels;
+    const size_t frames = count / channels;
+    float peaks[kLoudnessChunk];
+    float peak = m->peak;
+    for (size_t pos = 0; pos < frames;) {
+        const int n = frames - pos < kLoudnessChunk ? (int)(frames - pos)
+                                                    : kLoudnessChunk;
+        const float *restrict xs = data + pos * channels;
+        // K-weighted energy, split at sub-block boundaries.
+        for (int i = 0; i < n;) {
+            const int avail = m->blocklen - m->blockpos;
+            const int amt = n - i < avail ? n - i : avail;
+            m->blocksum += loudness_filter(m, amt, xs + i * channels);
+            m->blockpos += amt;
+            i += amt;
+            if (m->blockpos == m->blocklen) {
+                loudness_block(m);
+            }
+        }
+        // True peak of each channel. The filters measure the samples which
+        // are kLoudnessPending before the newest one. Near the start of the
+        // stream, the filters extend past the start, and only the samples
+        // themselves are measured.
+        const int warmup = m->warmup < n ? m->warmup : n;
+        for (int c = 0; c < channels; c++) {
+            float *restrict buf =
+                m->buffer + c * (kLoudnessHistory + kLoudnessChunk);
+            for (int i = 0; i < n; i++) {
+                buf[kLoudnessHistory + i] = xs[i * channels + c];
+            }
+            ufxr_truepeak(n, peaks, buf, m->coeffs);
+            for (int i = 0; i < warmup; i++) {
+                peaks[i] = fabsf(buf[kLoudnessPending - 1 + i]);
+            }
+            for (int i = 0; i < n; i++) {
+                peak = peaks[i] > peak ? peaks[i] : peak;
+            }
+            memmove(buf, buf + n, sizeof(float) * kLoudnessHistory);
+        }
+        m->warmup -= warmup;
+        pos += n;
+    }
+    m->peak = peak;
+}
+
+double ufxr_loudness_integrated(const struct ufxr_loudness *restrict m) {
+    const size_t *restrict counts = m->counts;
+    const double *restrict energies = m->energies;
+    size_t total = 0;
+    double sum = 0.0;
+    for (int i = 0; i < kLoudnessBins; i++) {
+        total += counts[i];
+        sum += energies[i];
+    }
+    if (total == 0) {
+        return -HUGE_VAL;
+    }
+    // Keep the bins whose lower edge is at or above the relative gate.
+    const double gate =
+        loudness_lufs(sum / (double)total) + kLoudnessRelativeGate;
+    const double start =
+        ceil((gate - kLoudnessAbsoluteGate) * kLoudnessBinsPerLU);
+    total = 0;
+    sum = 0.0;
+    for (int i = start > 0.0 ? (int)start : 0; i < kLoudnessBins; i++) {
+        total += counts[i];
+        sum += energies[i];
+    }
+    if (total == 0) {
+        return -HUGE_VAL;
+    }
+    return loudness_lufs(sum / (double)total);
+}
+
+double ufxr_loudness_truepeak(const struct ufxr_loudness *restrict m) {
+    // The samples at the end of the stream which are still pending are
+    // measured without interpolation, since the filters would extend past the
+    // end of the stream.
+    float peak = m->peak;
+    for (int c = 0; c < m->channels; c++) {
+        const float *restrict buf =
+            m->buffer + c * (kLoudnessHistory + kLoudnessChunk);
+        for (int i = kLoudnessHistory - kLoudnessPending; i < kLoudnessHistory;
+             i++) {
+            const float x = fabsf(buf[i]);
+            peak = x > peak ? x : peak;
+        }
+    }
+    return 20.0 * log10((double)peak);
+}
+
+double ufxr_loudness_gain(const struct ufxr_loudness *restrict m,
+                          double target) {
+    const double lufs = ufxr_loudness_integrated(m);
+    if (!isfinite(lufs)) {
+        return 1.0;
+    }
+    return pow(10.0, 0.05 * (target - lufs));
+}
+
+void ufxr_loudness_normalize(const struct ufxr_loudness *restrict m,
+                             double target, float *restrict data,
+                             size_t count) {
+    const float gain = ufxr_loudness_gain(m, target);
+    for (size_t i = 0; i < count; i++) {
+        data[i] *= gain;
+    }
+}
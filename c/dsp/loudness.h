@@ -0,0 +1,94 @@
+// c/dsp/loudness.h - Loudness measurement.
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+struct ufxr_error;
+
+// A loudness meter, which measures integrated loudness and true peak level as
+// specified by EBU R128 and ITU-R BS.1770-4.
+//
+// Audio is K-weighted with two biquad filters, and the mean square of each
+// channel is summed over 400 ms blocks which overlap by 75%. Blocks below -70
+// LUFS are discarded, then blocks more than 10 LU below the loudness of the
+// remaining blocks are discarded. Gated blocks are kept in a histogram with
+// 0.01 LU bins, so the memory used does not depend on the length of the
+// stream, and the relative gate is resolved to 0.01 LU. True peaks are
+// measured with 4x oversampling. Points between samples are not measured
+// where the interpolation filter extends past either end of the stream, so
+// audio which starts or ends abruptly does not measure the overshoot of a
+// step.
+//
+// The meter takes interleaved samples, so it can be run alongside a wave
+// writer by passing it the same data given to ufxr_wavewriter_write(). To
+// normalize audio which has already been rendered, measure the buffer, then
+// call ufxr_loudness_normalize() on it before writing it.
+//
+// All fields are private. Do not access them.
+struct ufxr_loudness {
+    int channels;
+    // Length of a 100 ms sub-block, in frames, and the number of frames in the
+    // current sub-block so far.
+    int blocklen;
+    int blockpos;
+    // Sum of squares of the K-weighted signal in the current sub-block, and
+    // mean squares of the previous three sub-blocks, oldest first.
+    double blocksum;
+    double history[3];
+    // Number of sub-blocks finished, up to 3.
+    int subblocks;
+    // K-weighting filter coefficients b0, b1, b2, a1, a2 for each stage, and
+    // filter state for each stage of each channel.
+    double filter[10];
+    double state[8];
+    // Number of blocks and sum of their mean squares in each histogram bin.
+    size_t *counts;
+    double *energies;
+    // Largest true peak so far, linear.
+    float peak;
+    // Number of true peak measurements left whose filters extend past the
+    // start of the stream.
+    int warmup;
+    // True peak interpolation filters, and input history for each channel.
+    float *coeffs;
+    float *buffer;
+};
+
+// Create a loudness meter for audio with 1 or 2 channels. If successful,
+// destroy() must be called to release resources. This is the only function
+// which allocates memory.
+bool ufxr_loudness_create(struct ufxr_loudness *restrict m, int samplerate,
+                          int channels, struct ufxr_error *err);
+
+// Destroy a loudness meter and release any resources.
+void ufxr_loudness_destroy(struct ufxr_loudness *restrict m);
+
+// Clear the measurements, and start a new stream.
+void ufxr_loudness_reset(struct ufxr_loudness *restrict m);
+
+// Measure interleaved audio. The count is the number of samples, and must be a
+// whole number of frames. Does not allocate memory.
+void ufxr_loudness_process(struct ufxr_loudness *restrict m,
+                           const float *restrict data, size_t count);
+
+// Return the integrated loudness of the stream so far, in LUFS. Returns
+// -HUGE_VAL if no block is above the absolute gate. A partial block at the end
+// of the stream is not counted.
+double ufxr_loudness_integrated(const struct ufxr_loudness *restrict m);
+
+// Return the largest true peak of the stream so far, in dBTP.
+double ufxr_loudness_truepeak(const struct ufxr_loudness *restrict m);
+
+// Return the linear gain which brings the stream to the target loudness, in
+// LUFS. Returns 1 if the stream is silent.
+double ufxr_loudness_gain(const struct ufxr_loudness *restrict m,
+                          double target);
+
+// Scale interleaved audio which has already been measured, so it has the
+// target loudness, in LUFS. This is the second pass of two-pass
+// normalization. The true peak of the result is the measured true peak plus
+// the gain, and may be above 0 dBTP, so a limiter may be needed afterwards.
+void ufxr_loudness_normalize(const struct ufxr_loudness *restrict m,
+                             double target, float *restrict data,
+                             size_t count);
@@ -0,0 +1,218 @@
+// modal.c - Modal resonator bank.
+#include "c/dsp/modal.h"
+
+#include "c/dsp/impl.h"
+#include "c/io/error.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Per-mode state. The state is stored as structure of arrays. Each resonator
+// computes y[n] = a1 y[n-1] + a2 y[n-2] + b x[n].
+enum {
+    kModalA1,    // Feedback coefficient, 2 r cos(w).
+    kModalA2,    // Feedback coefficient, -r^2.
+    kModalB,     // Input gain.
+    kModalY1,    // Previous output.
+    kModalY2,    // Output before previous.
+    kModalFieldCount,
+};
+
+enum {
+    // Arrays are padded to a multiple of this many modes. Padding modes have
+    // zero gain and stay silent.
+    kModalGroup = 16,
+};
+
+static inline float *modal_field(const struct ufxr_modalbank *restrict m,
+                                 int field) {
+    return m->state + field * m->capacity;
+}
+
+// AVX version.
+#if !HAVE_FUNC && USE_AVX
+#define HAVE_FUNC 1
+#include <immintrin.h>
+
+// Process 16 modes at a time, in two vectors. The modes are independent, so
+// the recurrences for different groups of modes can execute in parallel.
+static void modal_run(struct ufxr_modalbank *restrict m, int n,
+                      float *restrict outs, const float *restrict xs) {
+    const int cap = m->capacity;
+    const float *restrict a1s = modal_field(m, kModalA1),
+                          *restrict a2s = modal_field(m, kModalA2),
+                          *restrict bs = modal_field(m, kModalB);
+    float *restrict y1s = modal_field(m, kModalY1),
+                    *restrict y2s = modal_field(m, kModalY2);
+    for (int i = 0; i < n; i++) {
+        const __m256 x = _mm256_set1_ps(xs[i]);
+        __m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps();
+        for (int j = 0; j < cap; j += 16) {
+            __m256 y10 = _mm256_load_ps(y1s + j);
+            __m256 y11 = _mm256_load_ps(y1s + j + 8);
+            __m256 y0 = _mm256_add_ps(
+                _mm256_add_ps(
+                    _mm256_mul_ps(_mm256_load_ps(a1s + j), y10),
+                    _mm256_mul_ps(_mm256_load_ps(a2s + j),
+                                  _mm256_load_ps(y2s + j))),
+                _mm256_mul_ps(_mm256_load_ps(bs + j), x));
+            __m256 y1 = _mm256_add_ps(
+                _mm256_add_ps(
+                    _mm256_mul_ps(_mm256_load_ps(a1s + j + 8), y11),
+                    _mm256_mul_ps(_mm256_load_ps(a2s + j + 8),
+                                  _mm256_load_ps(y2s + j + 8))),
+                _mm256_mul_ps(_mm256_load_ps(bs + j + 8), x));
+            _mm256_store_ps(y2s + j, y10);
+            _mm256_store_ps(y2s + j + 8, y11);
+            _mm256_store_ps(y1s + j, y0);
+            _mm256_store_ps(y1s + j + 8, y1);
+            acc0 = _mm256_add_ps(acc0, y0);
+            acc1 = _mm256_add_ps(acc1, y1);
+        }
+        acc0 = _mm256_add_ps(acc0, acc1);
+        __m128 acc = _mm_add_ps(_mm256_castps256_ps128(acc0),
+                                _mm256_extractf128_ps(acc0, 1));
+        acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+        acc = _mm_add_ss(acc,
+                         _mm_shuffle_ps(acc, acc, _MM_SHUFFLE(1, 1, 1, 1)));
+        outs[i] = _mm_cvtss_f32(acc);
+    }
+}
+#endif
+
+// SSE2 version.
+#if !HAVE_FUNC && USE_SSE2
+#define HAVE_FUNC 1
+#include <xmmintrin.h>
+
+static void modal_run(struct ufxr_modalbank *restrict m, int n,
+                      float *restrict outs, const float *restrict xs) {
+    const int cap = m->capacity;
+    const float *restrict a1s = modal_field(m, kModalA1),
+                          *restrict a2s = modal_field(m, kModalA2),
+                          *restrict bs = modal_field(m, kModalB);
+    float *restrict y1s = modal_field(m, kModalY1),
+                    *restrict y2s = modal_field(m, kModalY2);
+    for (int i = 0; i < n; i++) {
+        const __m128 x = _mm_set1_ps(xs[i]);
+        __m128 acc[4] = {_mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps(),
+                         _mm_setzero_ps()};
+        for (int j = 0; j < cap; j += 16) {
+            for (int k = 0; k < 4; k++) {
+                const int jk = j + 4 * k;
+                __m128 yp = _mm_load_ps(y1s + jk);
+                __m128 y = _mm_add_ps(
+                    _mm_add_ps(_mm_mul_ps(_mm_load_ps(a1s + jk), yp),
+                               _mm_mul_ps(_mm_load_ps(a2s + jk),
+                                          _mm_load_ps(y2s + jk))),
+                    _mm_mul_ps(_mm_load_ps(bs + jk), x));
+                _mm_store_ps(y2s + jk, yp);
+                _mm_store_ps(y1s + jk, y);
+                acc[k] = _mm_add_ps(acc[k], y);
+            }
+        }
+        __m128 sum =
+            _mm_add_ps(_mm_add_ps(acc[0], acc[1]), _mm_add_ps(acc[2], acc[3]));
+        sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+        sum = _mm_add_ss(sum,
+                         _mm_shuffle_ps(sum, sum, _MM_SHUFFLE(1, 1, 1, 1)));
+        outs[i] = _mm_cvtss_f32(sum);
+    }
+}
+#endif
+
+// Scalar version.
+#if !HAVE_FUNC
+static void modal_run(struct ufxr_modalbank *restrict m, int n,
+                      float *restrict outs, const float *restrict xs) {
+    const int count = m->modes;
+    const float *restrict a1s = modal_field(m, kModalA1),
+                          *restrict a2s = modal_field(m, kModalA2),
+                          *restrict bs = modal_field(m, kModalB);
+    float *restrict y1s = modal_field(m, kModalY1),
+                    *restrict y2s = modal_field(m, kModalY2);
+    for (int i = 0; i < n; i++) {
+        const float x = xs[i];
+        float acc = 0.0f;
+        for (int j = 0; j < count; j++) {
+            float y = a1s[j] * y1s[j] + a2s[j] * y2s[j] + bs[j] * x;
+            y2s[j] = y1s[j];
+            y1s[j] = y;
+            acc += y;
+        }
+        outs[i] = acc;
+    }
+}
+#endif
+
+bool ufxr_modalbank_create(struct ufxr_modalbank *restrict m, int samplerate,
+                           int count, const struct ufxr_mode *restrict modes,
+                           struct ufxr_error *err) {
+    if (samplerate <= 0 || count < 1 || count > UFXR_MODAL_MAXMODES) {
+        ufxr_error_setcode(err, kUFXRErrorInvalidArgument);
+        return false;
+    }
+    for (int i = 0; i < count; i++) {
+        if (!(modes[i].freq >= 0.0f) || !(modes[i].decay > 0.0f) ||
+            !isfinite(modes[i].gain)) {
+            ufxr_error_setcode(err, kUFXRErrorInvalidArgument);
+            return false;
+        }
+    }
+    const int capacity = (count + kModalGroup - 1) & ~(kModalGroup - 1);
+    float *state = ufxr_alloc(sizeof(float) * kModalFieldCount * capacity);
+    if (state == NULL) {
+        ufxr_error_seterrno(err);
+        return false;
+    }
+    *m = (struct ufxr_modalbank){
+        .samplerate = samplerate,
+        .modes = count,
+        .capacity = capacity,
+        .state = state,
+    };
+    for (int i = 0; i < count; i++) {
+        ufxr_modalbank_set(m, i, &modes[i]);
+    }
+    return true;
+}
+
+void ufxr_modalbank_destroy(struct ufxr_modalbank *restrict m) {
+    free(m->state);
+    m->state = NULL;
+}
+
+void ufxr_modalbank_reset(struct ufxr_modalbank *restrict m) {
+    memset(modal_field(m, kModalY1), 0, sizeof(float) * m->capacity);
+    memset(modal_field(m, kModalY2), 0, sizeof(float) * m->capacity);
+}
+
+void ufxr_modalbank_set(struct ufxr_modalbank *restrict m, int index,
+                        const struct ufxr_mode *restrict mode) {
+    const double rate = m->samplerate;
+    const double pi = 4.0 * atan(1.0);
+    double w = 2.0 * pi * (double)mode->freq / rate;
+    double a1 = 0.0, a2 = 0.0, b = 0.0;
+    if (w > 0.0 && w < pi && mode->decay > 0.0f) {
+        // Pole radius which gives a 60 dB decay after the given decay time.
+        double r = pow(10.0, -3.0 / ((double)mode->decay * rate));
+        a1 = 2.0 * r * cos(w);
+        a2 = -r * r;
+        // The impulse response is b r^n sin((n+1) w) / sin(w), so scale by
+        // sin(w) to get the requested amplitude.
+        b = (double)mode->gain * sin(w);
+    }
+    modal_field(m, kModalA1)[index] = a1;
+    modal_field(m, kModalA2)[index] = a2;
+    modal_field(m, kModalB)[index] = b;
+}
+
+void ufxr_modalbank_process(struct ufxr_modalbank *restrict m, int n,
+                            float *restrict outs, const float *restrict xs) {
+    // The resonators decay into subnormals, which are very slow.
+    struct ufxr_fpstate fp;
+    ufxr_fpstate_ftz(&fp);
+    modal_run(m, n, outs, xs);
+    ufxr_fpstate_restore(&fp);
+}
@@ -0,0 +1,60 @@
+// c/dsp/modal.h - Modal resonator bank.
+#pragma once
+
+#include <stdbool.h>
+
+struct ufxr_error;
+
+// Maximum number of modes in a resonator bank.
+#define UFXR_MODAL_MAXMODES 4096
+
+// Parameters for one mode of a resonator bank.
+struct ufxr_mode {
+    // Frequency in Hz. Modes at or above the Nyquist frequency are silent.
+    float freq;
+    // Decay time (T60) in seconds. This is the time it takes for the mode to
+    // fall by 60 dB after it is excited.
+    float decay;
+    // Amplitude of the mode's response to a unit impulse.
+    float gain;
+};
+
+// A bank of decaying resonators, for modal synthesis of struck and plucked
+// objects like bells, bars, and plates.
+//
+// Each mode is a two-pole resonator. All modes are excited by the same input
+// and their outputs are summed. Mode parameters are stored as a structure of
+// arrays, and the bank is processed many modes at a time.
+//
+// All fields are private. Do not access them.
+struct ufxr_modalbank {
+    int samplerate;
+    int modes;
+    int capacity;
+    float *state;
+};
+
+// Create a resonator bank with the given modes. The number of modes must be in
+// the range 1 to UFXR_MODAL_MAXMODES. If successful, destroy() must be called
+// to release resources. This is the only function which allocates memory.
+bool ufxr_modalbank_create(struct ufxr_modalbank *restrict m, int samplerate,
+                           int count, const struct ufxr_mode *restrict modes,
+                           struct ufxr_error *err);
+
+// Destroy a resonator bank and release any resources.
+void ufxr_modalbank_destroy(struct ufxr_modalbank *restrict m);
+
+// Clear the resonator state, silencing all modes.
+void ufxr_modalbank_reset(struct ufxr_modalbank *restrict m);
+
+// Change the parameters of one mode. The index must be less than the number of
+// modes. The mode keeps ringing with the new parameters. Does not allocate
+// memory.
+void ufxr_modalbank_set(struct ufxr_modalbank *restrict m, int index,
+                        const struct ufxr_mode *restrict mode);
+
+// Process a block of audio. The input excites every mode, and the output is
+// the sum of all modes. The state is preserved between calls, so a long signal
+// can be processed in blocks of any size. Does not allocate memory.
+void ufxr_modalbank_process(struct ufxr_modalbank *restrict m, int n,
+                            float *restrict outs, const float *restrict xs);
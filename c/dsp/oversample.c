@@ -0,0 +1,268 @@
+// oversample.c - Polyphase half-band oversampling.
+#include "c/dsp/oversample.h"
+
+#include "c/dsp/impl.h"
+#include "c/io/error.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Half-length of the half-band filter for each stage, K. The filter has 4K-1
+// taps, 2K of which are nonzero and not equal to 1/2. The first stage has a
+// passband up to about 0.4 times the original sample rate. Later stages only
+// need to reject images of that passband, so they can be much shorter.
+static const int kHalfbandSize[UFXR_OVERSAMPLE_MAXSTAGES] = {12, 6, 4};
+
+// Kaiser window shape parameter. This gives about 80 dB of stopband
+// attenuation.
+static const double kHalfbandBeta = 8.0;
+
+// SSE2 version.
+#if !HAVE_FUNC && USE_SSE2
+#define HAVE_FUNC 1
+#include <xmmintrin.h>
+
+// Compute outs[i] = sum(coeffs[k] * xs[i-k]) for k in [0, taps). The input
+// must have taps-1 samples of history before xs[0]. Output must be aligned.
+static void halfband_fir(int n, float *restrict outs, const float *restrict xs,
+                         int taps, const float *restrict coeffs) {
+    for (int i = 0; i < n; i += 4) {
+        __m128 acc = _mm_setzero_ps();
+        for (int k = 0; k < taps; k++) {
+            acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(coeffs[k]),
+                                             _mm_loadu_ps(xs + i - k)));
+        }
+        _mm_store_ps(outs + i, acc);
+    }
+}
+
+// Interleave two signals: outs[2i] = even[i], outs[2i+1] = odd[i].
+static void halfband_interleave(int n, float *restrict outs,
+                                const float *restrict even,
+                                const float *restrict odd) {
+    for (int i = 0; i < n; i += 4) {
+        __m128 e = _mm_load_ps(even + i), o = _mm_loadu_ps(odd + i);
+        _mm_store_ps(outs + 2 * i, _mm_unpacklo_ps(e, o));
+        _mm_store_ps(outs + 2 * i + 4, _mm_unpackhi_ps(e, o));
+    }
+}
+
+// Deinterleave a signal: even[i] = xs[2i], odd[i] = xs[2i+1].
+static void halfband_deinterleave(int n, float *restrict even,
+                                  float *restrict odd,
+                                  const float *restrict xs) {
+    for (int i = 0; i < n; i += 4) {
+        __m128 a = _mm_load_ps(xs + 2 * i), b = _mm_load_ps(xs + 2 * i + 4);
+        _mm_storeu_ps(even + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+        _mm_storeu_ps(odd + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+    }
+}
+#endif
+
+// Scalar version.
+#if !HAVE_FUNC
+static void halfband_fir(int n, float *restrict outs, const float *restrict xs,
+                         int taps, const float *restrict coeffs) {
+    for (int i = 0; i < n; i++) {
+        float acc = 0.0f;
+        for (int k = 0; k < taps; k++) {
+            acc += coeffs[k] * xs[i - k];
+        }
+        outs[i] = acc;
+    }
+}
+
+static void halfband_interleave(int n, float *restrict outs,
+                                const float *restrict even,
+                                const float *restrict odd) {
+    for (int i = 0; i < n; i++) {
+        outs[2 * i] = even[i];
+        outs[2 * i + 1] = odd[i];
+    }
+}
+
+static void halfband_deinterleave(int n, float *restrict even,
+                                  float *restrict odd,
+                                  const float *restrict xs) {
+    for (int i = 0; i < n; i++) {
+        even[i] = xs[2 * i];
+        odd[i] = xs[2 * i + 1];
+    }
+}
+#endif
+
+// Create one half-band stage. The block size is the maximum input size for
+// upsampling, or output size for downsampling.
+static bool halfband_create(struct ufxr_halfband *restrict h, int half,
+                            int block) {
+    const int taps = 2 * half, hist = taps - 1;
+    const size_t bufsize = sizeof(float) * (size_t)(hist + block);
+    h->half = half;
+    h->coeffs = ufxr_alloc(sizeof(float) * taps);
+    h->upbuf = ufxr_alloc(bufsize);
+    h->evenbuf = ufxr_alloc(bufsize);
+    h->oddbuf = ufxr_alloc(bufsize);
+    h->temp = ufxr_alloc(sizeof(float) * block);
+    if (h->coeffs == NULL || h->upbuf == NULL || h->evenbuf == NULL ||
+        h->oddbuf == NULL || h->temp == NULL) {
+        return false;
+    }
+    // Nonzero taps of the half-band filter, scaled by 2 for the gain of
+    // upsampling. Tap k is at distance d = 2k - 2K + 1 from the center.
+    const double pi = 4.0 * atan(1.0);
+    for (int k = 0; k < taps; k++) {
+        double d = 2 * k - taps + 1;
+        double x = 0.5 * pi * d;
+        h->coeffs[k] = (float)(2.0 * sin(x) / (2.0 * x) *
+                               ufxr_kaiser(d / (double)taps, kHalfbandBeta));
+    }
+    return true;
+}
+
+static void halfband_destroy(struct ufxr_halfband *restrict h) {
+    free(h->coeffs);
+    free(h->upbuf);
+    free(h->evenbuf);
+    free(h->oddbuf);
+    free(h->temp);
+    *h = (struct ufxr_halfband){0};
+}
+
+// Upsample n samples by 2. The even outputs are filtered and the odd outputs
+// are the center tap, which is a delay of K-1 input samples.
+static void halfband_up(struct ufxr_halfband *restrict h, int n,
+                        float *restrict outs, const float *restrict xs) {
+    const int taps = 2 * h->half, hist = taps - 1;
+    float *restrict buf = h->upbuf;
+    memcpy(buf + hist, xs, sizeof(float) * n);
+    halfband_fir(n, h->temp, buf + hist, taps, h->coeffs);
+    halfband_interleave(n, outs, h->temp, buf + hist - (h->half - 1));
+    memmove(buf, buf + n, sizeof(float) * hist);
+}
+
+// Downsample 2n samples by 2. This is the same filter as upsampling, with the
+// phases swapped and gain halved.
+static void halfband_down(struct ufxr_halfband *restrict h, int n,
+                          float *restrict outs, const float *restrict xs) {
+    const int taps = 2 * h->half, hist = taps - 1;
+    float *restrict even = h->evenbuf, *restrict odd = h->oddbuf;
+    halfband_deinterleave(n, even + hist, odd + hist, xs);
+    halfband_fir(n, outs, even + hist, taps, h->coeffs);
+    const float *restrict delayed = odd + hist - h->half;
+    for (int i = 0; i < n; i++) {
+        outs[i] = 0.5f * (outs[i] + delayed[i]);
+    }
+    memmove(even, even + n, sizeof(float) * hist);
+    memmove(odd, odd + n, sizeof(float) * hist);
+}
+
+bool ufxr_oversampler_create(struct ufxr_oversampler *restrict o, int factor,
+                             int block, struct ufxr_error *err) {
+    int stages;
+    switch (factor) {
+    case 2:
+        stages = 1;
+        break;
+    case 4:
+        stages = 2;
+        break;
+    case 8:
+        stages = 3;
+        break;
+    default:
+        ufxr_error_setcode(err, kUFXRErrorInvalidArgument);
+        return false;
+    }
+    if (block < UFXR_QUANTUM || block % UFXR_QUANTUM != 0 ||
+        block > (1 << 20)) {
+        ufxr_error_setcode(err, kUFXRErrorInvalidArgument);
+        return false;
+    }
+    *o = (struct ufxr_oversampler){
+        .factor = factor,
+        .stages = stages,
+        .block = block,
+    };
+    const size_t highsize = sizeof(float) * (size_t)block * factor;
+    bool ok = true;
+    for (int i = 0; i < 2; i++) {
+        o->work[i] = ufxr_alloc(highsize / 2);
+        o->high[i] = ufxr_alloc(highsize);
+        ok = ok && o->work[i] != NULL && o->high[i] != NULL;
+    }
+    for (int s = 0; s < stages && ok; s++) {
+        ok = halfband_create(&o->stage[s], kHalfbandSize[s], block << s);
+    }
+    if (!ok) {
+        ufxr_error_seterrno(err);
+        ufxr_oversampler_destroy(o);
+        return false;
+    }
+    return true;
+}
+
+void ufxr_oversampler_destroy(struct ufxr_oversampler *restrict o) {
+    for (int i = 0; i < 2; i++) {
+        free(o->work[i]);
+        free(o->high[i]);
+        o->work[i] = NULL;
+        o->high[i] = NULL;
+    }
+    for (int s = 0; s < UFXR_OVERSAMPLE_MAXSTAGES; s++) {
+        halfband_destroy(&o->stage[s]);
+    }
+}
+
+void ufxr_oversampler_reset(struct ufxr_oversampler *restrict o) {
+    for (int s = 0; s < o->stages; s++) {
+        struct ufxr_halfband *restrict h = &o->stage[s];
+        const size_t histsize = sizeof(float) * (2 * h->half - 1);
+        memset(h->upbuf, 0, histsize);
+        memset(h->evenbuf, 0, histsize);
+        memset(h->oddbuf, 0, histsize);
+    }
+}
+
+float ufxr_oversampler_latency(const struct ufxr_oversampler *restrict o) {
+    // Each stage delays by 2K-1 samples at its higher rate, once going up and
+    // once going down.
+    float latency = 0.0f;
+    for (int s = 0; s < o->stages; s++) {
+        latency += (float)(2 * o->stage[s].half - 1) / (float)(1 << s);
+    }
+    return latency;
+}
+
+void ufxr_oversampler_up(struct ufxr_oversampler *restrict o, int n,
+                         float *restrict outs, const float *restrict xs) {
+    const int last = o->stages - 1;
+    const float *in = xs;
+    for (int s = 0; s <= last; s++) {
+        float *out = s == last ? outs : o->work[s & 1];
+        halfband_up(&o->stage[s], n << s, out, in);
+        in = out;
+    }
+}
+
+void ufxr_oversampler_down(struct ufxr_oversampler *restrict o, int n,
+                           float *restrict outs, const float *restrict xs) {
+    const float *in = xs;
+    for (int s = o->stages - 1; s >= 0; s--) {
+        float *out = s == 0 ? outs : o->work[s & 1];
+        halfband_down(&o->stage[s], n << s, out, in);
+        in = out;
+    }
+}
+
+void ufxr_oversampler_process(struct ufxr_oversampler *restrict o, int n,
+                              float *restrict outs, const float *restrict xs,
+                              ufxr_oversample_op op) {
+    const int block = o->block, factor = o->factor;
+    for (int i = 0; i < n; i += block) {
+        int count = n - i < block ? n - i : block;
+        ufxr_oversampler_up(o, count, o->high[0], xs + i);
+        op(count * factor, o->high[1], o->high[0]);
+        ufxr_oversampler_down(o, count, outs + i, o->high[1]);
+    }
+}
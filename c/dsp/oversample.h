@@ -0,0 +1,85 @@
+// c/dsp/oversample.h - Polyphase half-band oversampling.
+#pragma once
+
+#include <stdbool.h>
+
+struct ufxr_error;
+
+// Maximum number of half-band stages, for 8x oversampling.
+#define UFXR_OVERSAMPLE_MAXSTAGES 3
+
+// An operator which can be run by the oversampler. This is the same signature
+// as the operators in c/ops/ops.h.
+typedef void (*ufxr_oversample_op)(int n, float *restrict outs,
+                                   const float *restrict xs);
+
+// One 2x stage of an oversampler. All fields are private.
+struct ufxr_halfband {
+    int half;
+    float *coeffs;
+    float *upbuf;
+    float *evenbuf;
+    float *oddbuf;
+    float *temp;
+};
+
+// An oversampler, for running nonlinear operators at a higher sample rate to
+// reduce aliasing.
+//
+// Each 2x stage is a polyphase half-band FIR filter. Half of the taps in a
+// half-band filter are zero, so one polyphase branch is a pure delay and only
+// the other branch needs to be computed. The first stage, at the original
+// sample rate, has the sharpest filter. Later stages only need to reject the
+// images of the first stage, so they use shorter filters.
+//
+// Audio is processed in blocks no larger than the block size given at
+// creation, so the memory used at the higher rate is bounded.
+//
+// All fields are private. Do not access them.
+struct ufxr_oversampler {
+    int factor;
+    int stages;
+    int block;
+    float *work[2];
+    float *high[2];
+    struct ufxr_halfband stage[UFXR_OVERSAMPLE_MAXSTAGES];
+};
+
+// Create an oversampler. The factor must be 2, 4, or 8. The block size is the
+// maximum number of samples, at the original rate, which can be processed at
+// once, and must be a multiple of UFXR_QUANTUM. If successful, destroy() must
+// be called to release resources. This is the only function which allocates
+// memory.
+bool ufxr_oversampler_create(struct ufxr_oversampler *restrict o, int factor,
+                             int block, struct ufxr_error *err);
+
+// Destroy an oversampler and release any resources.
+void ufxr_oversampler_destroy(struct ufxr_oversampler *restrict o);
+
+// Clear the filter state of an oversampler.
+void ufxr_oversampler_reset(struct ufxr_oversampler *restrict o);
+
+// Return the latency of upsampling followed by downsampling, in samples at the
+// original rate. This may not be an integer.
+float ufxr_oversampler_latency(const struct ufxr_oversampler *restrict o);
+
+// Upsample n samples, producing factor * n samples. The size must be a multiple
+// of UFXR_QUANTUM and no larger than the block size. Arrays must be aligned to
+// UFXR_ALIGN.
+void ufxr_oversampler_up(struct ufxr_oversampler *restrict o, int n,
+                         float *restrict outs, const float *restrict xs);
+
+// Downsample factor * n samples, producing n samples. The size must be a
+// multiple of UFXR_QUANTUM and no larger than the block size. Arrays must be
+// aligned to UFXR_ALIGN.
+void ufxr_oversampler_down(struct ufxr_oversampler *restrict o, int n,
+                           float *restrict outs, const float *restrict xs);
+
+// Upsample the input, run an operator at the higher rate, and downsample the
+// result. The operator must be memoryless, like ufxr_tri or ufxr_sin1_2,
+// because it is called once per block. The size must be a multiple of
+// UFXR_QUANTUM, but may be larger than the block size. Arrays must be aligned
+// to UFXR_ALIGN.
+void ufxr_oversampler_process(struct ufxr_oversampler *restrict o, int n,
+                              float *restrict outs, const float *restrict xs,
+                              ufxr_oversample_op op);
@@ -0,0 +1,237 @@
+// pm.c - Phase modulation synthesis.
+#include "c/dsp/pm.h"
+
+#include "c/dsp/impl.h"
+#include "c/io/error.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Per-voice state. The state is stored as structure of arrays, so groups of
+// four voices can be loaded as vectors.
+enum {
+    kPMCarrier,  // Carrier phase, in cycles.
+    kPMMod,      // Modulator phase, in cycles.
+    kPMRatio,    // Modulator frequency ratio.
+    kPMIndex,    // Modulation index, in cycles.
+    kPMFeedback, // Feedback gain, in cycles, divided by two.
+    kPMY1,       // Previous modulator output.
+    kPMY2,       // Modulator output before previous.
+    kPMFieldCount,
+};
+
+enum {
+    // Arrays are padded to a multiple of this many voices.
+    kPMGroup = 4,
+};
+
+static inline float *pm_field(const struct ufxr_pm *restrict pm, int field) {
+    return pm->state + field * pm->capacity;
+}
+
+// Compute sin(2 pi x), with the same approximation as ufxr_sin1_2.
+static inline float pm_sin(float x) {
+    x -= rintf(x);
+    return x * (8.0f - 16.0f * fabsf(x));
+}
+
+// Generate one voice, one sample at a time. Feedback uses the average of the
+// last two modulator outputs, which damps the oscillation that otherwise
+// appears at high feedback.
+static void pm_voice(struct ufxr_pm *restrict pm, int v, int n,
+                     float *restrict outs, const float *restrict xs) {
+    const float ratio = pm_field(pm, kPMRatio)[v],
+                index = pm_field(pm, kPMIndex)[v],
+                feedback = pm_field(pm, kPMFeedback)[v];
+    float cp = pm_field(pm, kPMCarrier)[v], mp = pm_field(pm, kPMMod)[v],
+          y1 = pm_field(pm, kPMY1)[v], y2 = pm_field(pm, kPMY2)[v];
+    for (int i = 0; i < n; i++) {
+        const float f = xs[i];
+        cp += f;
+        cp -= rintf(cp);
+        mp += f * ratio;
+        mp -= rintf(mp);
+        float m = pm_sin(mp + feedback * (y1 + y2));
+        y2 = y1;
+        y1 = m;
+        outs[i] = pm_sin(cp + index * m);
+    }
+    pm_field(pm, kPMCarrier)[v] = cp;
+    pm_field(pm, kPMMod)[v] = mp;
+    pm_field(pm, kPMY1)[v] = y1;
+    pm_field(pm, kPMY2)[v] = y2;
+}
+
+// SSE2 version.
+#if !HAVE_FUNC && USE_SSE2
+#define HAVE_FUNC 1
+#include <emmintrin.h>
+
+// Return x - round(x).
+static inline __m128 pm_wrap(__m128 x) {
+    return _mm_sub_ps(x, _mm_cvtepi32_ps(_mm_cvtps_epi32(x)));
+}
+
+// Compute sin(2 pi x), with the same approximation as ufxr_sin1_2.
+static inline __m128 pm_sin4(__m128 x) {
+    const __m128 abs = _mm_castsi128_ps(_mm_srli_epi32(_mm_set1_epi32(-1), 1));
+    x = pm_wrap(x);
+    return _mm_mul_ps(x, _mm_sub_ps(_mm_set1_ps(8.0f),
+                                    _mm_mul_ps(_mm_set1_ps(16.0f),
+                                               _mm_and_ps(x, abs))));
+}
+
+// Return the running sum of the elements of x.
+static inline __m128 pm_prefix(__m128 x) {
+    x = _mm_add_ps(x, _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(x), 4)));
+    x = _mm_add_ps(x, _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(x), 8)));
+    return x;
+}
+
+// Generate one voice without feedback, four samples at a time. The phase of
+// each sample is computed with a running sum within the vector.
+static void pm_time(struct ufxr_pm *restrict pm, int v, int n,
+                    float *restrict outs, const float *restrict xs) {
+    const __m128 ratio = _mm_set1_ps(pm_field(pm, kPMRatio)[v]),
+                 index = _mm_set1_ps(pm_field(pm, kPMIndex)[v]);
+    __m128 cp = _mm_set1_ps(pm_field(pm, kPMCarrier)[v]),
+           mp = _mm_set1_ps(pm_field(pm, kPMMod)[v]);
+    for (int i = 0; i < n; i += 4) {
+        __m128 f = _mm_load_ps(xs + i);
+        __m128 c = pm_wrap(_mm_add_ps(cp, pm_prefix(f)));
+        __m128 m = pm_wrap(_mm_add_ps(mp, pm_prefix(_mm_mul_ps(f, ratio))));
+        cp = _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 3, 3, 3));
+        mp = _mm_shuffle_ps(m, m, _MM_SHUFFLE(3, 3, 3, 3));
+        __m128 y = pm_sin4(_mm_add_ps(c, _mm_mul_ps(index, pm_sin4(m))));
+        _mm_store_ps(outs + i, y);
+    }
+    pm_field(pm, kPMCarrier)[v] = _mm_cvtss_f32(cp);
+    pm_field(pm, kPMMod)[v] = _mm_cvtss_f32(mp);
+}
+
+// Generate four voices with feedback, one sample at a time for each voice.
+// Each block of four samples from four voices is transposed so that each
+// vector holds one sample from every voice.
+static void pm_lanes(struct ufxr_pm *restrict pm, int v, int n,
+                     float *restrict outs, const float *restrict xs) {
+    const __m128 ratio = _mm_load_ps(pm_field(pm, kPMRatio) + v),
+                 index = _mm_load_ps(pm_field(pm, kPMIndex) + v),
+                 feedback = _mm_load_ps(pm_field(pm, kPMFeedback) + v);
+    __m128 cp = _mm_load_ps(pm_field(pm, kPMCarrier) + v),
+           mp = _mm_load_ps(pm_field(pm, kPMMod) + v),
+           y1 = _mm_load_ps(pm_field(pm, kPMY1) + v),
+           y2 = _mm_load_ps(pm_field(pm, kPMY2) + v);
+    const float *restrict x0 = xs + (size_t)v * n;
+    float *restrict o0 = outs + (size_t)v * n;
+    for (int i = 0; i < n; i += 4) {
+        __m128 f[4], y[4];
+        for (int k = 0; k < 4; k++) {
+            f[k] = _mm_load_ps(x0 + (size_t)k * n + i);
+        }
+        _MM_TRANSPOSE4_PS(f[0], f[1], f[2], f[3]);
+        for (int k = 0; k < 4; k++) {
+            cp = pm_wrap(_mm_add_ps(cp, f[k]));
+            mp = pm_wrap(_mm_add_ps(mp, _mm_mul_ps(f[k], ratio)));
+            __m128 fb = _mm_mul_ps(feedback, _mm_add_ps(y1, y2));
+            __m128 m = pm_sin4(_mm_add_ps(mp, fb));
+            y2 = y1;
+            y1 = m;
+            y[k] = pm_sin4(_mm_add_ps(cp, _mm_mul_ps(index, m)));
+        }
+        _MM_TRANSPOSE4_PS(y[0], y[1], y[2], y[3]);
+        for (int k = 0; k < 4; k++) {
+            _mm_store_ps(o0 + (size_t)k * n + i, y[k]);
+        }
+    }
+    _mm_store_ps(pm_field(pm, kPMCarrier) + v, cp);
+    _mm_store_ps(pm_field(pm, kPMMod) + v, mp);
+    _mm_store_ps(pm_field(pm, kPMY1) + v, y1);
+    _mm_store_ps(pm_field(pm, kPMY2) + v, y2);
+}
+
+static void pm_run(struct ufxr_pm *restrict pm, int n, float *restrict outs,
+                   const float *restrict xs) {
+    const int voices = pm->voices;
+    const float *restrict feedback = pm_field(pm, kPMFeedback);
+    for (int v = 0; v < voices; v += 4) {
+        int count = voices - v < 4 ? voices - v : 4;
+        bool any = false;
+        for (int k = 0; k < count; k++) {
+            any = any || feedback[v + k] != 0.0f;
+        }
+        if (any && count == 4) {
+            pm_lanes(pm, v, n, outs, xs);
+            continue;
+        }
+        for (int k = v; k < v + count; k++) {
+            const size_t off = (size_t)k * n;
+            if (feedback[k] != 0.0f) {
+                pm_voice(pm, k, n, outs + off, xs + off);
+            } else {
+                pm_time(pm, k, n, outs + off, xs + off);
+            }
+        }
+    }
+}
+#endif
+
+// Scalar version.
+#if !HAVE_FUNC
+static void pm_run(struct ufxr_pm *restrict pm, int n, float *restrict outs,
+                   const float *restrict xs) {
+    for (int v = 0; v < pm->voices; v++) {
+        const size_t off = (size_t)v * n;
+        pm_voice(pm, v, n, outs + off, xs + off);
+    }
+}
+#endif
+
+bool ufxr_pm_create(struct ufxr_pm *restrict pm, int voices,
+                    struct ufxr_error *err) {
+    if (voices < 1 || voices > UFXR_PM_MAXVOICES) {
+        ufxr_error_setcode(err, kUFXRErrorInvalidArgument);
+        return false;
+    }
+    const int capacity = (voices + kPMGroup - 1) & ~(kPMGroup - 1);
+    float *state = ufxr_alloc(sizeof(float) * kPMFieldCount * capacity);
+    if (state == NULL) {
+        ufxr_error_seterrno(err);
+        return false;
+    }
+    *pm = (struct ufxr_pm){
+        .voices = voices,
+        .capacity = capacity,
+        .state = state,
+    };
+    for (int i = 0; i < capacity; i++) {
+        pm_field(pm, kPMRatio)[i] = 1.0f;
+    }
+    return true;
+}
+
+void ufxr_pm_destroy(struct ufxr_pm *restrict pm) {
+    free(pm->state);
+    pm->state = NULL;
+}
+
+void ufxr_pm_reset(struct ufxr_pm *restrict pm) {
+    const size_t size = sizeof(float) * pm->capacity;
+    memset(pm_field(pm, kPMCarrier), 0, size);
+    memset(pm_field(pm, kPMMod), 0, size);
+    memset(pm_field(pm, kPMY1), 0, size);
+    memset(pm_field(pm, kPMY2), 0, size);
+}
+
+void ufxr_pm_set(struct ufxr_pm *restrict pm, int index,
+                 const struct ufxr_pmparams *restrict p) {
+    const float scale = (float)(1.0 / (8.0 * atan(1.0)));
+    pm_field(pm, kPMRatio)[index] = p->ratio;
+    pm_field(pm, kPMIndex)[index] = p->index * scale;
+    pm_field(pm, kPMFeedback)[index] = 0.5f * p->feedback * scale;
+}
+
+void ufxr_pm_process(struct ufxr_pm *restrict pm, int n, float *restrict outs,
+                     const float *restrict xs) {
+    pm_run(pm, n, outs, xs);
+}
@@ -0,0 +1,63 @@
+// c/dsp/pm.h - Phase modulation synthesis.
+#pragma once
+
+#include <stdbool.h>
+
+struct ufxr_error;
+
+// Maximum number of voices in a phase modulation oscillator.
+#define UFXR_PM_MAXVOICES 256
+
+// Parameters for one voice of a phase modulation oscillator.
+struct ufxr_pmparams {
+    // Modulator frequency, as a multiple of the carrier frequency.
+    float ratio;
+    // Modulation index, the peak phase deviation of the carrier in radians.
+    float index;
+    // Modulator self-feedback, in radians. Zero for no feedback. Values around
+    // 1 give a sawtooth-like modulator, and larger values become noisy.
+    float feedback;
+};
+
+// A bank of two-operator phase modulation voices. Each voice has a carrier and
+// a modulator, the modulator may modulate itself, and both operators use the
+// same parabolic sine approximation as ufxr_sin1_2.
+//
+// Each voice is computed in a single pass: the oscillator phases, modulator,
+// and carrier are computed together without intermediate buffers. Voices
+// without feedback are vectorized across time. With feedback, each sample of
+// the modulator depends on the previous one, so voices are vectorized across
+// voices instead, four at a time.
+//
+// All fields are private. Do not access them.
+struct ufxr_pm {
+    int voices;
+    int capacity;
+    float *state;
+};
+
+// Create a phase modulation oscillator with the given number of voices, from 1
+// to UFXR_PM_MAXVOICES. Every voice starts with ratio 1 and no modulation. If
+// successful, destroy() must be called to release resources. This is the only
+// function which allocates memory.
+bool ufxr_pm_create(struct ufxr_pm *restrict pm, int voices,
+                    struct ufxr_error *err);
+
+// Destroy a phase modulation oscillator and release any resources.
+void ufxr_pm_destroy(struct ufxr_pm *restrict pm);
+
+// Reset the phase and feedback state of every voice.
+void ufxr_pm_reset(struct ufxr_pm *restrict pm);
+
+// Set the parameters for one voice. The index must be less than the number of
+// voices.
+void ufxr_pm_set(struct ufxr_pm *restrict pm, int index,
+                 const struct ufxr_pmparams *restrict p);
+
+// Generate audio. The input contains the carrier frequency of each voice, in
+// cycles per sample, as one array of n samples per voice, stored
+// consecutively. The output has the same layout. The size must be a multiple
+// of UFXR_QUANTUM, and arrays must be aligned to UFXR_ALIGN. The state is
+// preserved between calls.
+void ufxr_pm_process(struct ufxr_pm *restrict pm, int n, float *restrict outs,
+                     const float *restrict xs);
@@ -0,0 +1,265 @@
+// resample.c - Sample rate conversion.
+#include "c/dsp/resample.h"
+
+#include "c/dsp/impl.h"
+#include "c/io/error.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+enum {
+    // Maximum number of entries in the filter table. Ratios with a larger
+    // numerator interpolate between entries.
+    kResampleMaxPhases = 512,
+    // Number of input samples buffered at once, in addition to the filter
+    // length.
+    kResampleChunk = 1024,
+    // Maximum ratio between sample rates.
+    kResampleMaxRatio = 32,
+};
+
+// Kaiser window shape parameter, and the resulting stopband attenuation in dB.
+static const double kResampleBeta = 8.0;
+static const double kResampleAtten = 80.0;
+
+// Width of the transition band, relative to the lower of the two Nyquist
+// frequencies. The transition band is centered on the Nyquist frequency, so
+// the passband extends to 90% of it.
+static const double kResampleTransition = 0.2;
+
+// AVX version.
+#if !HAVE_FUNC && USE_AVX
+#define HAVE_FUNC 1
+#include <immintrin.h>
+
+// Return the dot product of n coefficients and n samples. The coefficients
+// must be aligned, and n must be a multiple of 8.
+static float resample_dot(int n, const float *restrict coeffs,
+                          const float *restrict xs) {
+    __m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps();
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        acc0 = _mm256_add_ps(acc0, _mm256_mul_ps(_mm256_load_ps(coeffs + i),
+                                                 _mm256_loadu_ps(xs + i)));
+        acc1 = _mm256_add_ps(acc1,
+                             _mm256_mul_ps(_mm256_load_ps(coeffs + i + 8),
+                                           _mm256_loadu_ps(xs + i + 8)));
+    }
+    if (i < n) {
+        acc0 = _mm256_add_ps(acc0, _mm256_mul_ps(_mm256_load_ps(coeffs + i),
+                                                 _mm256_loadu_ps(xs + i)));
+    }
+    acc0 = _mm256_add_ps(acc0, acc1);
+    __m128 acc = _mm_add_ps(_mm256_castps256_ps128(acc0),
+                            _mm256_extractf128_ps(acc0, 1));
+    acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+    acc = _mm_add_ss(acc, _mm_shuffle_ps(acc, acc, _MM_SHUFFLE(1, 1, 1, 1)));
+    return _mm_cvtss_f32(acc);
+}
+
+// Interpolate between two rows of coefficients: outs = a + w * (b - a). The
+// arrays must be aligned, and n must be a multiple of 8.
+static void resample_lerp(int n, float *restrict outs, const float *restrict a,
+                          const float *restrict b, float w) {
+    const __m256 vw = _mm256_set1_ps(w);
+    for (int i = 0; i < n; i += 8) {
+        __m256 va = _mm256_load_ps(a + i), vb = _mm256_load_ps(b + i);
+        __m256 d = _mm256_sub_ps(vb, va);
+        _mm256_store_ps(outs + i, _mm256_add_ps(va, _mm256_mul_ps(vw, d)));
+    }
+}
+#endif
+
+// SSE2 version.
+#if !HAVE_FUNC && USE_SSE2
+#define HAVE_FUNC 1
+#include <xmmintrin.h>
+
+static float resample_dot(int n, const float *restrict coeffs,
+                          const float *restrict xs) {
+    __m128 acc0 = _mm_setzero_ps(), acc1 = _mm_setzero_ps();
+    for (int i = 0; i < n; i += 8) {
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_load_ps(coeffs + i),
+                                           _mm_loadu_ps(xs + i)));
+        acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_load_ps(coeffs + i + 4),
+                                           _mm_loadu_ps(xs + i + 4)));
+    }
+    __m128 acc = _mm_add_ps(acc0, acc1);
+    acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+    acc = _mm_add_ss(acc, _mm_shuffle_ps(acc, acc, _MM_SHUFFLE(1, 1, 1, 1)));
+    return _mm_cvtss_f32(acc);
+}
+
+static void resample_lerp(int n, float *restrict outs, const float *restrict a,
+                          const float *restrict b, float w) {
+    const __m128 vw = _mm_set1_ps(w);
+    for (int i = 0; i < n; i += 4) {
+        __m128 va = _mm_load_ps(a + i), vb = _mm_load_ps(b + i);
+        _mm_store_ps(outs + i,
+                     _mm_add_ps(va, _mm_mul_ps(vw, _mm_sub_ps(vb, va))));
+    }
+}
+#endif
+
+// Scalar version.
+#if !HAVE_FUNC
+static float resample_dot(int n, const float *restrict coeffs,
+                          const float *restrict xs) {
+    float acc = 0.0f;
+    for (int i = 0; i < n; i++) {
+        acc += coeffs[i] * xs[i];
+    }
+    return acc;
+}
+
+static void resample_lerp(int n, float *restrict outs, const float *restrict a,
+                          const float *restrict b, float w) {
+    for (int i = 0; i < n; i++) {
+        outs[i] = a[i] + w * (b[i] - a[i]);
+    }
+}
+#endif
+
+static int gcd(int a, int b) {
+    while (b != 0) {
+        int t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+bool ufxr_resampler_create(struct ufxr_resampler *restrict r, int inrate,
+                           int outrate, struct ufxr_error *err) {
+    if (inrate < 1 || outrate < 1 || inrate / kResampleMaxRatio > outrate ||
+        outrate / kResampleMaxRatio > inrate) {
+        ufxr_error_setcode(err, kUFXRErrorInvalidArgument);
+        return false;
+    }
+    const int g = gcd(inrate, outrate);
+    const int num = outrate / g, den = inrate / g;
+    const int phases = num <= kResampleMaxPhases ? num : kResampleMaxPhases;
+
+    // Cutoff frequency and transition width, in cycles per input sample.
+    const double scale = outrate < inrate ? (double)outrate / inrate : 1.0;
+    const double cutoff = 0.5 * scale;
+    const double width = kResampleTransition * cutoff;
+    const double pi = 4.0 * atan(1.0);
+    // Kaiser's formula for filter length, rounded up to a multiple of 8.
+    int taps =
+        (int)ceil((kResampleAtten - 8.0) / (2.285 * 2.0 * pi * width)) + 1;
+    taps = (taps + 7) & ~7;
+
+    *r = (struct ufxr_resampler){
+        .inrate = inrate,
+        .outrate = outrate,
+        .num = num,
+        .den = den,
+        .taps = taps,
+        .phases = phases,
+        .capacity = taps + kResampleChunk,
+    };
+    r->table = ufxr_alloc(sizeof(float) * (size_t)taps * (phases + 1));
+    r->buffer = ufxr_alloc(sizeof(float) * r->capacity);
+    r->temp = ufxr_alloc(sizeof(float) * taps);
+    if (r->table == NULL || r->buffer == NULL || r->temp == NULL) {
+        ufxr_error_seterrno(err);
+        ufxr_resampler_destroy(r);
+        return false;
+    }
+
+    // Row p of the table is for output samples at a fraction p/phases after an
+    // input sample. Coefficient k of each row is applied to the input sample at
+    // an offset of k + 1 - taps/2.
+    const int half = taps / 2;
+    for (int p = 0; p <= phases; p++) {
+        float *restrict row = r->table + (size_t)p * taps;
+        for (int k = 0; k < taps; k++) {
+            double t = (double)p / phases + (half - 1 - k);
+            double x = 2.0 * pi * cutoff * t;
+            double sinc = x == 0.0 ? 1.0 : sin(x) / x;
+            row[k] = (float)(2.0 * cutoff * sinc *
+                             ufxr_kaiser(t / half, kResampleBeta));
+        }
+    }
+    ufxr_resampler_reset(r);
+    return true;
+}
+
+void ufxr_resampler_destroy(struct ufxr_resampler *restrict r) {
+    free(r->table);
+    free(r->buffer);
+    free(r->temp);
+    r->table = NULL;
+    r->buffer = NULL;
+    r->temp = NULL;
+}
+
+void ufxr_resampler_reset(struct ufxr_resampler *restrict r) {
+    // The buffer starts with enough silence before the first input sample to
+    // compute the first output sample.
+    const int start = r->taps / 2 - 1;
+    memset(r->buffer, 0, sizeof(float) * start);
+    r->pos = start;
+    r->frac = 0;
+    r->fill = start;
+}
+
+int ufxr_resampler_maxout(const struct ufxr_resampler *restrict r, int n) {
+    return (int)((long long)n * r->num / r->den) + 1;
+}
+
+int ufxr_resampler_latency(const struct ufxr_resampler *restrict r) {
+    return r->taps / 2;
+}
+
+int ufxr_resampler_process(struct ufxr_resampler *restrict r, int n,
+                           float *restrict outs, const float *restrict xs) {
+    const int taps = r->taps, half = taps / 2, num = r->num;
+    const int phases = r->phases, capacity = r->capacity;
+    const int step = r->den / num, stepfrac = r->den % num;
+    const bool exact = phases == num;
+    float *restrict buf = r->buffer;
+    const float *restrict table = r->table;
+    int pos = r->pos, frac = r->frac, fill = r->fill, count = 0;
+    for (int i = 0; i < n;) {
+        int amt = capacity - fill < n - i ? capacity - fill : n - i;
+        memcpy(buf + fill, xs + i, sizeof(float) * amt);
+        fill += amt;
+        i += amt;
+        while (pos + half < fill) {
+            const float *restrict coeffs;
+            if (exact) {
+                coeffs = table + (size_t)frac * taps;
+            } else {
+                long long t = (long long)frac * phases;
+                int p = t / num;
+                float w = (float)(t % num) / (float)num;
+                const float *row = table + (size_t)p * taps;
+                resample_lerp(taps, r->temp, row, row + taps, w);
+                coeffs = r->temp;
+            }
+            outs[count++] = resample_dot(taps, coeffs, buf + pos + 1 - half);
+            pos += step;
+            frac += stepfrac;
+            if (frac >= num) {
+                frac -= num;
+                pos++;
+            }
+        }
+        // Discard input which is no longer needed. When downsampling, the
+        // next output may be past the end of the buffered input.
+        int discard = pos + 1 - half;
+        if (discard > fill) {
+            discard = fill;
+        }
+        memmove(buf, buf + discard, sizeof(float) * (fill - discard));
+        fill -= discard;
+        pos -= discard;
+    }
+    r->pos = pos;
+    r->frac = frac;
+    r->fill = fill;
+    return count;
+}
@@ -0,0 +1,73 @@
+// c/dsp/resample.h - Sample rate conversion.
+#pragma once
+
+#include <stdbool.h>
+
+struct ufxr_error;
+
+// A streaming sample rate converter, for converting rendered audio to the
+// sample rate of the output file.
+//
+// Output samples are computed with a Kaiser-windowed sinc filter. The filter is
+// precomputed as a table of polyphase branches, one for each fractional
+// position between input samples. If the ratio between the sample rates
+// reduces to a fraction with a small enough numerator, like 147/160 for 48 kHz
+// to 44.1 kHz, every output sample falls on an entry in the table. Otherwise,
+// coefficients are interpolated between adjacent entries.
+//
+// When downsampling, the filter cutoff is lowered to the output Nyquist
+// frequency.
+//
+// Memory use is fixed at creation and does not depend on the length of the
+// stream. Audio may be processed in blocks of any size. To use with a wave
+// writer, pass each block of rendered audio to ufxr_resampler_process(), then
+// pass the result to ufxr_wavewriter_write().
+//
+// All fields are private. Do not access them.
+struct ufxr_resampler {
+    int inrate;
+    int outrate;
+    // Ratio of sample rates, reduced. Output samples are spaced den/num input
+    // samples apart.
+    int num;
+    int den;
+    // Filter length, in input samples, and number of table entries.
+    int taps;
+    int phases;
+    // Current position, as an index into the buffer plus a fraction with
+    // denominator num.
+    int pos;
+    int frac;
+    int fill;
+    int capacity;
+    float *table;
+    float *buffer;
+    float *temp;
+};
+
+// Create a sample rate converter. Sample rates must be positive and differ by
+// at most a factor of 32. If successful, destroy() must be called to release
+// resources. This is the only function which allocates memory.
+bool ufxr_resampler_create(struct ufxr_resampler *restrict r, int inrate,
+                           int outrate, struct ufxr_error *err);
+
+// Destroy a sample rate converter and release any resources.
+void ufxr_resampler_destroy(struct ufxr_resampler *restrict r);
+
+// Clear the converter state, and start a new stream.
+void ufxr_resampler_reset(struct ufxr_resampler *restrict r);
+
+// Return the maximum number of samples produced by processing n input samples.
+int ufxr_resampler_maxout(const struct ufxr_resampler *restrict r, int n);
+
+// Return the number of input samples which must be processed after the end of
+// the stream before the last output sample is produced. Process this many
+// zeroes to flush the converter.
+int ufxr_resampler_latency(const struct ufxr_resampler *restrict r);
+
+// Process n input samples, and return the number of output samples written.
+// The output must have space for ufxr_resampler_maxout(n) samples. Output
+// sample k is the input signal evaluated at time k * inrate / outrate, counting
+// from the start of the stream. Does not allocate memory.
+int ufxr_resampler_process(struct ufxr_resampler *restrict r, int n,
+                           float *restrict outs, const float *restrict xs);
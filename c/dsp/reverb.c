@@ -0,0 +1,386 @@
+// reverb.c - Feedback delay network reverb.
+#include "c/dsp/reverb.h"
+
+#include "c/dsp/impl.h"
+#include "c/io/error.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+// Per-line state. The state is stored as structure of arrays, and each array
+// has one element per delay line, so we can process four lines at a time.
+enum {
+    kReverbDelay, // Delay line length, in samples.
+    kReverbDepth, // Modulation depth, in samples.
+    kReverbGain,  // Feedback gain, including matrix normalization.
+    kReverbDamp,  // Damping filter coefficient.
+    kReverbLow,   // Damping filter state.
+    kReverbCos,   // LFO state, cosine.
+    kReverbSin,   // LFO state, sine.
+    kReverbIn,    // Input gain.
+    kReverbOut,   // Output gain.
+    kReverbFieldCount,
+};
+
+enum {
+    // Number of samples to process between LFO renormalizations.
+    kReverbChunk = 256,
+    // Maximum delay line size. Read positions are calculated in
+    // single-precision, so this must stay well below 2^24.
+    kReverbMaxSize = 1 << 20,
+};
+
+static inline float *reverb_field(const struct ufxr_reverb *restrict r,
+                                  int field) {
+    return r->state + field * r->lines;
+}
+
+static bool is_prime(unsigned n) {
+    if (n < 2) {
+        return false;
+    }
+    for (unsigned d = 2; d * d <= n; d++) {
+        if (n % d == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Return the smallest prime which is at least n.
+static unsigned next_prime(unsigned n) {
+    while (!is_prime(n)) {
+        n++;
+    }
+    return n;
+}
+
+bool ufxr_reverb_create(struct ufxr_reverb *restrict r,
+                        const struct ufxr_reverbparams *restrict p,
+                        struct ufxr_error *err) {
+    if (p->samplerate <= 0 || (p->lines != 8 && p->lines != 16) ||
+        !(p->delay > 0.0f) || !(p->decay > 0.0f) || !(p->damping > 0.0f) ||
+        !(p->moddepth >= 0.0f) || !(p->modrate >= 0.0f)) {
+        ufxr_error_setcode(err, kUFXRErrorInvalidArgument);
+        return false;
+    }
+    const int nlines = p->lines;
+    const double rate = p->samplerate;
+    const double pi = 4.0 * atan(1.0);
+
+    // Line lengths are spaced exponentially over an octave and rounded up to
+    // distinct primes, so the lines have no common factors.
+    unsigned lengths[UFXR_REVERB_MAXLINES];
+    unsigned prev = 0;
+    for (int i = 0; i < nlines; i++) {
+        double t = (double)i / (double)(nlines - 1) - 0.5;
+        double len = rint((double)p->delay * rate * exp2(t));
+        if (len > kReverbMaxSize / 2) {
+            ufxr_error_setcode(err, kUFXRErrorInvalidArgument);
+            return false;
+        }
+        unsigned ilen = len < 3.0 ? 3 : (unsigned)len;
+        if (ilen <= prev) {
+            ilen = prev + 1;
+        }
+        prev = next_prime(ilen);
+        lengths[i] = prev;
+    }
+    // The modulated delay must always be at least two samples, so the
+    // interpolated read never touches the sample being written.
+    double depth = (double)p->moddepth * rate;
+    if (depth > lengths[0] - 2.0) {
+        depth = lengths[0] - 2.0;
+    }
+    unsigned size = ufxr_pow2(lengths[nlines - 1] + (unsigned)ceil(depth) + 2);
+
+    float *buffer = ufxr_alloc(sizeof(float) * size * nlines);
+    if (buffer == NULL) {
+        ufxr_error_seterrno(err);
+        return false;
+    }
+    float *state = ufxr_alloc(sizeof(float) * kReverbFieldCount * nlines);
+    if (state == NULL) {
+        ufxr_error_seterrno(err);
+        free(buffer);
+        return false;
+    }
+    *r = (struct ufxr_reverb){
+        .lines = nlines,
+        .mask = size - 1,
+        .pos = 0,
+        .count = 0,
+        .buffer = buffer,
+        .state = state,
+        .rot_cos = cos(2.0 * pi * (double)p->modrate / rate),
+        .rot_sin = sin(2.0 * pi * (double)p->modrate / rate),
+    };
+    const double norm = 1.0 / sqrt(nlines);
+    const double damp = 1.0 - exp(-2.0 * pi * (double)p->damping / rate);
+    for (int i = 0; i < nlines; i++) {
+        // Gain which gives a 60 dB decay after the given decay time.
+        double gain = pow(10.0, -3.0 * lengths[i] / ((double)p->decay * rate));
+        double phase = 2.0 * pi * i / nlines;
+        reverb_field(r, kReverbDelay)[i] = lengths[i];
+        reverb_field(r, kReverbDepth)[i] = depth;
+        reverb_field(r, kReverbGain)[i] = gain * norm;
+        reverb_field(r, kReverbDamp)[i] = damp;
+        reverb_field(r, kReverbCos)[i] = cos(phase);
+        reverb_field(r, kReverbSin)[i] = sin(phase);
+        reverb_field(r, kReverbIn)[i] = (i & 1) != 0 ? -norm : norm;
+        reverb_field(r, kReverbOut)[i] = (i & 2) != 0 ? -norm : norm;
+    }
+    return true;
+}
+
+void ufxr_reverb_destroy(struct ufxr_reverb *restrict r) {
+    free(r->buffer);
+    free(r->state);
+    r->buffer = NULL;
+    r->state = NULL;
+}
+
+void ufxr_reverb_reset(struct ufxr_reverb *restrict r) {
+    size_t size = (size_t)(r->mask + 1) * r->lines;
+    float *restrict buffer = r->buffer;
+    for (size_t i = 0; i < size; i++) {
+        buffer[i] = 0.0f;
+    }
+    float *restrict low = reverb_field(r, kReverbLow);
+    for (int i = 0; i < r->lines; i++) {
+        low[i] = 0.0f;
+    }
+    r->pos = 0;
+}
+
+// SSE2 version.
+#if !HAVE_FUNC && USE_SSE2
+#define HAVE_FUNC 1
+#include <emmintrin.h>
+
+// Apply the unnormalized Hadamard transform to a vector of 4*nv elements, in
+// place. The first two stages are within each SSE vector, the remaining stages
+// are between vectors.
+static inline void reverb_hadamard(int nv, __m128 *restrict v) {
+    const __m128 neg1 = _mm_set_ps(-0.0f, 0.0f, -0.0f, 0.0f);
+    const __m128 neg2 = _mm_set_ps(-0.0f, -0.0f, 0.0f, 0.0f);
+    for (int i = 0; i < nv; i++) {
+        __m128 a = v[i];
+        a = _mm_add_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1)),
+                       _mm_xor_ps(a, neg1));
+        a = _mm_add_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(1, 0, 3, 2)),
+                       _mm_xor_ps(a, neg2));
+        v[i] = a;
+    }
+    for (int h = 1; h < nv; h *= 2) {
+        for (int i = 0; i < nv; i += 2 * h) {
+            for (int j = i; j < i + h; j++) {
+                __m128 x = v[j], y = v[j + h];
+                v[j] = _mm_add_ps(x, y);
+                v[j + h] = _mm_sub_ps(x, y);
+            }
+        }
+    }
+}
+
+static inline float reverb_hsum(__m128 x) {
+    x = _mm_add_ps(x, _mm_movehl_ps(x, x));
+    x = _mm_add_ss(x, _mm_shuffle_ps(x, x, _MM_SHUFFLE(1, 1, 1, 1)));
+    return _mm_cvtss_f32(x);
+}
+
+static void reverb_run(struct ufxr_reverb *restrict r, int n,
+                       float *restrict outs, const float *restrict xs) {
+    enum {
+        kMaxVec = UFXR_REVERB_MAXLINES / 4,
+    };
+    const int nlines = r->lines, nv = nlines / 4;
+    const unsigned mask = r->mask;
+    const size_t size = (size_t)mask + 1;
+    float *restrict buffer = r->buffer;
+    unsigned pos = r->pos;
+    __m128 delay[kMaxVec], depth[kMaxVec], gain[kMaxVec], damp[kMaxVec],
+        low[kMaxVec], lcos[kMaxVec], lsin[kMaxVec], ing[kMaxVec],
+        outg[kMaxVec];
+    for (int v = 0; v < nv; v++) {
+        delay[v] = _mm_load_ps(reverb_field(r, kReverbDelay) + 4 * v);
+        depth[v] = _mm_load_ps(reverb_field(r, kReverbDepth) + 4 * v);
+        gain[v] = _mm_load_ps(reverb_field(r, kReverbGain) + 4 * v);
+        damp[v] = _mm_load_ps(reverb_field(r, kReverbDamp) + 4 * v);
+        low[v] = _mm_load_ps(reverb_field(r, kReverbLow) + 4 * v);
+        lcos[v] = _mm_load_ps(reverb_field(r, kReverbCos) + 4 * v);
+        lsin[v] = _mm_load_ps(reverb_field(r, kReverbSin) + 4 * v);
+        ing[v] = _mm_load_ps(reverb_field(r, kReverbIn) + 4 * v);
+        outg[v] = _mm_load_ps(reverb_field(r, kReverbOut) + 4 * v);
+    }
+    const __m128 rcos = _mm_set1_ps(r->rot_cos);
+    const __m128 rsin = _mm_set1_ps(r->rot_sin);
+    const __m128 fsize = _mm_set1_ps((float)size);
+    _Alignas(16) int ipos[UFXR_REVERB_MAXLINES];
+    _Alignas(16) float y0[UFXR_REVERB_MAXLINES];
+    _Alignas(16) float y1[UFXR_REVERB_MAXLINES];
+    unsigned count = r->count;
+    for (int i = 0; i < n;) {
+        int end = n - i < (int)(kReverbChunk - count)
+                      ? n
+                      : i + (int)(kReverbChunk - count);
+        count += end - i;
+        for (; i < end; i++) {
+            __m128 frac[kMaxVec], fb[kMaxVec];
+            // Advance the LFOs and find the read position in each line,
+            // relative to the write position.
+            for (int v = 0; v < nv; v++) {
+                __m128 c = lcos[v], s = lsin[v];
+                lcos[v] = _mm_sub_ps(_mm_mul_ps(c, rcos), _mm_mul_ps(s, rsin));
+                lsin[v] = _mm_add_ps(_mm_mul_ps(s, rcos), _mm_mul_ps(c, rsin));
+                __m128 t = _mm_sub_ps(
+                    fsize,
+                    _mm_add_ps(delay[v], _mm_mul_ps(depth[v], lsin[v])));
+                __m128i it = _mm_cvttps_epi32(t);
+                frac[v] = _mm_sub_ps(t, _mm_cvtepi32_ps(it));
+                _mm_store_si128((void *)(ipos + 4 * v), it);
+            }
+            for (int j = 0; j < nlines; j++) {
+                const float *restrict line = buffer + size * j;
+                unsigned k = pos + ipos[j];
+                y0[j] = line[k & mask];
+                y1[j] = line[(k + 1) & mask];
+            }
+            __m128 acc = _mm_setzero_ps();
+            for (int v = 0; v < nv; v++) {
+                __m128 a0 = _mm_load_ps(y0 + 4 * v);
+                __m128 a1 = _mm_load_ps(y1 + 4 * v);
+                __m128 y =
+                    _mm_add_ps(a0, _mm_mul_ps(frac[v], _mm_sub_ps(a1, a0)));
+                low[v] = _mm_add_ps(low[v],
+                                    _mm_mul_ps(damp[v], _mm_sub_ps(y, low[v])));
+                acc = _mm_add_ps(acc, _mm_mul_ps(low[v], outg[v]));
+                fb[v] = _mm_mul_ps(low[v], gain[v]);
+            }
+            reverb_hadamard(nv, fb);
+            const __m128 x = _mm_set1_ps(xs[i]);
+            for (int v = 0; v < nv; v++) {
+                _mm_store_ps(y0 + 4 * v,
+                             _mm_add_ps(fb[v], _mm_mul_ps(x, ing[v])));
+            }
+            for (int j = 0; j < nlines; j++) {
+                buffer[size * j + pos] = y0[j];
+            }
+            pos = (pos + 1) & mask;
+            outs[i] = reverb_hsum(acc);
+        }
+        if (count < kReverbChunk) {
+            break;
+        }
+        // Keep the LFOs from drifting away from unit amplitude.
+        count = 0;
+        const __m128 c0 = _mm_set1_ps(1.5f), c1 = _mm_set1_ps(0.5f);
+        for (int v = 0; v < nv; v++) {
+            __m128 c = lcos[v], s = lsin[v];
+            __m128 k = _mm_sub_ps(
+                c0, _mm_mul_ps(c1, _mm_add_ps(_mm_mul_ps(c, c),
+                                              _mm_mul_ps(s, s))));
+            lcos[v] = _mm_mul_ps(c, k);
+            lsin[v] = _mm_mul_ps(s, k);
+        }
+    }
+    for (int v = 0; v < nv; v++) {
+        _mm_store_ps(reverb_field(r, kReverbLow) + 4 * v, low[v]);
+        _mm_store_ps(reverb_field(r, kReverbCos) + 4 * v, lcos[v]);
+        _mm_store_ps(reverb_field(r, kReverbSin) + 4 * v, lsin[v]);
+    }
+    r->pos = pos;
+    r->count = count;
+}
+#endif
+
+// Scalar version.
+#if !HAVE_FUNC
+
+// Apply the unnormalized Hadamard transform to a vector, in place.
+static inline void reverb_hadamard(int n, float *restrict v) {
+    for (int h = 1; h < n; h *= 2) {
+        for (int i = 0; i < n; i += 2 * h) {
+            for (int j = i; j < i + h; j++) {
+                float x = v[j], y = v[j + h];
+                v[j] = x + y;
+                v[j + h] = x - y;
+            }
+        }
+    }
+}
+
+static void reverb_run(struct ufxr_reverb *restrict r, int n,
+                       float *restrict outs, const float *restrict xs) {
+    const int nlines = r->lines;
+    const unsigned mask = r->mask;
+    const size_t size = (size_t)mask + 1;
+    float *restrict buffer = r->buffer;
+    unsigned pos = r->pos;
+    const float *restrict delay = reverb_field(r, kReverbDelay);
+    const float *restrict depth = reverb_field(r, kReverbDepth);
+    const float *restrict gain = reverb_field(r, kReverbGain);
+    const float *restrict damp = reverb_field(r, kReverbDamp);
+    float *restrict low = reverb_field(r, kReverbLow);
+    float *restrict lcos = reverb_field(r, kReverbCos);
+    float *restrict lsin = reverb_field(r, kReverbSin);
+    const float *restrict ing = reverb_field(r, kReverbIn);
+    const float *restrict outg = reverb_field(r, kReverbOut);
+    const float rcos = r->rot_cos, rsin = r->rot_sin;
+    float fb[UFXR_REVERB_MAXLINES];
+    unsigned count = r->count;
+    for (int i = 0; i < n;) {
+        int end = n - i < (int)(kReverbChunk - count)
+                      ? n
+                      : i + (int)(kReverbChunk - count);
+        count += end - i;
+        for (; i < end; i++) {
+            float acc = 0.0f;
+            for (int j = 0; j < nlines; j++) {
+                float c = lcos[j], s = lsin[j];
+                lcos[j] = c * rcos - s * rsin;
+                lsin[j] = s * rcos + c * rsin;
+                float t = (float)size - (delay[j] + depth[j] * lsin[j]);
+                unsigned it = (unsigned)t;
+                float frac = t - (float)it;
+                const float *restrict line = buffer + size * j;
+                unsigned k = pos + it;
+                float a0 = line[k & mask], a1 = line[(k + 1) & mask];
+                float y = a0 + frac * (a1 - a0);
+                low[j] += damp[j] * (y - low[j]);
+                acc += low[j] * outg[j];
+                fb[j] = low[j] * gain[j];
+            }
+            reverb_hadamard(nlines, fb);
+            const float x = xs[i];
+            for (int j = 0; j < nlines; j++) {
+                buffer[size * j + pos] = fb[j] + x * ing[j];
+            }
+            pos = (pos + 1) & mask;
+            outs[i] = acc;
+        }
+        if (count < kReverbChunk) {
+            break;
+        }
+        // Keep the LFOs from drifting away from unit amplitude.
+        count = 0;
+        for (int j = 0; j < nlines; j++) {
+            float c = lcos[j], s = lsin[j];
+            float k = 1.5f - 0.5f * (c * c + s * s);
+            lcos[j] = c * k;
+            lsin[j] = s * k;
+        }
+    }
+    r->pos = pos;
+    r->count = count;
+}
+#endif
+
+void ufxr_reverb_process(struct ufxr_reverb *restrict r, int n,
+                         float *restrict outs, const float *restrict xs) {
+    // The tail decays into subnormals, which are very slow.
+    struct ufxr_fpstate fp;
+    ufxr_fpstate_ftz(&fp);
+    reverb_run(r, n, outs, xs);
+    ufxr_fpstate_restore(&fp);
+}
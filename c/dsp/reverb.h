@@ -0,0 +1,67 @@
+// c/dsp/reverb.h - Feedback delay network reverb.
+#pragma once
+
+#include <stdbool.h>
+
+struct ufxr_error;
+
+// Maximum number of delay lines in a reverb.
+#define UFXR_REVERB_MAXLINES 16
+
+// Parameters for a reverb.
+struct ufxr_reverbparams {
+    // Sample rate in Hz.
+    int samplerate;
+    // Number of delay lines. Must be 8 or 16.
+    int lines;
+    // Average delay line length, in seconds. Line lengths are spread over an
+    // octave centered on this value. Larger values sound like larger rooms.
+    float delay;
+    // Decay time (RT60) in seconds. This is the time it takes for the reverb
+    // tail to fall by 60 dB.
+    float decay;
+    // Cutoff frequency of the damping filter in each delay line, in Hz. High
+    // frequencies decay faster than low frequencies.
+    float damping;
+    // Delay line modulation depth, in seconds. May be zero.
+    float moddepth;
+    // Delay line modulation rate, in Hz.
+    float modrate;
+};
+
+// A feedback delay network reverb.
+//
+// The delay lines are mixed through a normalized Hadamard matrix and each line
+// has a one-pole lowpass damping filter. The read position of each line is
+// modulated by a sine LFO with a different phase per line, which breaks up
+// metallic resonances in the tail.
+//
+// All fields are private. Do not access them.
+struct ufxr_reverb {
+    int lines;
+    unsigned mask;
+    unsigned pos;
+    unsigned count;
+    float *buffer;
+    float *state;
+    float rot_cos;
+    float rot_sin;
+};
+
+// Create a reverb. If successful, destroy() must be called to release
+// resources. This is the only function which allocates memory.
+bool ufxr_reverb_create(struct ufxr_reverb *restrict r,
+                        const struct ufxr_reverbparams *restrict p,
+                        struct ufxr_error *err);
+
+// Destroy a reverb and release any resources.
+void ufxr_reverb_destroy(struct ufxr_reverb *restrict r);
+
+// Clear the reverb state, silencing the tail.
+void ufxr_reverb_reset(struct ufxr_reverb *restrict r);
+
+// Process a block of audio. The output is the wet signal only. The state is
+// preserved between calls, so a long signal can be processed in blocks of any
+// size. Does not allocate memory.
+void ufxr_reverb_process(struct ufxr_reverb *restrict r, int n,
+                         float *restrict outs, const float *restrict xs);
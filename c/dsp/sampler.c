@@ -0,0 +1,226 @@
+// sampler.c - Sample playback.
+#include "c/dsp/sampler.h"
+
+#include "c/dsp/impl.h"
+#include "c/io/error.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+enum {
+    // Number of output samples computed at a time.
+    kSamplerChunk = 64,
+};
+
+// Gather n raw samples from one channel of the span as 32-bit integers. Float
+// samples are gathered as their bit patterns.
+static void sampler_gather(const struct ufxr_wavespan *restrict span,
+                           int channel, int n, int32_t *restrict outs,
+                           const size_t *restrict index) {
+    const unsigned char *restrict data = span->data;
+    const size_t stride = span->channels;
+    switch (span->format) {
+    case kUFXRFormatU8:
+        for (int i = 0; i < n; i++) {
+            outs[i] = (int32_t)data[index[i] * stride + channel] - 128;
+        }
+        break;
+    case kUFXRFormatS16:
+        for (int i = 0; i < n; i++) {
+            const unsigned char *p = data + (index[i] * stride + channel) * 2;
+            outs[i] = (int16_t)(p[0] | p[1] << 8);
+        }
+        break;
+    case kUFXRFormatS24:
+        // Samples are placed in the high 24 bits.
+        for (int i = 0; i < n; i++) {
+            const unsigned char *p = data + (index[i] * stride + channel) * 3;
+            outs[i] = (int32_t)((uint32_t)p[0] << 8 | (uint32_t)p[1] << 16 |
+                                (uint32_t)p[2] << 24);
+        }
+        break;
+    case kUFXRFormatF32:
+        for (int i = 0; i < n; i++) {
+            const unsigned char *p = data + (index[i] * stride + channel) * 4;
+            outs[i] = (int32_t)((uint32_t)p[0] | (uint32_t)p[1] << 8 |
+                                (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24);
+        }
+        break;
+    default:
+        memset(outs, 0, sizeof(*outs) * n);
+        break;
+    }
+}
+
+// SSE2 version.
+#if !HAVE_FUNC && USE_SSE2
+#define HAVE_FUNC 1
+#include <emmintrin.h>
+
+// Convert gathered samples to float and interpolate between them. The count
+// must be a multiple of 4. If isfloat is set, the samples are float bit
+// patterns and the scale is ignored.
+static void sampler_lerp(int n, float *restrict outs, const int32_t *restrict a,
+                         const int32_t *restrict b, const float *restrict frac,
+                         float scale, bool isfloat) {
+    const __m128 vscale = _mm_set1_ps(scale);
+    for (int i = 0; i < n; i += 4) {
+        __m128i ia = _mm_loadu_si128((const __m128i *)(a + i)),
+                ib = _mm_loadu_si128((const __m128i *)(b + i));
+        __m128 fa, fb;
+        if (isfloat) {
+            fa = _mm_castsi128_ps(ia);
+            fb = _mm_castsi128_ps(ib);
+        } else {
+            fa = _mm_mul_ps(_mm_cvtepi32_ps(ia), vscale);
+            fb = _mm_mul_ps(_mm_cvtepi32_ps(ib), vscale);
+        }
+        __m128 f = _mm_loadu_ps(frac + i);
+        _mm_storeu_ps(outs + i,
+                      _mm_add_ps(fa, _mm_mul_ps(f, _mm_sub_ps(fb, fa))));
+    }
+}
+#endif
+
+// Scalar version.
+#if !HAVE_FUNC
+static void sampler_lerp(int n, float *restrict outs, const int32_t *restrict a,
+                         const int32_t *restrict b, const float *restrict frac,
+                         float scale, bool isfloat) {
+    for (int i = 0; i < n; i++) {
+        float fa, fb;
+        if (isfloat) {
+            memcpy(&fa, a + i, sizeof(fa));
+            memcpy(&fb, b + i, sizeof(fb));
+        } else {
+            fa = (float)a[i] * scale;
+            fb = (float)b[i] * scale;
+        }
+        outs[i] = fa + frac[i] * (fb - fa);
+    }
+}
+#endif
+
+// Compute the positions of up to n output samples, and advance the playback
+// position. Returns the number of samples computed, which is less than n if
+// playback stops.
+static int sampler_advance(struct ufxr_sampler *restrict s, int n,
+                           size_t *restrict i0, size_t *restrict i1,
+                           float *restrict frac, const float *restrict rates) {
+    const size_t length = s->span.length;
+    const size_t loopstart = s->loopstart, loopend = s->loopend;
+    const bool loop = loopend > loopstart;
+    const double lo = (double)loopstart, hi = (double)loopend,
+                 looplen = hi - lo;
+    double pos = s->pos;
+    int i = 0;
+    for (; i < n && s->playing; i++) {
+        const double base = floor(pos);
+        const size_t index = (size_t)base;
+        size_t next = index + 1;
+        if (loop && next == loopend) {
+            next = loopstart;
+        } else if (next >= length) {
+            next = index;
+        }
+        i0[i] = index;
+        i1[i] = next;
+        frac[i] = (float)(pos - base);
+        const bool inloop = loop && pos >= lo && pos < hi;
+        pos += (double)rates[i];
+        if (inloop) {
+            if (pos >= hi) {
+                pos = lo + fmod(pos - lo, looplen);
+            } else if (pos < lo) {
+                pos = hi - fmod(lo - pos, looplen);
+                if (pos >= hi) {
+                    pos -= looplen;
+                }
+            }
+        }
+        if (!(pos >= 0.0 && pos < (double)length)) {
+            s->playing = false;
+        }
+    }
+    s->pos = pos;
+    return i;
+}
+
+bool ufxr_sampler_init(struct ufxr_sampler *restrict s,
+                       const struct ufxr_wavespan *restrict span,
+                       struct ufxr_error *err) {
+    if (span->data == NULL || span->length < 1 || span->channels < 1 ||
+        span->channels > 2 || span->format < kUFXRFormatU8 ||
+        span->format > kUFXRFormatF32) {
+        ufxr_error_setcode(err, kUFXRErrorInvalidArgument);
+        return false;
+    }
+    *s = (struct ufxr_sampler){
+        .span = *span,
+    };
+    return true;
+}
+
+bool ufxr_sampler_setloop(struct ufxr_sampler *restrict s, size_t start,
+                          size_t end) {
+    if (start > end || end > s->span.length) {
+        return false;
+    }
+    s->loopstart = start;
+    s->loopend = end;
+    return true;
+}
+
+void ufxr_sampler_start(struct ufxr_sampler *restrict s, double pos) {
+    s->pos = pos;
+    s->playing = pos >= 0.0 && pos < (double)s->span.length;
+}
+
+void ufxr_sampler_stop(struct ufxr_sampler *restrict s) {
+    s->playing = false;
+}
+
+bool ufxr_sampler_playing(const struct ufxr_sampler *restrict s) {
+    return s->playing;
+}
+
+void ufxr_sampler_process(struct ufxr_sampler *restrict s, int n,
+                          float *restrict left, float *restrict right,
+                          const float *restrict rates) {
+    static const float kScale[] = {
+        [kUFXRFormatU8] = 1.0f / 128.0f,
+        [kUFXRFormatS16] = 1.0f / 32768.0f,
+        [kUFXRFormatS24] = 1.0f / 2147483648.0f,
+        [kUFXRFormatF32] = 1.0f,
+    };
+    const float scale = kScale[s->span.format];
+    const bool isfloat = s->span.format == kUFXRFormatF32;
+    size_t i0[kSamplerChunk], i1[kSamplerChunk];
+    int32_t a[kSamplerChunk], b[kSamplerChunk];
+    float frac[kSamplerChunk], temp[kSamplerChunk];
+    for (int pos = 0; pos < n;) {
+        int count = n - pos < kSamplerChunk ? n - pos : kSamplerChunk;
+        int active = sampler_advance(s, count, i0, i1, frac, rates + pos);
+        // Round up to a whole number of vectors. The extra samples are not
+        // used.
+        int padded = (active + 3) & ~3;
+        for (int i = active; i < padded; i++) {
+            i0[i] = 0;
+            i1[i] = 0;
+            frac[i] = 0.0f;
+        }
+        for (int c = 0; c < s->span.channels; c++) {
+            sampler_gather(&s->span, c, padded, a, i0);
+            sampler_gather(&s->span, c, padded, b, i1);
+            sampler_lerp(padded, temp, a, b, frac, scale, isfloat);
+            float *restrict out = (c == 0 ? left : right) + pos;
+            memcpy(out, temp, sizeof(float) * active);
+            memset(out + active, 0, sizeof(float) * (count - active));
+        }
+        if (s->span.channels == 1) {
+            memcpy(right + pos, left + pos, sizeof(float) * count);
+        }
+        pos += count;
+    }
+}
@@ -0,0 +1,59 @@
+// c/dsp/sampler.h - Sample playback.
+#pragma once
+
+#include "c/io/wave.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+
+struct ufxr_error;
+
+// A sample player, which plays audio directly from a wave file span at a
+// variable rate, with an optional loop.
+//
+// Samples are read in the file's format and converted as they are played, so
+// a memory-mapped file is never decoded into a float array, and only the pages
+// which are played are read from disk. Playback uses linear interpolation.
+// Interpolation across the loop end uses the sample at the loop start.
+//
+// The sampler does not allocate memory, and there is nothing to destroy. The
+// span must remain valid while the sampler is in use.
+//
+// All fields are private. Do not access them.
+struct ufxr_sampler {
+    struct ufxr_wavespan span;
+    size_t loopstart;
+    size_t loopend;
+    double pos;
+    bool playing;
+};
+
+// Initialize a sampler which plays the given span. The span must have at least
+// one frame. The sampler is stopped, with no loop.
+bool ufxr_sampler_init(struct ufxr_sampler *restrict s,
+                       const struct ufxr_wavespan *restrict span,
+                       struct ufxr_error *err);
+
+// Set the loop points, in frames. Playback which reaches the end of the loop
+// continues from the start, and playback in reverse which reaches the start of
+// the loop continues from the end. If the start and end are equal, the loop is
+// removed. Returns false if the loop points are out of range.
+bool ufxr_sampler_setloop(struct ufxr_sampler *restrict s, size_t start,
+                          size_t end);
+
+// Start playback from the given position, in frames.
+void ufxr_sampler_start(struct ufxr_sampler *restrict s, double pos);
+
+// Stop playback.
+void ufxr_sampler_stop(struct ufxr_sampler *restrict s);
+
+// Return true if the sampler is playing. Without a loop, playback stops when
+// it passes either end of the span.
+bool ufxr_sampler_playing(const struct ufxr_sampler *restrict s);
+
+// Generate a block of audio. The rates are the playback rate for each sample,
+// in frames per output sample, and may be negative. Mono spans are written to
+// both outputs. Outputs are zero while stopped. Does not allocate memory.
+void ufxr_sampler_process(struct ufxr_sampler *restrict s, int n,
+                          float *restrict left, float *restrict right,
+                          const float *restrict rates);
@@ -0,0 +1,128 @@
+// truepeak.c - True peak measurement.
+#include "c/dsp/impl.h"
+
+#include <math.h>
+
+enum {
+    kTruePeakTaps = UFXR_TRUEPEAK_TAPS,
+    // Number of points interpolated between each pair of samples.
+    kTruePeakPoints = 3,
+    // Offset of the sample measured from the start of the filter input.
+    kTruePeakCenter = kTruePeakTaps / 2 - 1,
+};
+
+// Measure the true peak of one sample.
+static inline float truepeak1(const float *restrict xs,
+                              const float *restrict coeffs) {
+    float y = fabsf(xs[kTruePeakCenter]);
+    for (int p = 0; p < kTruePeakPoints; p++) {
+        const float *restrict c = coeffs + p * kTruePeakTaps;
+        float acc = 0.0f;
+        for (int k = 0; k < kTruePeakTaps; k++) {
+            acc += c[k] * xs[k];
+        }
+        acc = fabsf(acc);
+        y = acc > y ? acc : y;
+    }
+    return y;
+}
+
+// AVX version.
+#if !HAVE_FUNC && USE_AVX
+#define HAVE_FUNC 1
+#include <immintrin.h>
+
+void ufxr_truepeak(int n, float *restrict peaks, const float *restrict xs,
+                   const float *restrict coeffs) {
+    const __m256 abs = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 acc[kTruePeakPoints];
+        for (int p = 0; p < kTruePeakPoints; p++) {
+            acc[p] = _mm256_setzero_ps();
+        }
+        for (int k = 0; k < kTruePeakTaps; k++) {
+            __m256 x = _mm256_loadu_ps(xs + i + k);
+            for (int p = 0; p < kTruePeakPoints; p++) {
+                __m256 c = _mm256_broadcast_ss(coeffs + p * kTruePeakTaps + k);
+                acc[p] = _mm256_add_ps(acc[p], _mm256_mul_ps(c, x));
+            }
+        }
+        __m256 y =
+            _mm256_and_ps(_mm256_loadu_ps(xs + i + kTruePeakCenter), abs);
+        for (int p = 0; p < kTruePeakPoints; p++) {
+            y = _mm256_max_ps(y, _mm256_and_ps(acc[p], abs));
+        }
+        _mm256_storeu_ps(peaks + i, y);
+    }
+    for (; i < n; i++) {
+        peaks[i] = truepeak1(xs + i, coeffs);
+    }
+}
+#endif
+
+// SSE2 version.
+#if !HAVE_FUNC && USE_SSE2
+#define HAVE_FUNC 1
+#include <emmintrin.h>
+
+void ufxr_truepeak(int n, float *restrict peaks, const float *restrict xs,
+                   const float *restrict coeffs) {
+    const __m128 abs = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 acc[kTruePeakPoints];
+        for (int p = 0; p < kTruePeakPoints; p++) {
+            acc[p] = _mm_setzero_ps();
+        }
+        for (int k = 0; k < kTruePeakTaps; k++) {
+            __m128 x = _mm_loadu_ps(xs + i + k);
+            for (int p = 0; p < kTruePeakPoints; p++) {
+                __m128 c = _mm_set1_ps(coeffs[p * kTruePeakTaps + k]);
+                acc[p] = _mm_add_ps(acc[p], _mm_mul_ps(c, x));
+            }
+        }
+        __m128 y = _mm_and_ps(_mm_loadu_ps(xs + i + kTruePeakCenter), abs);
+        for (int p = 0; p < kTruePeakPoints; p++) {
+            y = _mm_max_ps(y, _mm_and_ps(acc[p], abs));
+        }
+        _mm_storeu_ps(peaks + i, y);
+    }
+    for (; i < n; i++) {
+        peaks[i] = truepeak1(xs + i, coeffs);
+    }
+}
+#endif
+
+// Scalar version.
+#if !HAVE_FUNC
+void ufxr_truepeak(int n, float *restrict peaks, const float *restrict xs,
+                   const float *restrict coeffs) {
+    for (int i = 0; i < n; i++) {
+        peaks[i] = truepeak1(xs + i, coeffs);
+    }
+}
+#endif
+
+void ufxr_truepeak_init(float *coeffs) {
+    // Kaiser-windowed sinc filters for points 1/4, 2/4, and 3/4 of the way
+    // from the sample at the center of the filter to the next one. Each filter
+    // is normalized to unity gain at DC.
+    const double pi = 4.0 * atan(1.0);
+    const int half = kTruePeakTaps / 2;
+    for (int p = 0; p < kTruePeakPoints; p++) {
+        float *restrict c = coeffs + p * kTruePeakTaps;
+        double frac = (double)(p + 1) / (kTruePeakPoints + 1), sum = 0.0;
+        double v[kTruePeakTaps];
+        for (int k = 0; k < kTruePeakTaps; k++) {
+            double t = (half - 1 + frac) - k;
+            double x = pi * t;
+            double sinc = x == 0.0 ? 1.0 : sin(x) / x;
+            v[k] = sinc * ufxr_kaiser(t / half, 6.0);
+            sum += v[k];
+        }
+        for (int k = 0; k < kTruePeakTaps; k++) {
+            c[k] = v[k] / sum;
+        }
+    }
+}
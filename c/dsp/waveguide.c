@@ -0,0 +1,133 @@
+// waveguide.c - Plucked string waveguide.
+#include "c/dsp/waveguide.h"
+
+#include "c/dsp/impl.h"
+#include "c/io/error.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+static bool waveguide_valid(const struct ufxr_waveguideparams *restrict p,
+                            int samplerate, float minfreq) {
+    return p->freq >= minfreq && p->freq <= 0.25f * (float)samplerate &&
+           p->decay > 0.0f && p->brightness >= 0.0f && p->brightness <= 1.0f;
+}
+
+// Calculate filter coefficients for the given parameters.
+static void waveguide_tune(struct ufxr_waveguide *restrict w,
+                           const struct ufxr_waveguideparams *restrict p) {
+    const double rate = w->samplerate;
+    // Total loop delay, in samples. The loss filter contributes a delay equal
+    // to its smoothing coefficient, and the allpass provides the remainder
+    // beyond the integer delay line length. Keeping the allpass delay between
+    // 0.5 and 1.5 samples keeps its phase response flat at low frequencies.
+    double period = rate / (double)p->freq;
+    double smooth = 0.5 * (1.0 - (double)p->brightness);
+    double rest = period - smooth;
+    int delay = (int)floor(rest - 0.5);
+    double frac = rest - delay;
+    w->delay = delay;
+    w->smooth = smooth;
+    w->allpass = (1.0 - frac) / (1.0 + frac);
+    // Loop gain which gives a 60 dB decay after the given decay time.
+    w->gain = pow(10.0, -3.0 * period / ((double)p->decay * rate));
+}
+
+bool ufxr_waveguide_create(struct ufxr_waveguide *restrict w,
+                           const struct ufxr_waveguideparams *restrict p,
+                           struct ufxr_error *err) {
+    if (p->samplerate <= 0 || !(p->minfreq > 0.0f) ||
+        !waveguide_valid(p, p->samplerate, p->minfreq)) {
+        ufxr_error_setcode(err, kUFXRErrorInvalidArgument);
+        return false;
+    }
+    double maxdelay = ceil((double)p->samplerate / (double)p->minfreq) + 2.0;
+    if (maxdelay > (1 << 24)) {
+        ufxr_error_setcode(err, kUFXRErrorInvalidArgument);
+        return false;
+    }
+    unsigned size = ufxr_pow2((unsigned)maxdelay);
+    float *buffer = ufxr_alloc(sizeof(float) * size);
+    if (buffer == NULL) {
+        ufxr_error_seterrno(err);
+        return false;
+    }
+    *w = (struct ufxr_waveguide){
+        .samplerate = p->samplerate,
+        .minfreq = p->minfreq,
+        .mask = size - 1,
+        .seed = 1,
+        .buffer = buffer,
+    };
+    waveguide_tune(w, p);
+    return true;
+}
+
+void ufxr_waveguide_destroy(struct ufxr_waveguide *restrict w) {
+    free(w->buffer);
+    w->buffer = NULL;
+}
+
+void ufxr_waveguide_reset(struct ufxr_waveguide *restrict w) {
+    memset(w->buffer, 0, sizeof(float) * (w->mask + 1));
+    w->pos = 0;
+    w->loss_x1 = 0.0f;
+    w->ap_x1 = 0.0f;
+    w->ap_y1 = 0.0f;
+}
+
+bool ufxr_waveguide_set(struct ufxr_waveguide *restrict w,
+                        const struct ufxr_waveguideparams *restrict p,
+                        struct ufxr_error *err) {
+    if (!waveguide_valid(p, w->samplerate, w->minfreq)) {
+        ufxr_error_setcode(err, kUFXRErrorInvalidArgument);
+        return false;
+    }
+    waveguide_tune(w, p);
+    return true;
+}
+
+void ufxr_waveguide_pluck(struct ufxr_waveguide *restrict w, float amplitude) {
+    // The most recently written samples are the next to be read, so fill the
+    // last period of the delay line.
+    float *restrict buf = w->buffer;
+    const unsigned mask = w->mask;
+    const float scale = 2.0f * amplitude / 4294967296.0f;
+    unsigned seed = w->seed;
+    for (int i = 1; i <= w->delay; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        buf[(w->pos - i) & mask] += (float)seed * scale - amplitude;
+    }
+    w->seed = seed;
+}
+
+void ufxr_waveguide_process(struct ufxr_waveguide *restrict w, int n,
+                            float *restrict outs, const float *restrict xs) {
+    // The string decays into subnormals, which are very slow.
+    struct ufxr_fpstate fp;
+    ufxr_fpstate_ftz(&fp);
+    float *restrict buf = w->buffer;
+    const unsigned mask = w->mask, delay = w->delay;
+    const float g0 = w->gain * (1.0f - w->smooth), g1 = w->gain * w->smooth;
+    const float c = w->allpass;
+    unsigned pos = w->pos;
+    float loss_x1 = w->loss_x1, ap_x1 = w->ap_x1, ap_y1 = w->ap_y1;
+    for (int i = 0; i < n; i++) {
+        float v = buf[(pos - delay) & mask];
+        float lp = g0 * v + g1 * loss_x1;
+        loss_x1 = v;
+        float ap = c * (lp - ap_y1) + ap_x1;
+        ap_x1 = lp;
+        ap_y1 = ap;
+        float y = xs[i] + ap;
+        buf[pos & mask] = y;
+        outs[i] = y;
+        pos++;
+    }
+    w->pos = pos & mask;
+    w->loss_x1 = loss_x1;
+    w->ap_x1 = ap_x1;
+    w->ap_y1 = ap_y1;
+    ufxr_fpstate_restore(&fp);
+}
@@ -0,0 +1,82 @@
+// c/dsp/waveguide.h - Plucked string waveguide.
+#pragma once
+
+#include <stdbool.h>
+
+struct ufxr_error;
+
+// Parameters for a string.
+struct ufxr_waveguideparams {
+    // Sample rate in Hz.
+    int samplerate;
+    // Lowest frequency the string will be tuned to, in Hz. This determines the
+    // size of the delay line.
+    float minfreq;
+    // Fundamental frequency, in Hz. Must be at least minfreq and at most a
+    // quarter of the sample rate.
+    float freq;
+    // Decay time (T60) of the fundamental, in seconds.
+    float decay;
+    // Brightness, from 0 to 1. At 0, the loss filter averages adjacent samples
+    // and high harmonics die out quickly, like the original Karplus-Strong
+    // algorithm. At 1, all harmonics decay at the same rate.
+    float brightness;
+};
+
+// A plucked string, using a Karplus-Strong style digital waveguide.
+//
+// The string is a delay line in a feedback loop with a one-zero loss filter
+// and a first-order allpass filter. The allpass provides the fractional part of
+// the loop delay, so the string can be tuned accurately at any frequency. The
+// input is added into the loop, so the string can be excited by a burst of
+// noise, an impulse, or any other signal.
+//
+// All fields are private. Do not access them.
+struct ufxr_waveguide {
+    int samplerate;
+    float minfreq;
+    unsigned mask;
+    unsigned pos;
+    unsigned seed;
+    int delay;
+    // Loss filter: y = gain * ((1 - smooth) * x[n] + smooth * x[n-1]).
+    float gain;
+    float smooth;
+    // Allpass coefficient.
+    float allpass;
+    // Filter state.
+    float loss_x1;
+    float ap_x1;
+    float ap_y1;
+    float *buffer;
+};
+
+// Create a string. If successful, destroy() must be called to release
+// resources. This is the only function which allocates memory.
+bool ufxr_waveguide_create(struct ufxr_waveguide *restrict w,
+                           const struct ufxr_waveguideparams *restrict p,
+                           struct ufxr_error *err);
+
+// Destroy a string and release any resources.
+void ufxr_waveguide_destroy(struct ufxr_waveguide *restrict w);
+
+// Clear the string state, silencing it.
+void ufxr_waveguide_reset(struct ufxr_waveguide *restrict w);
+
+// Change the frequency, decay, and brightness of a string. The sample rate and
+// minimum frequency are ignored, and the frequency must be at least the
+// minimum given when the string was created. The string keeps ringing.
+bool ufxr_waveguide_set(struct ufxr_waveguide *restrict w,
+                        const struct ufxr_waveguideparams *restrict p,
+                        struct ufxr_error *err);
+
+// Pluck the string by adding one period of white noise to the delay line, with
+// peak amplitude given.
+void ufxr_waveguide_pluck(struct ufxr_waveguide *restrict w, float amplitude);
+
+// Process a block of audio. The input is added into the feedback loop, and the
+// output is the signal written to the delay line. The state is preserved
+// between calls, so a long signal can be processed in blocks of any size. Does
+// not allocate memory.
+void ufxr_waveguide_process(struct ufxr_waveguide *restrict w, int n,
+                            float *restrict outs, const float *restrict xs);
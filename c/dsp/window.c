@@ -0,0 +1,24 @@
+// window.c - Window functions.
+#include "c/dsp/impl.h"
+
+#include <math.h>
+
+// Modified Bessel function of the first kind, order zero.
+static double bessel_i0(double x) {
+    double sum = 1.0, term = 1.0, y = 0.25 * x * x;
+    for (int k = 1; k < 100; k++) {
+        term *= y / ((double)k * (double)k);
+        sum += term;
+        if (term < sum * 1e-17) {
+            break;
+        }
+    }
+    return sum;
+}
+
+double ufxr_kaiser(double x, double beta) {
+    if (x < -1.0 || x > 1.0) {
+        return 0.0;
+    }
+    return bessel_i0(beta * sqrt(1.0 - x * x)) / bessel_i0(beta);
+}
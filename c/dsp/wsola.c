@@ -0,0 +1,273 @@
+// wsola.c - Time stretching and pitch shifting.
+#include "c/dsp/wsola.h"
+
+#include "c/dsp/impl.h"
+#include "c/io/error.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+enum {
+    // Number of input samples buffered at once, in addition to the input
+    // needed for the next frame.
+    kWSOLAChunk = 1024,
+};
+
+// Frame length and search tolerance, in seconds.
+static const double kWSOLAFrameTime = 0.03;
+static const double kWSOLAToleranceTime = 0.01;
+
+// Limits for the stretch and pitch ratios.
+static const double kWSOLAMinRatio = 0.25;
+static const double kWSOLAMaxRatio = 4.0;
+
+// AVX version.
+#if !HAVE_FUNC && USE_AVX
+#define HAVE_FUNC 1
+#include <immintrin.h>
+
+// Return the dot product of n template samples and n input samples. The
+// template must be aligned, and n must be a multiple of 8.
+static float wsola_dot(int n, const float *restrict ts,
+                       const float *restrict xs) {
+    __m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps();
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        acc0 = _mm256_add_ps(acc0, _mm256_mul_ps(_mm256_load_ps(ts + i),
+                                                 _mm256_loadu_ps(xs + i)));
+        acc1 = _mm256_add_ps(acc1, _mm256_mul_ps(_mm256_load_ps(ts + i + 8),
+                                                 _mm256_loadu_ps(xs + i + 8)));
+    }
+    if (i < n) {
+        acc0 = _mm256_add_ps(acc0, _mm256_mul_ps(_mm256_load_ps(ts + i),
+                                                 _mm256_loadu_ps(xs + i)));
+    }
+    acc0 = _mm256_add_ps(acc0, acc1);
+    __m128 acc = _mm_add_ps(_mm256_castps256_ps128(acc0),
+                            _mm256_extractf128_ps(acc0, 1));
+    acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+    acc = _mm_add_ss(acc, _mm_shuffle_ps(acc, acc, _MM_SHUFFLE(1, 1, 1, 1)));
+    return _mm_cvtss_f32(acc);
+}
+#endif
+
+// SSE2 version.
+#if !HAVE_FUNC && USE_SSE2
+#define HAVE_FUNC 1
+#include <xmmintrin.h>
+
+static float wsola_dot(int n, const float *restrict ts,
+                       const float *restrict xs) {
+    __m128 acc0 = _mm_setzero_ps(), acc1 = _mm_setzero_ps();
+    for (int i = 0; i < n; i += 8) {
+        acc0 = _mm_add_ps(
+            acc0, _mm_mul_ps(_mm_load_ps(ts + i), _mm_loadu_ps(xs + i)));
+        acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_load_ps(ts + i + 4),
+                                           _mm_loadu_ps(xs + i + 4)));
+    }
+    __m128 acc = _mm_add_ps(acc0, acc1);
+    acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+    acc = _mm_add_ss(acc, _mm_shuffle_ps(acc, acc, _MM_SHUFFLE(1, 1, 1, 1)));
+    return _mm_cvtss_f32(acc);
+}
+#endif
+
+// Scalar version.
+#if !HAVE_FUNC
+static float wsola_dot(int n, const float *restrict ts,
+                       const float *restrict xs) {
+    float acc = 0.0f;
+    for (int i = 0; i < n; i++) {
+        acc += ts[i] * xs[i];
+    }
+    return acc;
+}
+#endif
+
+// Return the start of the next frame, which is the position within the
+// tolerance of the nominal position where the input best matches the waveform
+// continuing from the previous frame.
+static int wsola_search(struct ufxr_wsola *restrict w, int nominal) {
+    const int len = w->overlap, tol = w->tolerance;
+    const float *restrict buf = w->buffer;
+    float *restrict tmpl = w->temp;
+    memcpy(tmpl, buf + w->prev + (int)lround(w->hop * w->pitch),
+           sizeof(float) * len);
+    // Energy of the candidate, updated as the candidate slides.
+    const int first = nominal - tol;
+    double energy = 0.0;
+    for (int i = 0; i < len; i++) {
+        energy += (double)buf[first + i] * (double)buf[first + i];
+    }
+    int best = nominal;
+    double bestscore = -HUGE_VAL;
+    for (int x = first; x <= nominal + tol; x++) {
+        double corr = wsola_dot(len, tmpl, buf + x);
+        double score = corr / sqrt(energy + 1e-20);
+        if (score > bestscore) {
+            bestscore = score;
+            best = x;
+        }
+        energy += (double)buf[x + len] * (double)buf[x + len] -
+                  (double)buf[x] * (double)buf[x];
+    }
+    return best;
+}
+
+// Add a windowed frame starting at the given input position to the
+// accumulator.
+static void wsola_frame(struct ufxr_wsola *restrict w, int start) {
+    const int frame = w->frame;
+    const float *restrict win = w->window, *restrict src = w->buffer + start;
+    float *restrict accum = w->accum;
+    if (w->pitch == 1.0) {
+        for (int j = 0; j < frame; j++) {
+            accum[j] += win[j] * src[j];
+        }
+        return;
+    }
+    const float pitch = w->pitch;
+    for (int j = 0; j < frame; j++) {
+        float x = (float)j * pitch;
+        int i = (int)x;
+        float f = x - (float)i;
+        accum[j] += win[j] * (src[i] + f * (src[i + 1] - src[i]));
+    }
+}
+
+bool ufxr_wsola_create(struct ufxr_wsola *restrict w, int samplerate,
+                       double stretch, double pitch, struct ufxr_error *err) {
+    if (samplerate < 1000 || !(stretch >= kWSOLAMinRatio) ||
+        !(stretch <= kWSOLAMaxRatio) || !(pitch >= kWSOLAMinRatio) ||
+        !(pitch <= kWSOLAMaxRatio)) {
+        ufxr_error_setcode(err, kUFXRErrorInvalidArgument);
+        return false;
+    }
+    // The frame length is a multiple of 8, so the hop is a multiple of
+    // UFXR_QUANTUM.
+    const int frame = ((int)ceil(samplerate * kWSOLAFrameTime) + 7) & ~7;
+    const int hop = frame / 2;
+    const int tolerance = (int)lround(samplerate * kWSOLAToleranceTime);
+    int overlap = (int)(hop * pitch) & ~7;
+    if (overlap < 8) {
+        overlap = 8;
+    }
+    const int span = (int)ceil((frame - 1) * pitch) + 2;
+    const double step = hop / stretch;
+    // Input kept after discarding: the search window, the previous frame, and
+    // the distance between them.
+    const int keep = 2 * tolerance + span + (int)ceil(step + hop * pitch) + 2;
+    *w = (struct ufxr_wsola){
+        .stretch = stretch,
+        .pitch = pitch,
+        .step = step,
+        .frame = frame,
+        .hop = hop,
+        .tolerance = tolerance,
+        .overlap = overlap,
+        .span = span,
+        .capacity = keep + kWSOLAChunk,
+    };
+    w->window = ufxr_alloc(sizeof(float) * frame);
+    w->buffer = ufxr_alloc(sizeof(float) * w->capacity);
+    w->accum = ufxr_alloc(sizeof(float) * frame);
+    w->temp = ufxr_alloc(sizeof(float) * overlap);
+    if (w->window == NULL || w->buffer == NULL || w->accum == NULL ||
+        w->temp == NULL) {
+        ufxr_error_seterrno(err);
+        ufxr_wsola_destroy(w);
+        return false;
+    }
+    // Periodic Hann window, which sums to exactly 1 at 50% overlap.
+    const double pi = 4.0 * atan(1.0);
+    for (int i = 0; i < frame; i++) {
+        w->window[i] = 0.5 - 0.5 * cos(2.0 * pi * i / frame);
+    }
+    ufxr_wsola_reset(w);
+    return true;
+}
+
+void ufxr_wsola_destroy(struct ufxr_wsola *restrict w) {
+    free(w->window);
+    free(w->buffer);
+    free(w->accum);
+    free(w->temp);
+    w->window = NULL;
+    w->buffer = NULL;
+    w->accum = NULL;
+    w->temp = NULL;
+}
+
+void ufxr_wsola_reset(struct ufxr_wsola *restrict w) {
+    // The first frame starts one hop before the first input sample, and its
+    // first hop of output is discarded. The buffer starts with enough silence
+    // for the first frame and its search window.
+    const double lead = w->hop * w->pitch;
+    const int start = w->tolerance + (int)ceil(lead);
+    memset(w->buffer, 0, sizeof(float) * start);
+    memset(w->accum, 0, sizeof(float) * w->frame);
+    w->pos = start - lead;
+    w->prev = 0;
+    w->started = false;
+    w->fill = start;
+}
+
+int ufxr_wsola_maxout(const struct ufxr_wsola *restrict w, int n) {
+    return w->hop * ((int)(n / w->step) + 2);
+}
+
+int ufxr_wsola_latency(const struct ufxr_wsola *restrict w) {
+    return (int)ceil(2.0 * w->step) + w->tolerance + w->span;
+}
+
+int ufxr_wsola_process(struct ufxr_wsola *restrict w, int n,
+                       float *restrict outs, const float *restrict xs) {
+    const int frame = w->frame, hop = w->hop, tol = w->tolerance;
+    const int capacity = w->capacity, span = w->span;
+    const int advance = (int)lround(hop * w->pitch);
+    float *restrict buf = w->buffer, *restrict accum = w->accum;
+    int fill = w->fill, count = 0;
+    for (int i = 0; i < n;) {
+        int amt = capacity - fill < n - i ? capacity - fill : n - i;
+        memcpy(buf + fill, xs + i, sizeof(float) * amt);
+        fill += amt;
+        i += amt;
+        for (;;) {
+            const int nominal = (int)lround(w->pos);
+            if (nominal + tol + span > fill) {
+                break;
+            }
+            int start = nominal;
+            if (w->started) {
+                start = wsola_search(w, nominal);
+            }
+            wsola_frame(w, start);
+            if (w->started) {
+                memcpy(outs + count, accum, sizeof(float) * hop);
+                count += hop;
+            }
+            memmove(accum, accum + hop, sizeof(float) * (frame - hop));
+            memset(accum + frame - hop, 0, sizeof(float) * hop);
+            w->started = true;
+            w->prev = start;
+            w->pos += w->step;
+        }
+        // Discard input which is no longer needed by the next search.
+        int discard = (int)lround(w->pos) - tol;
+        if (w->started && w->prev + advance < discard) {
+            discard = w->prev + advance;
+        }
+        if (discard > fill) {
+            discard = fill;
+        }
+        if (discard > 0) {
+            memmove(buf, buf + discard, sizeof(float) * (fill - discard));
+            fill -= discard;
+            w->pos -= discard;
+            w->prev -= discard;
+        }
+    }
+    w->fill = fill;
+    return count;
+}
@@ -0,0 +1,78 @@
+// c/dsp/wsola.h - Time stretching and pitch shifting.
+#pragma once
+
+#include <stdbool.h>
+
+struct ufxr_error;
+
+// A streaming time stretcher and pitch shifter, using waveform similarity
+// overlap-add (WSOLA). This makes longer, shorter, or transposed variants of
+// rendered audio without rendering it again.
+//
+// The output is built from Hann-windowed frames with 50% overlap. Each frame is
+// read from the input near its nominal position, at an offset chosen so that
+// it lines up with the waveform continuing from the previous frame. The offset
+// is found by searching for the maximum normalized cross-correlation over a
+// window of about 10 ms. To shift pitch, frames are read from the input at the
+// pitch ratio with linear interpolation, and placed further apart or closer
+// together to keep the duration.
+//
+// Memory use is fixed at creation and does not depend on the length of the
+// stream. Audio may be processed in blocks of any size.
+//
+// All fields are private. Do not access them.
+struct ufxr_wsola {
+    double stretch;
+    double pitch;
+    // Nominal distance between frames, in input samples.
+    double step;
+    // Frame length and distance between frames, in output samples.
+    int frame;
+    int hop;
+    // Maximum distance between a frame and its nominal position, in input
+    // samples.
+    int tolerance;
+    // Length of the waveform compared when searching, in input samples.
+    int overlap;
+    // Number of input samples read by one frame.
+    int span;
+    // Nominal position of the next frame, as an index into the buffer.
+    double pos;
+    // Start of the previous frame, as an index into the buffer.
+    int prev;
+    bool started;
+    int fill;
+    int capacity;
+    float *window;
+    float *buffer;
+    float *accum;
+    float *temp;
+};
+
+// Create a time stretcher. The output is stretch times as long as the input,
+// with pitch multiplied by pitch. Both ratios must be between 0.25 and 4. If
+// successful, destroy() must be called to release resources. This is the only
+// function which allocates memory.
+bool ufxr_wsola_create(struct ufxr_wsola *restrict w, int samplerate,
+                       double stretch, double pitch, struct ufxr_error *err);
+
+// Destroy a time stretcher and release any resources.
+void ufxr_wsola_destroy(struct ufxr_wsola *restrict w);
+
+// Clear the time stretcher state, and start a new stream.
+void ufxr_wsola_reset(struct ufxr_wsola *restrict w);
+
+// Return the maximum number of samples produced by processing n input samples.
+int ufxr_wsola_maxout(const struct ufxr_wsola *restrict w, int n);
+
+// Return the number of input samples which must be processed after the end of
+// the stream before the output covers the entire stream. Process this many
+// zeroes to flush the time stretcher.
+int ufxr_wsola_latency(const struct ufxr_wsola *restrict w);
+
+// Process n input samples, and return the number of output samples written.
+// The output must have space for ufxr_wsola_maxout(n) samples. Output sample k
+// is taken from the input near time k / stretch, counting from the start of
+// the stream. Does not allocate memory.
+int ufxr_wsola_process(struct ufxr_wsola *restrict w, int n,
+                       float *restrict outs, const float *restrict xs);
@@ -0,0 +1,645 @@
+// fft.c - Fast Fourier transform.
+#include "c/fft/fft.h"
+
+#include "c/config/config.h"
+#include "c/io/error.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+// The complex FFT is an in-place, radix-4, decimation in time FFT on data in
+// bit-reversed order. Each radix-4 stage combines four transforms of size q
+// into one transform of size 4q. If the size is an odd power of two, the last
+// stage is radix-2. The inverse FFT is computed with the forward FFT by
+// swapping the real and imaginary parts, since IFFT(x) = swap(FFT(swap(x))).
+//
+// Twiddle factors are precomputed in the order they are used, so every stage
+// reads them sequentially. For each radix-4 stage with q >= 4 there are four
+// arrays of q elements, cos and -sin of 2 pi j / 2q and then of 2 pi j / 4q.
+// The first stage, q = 1, needs no twiddle factors. The radix-2 stage, if
+// present, has two arrays of n/2 elements, cos and -sin of 2 pi j / n.
+//
+// The real FFT of size n is computed as a complex FFT of size m = n/2, where
+// the real input is treated as m complex values, followed by a pass which
+// separates the spectra of the even and odd samples. Its twiddle factors are
+// two arrays of m/2+1 elements, cos and -sin of 2 pi k / n.
+
+// Alignment of twiddle factor arrays, which is enough for AVX.
+#define FFT_ALIGN 32
+
+static void *fft_alloc(size_t size) {
+    size = (size + FFT_ALIGN - 1) & ~(size_t)(FFT_ALIGN - 1);
+    return aligned_alloc(FFT_ALIGN, size);
+}
+
+bool ufxr_cfft_create(struct ufxr_cfft *restrict f, int n,
+                      struct ufxr_error *err) {
+    if (n < 4 || n > (1 << 28) || (n & (n - 1)) != 0) {
+        ufxr_error_setcode(err, kUFXRErrorInvalidArgument);
+        return false;
+    }
+    size_t size = 0;
+    int q;
+    for (q = 4; 4 * q <= n; q *= 4) {
+        size += 4 * q;
+    }
+    if (q < n) {
+        size += n;
+    }
+    float *twiddle = fft_alloc(sizeof(float) * (size + 1));
+    int *bitrev = malloc(sizeof(int) * n);
+    if (twiddle == NULL || bitrev == NULL) {
+        ufxr_error_seterrno(err);
+        free(twiddle);
+        free(bitrev);
+        return false;
+    }
+    const double pi = 4.0 * atan(1.0);
+    float *tw = twiddle;
+    for (q = 4; 4 * q <= n; q *= 4) {
+        for (int j = 0; j < q; j++) {
+            double a1 = pi * j / q, a2 = 0.5 * pi * j / q;
+            tw[j] = cos(a1);
+            tw[q + j] = -sin(a1);
+            tw[2 * q + j] = cos(a2);
+            tw[3 * q + j] = -sin(a2);
+        }
+        tw += 4 * q;
+    }
+    if (q < n) {
+        for (int j = 0; j < n / 2; j++) {
+            double a = 2.0 * pi * j / n;
+            tw[j] = cos(a);
+            tw[n / 2 + j] = -sin(a);
+        }
+    }
+    int bits = __builtin_ctz(n);
+    for (int i = 0; i < n; i++) {
+        unsigned r = 0;
+        for (int b = 0; b < bits; b++) {
+            r |= ((i >> b) & 1u) << (bits - 1 - b);
+        }
+        bitrev[i] = r;
+    }
+    *f = (struct ufxr_cfft){
+        .n = n,
+        .twiddle = twiddle,
+        .bitrev = bitrev,
+    };
+    return true;
+}
+
+void ufxr_cfft_destroy(struct ufxr_cfft *restrict f) {
+    free(f->twiddle);
+    free(f->bitrev);
+    f->twiddle = NULL;
+    f->bitrev = NULL;
+}
+
+bool ufxr_fft_create(struct ufxr_fft *restrict f, int n,
+                     struct ufxr_error *err) {
+    if (n < 8 || n > (1 << 29) || (n & (n - 1)) != 0) {
+        ufxr_error_setcode(err, kUFXRErrorInvalidArgument);
+        return false;
+    }
+    const int m = n / 2;
+    float *twiddle = fft_alloc(sizeof(float) * (m + 2));
+    if (twiddle == NULL) {
+        ufxr_error_seterrno(err);
+        return false;
+    }
+    if (!ufxr_cfft_create(&f->cfft, m, err)) {
+        free(twiddle);
+        return false;
+    }
+    const double pi = 4.0 * atan(1.0);
+    for (int k = 0; k <= m / 2; k++) {
+        double a = 2.0 * pi * k / n;
+        twiddle[k] = cos(a);
+        twiddle[m / 2 + 1 + k] = -sin(a);
+    }
+    f->n = n;
+    f->twiddle = twiddle;
+    return true;
+}
+
+void ufxr_fft_destroy(struct ufxr_fft *restrict f) {
+    ufxr_cfft_destroy(&f->cfft);
+    free(f->twiddle);
+    f->twiddle = NULL;
+}
+
+// First radix-4 stage, combining transforms of size 1. No twiddle factors.
+static inline void cfft_first_scalar(int n, float *restrict re,
+                                     float *restrict im) {
+    for (int i = 0; i < n; i += 4) {
+        float a0r = re[i], a1r = re[i + 1], a2r = re[i + 2], a3r = re[i + 3];
+        float a0i = im[i], a1i = im[i + 1], a2i = im[i + 2], a3i = im[i + 3];
+        float b0r = a0r + a1r, b0i = a0i + a1i;
+        float b1r = a0r - a1r, b1i = a0i - a1i;
+        float b2r = a2r + a3r, b2i = a2i + a3i;
+        float b3r = a2r - a3r, b3i = a2i - a3i;
+        re[i] = b0r + b2r;
+        im[i] = b0i + b2i;
+        re[i + 1] = b1r + b3i;
+        im[i + 1] = b1i - b3r;
+        re[i + 2] = b0r - b2r;
+        im[i + 2] = b0i - b2i;
+        re[i + 3] = b1r - b3i;
+        im[i + 3] = b1i + b3r;
+    }
+}
+
+// Radix-4 stage, combining transforms of size q into transforms of size 4q.
+static inline void cfft_radix4_scalar(int n, int q, float *restrict re,
+                                      float *restrict im,
+                                      const float *restrict tw) {
+    const float *restrict w1r = tw, *restrict w1i = tw + q;
+    const float *restrict w2r = tw + 2 * q, *restrict w2i = tw + 3 * q;
+    for (int i = 0; i < n; i += 4 * q) {
+        float *restrict r = re + i, *restrict m = im + i;
+        for (int j = 0; j < q; j++) {
+            float a0r = r[j], a1r = r[j + q], a2r = r[j + 2 * q],
+                  a3r = r[j + 3 * q];
+            float a0i = m[j], a1i = m[j + q], a2i = m[j + 2 * q],
+                  a3i = m[j + 3 * q];
+            float t1r = a1r * w1r[j] - a1i * w1i[j];
+            float t1i = a1r * w1i[j] + a1i * w1r[j];
+            float t3r = a3r * w1r[j] - a3i * w1i[j];
+            float t3i = a3r * w1i[j] + a3i * w1r[j];
+            float b0r = a0r + t1r, b0i = a0i + t1i;
+            float b1r = a0r - t1r, b1i = a0i - t1i;
+            float b2r = a2r + t3r, b2i = a2i + t3i;
+            float b3r = a2r - t3r, b3i = a2i - t3i;
+            float u2r = b2r * w2r[j] - b2i * w2i[j];
+            float u2i = b2r * w2i[j] + b2i * w2r[j];
+            float u3r = b3r * w2r[j] - b3i * w2i[j];
+            float u3i = b3r * w2i[j] + b3i * w2r[j];
+            r[j] = b0r + u2r;
+            m[j] = b0i + u2i;
+            r[j + q] = b1r + u3i;
+            m[j + q] = b1i - u3r;
+            r[j + 2 * q] = b0r - u2r;
+            m[j + 2 * q] = b0i - u2i;
+            r[j + 3 * q] = b1r - u3i;
+            m[j + 3 * q] = b1i + u3r;
+        }
+    }
+}
+
+// Final radix-2 stage, combining two transforms of size n/2.
+static inline void cfft_radix2_scalar(int n, float *restrict re,
+                                      float *restrict im,
+                                      const float *restrict tw) {
+    const int h = n / 2;
+    const float *restrict wr = tw, *restrict wi = tw + h;
+    for (int j = 0; j < h; j++) {
+        float br = re[j + h], bi = im[j + h];
+        float tr = br * wr[j] - bi * wi[j];
+        float ti = br * wi[j] + bi * wr[j];
+        re[j + h] = re[j] - tr;
+        im[j + h] = im[j] - ti;
+        re[j] += tr;
+        im[j] += ti;
+    }
+}
+
+#if USE_SSE2
+#include <xmmintrin.h>
+
+static inline void cfft_first_sse(int n, float *restrict re,
+                                  float *restrict im) {
+    if (n < 16) {
+        cfft_first_scalar(n, re, im);
+        return;
+    }
+    for (int i = 0; i < n; i += 16) {
+        // Transpose, so each vector holds the same element from four
+        // different transforms.
+        __m128 a0r = _mm_load_ps(re + i), a1r = _mm_load_ps(re + i + 4),
+               a2r = _mm_load_ps(re + i + 8), a3r = _mm_load_ps(re + i + 12);
+        __m128 a0i = _mm_load_ps(im + i), a1i = _mm_load_ps(im + i + 4),
+               a2i = _mm_load_ps(im + i + 8), a3i = _mm_load_ps(im + i + 12);
+        _MM_TRANSPOSE4_PS(a0r, a1r, a2r, a3r);
+        _MM_TRANSPOSE4_PS(a0i, a1i, a2i, a3i);
+        __m128 b0r = _mm_add_ps(a0r, a1r), b0i = _mm_add_ps(a0i, a1i);
+        __m128 b1r = _mm_sub_ps(a0r, a1r), b1i = _mm_sub_ps(a0i, a1i);
+        __m128 b2r = _mm_add_ps(a2r, a3r), b2i = _mm_add_ps(a2i, a3i);
+        __m128 b3r = _mm_sub_ps(a2r, a3r), b3i = _mm_sub_ps(a2i, a3i);
+        __m128 c0r = _mm_add_ps(b0r, b2r), c0i = _mm_add_ps(b0i, b2i);
+        __m128 c1r = _mm_add_ps(b1r, b3i), c1i = _mm_sub_ps(b1i, b3r);
+        __m128 c2r = _mm_sub_ps(b0r, b2r), c2i = _mm_sub_ps(b0i, b2i);
+        __m128 c3r = _mm_sub_ps(b1r, b3i), c3i = _mm_add_ps(b1i, b3r);
+        _MM_TRANSPOSE4_PS(c0r, c1r, c2r, c3r);
+        _MM_TRANSPOSE4_PS(c0i, c1i, c2i, c3i);
+        _mm_store_ps(re + i, c0r);
+        _mm_store_ps(re + i + 4, c1r);
+        _mm_store_ps(re + i + 8, c2r);
+        _mm_store_ps(re + i + 12, c3r);
+        _mm_store_ps(im + i, c0i);
+        _mm_store_ps(im + i + 4, c1i);
+        _mm_store_ps(im + i + 8, c2i);
+        _mm_store_ps(im + i + 12, c3i);
+    }
+}
+
+static inline void cfft_radix4_sse(int n, int q, float *restrict re,
+                                   float *restrict im,
+                                   const float *restrict tw) {
+    const float *restrict w1r = tw, *restrict w1i = tw + q;
+    const float *restrict w2r = tw + 2 * q, *restrict w2i = tw + 3 * q;
+    for (int i = 0; i < n; i += 4 * q) {
+        float *restrict r = re + i, *restrict m = im + i;
+        for (int j = 0; j < q; j += 4) {
+            __m128 a0r = _mm_load_ps(r + j), a1r = _mm_load_ps(r + j + q),
+                   a2r = _mm_load_ps(r + j + 2 * q),
+                   a3r = _mm_load_ps(r + j + 3 * q);
+            __m128 a0i = _mm_load_ps(m + j), a1i = _mm_load_ps(m + j + q),
+                   a2i = _mm_load_ps(m + j + 2 * q),
+                   a3i = _mm_load_ps(m + j + 3 * q);
+            __m128 wr = _mm_load_ps(w1r + j), wi = _mm_load_ps(w1i + j);
+            __m128 t1r = _mm_sub_ps(_mm_mul_ps(a1r, wr), _mm_mul_ps(a1i, wi));
+            __m128 t1i = _mm_add_ps(_mm_mul_ps(a1r, wi), _mm_mul_ps(a1i, wr));
+            __m128 t3r = _mm_sub_ps(_mm_mul_ps(a3r, wr), _mm_mul_ps(a3i, wi));
+            __m128 t3i = _mm_add_ps(_mm_mul_ps(a3r, wi), _mm_mul_ps(a3i, wr));
+            __m128 b0r = _mm_add_ps(a0r, t1r), b0i = _mm_add_ps(a0i, t1i);
+            __m128 b1r = _mm_sub_ps(a0r, t1r), b1i = _mm_sub_ps(a0i, t1i);
+            __m128 b2r = _mm_add_ps(a2r, t3r), b2i = _mm_add_ps(a2i, t3i);
+            __m128 b3r = _mm_sub_ps(a2r, t3r), b3i = _mm_sub_ps(a2i, t3i);
+            wr = _mm_load_ps(w2r + j);
+            wi = _mm_load_ps(w2i + j);
+            __m128 u2r = _mm_sub_ps(_mm_mul_ps(b2r, wr), _mm_mul_ps(b2i, wi));
+            __m128 u2i = _mm_add_ps(_mm_mul_ps(b2r, wi), _mm_mul_ps(b2i, wr));
+            __m128 u3r = _mm_sub_ps(_mm_mul_ps(b3r, wr), _mm_mul_ps(b3i, wi));
+            __m128 u3i = _mm_add_ps(_mm_mul_ps(b3r, wi), _mm_mul_ps(b3i, wr));
+            _mm_store_ps(r + j, _mm_add_ps(b0r, u2r));
+            _mm_store_ps(m + j, _mm_add_ps(b0i, u2i));
+            _mm_store_ps(r + j + q, _mm_add_ps(b1r, u3i));
+            _mm_store_ps(m + j + q, _mm_sub_ps(b1i, u3r));
+            _mm_store_ps(r + j + 2 * q, _mm_sub_ps(b0r, u2r));
+            _mm_store_ps(m + j + 2 * q, _mm_sub_ps(b0i, u2i));
+            _mm_store_ps(r + j + 3 * q, _mm_sub_ps(b1r, u3i));
+            _mm_store_ps(m + j + 3 * q, _mm_add_ps(b1i, u3r));
+        }
+    }
+}
+
+static inline void cfft_radix2_sse(int n, float *restrict re,
+                                   float *restrict im,
+                                   const float *restrict tw) {
+    const int h = n / 2;
+    const float *restrict wr = tw, *restrict wi = tw + h;
+    for (int j = 0; j < h; j += 4) {
+        __m128 ar = _mm_load_ps(re + j), ai = _mm_load_ps(im + j);
+        __m128 br = _mm_load_ps(re + j + h), bi = _mm_load_ps(im + j + h);
+        __m128 cr = _mm_load_ps(wr + j), ci = _mm_load_ps(wi + j);
+        __m128 tr = _mm_sub_ps(_mm_mul_ps(br, cr), _mm_mul_ps(bi, ci));
+        __m128 ti = _mm_add_ps(_mm_mul_ps(br, ci), _mm_mul_ps(bi, cr));
+        _mm_store_ps(re + j, _mm_add_ps(ar, tr));
+        _mm_store_ps(im + j, _mm_add_ps(ai, ti));
+        _mm_store_ps(re + j + h, _mm_sub_ps(ar, tr));
+        _mm_store_ps(im + j + h, _mm_sub_ps(ai, ti));
+    }
+}
+#endif
+
+// AVX version.
+#if !HAVE_FUNC && USE_AVX
+#define HAVE_FUNC 1
+#include <immintrin.h>
+
+// Radix-4 stage, for q >= 8. Data arrays are only required to be aligned to
+// UFXR_ALIGN, so they are accessed with unaligned loads and stores.
+static inline void cfft_radix4_avx(int n, int q, float *restrict re,
+                                   float *restrict im,
+                                   const float *restrict tw) {
+    const float *restrict w1r = tw, *restrict w1i = tw + q;
+    const float *restrict w2r = tw + 2 * q, *restrict w2i = tw + 3 * q;
+    for (int i = 0; i < n; i += 4 * q) {
+        float *restrict r = re + i, *restrict m = im + i;
+        for (int j = 0; j < q; j += 8) {
+            __m256 a0r = _mm256_loadu_ps(r + j),
+                   a1r = _mm256_loadu_ps(r + j + q),
+                   a2r = _mm256_loadu_ps(r + j + 2 * q),
+                   a3r = _mm256_loadu_ps(r + j + 3 * q);
+            __m256 a0i = _mm256_loadu_ps(m + j),
+                   a1i = _mm256_loadu_ps(m + j + q),
+                   a2i = _mm256_loadu_ps(m + j + 2 * q),
+                   a3i = _mm256_loadu_ps(m + j + 3 * q);
+            __m256 wr = _mm256_load_ps(w1r + j), wi = _mm256_load_ps(w1i + j);
+            __m256 t1r =
+                _mm256_sub_ps(_mm256_mul_ps(a1r, wr), _mm256_mul_ps(a1i, wi));
+            __m256 t1i =
+                _mm256_add_ps(_mm256_mul_ps(a1r, wi), _mm256_mul_ps(a1i, wr));
+            __m256 t3r =
+                _mm256_sub_ps(_mm256_mul_ps(a3r, wr), _mm256_mul_ps(a3i, wi));
+            __m256 t3i =
+                _mm256_add_ps(_mm256_mul_ps(a3r, wi), _mm256_mul_ps(a3i, wr));
+            __m256 b0r = _mm256_add_ps(a0r, t1r), b0i = _mm256_add_ps(a0i, t1i);
+            __m256 b1r = _mm256_sub_ps(a0r, t1r), b1i = _mm256_sub_ps(a0i, t1i);
+            __m256 b2r = _mm256_add_ps(a2r, t3r), b2i = _mm256_add_ps(a2i, t3i);
+            __m256 b3r = _mm256_sub_ps(a2r, t3r), b3i = _mm256_sub_ps(a2i, t3i);
+            wr = _mm256_load_ps(w2r + j);
+            wi = _mm256_load_ps(w2i + j);
+            __m256 u2r =
+                _mm256_sub_ps(_mm256_mul_ps(b2r, wr), _mm256_mul_ps(b2i, wi));
+            __m256 u2i =
+                _mm256_add_ps(_mm256_mul_ps(b2r, wi), _mm256_mul_ps(b2i, wr));
+            __m256 u3r =
+                _mm256_sub_ps(_mm256_mul_ps(b3r, wr), _mm256_mul_ps(b3i, wi));
+            __m256 u3i =
+                _mm256_add_ps(_mm256_mul_ps(b3r, wi), _mm256_mul_ps(b3i, wr));
+            _mm256_storeu_ps(r + j, _mm256_add_ps(b0r, u2r));
+            _mm256_storeu_ps(m + j, _mm256_add_ps(b0i, u2i));
+            _mm256_storeu_ps(r + j + q, _mm256_add_ps(b1r, u3i));
+            _mm256_storeu_ps(m + j + q, _mm256_sub_ps(b1i, u3r));
+            _mm256_storeu_ps(r + j + 2 * q, _mm256_sub_ps(b0r, u2r));
+            _mm256_storeu_ps(m + j + 2 * q, _mm256_sub_ps(b0i, u2i));
+            _mm256_storeu_ps(r + j + 3 * q, _mm256_sub_ps(b1r, u3i));
+            _mm256_storeu_ps(m + j + 3 * q, _mm256_add_ps(b1i, u3r));
+        }
+    }
+}
+
+// Final radix-2 stage, for n >= 16.
+static inline void cfft_radix2_avx(int n, float *restrict re,
+                                   float *restrict im,
+                                   const float *restrict tw) {
+    const int h = n / 2;
+    const float *restrict wr = tw, *restrict wi = tw + h;
+    for (int j = 0; j < h; j += 8) {
+        __m256 ar = _mm256_loadu_ps(re + j), ai = _mm256_loadu_ps(im + j);
+        __m256 br = _mm256_loadu_ps(re + j + h),
+               bi = _mm256_loadu_ps(im + j + h);
+        __m256 cr = _mm256_load_ps(wr + j), ci = _mm256_load_ps(wi + j);
+        __m256 tr = _mm256_sub_ps(_mm256_mul_ps(br, cr), _mm256_mul_ps(bi, ci));
+        __m256 ti = _mm256_add_ps(_mm256_mul_ps(br, ci), _mm256_mul_ps(bi, cr));
+        _mm256_storeu_ps(re + j, _mm256_add_ps(ar, tr));
+        _mm256_storeu_ps(im + j, _mm256_add_ps(ai, ti));
+        _mm256_storeu_ps(re + j + h, _mm256_sub_ps(ar, tr));
+        _mm256_storeu_ps(im + j + h, _mm256_sub_ps(ai, ti));
+    }
+}
+
+// Complex FFT on data in bit-reversed order.
+static void cfft_dit(const struct ufxr_cfft *restrict f, float *restrict re,
+                     float *restrict im) {
+    const int n = f->n;
+    const float *restrict tw = f->twiddle;
+    cfft_first_sse(n, re, im);
+    int q;
+    for (q = 4; 4 * q <= n; q *= 4) {
+        if (q < 8) {
+            cfft_radix4_sse(n, q, re, im, tw);
+        } else {
+            cfft_radix4_avx(n, q, re, im, tw);
+        }
+        tw += 4 * q;
+    }
+    if (q < n) {
+        if (n < 16) {
+            cfft_radix2_sse(n, re, im, tw);
+        } else {
+            cfft_radix2_avx(n, re, im, tw);
+        }
+    }
+}
+#endif
+
+// SSE2 version.
+#if !HAVE_FUNC && USE_SSE2
+#define HAVE_FUNC 1
+
+// Complex FFT on data in bit-reversed order.
+static void cfft_dit(const struct ufxr_cfft *restrict f, float *restrict re,
+                     float *restrict im) {
+    const int n = f->n;
+    const float *restrict tw = f->twiddle;
+    cfft_first_sse(n, re, im);
+    int q;
+    for (q = 4; 4 * q <= n; q *= 4) {
+        cfft_radix4_sse(n, q, re, im, tw);
+        tw += 4 * q;
+    }
+    if (q < n) {
+        cfft_radix2_sse(n, re, im, tw);
+    }
+}
+#endif
+
+// Scalar version.
+#if !HAVE_FUNC
+
+// Complex FFT on data in bit-reversed order.
+static void cfft_dit(const struct ufxr_cfft *restrict f, float *restrict re,
+                     float *restrict im) {
+    const int n = f->n;
+    const float *restrict tw = f->twiddle;
+    cfft_first_scalar(n, re, im);
+    int q;
+    for (q = 4; 4 * q <= n; q *= 4) {
+        cfft_radix4_scalar(n, q, re, im, tw);
+        tw += 4 * q;
+    }
+    if (q < n) {
+        cfft_radix2_scalar(n, re, im, tw);
+    }
+}
+#endif
+
+// Permute data into bit-reversed order, in place.
+static void cfft_bitrev(const struct ufxr_cfft *restrict f, float *restrict re,
+                        float *restrict im) {
+    const int n = f->n;
+    const int *restrict bitrev = f->bitrev;
+    for (int i = 0; i < n; i++) {
+        int j = bitrev[i];
+        if (i < j) {
+            float t = re[i];
+            re[i] = re[j];
+            re[j] = t;
+            t = im[i];
+            im[i] = im[j];
+            im[j] = t;
+        }
+    }
+}
+
+void ufxr_cfft_forward(const struct ufxr_cfft *restrict f, float *restrict re,
+                       float *restrict im) {
+    cfft_bitrev(f, re, im);
+    cfft_dit(f, re, im);
+}
+
+void ufxr_cfft_inverse(const struct ufxr_cfft *restrict f, float *restrict re,
+                       float *restrict im) {
+    cfft_bitrev(f, re, im);
+    cfft_dit(f, im, re);
+}
+
+// Separate the even and odd spectra after the forward complex FFT of the real
+// data, for bins k in [k0, m/2]. With A = Z[k] and B = conj(Z[m-k]), the even
+// spectrum is E = (A + B) / 2 and the odd spectrum is O = (A - B) / 2i. Then
+// X[k] = E + W^k O and X[m-k] = conj(E - W^k O).
+static inline void fft_split_scalar(int m, int k0, float *restrict re,
+                                    float *restrict im,
+                                    const float *restrict cr,
+                                    const float *restrict ci) {
+    for (int k = k0; k <= m / 2; k++) {
+        int k2 = m - k;
+        float ar = re[k], ai = im[k], br = re[k2], bi = -im[k2];
+        float er = 0.5f * (ar + br), ei = 0.5f * (ai + bi);
+        float odr = 0.5f * (ai - bi), odi = -0.5f * (ar - br);
+        float tr = odr * cr[k] - odi * ci[k];
+        float ti = odr * ci[k] + odi * cr[k];
+        re[k] = er + tr;
+        im[k] = ei + ti;
+        re[k2] = er - tr;
+        im[k2] = ti - ei;
+    }
+}
+
+// Undo the separation of the even and odd spectra, before the inverse complex
+// FFT, for bins k in [k0, m/2]. This is the inverse of fft_split, without the
+// factor of 1/2.
+static inline void fft_merge_scalar(int m, int k0, float *restrict re,
+                                    float *restrict im,
+                                    const float *restrict cr,
+                                    const float *restrict ci) {
+    for (int k = k0; k <= m / 2; k++) {
+        int k2 = m - k;
+        float ar = re[k], ai = im[k], br = re[k2], bi = -im[k2];
+        // E = X[k] + conj(X[m-k]), W^k O = X[k] - conj(X[m-k])
+        float er = ar + br, ei = ai + bi;
+        float dr = ar - br, di = ai - bi;
+        float odr = dr * cr[k] + di * ci[k];
+        float odi = di * cr[k] - dr * ci[k];
+        // Z[k] = E + iO, Z[m-k] = conj(E - iO)
+        re[k] = er - odi;
+        im[k] = ei + odr;
+        re[k2] = er + odi;
+        im[k2] = odr - ei;
+    }
+}
+
+#if USE_SSE2
+
+static inline __m128 fft_reverse(__m128 x) {
+    return _mm_shuffle_ps(x, x, _MM_SHUFFLE(0, 1, 2, 3));
+}
+
+// Process four bins at a time from each end of the spectrum, as long as the
+// two ends do not overlap.
+static inline void fft_split(int m, float *restrict re, float *restrict im,
+                             const float *restrict cr,
+                             const float *restrict ci) {
+    const __m128 half = _mm_set1_ps(0.5f), neg = _mm_set1_ps(-0.0f);
+    int k = 1;
+    for (; k + 4 <= m / 2; k += 4) {
+        int k2 = m - k - 3;
+        __m128 ar = _mm_loadu_ps(re + k), ai = _mm_loadu_ps(im + k);
+        __m128 br = fft_reverse(_mm_loadu_ps(re + k2));
+        __m128 bi = _mm_xor_ps(fft_reverse(_mm_loadu_ps(im + k2)), neg);
+        __m128 er = _mm_mul_ps(half, _mm_add_ps(ar, br));
+        __m128 ei = _mm_mul_ps(half, _mm_add_ps(ai, bi));
+        __m128 odr = _mm_mul_ps(half, _mm_sub_ps(ai, bi));
+        __m128 odi = _mm_mul_ps(half, _mm_sub_ps(br, ar));
+        __m128 c = _mm_loadu_ps(cr + k), s = _mm_loadu_ps(ci + k);
+        __m128 tr = _mm_sub_ps(_mm_mul_ps(odr, c), _mm_mul_ps(odi, s));
+        __m128 ti = _mm_add_ps(_mm_mul_ps(odr, s), _mm_mul_ps(odi, c));
+        _mm_storeu_ps(re + k, _mm_add_ps(er, tr));
+        _mm_storeu_ps(im + k, _mm_add_ps(ei, ti));
+        _mm_storeu_ps(re + k2, fft_reverse(_mm_sub_ps(er, tr)));
+        _mm_storeu_ps(im + k2, fft_reverse(_mm_sub_ps(ti, ei)));
+    }
+    fft_split_scalar(m, k, re, im, cr, ci);
+}
+
+static inline void fft_merge(int m, float *restrict re, float *restrict im,
+                             const float *restrict cr,
+                             const float *restrict ci) {
+    const __m128 neg = _mm_set1_ps(-0.0f);
+    int k = 1;
+    for (; k + 4 <= m / 2; k += 4) {
+        int k2 = m - k - 3;
+        __m128 ar = _mm_loadu_ps(re + k), ai = _mm_loadu_ps(im + k);
+        __m128 br = fft_reverse(_mm_loadu_ps(re + k2));
+        __m128 bi = _mm_xor_ps(fft_reverse(_mm_loadu_ps(im + k2)), neg);
+        __m128 er = _mm_add_ps(ar, br), ei = _mm_add_ps(ai, bi);
+        __m128 dr = _mm_sub_ps(ar, br), di = _mm_sub_ps(ai, bi);
+        __m128 c = _mm_loadu_ps(cr + k), s = _mm_loadu_ps(ci + k);
+        __m128 odr = _mm_add_ps(_mm_mul_ps(dr, c), _mm_mul_ps(di, s));
+        __m128 odi = _mm_sub_ps(_mm_mul_ps(di, c), _mm_mul_ps(dr, s));
+        _mm_storeu_ps(re + k, _mm_sub_ps(er, odi));
+        _mm_storeu_ps(im + k, _mm_add_ps(ei, odr));
+        _mm_storeu_ps(re + k2, fft_reverse(_mm_add_ps(er, odi)));
+        _mm_storeu_ps(im + k2, fft_reverse(_mm_sub_ps(odr, ei)));
+    }
+    fft_merge_scalar(m, k, re, im, cr, ci);
+}
+
+// Interleave real and imaginary parts.
+static inline void fft_interleave(int m, float *restrict out,
+                                  const float *restrict re,
+                                  const float *restrict im) {
+    for (int i = 0; i < m; i += 4) {
+        __m128 r = _mm_load_ps(re + i), c = _mm_load_ps(im + i);
+        _mm_store_ps(out + 2 * i, _mm_unpacklo_ps(r, c));
+        _mm_store_ps(out + 2 * i + 4, _mm_unpackhi_ps(r, c));
+    }
+}
+
+#else
+
+static inline void fft_split(int m, float *restrict re, float *restrict im,
+                             const float *restrict cr,
+                             const float *restrict ci) {
+    fft_split_scalar(m, 1, re, im, cr, ci);
+}
+
+static inline void fft_merge(int m, float *restrict re, float *restrict im,
+                             const float *restrict cr,
+                             const float *restrict ci) {
+    fft_merge_scalar(m, 1, re, im, cr, ci);
+}
+
+static inline void fft_interleave(int m, float *restrict out,
+                                  const float *restrict re,
+                                  const float *restrict im) {
+    for (int i = 0; i < m; i++) {
+        out[2 * i] = re[i];
+        out[2 * i + 1] = im[i];
+    }
+}
+
+#endif
+
+void ufxr_fft_forward(const struct ufxr_fft *restrict f, float *restrict out,
+                      const float *restrict in) {
+    const int n = f->n, m = n / 2;
+    const int *restrict bitrev = f->cfft.bitrev;
+    float *restrict re = out, *restrict im = out + m;
+    for (int i = 0; i < m; i++) {
+        int j = bitrev[i];
+        re[j] = in[2 * i];
+        im[j] = in[2 * i + 1];
+    }
+    cfft_dit(&f->cfft, re, im);
+    float r0 = re[0], i0 = im[0];
+    re[0] = r0 + i0;
+    im[0] = r0 - i0;
+    fft_split(m, re, im, f->twiddle, f->twiddle + m / 2 + 1);
+}
+
+void ufxr_fft_inverse(const struct ufxr_fft *restrict f, float *restrict out,
+                      float *restrict in) {
+    const int n = f->n, m = n / 2;
+    float *restrict re = in, *restrict im = in + m;
+    float x0 = re[0], xm = im[0];
+    re[0] = x0 + xm;
+    im[0] = x0 - xm;
+    fft_merge(m, re, im, f->twiddle, f->twiddle + m / 2 + 1);
+    cfft_bitrev(&f->cfft, re, im);
+    cfft_dit(&f->cfft, im, re);
+    fft_interleave(m, out, re, im);
+}
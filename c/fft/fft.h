@@ -0,0 +1,72 @@
+// c/fft/fft.h - Fast Fourier transform.
+#pragma once
+
+#include <stdbool.h>
+
+struct ufxr_error;
+
+// Complex data is stored in "split" format, as an array of real parts and a
+// separate array of imaginary parts. All arrays must be aligned to UFXR_ALIGN.
+//
+// Plans are not modified by transforms, and may be shared between threads.
+//
+// Transforms are not normalized: the inverse of the forward transform of x is
+// n * x.
+
+// A plan for computing the FFT of complex data with a given size.
+//
+// All fields are private. Do not access them.
+struct ufxr_cfft {
+    int n;
+    float *twiddle;
+    int *bitrev;
+};
+
+// A plan for computing the FFT of real data with a given size.
+//
+// Spectra of real data are stored as n floats: the real parts of bins 0..n/2-1
+// followed by the imaginary parts of the same bins. Bin 0 (DC) and bin n/2
+// (Nyquist) are both real, so the real part of the Nyquist bin is stored in
+// place of the imaginary part of bin 0.
+//
+// All fields are private. Do not access them.
+struct ufxr_fft {
+    int n;
+    struct ufxr_cfft cfft;
+    float *twiddle;
+};
+
+// Create an FFT plan for complex data of size n. The size must be a power of
+// two, at least 4. If successful, destroy() must be called to release
+// resources.
+bool ufxr_cfft_create(struct ufxr_cfft *restrict f, int n,
+                      struct ufxr_error *err);
+
+// Destroy an FFT plan and release any resources.
+void ufxr_cfft_destroy(struct ufxr_cfft *restrict f);
+
+// Compute the forward FFT of n complex values, in place.
+void ufxr_cfft_forward(const struct ufxr_cfft *restrict f, float *restrict re,
+                       float *restrict im);
+
+// Compute the inverse FFT of n complex values, in place.
+void ufxr_cfft_inverse(const struct ufxr_cfft *restrict f, float *restrict re,
+                       float *restrict im);
+
+// Create an FFT plan for real data of size n. The size must be a power of two,
+// at least 8. If successful, destroy() must be called to release resources.
+bool ufxr_fft_create(struct ufxr_fft *restrict f, int n,
+                     struct ufxr_error *err);
+
+// Destroy an FFT plan and release any resources.
+void ufxr_fft_destroy(struct ufxr_fft *restrict f);
+
+// Compute the forward FFT of n real samples. The output is a real spectrum,
+// described above.
+void ufxr_fft_forward(const struct ufxr_fft *restrict f, float *restrict out,
+                      const float *restrict in);
+
+// Compute the inverse FFT of a real spectrum, producing n real samples. The
+// input is used as scratch space and its contents are destroyed.
+void ufxr_fft_inverse(const struct ufxr_fft *restrict f, float *restrict out,
+                      float *restrict in);
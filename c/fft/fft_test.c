@@ -0,0 +1,152 @@
+#include "c/fft/fft.h"
+#include "c/io/error.h"
+#include "c/util/util.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+enum {
+    kMinSize = 4,
+    kMaxSize = 4096,
+};
+
+// Maximum error, relative to the largest value in the spectrum.
+static const double kMaxError = 1e-5;
+
+// Reference DFT of real data, in the same split format as the FFT. This is not
+// supposed to be fast, it is supposed to be obviously correct.
+static void dft(int n, double *restrict out, const float *restrict in) {
+    const double tau = 8.0 * atan(1.0);
+    for (int k = 0; k <= n / 2; k++) {
+        double re = 0.0, im = 0.0;
+        for (int i = 0; i < n; i++) {
+            double a = tau * (double)(((long)i * k) % n) / n;
+            re += (double)in[i] * cos(a);
+            im -= (double)in[i] * sin(a);
+        }
+        if (k == 0) {
+            out[0] = re;
+        } else if (k == n / 2) {
+            out[n / 2] = re;
+        } else {
+            out[k] = re;
+            out[n / 2 + k] = im;
+        }
+    }
+}
+
+static void random_fill(int n, float *restrict xs) {
+    unsigned state = 1;
+    for (int i = 0; i < n; i++) {
+        state = state * 1103515245u + 12345u;
+        xs[i] = (float)(state >> 8) * (1.0f / 16777216.0f) - 0.5f;
+    }
+}
+
+static bool test_complex(int n) {
+    struct ufxr_cfft f;
+    struct ufxr_error err;
+    if (!ufxr_cfft_create(&f, n, &err)) {
+        die(0, "ufxr_cfft_create");
+    }
+    float *xs = xmalloc(sizeof(float) * 2 * n);
+    float *ys = xmalloc(sizeof(float) * 2 * n);
+    double *ref = xmalloc(sizeof(double) * 2 * n);
+    random_fill(2 * n, xs);
+    for (int i = 0; i < 2 * n; i++) {
+        ys[i] = xs[i];
+    }
+    ufxr_cfft_forward(&f, ys, ys + n);
+    const double tau = 8.0 * atan(1.0);
+    for (int k = 0; k < n; k++) {
+        double re = 0.0, im = 0.0;
+        for (int i = 0; i < n; i++) {
+            double a = tau * (double)(((long)i * k) % n) / n;
+            double xr = xs[i], xi = xs[n + i];
+            re += xr * cos(a) + xi * sin(a);
+            im += xi * cos(a) - xr * sin(a);
+        }
+        ref[k] = re;
+        ref[n + k] = im;
+    }
+    double maxval = 0.0, maxerr = 0.0;
+    for (int i = 0; i < 2 * n; i++) {
+        double v = fabs(ref[i]), e = fabs(ref[i] - (double)ys[i]);
+        maxval = v > maxval ? v : maxval;
+        maxerr = e > maxerr ? e : maxerr;
+    }
+    double ferr = maxerr / maxval;
+    ufxr_cfft_inverse(&f, ys, ys + n);
+    maxerr = 0.0;
+    for (int i = 0; i < 2 * n; i++) {
+        double e = fabs((double)ys[i] / n - (double)xs[i]);
+        maxerr = e > maxerr ? e : maxerr;
+    }
+    double ierr = maxerr;
+    printf("Complex %5d: forward error %.2e, round trip error %.2e\n", n,
+           ferr, ierr);
+    ufxr_cfft_destroy(&f);
+    free(xs);
+    free(ys);
+    free(ref);
+    return ferr <= kMaxError && ierr <= kMaxError;
+}
+
+static bool test_real(int n) {
+    struct ufxr_fft f;
+    struct ufxr_error err;
+    if (!ufxr_fft_create(&f, n, &err)) {
+        die(0, "ufxr_fft_create");
+    }
+    float *xs = xmalloc(sizeof(float) * n);
+    float *ys = xmalloc(sizeof(float) * n);
+    float *zs = xmalloc(sizeof(float) * n);
+    double *ref = xmalloc(sizeof(double) * n);
+    random_fill(n, xs);
+    ufxr_fft_forward(&f, ys, xs);
+    dft(n, ref, xs);
+    double maxval = 0.0, maxerr = 0.0;
+    for (int i = 0; i < n; i++) {
+        double v = fabs(ref[i]), e = fabs(ref[i] - (double)ys[i]);
+        maxval = v > maxval ? v : maxval;
+        maxerr = e > maxerr ? e : maxerr;
+    }
+    double ferr = maxerr / maxval;
+    ufxr_fft_inverse(&f, zs, ys);
+    maxerr = 0.0;
+    for (int i = 0; i < n; i++) {
+        double e = fabs((double)zs[i] / n - (double)xs[i]);
+        maxerr = e > maxerr ? e : maxerr;
+    }
+    double ierr = maxerr;
+    printf("Real    %5d: forward error %.2e, round trip error %.2e\n", n, ferr,
+           ierr);
+    ufxr_fft_destroy(&f);
+    free(xs);
+    free(ys);
+    free(zs);
+    free(ref);
+    return ferr <= kMaxError && ierr <= kMaxError;
+}
+
+int main(int argc, char **argv) {
+    (void)argc;
+    (void)argv;
+    bool success = true;
+    puts("Testing: fft");
+    for (int n = kMinSize; n <= kMaxSize; n *= 2) {
+        if (!test_complex(n)) {
+            puts("****FAIL****");
+            success = false;
+        }
+        if (n >= 8 && !test_real(n)) {
+            puts("****FAIL****");
+            success = false;
+        }
+    }
+    if (!success) {
+        puts("****FAIL****");
+        exit(1);
+    }
+    return 0;
+}
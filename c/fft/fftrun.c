@@ -0,0 +1,293 @@
+#include "c/fft/fft.h"
+#include "c/io/error.h"
+#include "c/util/defs.h"
+#include "c/util/flag.h"
+#include "c/util/util.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define EXE_NAME "fftrun"
+
+enum {
+    kBenchmarkMinSize = 64,
+    kBenchmarkMaxSize = 65536,
+    // Number of samples to transform per run, for each size.
+    kBenchmarkSamples = 1 << 25,
+    kBenchmarkRuns = 1,
+};
+
+// Plans for one size.
+struct plans {
+    int n;
+    struct ufxr_cfft cfft;
+    struct ufxr_fft fft;
+};
+
+// Benchmark function. The input has 2n elements and must not be modified, the
+// output has 2n elements.
+typedef void (*func)(const struct plans *restrict p, float *restrict out,
+                     const float *restrict in);
+
+struct func_info {
+    char name[8];
+    func func;
+};
+
+// Complex transforms are in place, so they include a copy of the input. The
+// copy function measures the cost of that copy.
+static void run_copy(const struct plans *restrict p, float *restrict out,
+                     const float *restrict in) {
+    memcpy(out, in, sizeof(float) * 2 * p->n);
+}
+
+static void run_cfft(const struct plans *restrict p, float *restrict out,
+                     const float *restrict in) {
+    memcpy(out, in, sizeof(float) * 2 * p->n);
+    ufxr_cfft_forward(&p->cfft, out, out + p->n);
+}
+
+static void run_icfft(const struct plans *restrict p, float *restrict out,
+                      const float *restrict in) {
+    memcpy(out, in, sizeof(float) * 2 * p->n);
+    ufxr_cfft_inverse(&p->cfft, out, out + p->n);
+}
+
+static void run_rfft(const struct plans *restrict p, float *restrict out,
+                     const float *restrict in) {
+    ufxr_fft_forward(&p->fft, out, in);
+}
+
+// The inverse real transform destroys its input, so this includes a copy of
+// half the size of the complex copy.
+static void run_irfft(const struct plans *restrict p, float *restrict out,
+                      const float *restrict in) {
+    memcpy(out + p->n, in, sizeof(float) * p->n);
+    ufxr_fft_inverse(&p->fft, out, out + p->n);
+}
+
+#define F(f) \
+    { #f, run_##f }
+// clang-format off
+static const struct func_info kFuncs[] = {
+    F(cfft),
+    F(icfft),
+    F(rfft),
+    F(irfft),
+    F(copy),
+};
+// clang-format on
+#undef F
+
+static void help_benchmark(const char *name) {
+    xprintf(stdout, "\nUsage: %s [<pattern>] [<option>...]\n", name);
+    xputs(stdout,
+          "\n"
+          "Transforms:\n"
+          "  cfft   Complex forward FFT, plus copy\n"
+          "  icfft  Complex inverse FFT, plus copy\n"
+          "  rfft   Real forward FFT\n"
+          "  irfft  Real inverse FFT, plus half copy\n"
+          "  copy   Copy of complex data\n"
+          "\n"
+          "Options:\n"
+          "  -min <size>    Smallest transform size, default 64\n"
+          "  -max <size>    Largest transform size, default 65536\n"
+          "  -runs <count>  Number of benchmark runs\n"
+          "  -out <file>    Write results as CSV to <file>\n"
+          "\n"
+          "Times are reported in nanoseconds per sample.\n");
+}
+
+static double benchmark(const struct plans *restrict p, int iter, func f,
+                        const float *xs, float *ys) {
+    f(p, ys, xs); // Warm cache.
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &t0);
+    for (int i = 0; i < iter; i++) {
+        f(p, ys, xs);
+    }
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &t1);
+    return 1e9 * (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec);
+}
+
+static bool is_pow2(int n) {
+    return n > 0 && (n & (n - 1)) == 0;
+}
+
+static int exec_benchmark(int argc, char **argv) {
+    // Parse flags
+    int minsize = kBenchmarkMinSize;
+    int maxsize = kBenchmarkMaxSize;
+    int runs = kBenchmarkRuns;
+    const char *outfile = NULL;
+    flag_int(&minsize, "min", "minimum size");
+    flag_int(&maxsize, "max", "maximum size");
+    flag_int(&runs, "runs", "number of runs");
+    flag_string(&outfile, "out", "output file");
+    argc = flag_parse(argc, argv);
+    bool funcs[ARRAY_SIZE(kFuncs)]; // Which functions to benchmark.
+    for (size_t func = 0; func < ARRAY_SIZE(kFuncs); func++) {
+        funcs[func] = argc == 0;
+    }
+    for (int i = 0; i < argc; i++) {
+        bool found = false;
+        for (size_t func = 0; func < ARRAY_SIZE(kFuncs); func++) {
+            if (strcmp(kFuncs[func].name, argv[i]) == 0) {
+                found = true;
+                funcs[func] = true;
+                break;
+            }
+        }
+        if (!found) {
+            die_usagef("unknown transform %s", quote_str(argv[i]));
+        }
+    }
+    if (!is_pow2(minsize) || minsize < 8) {
+        die_usagef("invalid minimum size %d, must be a power of two >= 8",
+                   minsize);
+    }
+    if (!is_pow2(maxsize) || maxsize < minsize || maxsize > (1 << 24)) {
+        die_usagef("invalid maximum size %d", maxsize);
+    }
+    if (runs < 1) {
+        die_usage("run count must be positive");
+    }
+
+    // Execute
+    float *xs = xmalloc(sizeof(float) * 2 * maxsize);
+    float *ys = xmalloc(sizeof(float) * 2 * maxsize);
+    linspace(2 * maxsize, xs, -1.0f, 1.0f);
+    FILE *fp;
+    if (outfile == NULL) {
+        fp = stdout;
+    } else {
+        fp = fopen(outfile, "w");
+        if (fp == NULL) {
+            int ecode = errno;
+            dief(ecode, "could not open %s", quote_str(outfile));
+        }
+    }
+    xputs(fp, "Operator,TimeNS\n");
+    for (int run = 0; run < runs; run++) {
+        for (int n = minsize; n <= maxsize; n *= 2) {
+            struct plans p = {.n = n};
+            struct ufxr_error err;
+            if (!ufxr_cfft_create(&p.cfft, n, &err) ||
+                !ufxr_fft_create(&p.fft, n, &err)) {
+                die(0, "could not create FFT plan");
+            }
+            int iter = kBenchmarkSamples / n;
+            double samples = (double)iter * (double)n;
+            for (size_t func = 0; func < ARRAY_SIZE(kFuncs); func++) {
+                if (funcs[func]) {
+                    if (outfile != NULL) {
+                        fprintf(stderr, "\r\x1b[KBenchmark %d/%d %s %d",
+                                run + 1, runs, kFuncs[func].name, n);
+                        fflush(stderr);
+                    }
+                    double t = benchmark(&p, iter, kFuncs[func].func, xs, ys);
+                    xprintf(fp, "%s%d,%.3f\n", kFuncs[func].name, n,
+                            t / samples);
+                }
+            }
+            ufxr_cfft_destroy(&p.cfft);
+            ufxr_fft_destroy(&p.fft);
+        }
+    }
+    if (outfile != NULL) {
+        fputs("\r\x1b[K", stderr);
+        fflush(stderr);
+        if (fclose(fp) != 0) {
+            int ecode = errno;
+            dief(ecode, "error writing to %s", quote_str(outfile));
+        }
+    }
+    free(xs);
+    free(ys);
+    return 0;
+}
+
+static void help_help(const char *name);
+static int exec_help(int argc, char **argv);
+
+struct cmd_info {
+    const char *name;
+    const char *desc;
+    void (*help)(const char *name);
+    int (*exec)(int argc, char **argv);
+};
+
+static const struct cmd_info kCmds[] = {
+    {"benchmark", "Benchmark transforms", help_benchmark, exec_benchmark},
+    {"help", "Show help", help_help, exec_help},
+};
+
+static const struct cmd_info *find_cmd(const char *name) {
+    for (size_t i = 0; i < ARRAY_SIZE(kCmds); i++) {
+        if (strcmp(name, kCmds[i].name) == 0) {
+            return &kCmds[i];
+        }
+    }
+    die_usagef("no command named %s", quote_str(name));
+}
+
+static void usage(FILE *fp) {
+    xprintf(fp,
+            "%s: Execute UltraFXR FFTs\n"
+            "\n"
+            "Usage: %s <cmd> [<args>]\n"
+            "\n"
+            "Commands:\n",
+            EXE_NAME, EXE_NAME);
+    for (size_t i = 0; i < ARRAY_SIZE(kCmds); i++) {
+        xprintf(fp, "  %s: %s\n", kCmds[i].name, kCmds[i].desc);
+    }
+}
+
+static void help_cmd(const struct cmd_info *cmd) {
+    char fullname[64];
+    snprintf(fullname, sizeof(fullname), "%s %s", EXE_NAME, cmd->name);
+    xprintf(stdout, "%s: %s\n", fullname, cmd->desc);
+    cmd->help(fullname);
+}
+
+static void help_help(const char *name) {
+    xprintf(stdout, "\nUsage: %s [<topic>]\n", name);
+}
+
+static int exec_help(int argc, char **argv) {
+    if (argc <= 1) {
+        usage(stdout);
+    } else {
+        help_cmd(find_cmd(argv[1]));
+    }
+    return 0;
+}
+
+static bool is_help_flag(const char *arg) {
+    return strcmp(arg, "-h") == 0 || strcmp(arg, "-help") == 0 ||
+           strcmp(arg, "--help") == 0;
+}
+
+int main(int argc, char **argv) {
+    if (argc <= 1) {
+        usage(stderr);
+        return 64;
+    }
+    argc -= 1;
+    argv += 1;
+    const char *cmd = argv[0];
+    if (is_help_flag(cmd)) {
+        usage(stdout);
+        return 0;
+    }
+    const struct cmd_info *info = find_cmd(cmd);
+    if (argc >= 2 && is_help_flag(argv[1])) {
+        help_cmd(info);
+        return 0;
+    }
+    return info->exec(argc, argv);
+}
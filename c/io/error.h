@@ -12,6 +12,10 @@ typedef enum {
     kUFXRErrorInvalidArgument,
     // Too many samples (cannot write a file this long).
     kUFXRErrorTooLong,
+    // File is not a wave file, or uses an unsupported format.
+    kUFXRErrorBadWave,
+    // Bfxr parameters could not be parsed.
+    kUFXRErrorBadBfxr,
 } ufxr_errcode;
 
 struct ufxr_error {
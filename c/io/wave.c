@@ -169,9 +169,15 @@ bool ufxr_wavewriter_create(struct ufxr_wavewriter *restrict w,
         .riff_data_written = hlen - 8,
         .at_start = true,
     };
+    ufxr_dither_init(&w->dither, kUFXRDitherNone, info->channels, 1);
     return true;
 }
 
+void ufxr_wavewriter_setdither(struct ufxr_wavewriter *restrict w,
+                               ufxr_dithermode mode) {
+    ufxr_dither_init(&w->dither, mode, w->info.channels, 1);
+}
+
 void ufxr_wavewriter_destroy(struct ufxr_wavewriter *restrict w) {
     if (w->file) {
         close(w->file);
@@ -284,7 +290,7 @@ static bool ufxr_wavewriter_writeu8(struct ufxr_wavewriter *restrict w,
         size_t bufrem = end - pos;
         size_t datarem = dend - dpos;
         size_t n = bufrem < datarem ? bufrem : datarem;
-        ufxr_to_u8(n, pos, dpos);
+        ufxr_to_u8_dither(n, pos, dpos, &w->dither);
         pos += n;
         dpos += n;
     }
@@ -323,7 +329,7 @@ static bool ufxr_wavewriter_writes16(struct ufxr_wavewriter *restrict w,
         if (n > datarem) {
             n = datarem;
         }
-        ufxr_to_les16(n, pos, dpos);
+        ufxr_to_les16_dither(n, pos, dpos, &w->dither);
         pos += n * 2;
         dpos += n;
     }
@@ -431,6 +437,151 @@ static bool ufxr_wavewriter_writef32(struct ufxr_wavewriter *restrict w,
     return true;
 }
 
+bool ufxr_wavewriter_writeint16(struct ufxr_wavewriter *restrict w,
+                                const int16_t *restrict data, size_t count,
+                                struct ufxr_error *err) {
+    if (w->file == -1 || w->info.format != kUFXRFormatS16) {
+        ufxr_error_setcode(err, kUFXRErrorInvalidArgument);
+        return false;
+    }
+    unsigned riff_data_written;
+    if (__builtin_add_overflow(w->riff_data_written, count * 2,
+                               &riff_data_written)) {
+        ufxr_error_setcode(err, kUFXRErrorTooLong);
+        return false;
+    }
+    w->riff_data_written = riff_data_written;
+    w->samples_written += count;
+    const int16_t *dpos = data, *dend = dpos + count;
+    char *start = w->buffer, *pos = start + w->buffer_pos,
+         *end = start + w->buffer_size;
+    while (dpos < dend) {
+        if (pos == end) {
+            w->buffer_pos = end - start;
+            if (!ufxr_wavewriter_flush(w, err)) {
+                return false;
+            }
+            pos = start;
+        }
+        size_t bufrem = end - pos;
+        size_t datarem = dend - dpos;
+        size_t n = bufrem / 2;
+        // This should always be true, because we will always be at an even
+        // position in the buffer.
+        assert(n > 0);
+        if (n > datarem) {
+            n = datarem;
+        }
+        for (size_t i = 0; i < n; i++) {
+            put16(pos + i * 2, dpos[i]);
+        }
+        pos += n * 2;
+        dpos += n;
+    }
+    w->buffer_pos = pos - start;
+    return true;
+}
+
+// Convert planar stereo to the output format.
+static void ufxr_wavewriter_convertstereo(struct ufxr_wavewriter *restrict w,
+                                          size_t n, char *restrict out,
+                                          const float *restrict xs0,
+                                          const float *restrict xs1) {
+    switch (w->info.format) {
+    case kUFXRFormatU8:
+        ufxr_to_u8_dither_stereo(n, out, xs0, xs1, &w->dither);
+        break;
+    case kUFXRFormatS16:
+        ufxr_to_les16_dither_stereo(n, out, xs0, xs1, &w->dither);
+        break;
+    case kUFXRFormatS24:
+        ufxr_to_les24_stereo(n, out, xs0, xs1);
+        break;
+    case kUFXRFormatF32:
+        ufxr_to_lef32_stereo(n, out, xs0, xs1);
+        break;
+    default:
+        assert(0);
+    }
+}
+
+static bool ufxr_wavewriter_writestereo(struct ufxr_wavewriter *restrict w,
+                                        const float *restrict data0,
+                                        const float *restrict data1,
+                                        size_t count, struct ufxr_error *err) {
+    const size_t framesize = 2 * kUFXRWaveFormats[w->info.format].size;
+    unsigned riff_data_written;
+    if (__builtin_add_overflow(w->riff_data_written, count * framesize,
+                               &riff_data_written)) {
+        ufxr_error_setcode(err, kUFXRErrorTooLong);
+        return false;
+    }
+    w->riff_data_written = riff_data_written;
+    w->samples_written += count * 2;
+    size_t dpos = 0;
+    char *start = w->buffer, *pos = start + w->buffer_pos,
+         *end = start + w->buffer_size;
+    while (dpos < count) {
+        if (pos == end) {
+            w->buffer_pos = end - start;
+            if (!ufxr_wavewriter_flush(w, err)) {
+                return false;
+            }
+            pos = start;
+        }
+        size_t bufrem = end - pos;
+        size_t datarem = count - dpos;
+        size_t n = bufrem / framesize;
+        if (n > datarem) {
+            n = datarem;
+        }
+        ufxr_wavewriter_convertstereo(w, n, pos, data0 + dpos, data1 + dpos);
+        pos += n * framesize;
+        dpos += n;
+        if (dpos < count && pos < end) {
+            // A frame is split across the end of the buffer.
+            bufrem = end - pos;
+            char fdata[8];
+            ufxr_wavewriter_convertstereo(w, 1, fdata, data0 + dpos,
+                                          data1 + dpos);
+            dpos += 1;
+            memcpy(pos, fdata, bufrem);
+            w->buffer_pos = end - start;
+            if (!ufxr_wavewriter_flush(w, err)) {
+                return false;
+            }
+            pos = start;
+            memcpy(pos, fdata + bufrem, framesize - bufrem);
+            pos += framesize - bufrem;
+        }
+    }
+    w->buffer_pos = pos - start;
+    return true;
+}
+
+bool ufxr_wavewriter_writeplanar(struct ufxr_wavewriter *restrict w,
+                                 const float *const *data, size_t count,
+                                 struct ufxr_error *err) {
+    if (w->file == -1) {
+        ufxr_error_setcode(err, kUFXRErrorInvalidArgument);
+        return false;
+    }
+    switch (w->info.format) {
+    case kUFXRFormatU8:
+    case kUFXRFormatS16:
+    case kUFXRFormatS24:
+    case kUFXRFormatF32:
+        break;
+    default:
+        ufxr_error_setcode(err, kUFXRErrorInvalidArgument);
+        return false;
+    }
+    if (w->info.channels == 1) {
+        return ufxr_wavewriter_write(w, data[0], count, err);
+    }
+    return ufxr_wavewriter_writestereo(w, data[0], data[1], count, err);
+}
+
 bool ufxr_wavewriter_write(struct ufxr_wavewriter *restrict w,
                            const float *restrict data, size_t count,
                            struct ufxr_error *err) {
@@ -1,5 +1,10 @@
+#pragma once
+
+#include "c/convert/convert.h"
+
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 
 struct ufxr_error;
 
@@ -26,6 +31,18 @@ struct ufxr_waveinfo {
     unsigned length;
 };
 
+// A view of the audio data in a wave file, without copying it. Samples are
+// interleaved, in the file's sample format, little-endian, and not aligned.
+struct ufxr_wavespan {
+    const void *data;
+    // Number of channels, 1 or 2.
+    int channels;
+    // Sample format.
+    ufxr_format format;
+    // Length, in frames. Each frame has one sample for each channel.
+    size_t length;
+};
+
 // A wave file for writing audio.
 //
 // All fields are private. Do not access them.
@@ -39,6 +56,7 @@ struct ufxr_wavewriter {
     unsigned samples_written;
     unsigned riff_data_written;
     bool at_start;
+    struct ufxr_dither dither;
 };
 
 // Create a wave file for writing. If successful, destroy() must be called to
@@ -56,7 +74,83 @@ void ufxr_wavewriter_destroy(struct ufxr_wavewriter *restrict w);
 bool ufxr_wavewriter_finish(struct ufxr_wavewriter *restrict w,
                             struct ufxr_error *err);
 
-// Write audio data to the wave file.
+// Set the dither used when writing 8-bit and 16-bit samples. The default is
+// no dither. Other formats are not dithered.
+void ufxr_wavewriter_setdither(struct ufxr_wavewriter *restrict w,
+                               ufxr_dithermode mode);
+
+// Write audio data to the wave file. The data is interleaved, and the count is
+// the number of samples, including all channels.
 bool ufxr_wavewriter_write(struct ufxr_wavewriter *restrict w,
                            const float *restrict data, size_t count,
                            struct ufxr_error *err);
+
+// Write 16-bit integer samples to a wave file with the S16 format, without
+// conversion. The data is interleaved, and the count is the number of samples,
+// including all channels. This accepts the output of the Q15 operators.
+bool ufxr_wavewriter_writeint16(struct ufxr_wavewriter *restrict w,
+                                const int16_t *restrict data, size_t count,
+                                struct ufxr_error *err);
+
+// Write planar audio data to the wave file. There is one array for each
+// channel, and the count is the number of frames. The samples are interleaved
+// as they are converted, so the caller does not need to interleave them
+// first.
+bool ufxr_wavewriter_writeplanar(struct ufxr_wavewriter *restrict w,
+                                 const float *const *data, size_t count,
+                                 struct ufxr_error *err);
+
+// A wave file for reading audio. The file is memory-mapped and samples are
+// accessed directly from the mapping, so only the pages which are accessed are
+// read from disk.
+//
+// All fields are private. Do not access them.
+struct ufxr_wavereader {
+    struct ufxr_waveinfo info;
+    struct ufxr_wavespan span;
+    void *map;
+    size_t mapsize;
+    size_t pos;
+};
+
+// Open a wave file for reading. If successful, destroy() must be called to
+// release resources. Returns kUFXRErrorBadWave if the file is not a valid wave
+// file or uses an unsupported format.
+//
+// Both RIFF and RF64 files are supported, with a format chunk which is either
+// plain or WAVE_FORMAT_EXTENSIBLE. Samples with fewer valid bits than their
+// container, like 20 bits in 24, are read as if they used the full container.
+bool ufxr_wavereader_create(struct ufxr_wavereader *restrict r,
+                            const char *path, struct ufxr_error *err);
+
+// Destroy the wave file reader and unmap the file. Spans obtained from the
+// reader may no longer be used.
+void ufxr_wavereader_destroy(struct ufxr_wavereader *restrict r);
+
+// Get the wave file metadata. The length is exact, limited to UINT_MAX.
+struct ufxr_waveinfo ufxr_wavereader_info(
+    const struct ufxr_wavereader *restrict r);
+
+// Get a view of the audio data. The view remains valid until the reader is
+// destroyed.
+struct ufxr_wavespan ufxr_wavereader_span(
+    const struct ufxr_wavereader *restrict r);
+
+// Read samples from the wave file, converted to floating-point, starting where
+// the previous read stopped. The data is interleaved, and the count is the
+// number of samples, including all channels. The data must be aligned to
+// UFXR_ALIGN. Returns the number of samples read, which is less than count at
+// the end of the file.
+size_t ufxr_wavereader_read(struct ufxr_wavereader *restrict r,
+                            float *restrict data, size_t count);
+
+// Set the position of the next read, in frames. Positions past the end of the
+// file are moved to the end.
+void ufxr_wavereader_seek(struct ufxr_wavereader *restrict r, size_t frame);
+
+// Convert samples from a span to floating-point. The position and count are
+// in samples, including all channels, and the output is interleaved. The data
+// must be aligned to UFXR_ALIGN. Returns the number of samples converted,
+// which is less than count at the end of the span.
+size_t ufxr_wavespan_decode(const struct ufxr_wavespan *restrict span,
+                            size_t pos, float *restrict data, size_t count);
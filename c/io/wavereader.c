@@ -0,0 +1,265 @@
+#include "c/io/wave.h"
+
+#include "c/io/error.h"
+
+#include <fcntl.h>
+#include <limits.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Read little-endian integers from unaligned data.
+static inline unsigned get16(const unsigned char *ptr) {
+    return (unsigned)ptr[0] | (unsigned)ptr[1] << 8;
+}
+
+static inline unsigned get32(const unsigned char *ptr) {
+    return (unsigned)ptr[0] | (unsigned)ptr[1] << 8 |
+           (unsigned)ptr[2] << 16 | (unsigned)ptr[3] << 24;
+}
+
+static inline uint64_t get64(const unsigned char *ptr) {
+    return (uint64_t)get32(ptr) | (uint64_t)get32(ptr + 4) << 32;
+}
+
+// WAVE_FORMAT_EXTENSIBLE stores the format tag in the first two bytes of a
+// GUID, followed by these bytes.
+static const unsigned char kWaveSubformat[14] = {
+    0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x80,
+    0x00, 0x00, 0xaa, 0x00, 0x38, 0x9b, 0x71,
+};
+
+// Size of a chunk. In RF64 files, chunks larger than 4 GiB have a size of
+// 0xffffffff, and the real size is in the ds64 chunk, which has the RIFF size,
+// data size, and sample count, followed by a table of other chunk sizes. The
+// table must already be checked against the size of the ds64 chunk.
+static uint64_t ufxr_wavereader_chunksize(const unsigned char *restrict chunk,
+                                          const unsigned char *restrict ds64) {
+    const unsigned size = get32(chunk + 4);
+    if (ds64 == NULL || size != 0xffffffff) {
+        return size;
+    }
+    if (memcmp(chunk, "data", 4) == 0) {
+        return get64(ds64 + 8);
+    }
+    const unsigned table = get32(ds64 + 24);
+    for (unsigned i = 0; i < table; i++) {
+        const unsigned char *entry = ds64 + 28 + 12 * i;
+        if (memcmp(entry, chunk, 4) == 0) {
+            return get64(entry + 4);
+        }
+    }
+    return size;
+}
+
+// Decoder and sample size for each format.
+struct ufxr_wavedecoder {
+    void (*decode)(int n, float *restrict outs, const void *restrict data);
+    unsigned size;
+};
+
+static const struct ufxr_wavedecoder kUFXRWaveDecoders[] = {
+    [kUFXRFormatU8] = {.decode = ufxr_from_u8, .size = 1},
+    [kUFXRFormatS16] = {.decode = ufxr_from_les16, .size = 2},
+    [kUFXRFormatS24] = {.decode = ufxr_from_les24, .size = 3},
+    [kUFXRFormatF32] = {.decode = ufxr_from_lef32, .size = 4},
+};
+
+enum {
+    // Maximum number of samples decoded per call to a decoder, which keeps the
+    // count in range of an int. This is a multiple of UFXR_QUANTUM, so each
+    // block of output stays aligned.
+    kUFXRWaveDecodeBlock = 1 << 20,
+};
+
+// Parse the wave file headers, and fill in the metadata and data span. Returns
+// false if the file is not a supported wave file.
+static bool ufxr_wavereader_parse(struct ufxr_wavereader *restrict r) {
+    const unsigned char *start = r->map, *end = start + r->mapsize;
+    if (r->mapsize < 12 || memcmp(start + 8, "WAVE", 4) != 0) {
+        return false;
+    }
+    // RF64 and BW64 files have a ds64 chunk first, with 64-bit sizes.
+    bool rf64;
+    if (memcmp(start, "RIFF", 4) == 0) {
+        rf64 = false;
+    } else if (memcmp(start, "RF64", 4) == 0 ||
+               memcmp(start, "BW64", 4) == 0) {
+        rf64 = true;
+    } else {
+        return false;
+    }
+    // The RIFF size is ignored, since it is often wrong for files which were
+    // not finished.
+    const unsigned char *fmt = NULL, *data = NULL, *ds64 = NULL;
+    size_t fmtsize = 0, datasize = 0;
+    for (const unsigned char *ptr = start + 12; end - ptr >= 8;) {
+        const unsigned char *body = ptr + 8;
+        const size_t avail = end - body;
+        if (rf64 && ptr == start + 12) {
+            const size_t size = get32(ptr + 4);
+            if (memcmp(ptr, "ds64", 4) != 0 || size < 28 || size > avail ||
+                get32(body + 24) > (size - 28) / 12) {
+                return false;
+            }
+            ds64 = body;
+        }
+        const uint64_t size = ufxr_wavereader_chunksize(ptr, ds64);
+        if (memcmp(ptr, "fmt ", 4) == 0) {
+            if (size < 16 || size > avail) {
+                return false;
+            }
+            fmt = body;
+            fmtsize = size;
+        } else if (memcmp(ptr, "data", 4) == 0) {
+            // Truncated files have less data than the header says.
+            data = body;
+            datasize = size < avail ? size : avail;
+            break;
+        }
+        if (size >= avail) {
+            break;
+        }
+        // Chunks are padded to an even size.
+        ptr = body + size + (size & 1);
+    }
+    if (fmt == NULL || data == NULL) {
+        return false;
+    }
+    unsigned tag = get16(fmt);
+    const unsigned channels = get16(fmt + 2), samplerate = get32(fmt + 4),
+                   blocksize = get16(fmt + 12), bits = get16(fmt + 14);
+    if (tag == 0xfffe) {
+        // WAVE_FORMAT_EXTENSIBLE. The number of valid bits may be less than
+        // the container size, but the samples are left-justified, so they are
+        // decoded as if the container were full. The channel mask is ignored.
+        if (fmtsize < 40 || get16(fmt + 16) < 22 || get16(fmt + 18) > bits ||
+            memcmp(fmt + 26, kWaveSubformat, sizeof(kWaveSubformat)) != 0) {
+            return false;
+        }
+        tag = get16(fmt + 24);
+    }
+    ufxr_format format;
+    if (tag == 1 && bits == 8) {
+        format = kUFXRFormatU8;
+    } else if (tag == 1 && bits == 16) {
+        format = kUFXRFormatS16;
+    } else if (tag == 1 && bits == 24) {
+        format = kUFXRFormatS24;
+    } else if (tag == 3 && bits == 32) {
+        format = kUFXRFormatF32;
+    } else {
+        return false;
+    }
+    if (channels < 1 || channels > 2 || samplerate < 1 ||
+        samplerate > INT_MAX || blocksize != channels * (bits / 8)) {
+        return false;
+    }
+    const size_t length = datasize / blocksize;
+    r->info = (struct ufxr_waveinfo){
+        .samplerate = samplerate,
+        .channels = channels,
+        .format = format,
+        .length = length < UINT_MAX ? length : UINT_MAX,
+    };
+    r->span = (struct ufxr_wavespan){
+        .data = data,
+        .channels = channels,
+        .format = format,
+        .length = length,
+    };
+    return true;
+}
+
+bool ufxr_wavereader_create(struct ufxr_wavereader *restrict r,
+                            const char *path, struct ufxr_error *err) {
+    int file = open(path, O_RDONLY);
+    if (file == -1) {
+        ufxr_error_seterrno(err);
+        return false;
+    }
+    struct stat st;
+    if (fstat(file, &st) == -1) {
+        ufxr_error_seterrno(err);
+        close(file);
+        return false;
+    }
+    if (st.st_size < 12) {
+        ufxr_error_setcode(err, kUFXRErrorBadWave);
+        close(file);
+        return false;
+    }
+    // The mapping remains valid after the file is closed. Pages are read on
+    // first access.
+    size_t size = st.st_size;
+    void *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, file, 0);
+    if (map == MAP_FAILED) {
+        ufxr_error_seterrno(err);
+        close(file);
+        return false;
+    }
+    close(file);
+    *r = (struct ufxr_wavereader){
+        .map = map,
+        .mapsize = size,
+    };
+    if (!ufxr_wavereader_parse(r)) {
+        ufxr_error_setcode(err, kUFXRErrorBadWave);
+        ufxr_wavereader_destroy(r);
+        return false;
+    }
+    return true;
+}
+
+void ufxr_wavereader_destroy(struct ufxr_wavereader *restrict r) {
+    if (r->map != NULL) {
+        munmap(r->map, r->mapsize);
+        r->map = NULL;
+    }
+}
+
+struct ufxr_waveinfo ufxr_wavereader_info(
+    const struct ufxr_wavereader *restrict r) {
+    return r->info;
+}
+
+struct ufxr_wavespan ufxr_wavereader_span(
+    const struct ufxr_wavereader *restrict r) {
+    return r->span;
+}
+
+size_t ufxr_wavespan_decode(const struct ufxr_wavespan *restrict span,
+                            size_t pos, float *restrict data, size_t count) {
+    const size_t total = span->length * span->channels;
+    if (pos >= total) {
+        return 0;
+    }
+    if (count > total - pos) {
+        count = total - pos;
+    }
+    const struct ufxr_wavedecoder *d = &kUFXRWaveDecoders[span->format];
+    const unsigned char *src = span->data;
+    src += pos * d->size;
+    for (size_t i = 0; i < count;) {
+        const size_t n = count - i < kUFXRWaveDecodeBlock
+                             ? count - i
+                             : (size_t)kUFXRWaveDecodeBlock;
+        d->decode((int)n, data + i, src + i * d->size);
+        i += n;
+    }
+    return count;
+}
+
+size_t ufxr_wavereader_read(struct ufxr_wavereader *restrict r,
+                            float *restrict data, size_t count) {
+    const size_t n = ufxr_wavespan_decode(&r->span, r->pos, data, count);
+    r->pos += n;
+    return n;
+}
+
+void ufxr_wavereader_seek(struct ufxr_wavereader *restrict r, size_t frame) {
+    r->pos = (frame < r->span.length ? frame : r->span.length) *
+             r->span.channels;
+}
@@ -100,6 +100,8 @@ def main(argv):
                    action='store_true')
     p.add_argument('--runs', type=int, help='Number of benchmark runs')
     p.add_argument('--size', type=int, help='Size of array')
+    p.add_argument('--max', type=int,
+                   help='Repeat with sizes doubling up to this size')
     p.add_argument('--iter', type=int, help='Number of iterations per run')
     p.add_argument('--impl', choices={'vector', 'scalar'},
                    default='vector', help='Operator implementation')
@@ -113,6 +115,8 @@ def main(argv):
         bench_args.append('-iter={}'.format(args.iter))
     if args.size is not None:
         bench_args.append('-size={}'.format(args.size))
+    if args.max is not None:
+        bench_args.append('-max={}'.format(args.max))
 
     here = pathlib.Path(__file__).parent
     ref = here / 'bench_ref.csv'
@@ -0,0 +1,141 @@
+// f16.c - Half-precision storage.
+#include "c/ops/impl.h"
+
+#include <string.h>
+
+// Number of samples converted at a time by the op wrappers. The block is kept
+// in L1 cache, so the full-precision data is never written to memory.
+enum {
+    kF16Block = 256,
+};
+
+// F16C version.
+#if !HAVE_FUNC && USE_F16C && USE_AVX
+#define HAVE_FUNC 1
+#include <immintrin.h>
+void ufxr_f16_load(int n, float *restrict outs, const ufxr_f16 *restrict xs) {
+    CHECK2(n, outs, xs);
+    int i = 0;
+    for (; n - i >= 8; i += 8) {
+        __m128i h = _mm_load_si128((const void *)(xs + i));
+        _mm256_storeu_ps(outs + i, _mm256_cvtph_ps(h));
+    }
+    if (i < n) {
+        __m128i h = _mm_loadl_epi64((const void *)(xs + i));
+        _mm_store_ps(outs + i, _mm_cvtph_ps(h));
+    }
+}
+
+void ufxr_f16_store(int n, ufxr_f16 *restrict outs, const float *restrict xs) {
+    CHECK2(n, outs, xs);
+    int i = 0;
+    for (; n - i >= 8; i += 8) {
+        __m256 x = _mm256_loadu_ps(xs + i);
+        _mm_store_si128((void *)(outs + i),
+                        _mm256_cvtps_ph(x, _MM_FROUND_TO_NEAREST_INT));
+    }
+    if (i < n) {
+        __m128 x = _mm_load_ps(xs + i);
+        _mm_storel_epi64((void *)(outs + i),
+                         _mm_cvtps_ph(x, _MM_FROUND_TO_NEAREST_INT));
+    }
+}
+#endif
+
+// Scalar version.
+#if !HAVE_FUNC
+#include <math.h>
+
+static inline float f16_to_f32(ufxr_f16 h) {
+    const uint32_t sign = (uint32_t)(h & 0x8000) << 16;
+    const uint32_t exponent = (h >> 10) & 0x1f, mantissa = h & 0x3ff;
+    uint32_t u;
+    if (exponent == 0) {
+        // Zero or subnormal.
+        const float x = (float)mantissa * 0x1p-24f;
+        memcpy(&u, &x, 4);
+    } else if (exponent == 31) {
+        // Infinity or NaN.
+        u = 0x7f800000 | mantissa << 13;
+    } else {
+        u = (exponent + 112) << 23 | mantissa << 13;
+    }
+    u |= sign;
+    float x;
+    memcpy(&x, &u, 4);
+    return x;
+}
+
+// Round to nearest, with ties to even, like F16C.
+static inline ufxr_f16 f32_to_f16(float x) {
+    uint32_t u;
+    memcpy(&u, &x, 4);
+    const uint32_t sign = (u >> 16) & 0x8000, a = u & 0x7fffffff;
+    if (a > 0x7f800000) {
+        // NaN. Make it quiet and keep the high bits of the payload.
+        return sign | 0x7e00 | ((a >> 13) & 0x3ff);
+    }
+    if (a >= 0x477ff000) {
+        // Infinity, or rounds to infinity.
+        return sign | 0x7c00;
+    }
+    if (a >= 0x38800000) {
+        // Normal. A carry out of the mantissa correctly increments the
+        // exponent.
+        return sign | ((a - 0x38000000 + 0xfff + ((a >> 13) & 1)) >> 13);
+    }
+    // Subnormal or zero. Scaling to units of the smallest subnormal is exact.
+    float y;
+    const uint32_t ya = a;
+    memcpy(&y, &ya, 4);
+    return sign | (uint32_t)lrintf(y * 0x1p24f);
+}
+
+void ufxr_f16_load(int n, float *restrict outs, const ufxr_f16 *restrict xs) {
+    CHECK2(n, outs, xs);
+    for (int i = 0; i < n; i++) {
+        outs[i] = f16_to_f32(xs[i]);
+    }
+}
+
+void ufxr_f16_store(int n, ufxr_f16 *restrict outs, const float *restrict xs) {
+    CHECK2(n, outs, xs);
+    for (int i = 0; i < n; i++) {
+        outs[i] = f32_to_f16(xs[i]);
+    }
+}
+#endif
+
+void ufxr_op_hh(ufxr_op op, int n, ufxr_f16 *restrict outs,
+                const ufxr_f16 *restrict xs) {
+    CHECK2(n, outs, xs);
+    _Alignas(32) float x[kF16Block], y[kF16Block];
+    for (int i = 0; i < n; i += kF16Block) {
+        const int m = n - i < kF16Block ? n - i : kF16Block;
+        ufxr_f16_load(m, x, xs + i);
+        op(m, y, x);
+        ufxr_f16_store(m, outs + i, y);
+    }
+}
+
+void ufxr_op_hf(ufxr_op op, int n, float *restrict outs,
+                const ufxr_f16 *restrict xs) {
+    CHECK2(n, outs, xs);
+    _Alignas(32) float x[kF16Block];
+    for (int i = 0; i < n; i += kF16Block) {
+        const int m = n - i < kF16Block ? n - i : kF16Block;
+        ufxr_f16_load(m, x, xs + i);
+        op(m, outs + i, x);
+    }
+}
+
+void ufxr_op_fh(ufxr_op op, int n, ufxr_f16 *restrict outs,
+                const float *restrict xs) {
+    CHECK2(n, outs, xs);
+    _Alignas(32) float y[kF16Block];
+    for (int i = 0; i < n; i += kF16Block) {
+        const int m = n - i < kF16Block ? n - i : kF16Block;
+        op(m, y, xs + i);
+        ufxr_f16_store(m, outs + i, y);
+    }
+}
@@ -0,0 +1,63 @@
+// fpstate.c - Floating-point control state.
+#include "c/ops/impl.h"
+
+// SSE version. This is also used with the scalar operators, since scalar math
+// on x86-64 is done with SSE and is controlled by the same register.
+#if !HAVE_FUNC && __SSE__
+#define HAVE_FUNC 1
+#include <xmmintrin.h>
+
+// Flush-to-zero (bit 15) and denormals-are-zero (bit 6) in MXCSR.
+#define FPSTATE_FLUSH 0x8040u
+
+void ufxr_fpstate_ftz(struct ufxr_fpstate *restrict saved) {
+    const unsigned csr = _mm_getcsr();
+    saved->flags = csr & FPSTATE_FLUSH;
+    _mm_setcsr(csr | FPSTATE_FLUSH);
+}
+
+void ufxr_fpstate_restore(const struct ufxr_fpstate *restrict saved) {
+    // Keep the exception flags and rounding mode as they are now.
+    _mm_setcsr((_mm_getcsr() & ~FPSTATE_FLUSH) | saved->flags);
+}
+#endif
+
+// AArch64 version. The FZ bit in FPCR does the work of both FTZ and DAZ.
+#if !HAVE_FUNC && __aarch64__
+#define HAVE_FUNC 1
+#include <stdint.h>
+
+#define FPSTATE_FLUSH ((uint64_t)1 << 24)
+
+static inline uint64_t fpcr_get(void) {
+    uint64_t x;
+    __asm__ volatile("mrs %0, fpcr" : "=r"(x));
+    return x;
+}
+
+static inline void fpcr_set(uint64_t x) {
+    __asm__ volatile("msr fpcr, %0" : : "r"(x));
+}
+
+void ufxr_fpstate_ftz(struct ufxr_fpstate *restrict saved) {
+    const uint64_t fpcr = fpcr_get();
+    saved->flags = (fpcr & FPSTATE_FLUSH) != 0;
+    fpcr_set(fpcr | FPSTATE_FLUSH);
+}
+
+void ufxr_fpstate_restore(const struct ufxr_fpstate *restrict saved) {
+    const uint64_t fpcr = fpcr_get() & ~FPSTATE_FLUSH;
+    fpcr_set(saved->flags != 0 ? fpcr | FPSTATE_FLUSH : fpcr);
+}
+#endif
+
+// Other targets. Subnormals are left alone.
+#if !HAVE_FUNC
+void ufxr_fpstate_ftz(struct ufxr_fpstate *restrict saved) {
+    saved->flags = 0;
+}
+
+void ufxr_fpstate_restore(const struct ufxr_fpstate *restrict saved) {
+    (void)saved;
+}
+#endif
@@ -34,3 +34,10 @@ noreturn void ufxr_check_align_fail(const void *ptr);
         CHECK_ALIGN_(x1); \
         CHECK_ALIGN_(x2); \
     } while (0)
+#define CHECK3(n, x1, x2, x3) \
+    do {                      \
+        CHECK_SIZE_(n);       \
+        CHECK_ALIGN_(x1);     \
+        CHECK_ALIGN_(x2);     \
+        CHECK_ALIGN_(x3);     \
+    } while (0)
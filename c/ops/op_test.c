@@ -5,6 +5,7 @@
 
 #include <math.h>
 #include <stdlib.h>
+#include <string.h>
 
 // Calculate exponential function error in cents.
 static float exp2_err(int n, const float *restrict ys,
@@ -94,6 +95,314 @@ static const struct func_info kFuncs[] = {
 // Extra margin for error, a ratio.
 static const float kErrorMargin = 0.005f;
 
+// Reference conversion from half precision, using the definition of the
+// format.
+static float f16_value(unsigned h) {
+    const unsigned exponent = (h >> 10) & 0x1f, mantissa = h & 0x3ff;
+    double x;
+    if (exponent == 0) {
+        x = ldexp(mantissa, -24);
+    } else if (exponent == 31) {
+        x = mantissa == 0 ? INFINITY : NAN;
+    } else {
+        x = ldexp(mantissa + 1024, (int)exponent - 25);
+    }
+    return (float)((h & 0x8000) != 0 ? -x : x);
+}
+
+// Test half-precision conversion. Every half-precision value must convert to
+// single precision exactly and back. Values between two half-precision values
+// must round to the nearer, with ties going to the even one.
+static bool test_f16(void) {
+    enum {
+        // Test values per half-precision value: the value, just below and
+        // exactly at the midpoint to the next, and just above the midpoint.
+        kPerValue = 4,
+        kCount = 0x7c00 * 2 * kPerValue,
+    };
+    puts("Testing: f16");
+    ufxr_f16 *hs = xmalloc(sizeof(ufxr_f16) * 0x10000);
+    float *xs = xmalloc(sizeof(float) * kCount);
+    ufxr_f16 *expect = xmalloc(sizeof(ufxr_f16) * kCount);
+    ufxr_f16 *out = xmalloc(sizeof(ufxr_f16) * kCount);
+    int failures = 0;
+
+    for (unsigned h = 0; h < 0x10000; h++) {
+        hs[h] = h;
+    }
+    float *ys = xmalloc(sizeof(float) * 0x10000);
+    ufxr_f16_load(0x10000, ys, hs);
+    for (unsigned h = 0; h < 0x10000; h++) {
+        const float ref = f16_value(h);
+        const bool ok =
+            isnan(ref) ? isnan(ys[h]) : memcmp(&ref, &ys[h], 4) == 0;
+        if (!ok) {
+            if (failures < 10) {
+                printf("load 0x%04x: got %g, expect %g\n", h, (double)ys[h],
+                       (double)ref);
+            }
+            failures++;
+        }
+    }
+    free(ys);
+
+    // Finite values, and the values between them. The midpoint of two
+    // adjacent half-precision values is exact in single precision.
+    int n = 0;
+    for (unsigned h = 0; h < 0x7c00; h++) {
+        for (unsigned sign = 0; sign <= 0x8000; sign += 0x8000) {
+            const float x = f16_value(h | sign);
+            // Above the largest finite value, the next value is infinity.
+            const float next =
+                h == 0x7bff ? 65536.0f : fabsf(f16_value(h + 1));
+            const float mid = (fabsf(x) + next) * 0.5f;
+            const float s = sign != 0 ? -1.0f : 1.0f;
+            const unsigned even = (h & 1) == 0 ? h : h + 1;
+            xs[n] = x;
+            expect[n++] = h | sign;
+            xs[n] = s * nextafterf(mid, 0.0f);
+            expect[n++] = h | sign;
+            xs[n] = s * mid;
+            expect[n++] = even | sign;
+            xs[n] = s * nextafterf(mid, INFINITY);
+            expect[n++] = (h + 1) | sign;
+        }
+    }
+    ufxr_f16_store(n, out, xs);
+    for (int i = 0; i < n; i++) {
+        if (out[i] != expect[i]) {
+            if (failures < 10) {
+                printf("store %.9g: got 0x%04x, expect 0x%04x\n",
+                       (double)xs[i], out[i], expect[i]);
+            }
+            failures++;
+        }
+    }
+
+    // The wrappers must match separate conversions.
+    ufxr_f16 *ref = xmalloc(sizeof(ufxr_f16) * kCount);
+    float *tmp = xmalloc(sizeof(float) * kCount);
+    float *tmp2 = xmalloc(sizeof(float) * kCount);
+    const int m = 1000;
+    linspace(m, tmp, -5.0f, 5.0f);
+    ufxr_f16_store(m, out, tmp);
+    ufxr_f16_load(m, tmp, out);
+    ufxr_tri(m, tmp2, tmp);
+    ufxr_f16_store(m, ref, tmp2);
+    ufxr_op_hh(ufxr_tri, m, expect, out);
+    if (memcmp(ref, expect, sizeof(ufxr_f16) * m) != 0) {
+        puts("ufxr_op_hh: incorrect output");
+        failures++;
+    }
+    ufxr_op_hf(ufxr_tri, m, tmp, out);
+    if (memcmp(tmp, tmp2, sizeof(float) * m) != 0) {
+        puts("ufxr_op_hf: incorrect output");
+        failures++;
+    }
+    ufxr_op_fh(ufxr_tri, m, expect, tmp);
+    ufxr_tri(m, tmp2, tmp);
+    ufxr_f16_store(m, ref, tmp2);
+    if (memcmp(ref, expect, sizeof(ufxr_f16) * m) != 0) {
+        puts("ufxr_op_fh: incorrect output");
+        failures++;
+    }
+
+    printf("Failures: %d\n", failures);
+    free(hs);
+    free(xs);
+    free(expect);
+    free(out);
+    free(ref);
+    free(tmp);
+    free(tmp2);
+    if (failures != 0) {
+        puts("****FAIL****");
+        return false;
+    }
+    putc('\n', stdout);
+    return true;
+}
+
+// Test fixed-point operators. The elementwise operators are tested with every
+// input, against the floating-point versions or exact arithmetic.
+static bool test_q15(void) {
+    enum {
+        kCount = 0x10000,
+        // Odd lengths, to test the tail of each function.
+        kOscCount = 1000 + UFXR_QUANTUM,
+    };
+    puts("Testing: q15");
+    ufxr_q15 *xs = xmalloc(sizeof(ufxr_q15) * kCount);
+    ufxr_q15 *ys = xmalloc(sizeof(ufxr_q15) * kCount);
+    ufxr_q15 *out = xmalloc(sizeof(ufxr_q15) * kCount);
+    float *fx = xmalloc(sizeof(float) * kCount);
+    float *fy = xmalloc(sizeof(float) * kCount);
+    bool success = true;
+    for (int i = 0; i < kCount; i++) {
+        xs[i] = (ufxr_q15)(i - 32768);
+        fx[i] = (float)(i - 32768) * (1.0f / 65536.0f);
+    }
+
+    static const struct {
+        const char *name;
+        void (*func)(int n, ufxr_q15 *restrict outs,
+                     const ufxr_q15 *restrict xs);
+        void (*ref)(int n, float *restrict outs, const float *restrict xs);
+        int error;
+    } kElementwise[] = {
+        {"tri_q15", ufxr_tri_q15, ufxr_tri, 1},
+        {"sin1_2_q15", ufxr_sin1_2_q15, ufxr_sin1_2, 2},
+    };
+    for (size_t f = 0; f < ARRAY_SIZE(kElementwise); f++) {
+        kElementwise[f].func(kCount, out, xs);
+        kElementwise[f].ref(kCount, fy, fx);
+        double maxerr = 0.0;
+        for (int i = 0; i < kCount; i++) {
+            double ref = fmin((double)fy[i] * 32768.0, 32767.0);
+            maxerr = fmax(maxerr, fabs((double)out[i] - ref));
+        }
+        printf("%s error: %.2f\n", kElementwise[f].name, maxerr);
+        if (maxerr > kElementwise[f].error) {
+            success = false;
+        }
+    }
+
+    // Phase accumulates with wrapping.
+    unsigned state = 1;
+    for (int i = 0; i < kCount; i++) {
+        state = state * 1103515245u + 12345u;
+        ys[i] = (ufxr_q15)(int)((state >> 16) - 32768);
+    }
+    for (int n = kOscCount - 16; n <= kOscCount; n += UFXR_QUANTUM) {
+        ufxr_osc_q15(n, out, ys);
+        unsigned phase = 0;
+        for (int i = 0; i < n; i++) {
+            phase = (phase + (unsigned)(ys[i] & 0xffff)) & 0xffff;
+            if ((unsigned)(out[i] & 0xffff) != phase) {
+                printf("osc_q15: size %d: incorrect output at %d\n", n, i);
+                success = false;
+                break;
+            }
+        }
+    }
+
+    // Every input is tested against a second, shuffled input.
+    ufxr_mix_q15(kCount, out, xs, ys);
+    for (int i = 0; i < kCount; i++) {
+        long sum = (long)xs[i] + ys[i];
+        sum = sum > 32767 ? 32767 : sum < -32768 ? -32768 : sum;
+        if (out[i] != sum) {
+            printf("mix_q15: %d + %d: got %d\n", xs[i], ys[i], out[i]);
+            success = false;
+            break;
+        }
+    }
+    ufxr_multiply_q15(kCount, out, xs, ys);
+    for (int i = 0; i < kCount; i++) {
+        long product = (long)floor(ldexp((double)xs[i] * ys[i], -15) + 0.5);
+        if (product == 32768) {
+            // Overflow wraps, as with pmulhrsw.
+            product = -32768;
+        }
+        if (out[i] != product) {
+            printf("multiply_q15: %d * %d: got %d\n", xs[i], ys[i], out[i]);
+            success = false;
+            break;
+        }
+    }
+
+    free(xs);
+    free(ys);
+    free(out);
+    free(fx);
+    free(fy);
+    if (!success) {
+        puts("****FAIL****");
+    }
+    putc('\n', stdout);
+    return success;
+}
+
+// Test that each store mode gives the same output as calling the operator
+// directly, including sizes which end with a partial block.
+static bool test_store(void) {
+    static const ufxr_store kModes[] = {
+        kUFXRStoreAuto,
+        kUFXRStoreCache,
+        kUFXRStoreStream,
+    };
+    static const int kSizes[] = {UFXR_QUANTUM, 1024, 3000};
+    enum {
+        kCount = 3000,
+    };
+    puts("Testing: store");
+    float *xs = xmalloc(sizeof(float) * kCount);
+    float *expect = xmalloc(sizeof(float) * kCount);
+    float *out = xmalloc(sizeof(float) * (kCount + UFXR_QUANTUM));
+    bool success = true;
+    linspace(kCount, xs, -5.0f, 5.0f);
+    ufxr_sin1_2(kCount, expect, xs);
+    for (size_t i = 0; i < ARRAY_SIZE(kModes); i++) {
+        for (size_t j = 0; j < ARRAY_SIZE(kSizes); j++) {
+            const int n = kSizes[j];
+            // The guard after the output must not be written.
+            for (int k = 0; k < n + UFXR_QUANTUM; k++) {
+                out[k] = -1.0f;
+            }
+            ufxr_op_store(kModes[i], ufxr_sin1_2, n, out, xs);
+            if (memcmp(out, expect, sizeof(float) * n) != 0 ||
+                out[n] != -1.0f) {
+                printf("mode %d, size %d: incorrect output\n", (int)kModes[i],
+                       n);
+                success = false;
+            }
+        }
+    }
+    free(xs);
+    free(expect);
+    free(out);
+    if (!success) {
+        puts("****FAIL****");
+    }
+    putc('\n', stdout);
+    return success;
+}
+
+// Test the subnormal setting. This only checks the targets which support it.
+static bool test_fpstate(void) {
+    puts("Testing: fpstate");
+    bool success = true;
+#if __SSE__ || __aarch64__
+    // Volatile, so the arithmetic happens at run time.
+    volatile float small = 0x1p-140f, one = 1.0f;
+    struct ufxr_fpstate outer, inner;
+    ufxr_fpstate_ftz(&outer);
+    if (small * one != 0.0f) {
+        puts("subnormal not flushed");
+        success = false;
+    }
+    // Nested calls keep the setting until the outer call is restored.
+    ufxr_fpstate_ftz(&inner);
+    ufxr_fpstate_restore(&inner);
+    if (small * one != 0.0f) {
+        puts("subnormal not flushed after nested restore");
+        success = false;
+    }
+    ufxr_fpstate_restore(&outer);
+    if (small * one != 0x1p-140f) {
+        puts("subnormal flushed after restore");
+        success = false;
+    }
+#else
+    puts("Skipped");
+#endif
+    if (!success) {
+        puts("****FAIL****");
+    }
+    putc('\n', stdout);
+    return success;
+}
+
 int main(int argc, char **argv) {
     int size = 1 << 20;
     flag_int(&size, "size", "array size");
@@ -127,6 +436,19 @@ int main(int argc, char **argv) {
         fflush(stdout);
     }
 
+    if (!test_f16()) {
+        success = false;
+    }
+    if (!test_q15()) {
+        success = false;
+    }
+    if (!test_store()) {
+        success = false;
+    }
+    if (!test_fpstate()) {
+        success = false;
+    }
+
     if (!success) {
         puts("****FAIL****");
         exit(1);
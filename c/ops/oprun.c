@@ -4,6 +4,7 @@
 #include "c/util/util.h"
 
 #include <errno.h>
+#include <limits.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
@@ -19,7 +20,7 @@ enum {
 typedef void (*func)(int n, float *restrict outs, const float *restrict xs);
 
 struct func_info {
-    char name[8];
+    char name[16];
     func func;
 };
 
@@ -27,6 +28,100 @@ static void ufxr_memcpy(int n, float *restrict outs, const float *restrict xs) {
     memcpy(outs, xs, n * sizeof(float));
 }
 
+// Half-precision versions. These use the first half of each buffer.
+static void ufxr_f16load(int n, float *restrict outs,
+                         const float *restrict xs) {
+    ufxr_f16_load(n, outs, (const ufxr_f16 *)xs);
+}
+
+static void ufxr_f16store(int n, float *restrict outs,
+                          const float *restrict xs) {
+    ufxr_f16_store(n, (ufxr_f16 *)outs, xs);
+}
+
+static void ufxr_exp2_3_hf(int n, float *restrict outs,
+                           const float *restrict xs) {
+    ufxr_op_hf(ufxr_exp2_3, n, outs, (const ufxr_f16 *)xs);
+}
+
+static void ufxr_sin1_2_hh(int n, float *restrict outs,
+                           const float *restrict xs) {
+    ufxr_op_hh(ufxr_sin1_2, n, (ufxr_f16 *)outs, (const ufxr_f16 *)xs);
+}
+
+static void ufxr_tri_hh(int n, float *restrict outs,
+                        const float *restrict xs) {
+    ufxr_op_hh(ufxr_tri, n, (ufxr_f16 *)outs, (const ufxr_f16 *)xs);
+}
+
+// Fixed-point versions. These use the first half of each buffer, and the
+// binary operators use the input for both operands.
+static void ufxr_osc_q15f(int n, float *restrict outs,
+                          const float *restrict xs) {
+    ufxr_osc_q15(n, (ufxr_q15 *)outs, (const ufxr_q15 *)xs);
+}
+
+static void ufxr_tri_q15f(int n, float *restrict outs,
+                          const float *restrict xs) {
+    ufxr_tri_q15(n, (ufxr_q15 *)outs, (const ufxr_q15 *)xs);
+}
+
+static void ufxr_sin1_2_q15f(int n, float *restrict outs,
+                             const float *restrict xs) {
+    ufxr_sin1_2_q15(n, (ufxr_q15 *)outs, (const ufxr_q15 *)xs);
+}
+
+static void ufxr_mix_q15f(int n, float *restrict outs,
+                          const float *restrict xs) {
+    ufxr_mix_q15(n, (ufxr_q15 *)outs, (const ufxr_q15 *)xs,
+                 (const ufxr_q15 *)xs);
+}
+
+static void ufxr_multiply_q15f(int n, float *restrict outs,
+                               const float *restrict xs) {
+    ufxr_multiply_q15(n, (ufxr_q15 *)outs, (const ufxr_q15 *)xs,
+                      (const ufxr_q15 *)xs);
+}
+
+// Streaming versions.
+static void ufxr_memcpy_stream(int n, float *restrict outs,
+                               const float *restrict xs) {
+    ufxr_op_store(kUFXRStoreStream, ufxr_memcpy, n, outs, xs);
+}
+
+static void ufxr_exp2_3_stream(int n, float *restrict outs,
+                               const float *restrict xs) {
+    ufxr_op_store(kUFXRStoreStream, ufxr_exp2_3, n, outs, xs);
+}
+
+static void ufxr_sin1_2_stream(int n, float *restrict outs,
+                               const float *restrict xs) {
+    ufxr_op_store(kUFXRStoreStream, ufxr_sin1_2, n, outs, xs);
+}
+
+static void ufxr_tri_stream(int n, float *restrict outs,
+                            const float *restrict xs) {
+    ufxr_op_store(kUFXRStoreStream, ufxr_tri, n, outs, xs);
+}
+
+// Versions which flush subnormals to zero. Compare these to the plain versions
+// with the -subnormal flag.
+static void ufxr_sin1_2_ftz(int n, float *restrict outs,
+                            const float *restrict xs) {
+    struct ufxr_fpstate fp;
+    ufxr_fpstate_ftz(&fp);
+    ufxr_sin1_2(n, outs, xs);
+    ufxr_fpstate_restore(&fp);
+}
+
+static void ufxr_tri_ftz(int n, float *restrict outs,
+                         const float *restrict xs) {
+    struct ufxr_fpstate fp;
+    ufxr_fpstate_ftz(&fp);
+    ufxr_tri(n, outs, xs);
+    ufxr_fpstate_restore(&fp);
+}
+
 #define F(f) \
     { #f, ufxr_##f }
 // clang-format off
@@ -44,6 +139,22 @@ static const struct func_info kFuncs[] = {
     F(sin1_6),
     F(tri),
     F(memcpy),
+    F(f16load),
+    F(f16store),
+    F(exp2_3_hf),
+    F(sin1_2_hh),
+    F(tri_hh),
+    {"osc_q15", ufxr_osc_q15f},
+    {"tri_q15", ufxr_tri_q15f},
+    {"sin1_2_q15", ufxr_sin1_2_q15f},
+    {"mix_q15", ufxr_mix_q15f},
+    {"multiply_q15", ufxr_multiply_q15f},
+    F(memcpy_stream),
+    F(exp2_3_stream),
+    F(sin1_2_stream),
+    F(tri_stream),
+    F(sin1_2_ftz),
+    F(tri_ftz),
 };
 // clang-format on
 #undef F
@@ -63,8 +174,11 @@ static void help_benchmark(const char *name) {
           "\n"
           "Options:\n"
           "  -size <size>   Size of input array\n"
+          "  -max <size>    Repeat with sizes doubling up to <size>, keeping\n"
+          "                 the number of samples per run the same\n"
           "  -iter <count>  Number of function iterations per run\n"
           "  -runs <count>  Number of benchmark runs\n"
+          "  -subnormal     Scale the input so it is subnormal\n"
           "  -out <file>    Write results as CSV to <file>\n");
 }
 
@@ -83,13 +197,17 @@ static double benchmark(int size, int iter, func f, const float *xs,
 static int exec_benchmark(int argc, char **argv) {
     // Parse flags
     int size = kBenchmarkSize;
+    int maxsize = 0;
     int iter = kBenchmarkIter;
     int runs = kBenchmarkRuns;
     const char *outfile = NULL;
+    bool subnormal = false;
     flag_int(&size, "size", "array size");
+    flag_int(&maxsize, "max", "maximum array size");
     flag_int(&iter, "iter", "iteration count");
     flag_int(&runs, "runs", "number of runs");
     flag_string(&outfile, "out", "output file");
+    flag_bool(&subnormal, "subnormal", "use subnormal input");
     argc = flag_parse(argc, argv);
     bool funcs[ARRAY_SIZE(kFuncs)]; // Which functions to benchmark.
     if (argc == 0) {
@@ -141,6 +259,11 @@ static int exec_benchmark(int argc, char **argv) {
         die_usagef("invalid size %d, must be a multiple of %d", size,
                    UFXR_QUANTUM);
     }
+    if (maxsize == 0) {
+        maxsize = size;
+    } else if (maxsize < size) {
+        die_usagef("invalid maximum size %d", maxsize);
+    }
     if (iter < 1) {
         die_usage("iteration count must be positive");
     }
@@ -155,11 +278,24 @@ static int exec_benchmark(int argc, char **argv) {
             func_count++;
         }
     }
-    int cur_bench = 0, bench_count = runs * func_count;
-    float *xs = xmalloc(sizeof(float) * size);
-    float *ys = xmalloc(sizeof(float) * size);
+    int size_count = 0;
+    for (int n = size; n <= maxsize; n *= 2) {
+        size_count++;
+        if (n > INT_MAX / 2) {
+            break;
+        }
+    }
+    int cur_bench = 0, bench_count = runs * func_count * size_count;
+    float *xs = xmalloc(sizeof(float) * maxsize);
+    float *ys = xmalloc(sizeof(float) * maxsize);
     double samples = (double)iter * (double)size;
-    linspace(size, xs, -5.0f, 5.0f);
+    linspace(maxsize, xs, -5.0f, 5.0f);
+    if (subnormal) {
+        // The largest magnitude, 5 * 2^-140, is below 2^-126.
+        for (int i = 0; i < maxsize; i++) {
+            xs[i] *= 0x1p-140f;
+        }
+    }
     FILE *fp;
     if (outfile == NULL) {
         fp = stdout;
@@ -172,16 +308,31 @@ static int exec_benchmark(int argc, char **argv) {
     }
     xputs(fp, "Operator,TimeNS\n");
     for (int run = 0; run < runs; run++) {
-        for (size_t func = 0; func < ARRAY_SIZE(kFuncs); func++) {
-            if (funcs[func]) {
-                cur_bench++;
-                if (outfile != NULL) {
-                    fprintf(stderr, "\r\x1b[KBenchmark %3d/%3d %s", cur_bench,
-                            bench_count, kFuncs[func].name);
-                    fflush(stderr);
+        for (int i = 0; i < size_count; i++) {
+            const int n = size << i;
+            // When sweeping sizes, each size processes the same number of
+            // samples, and the size is appended to the operator name.
+            int n_iter = (int)(samples / n);
+            if (n_iter < 1) {
+                n_iter = 1;
+            }
+            for (size_t func = 0; func < ARRAY_SIZE(kFuncs); func++) {
+                if (funcs[func]) {
+                    cur_bench++;
+                    if (outfile != NULL) {
+                        fprintf(stderr, "\r\x1b[KBenchmark %3d/%3d %s %d",
+                                cur_bench, bench_count, kFuncs[func].name, n);
+                        fflush(stderr);
+                    }
+                    double t =
+                        benchmark(n, n_iter, kFuncs[func].func, xs, ys);
+                    double ns = t / ((double)n_iter * (double)n);
+                    if (size_count > 1) {
+                        xprintf(fp, "%s/%d,%.3f\n", kFuncs[func].name, n, ns);
+                    } else {
+                        xprintf(fp, "%s,%.3f\n", kFuncs[func].name, ns);
+                    }
                 }
-                double t = benchmark(size, iter, kFuncs[func].func, xs, ys);
-                xprintf(fp, "%s,%.3f\n", kFuncs[func].name, t / samples);
             }
         }
     }
@@ -1,6 +1,8 @@
 // c/ops/ops.h - Low-level signal processing operators.
 #pragma once
 
+#include <stdint.h>
+
 // All inputs to these functions must have a size which is a multiple of
 // UFXR_QUANTUM.
 #define UFXR_QUANTUM 4
@@ -52,3 +54,105 @@ void ufxr_sin1_3(int n, float *restrict outs, const float *restrict xs);
 void ufxr_sin1_4(int n, float *restrict outs, const float *restrict xs);
 void ufxr_sin1_5(int n, float *restrict outs, const float *restrict xs);
 void ufxr_sin1_6(int n, float *restrict outs, const float *restrict xs);
+
+// Signature of the elementwise operators above.
+typedef void (*ufxr_op)(int n, float *restrict outs, const float *restrict xs);
+
+// Half-precision floating-point number, stored as its IEEE 754 binary16 bit
+// pattern. This is intended for storing signals which do not need full
+// precision, like envelopes, LFOs, and pitch curves, in half the memory. Arrays
+// of these have the same size and alignment requirements as float arrays.
+typedef uint16_t ufxr_f16;
+
+// Convert half precision to single precision. This is exact.
+void ufxr_f16_load(int n, float *restrict outs, const ufxr_f16 *restrict xs);
+
+// Convert single precision to half precision, rounding to nearest.
+void ufxr_f16_store(int n, ufxr_f16 *restrict outs, const float *restrict xs);
+
+// Apply an elementwise operator to half-precision input or output. The data is
+// converted a block at a time, so the single-precision data stays in cache.
+// The operator must not depend on previous input, so ufxr_osc cannot be used.
+//
+// hh: half-precision input and output
+// hf: half-precision input, single-precision output
+// fh: single-precision input, half-precision output
+void ufxr_op_hh(ufxr_op op, int n, ufxr_f16 *restrict outs,
+                const ufxr_f16 *restrict xs);
+void ufxr_op_hf(ufxr_op op, int n, float *restrict outs,
+                const ufxr_f16 *restrict xs);
+void ufxr_op_fh(ufxr_op op, int n, ufxr_f16 *restrict outs,
+                const float *restrict xs);
+
+// Output size, in bytes, at which kUFXRStoreAuto switches to non-temporal
+// stores. Below this, the output is likely to be read again while it is still
+// in cache.
+#define UFXR_STREAM_THRESHOLD (8 << 20)
+
+// How an operator writes its output.
+typedef enum {
+    // Stream if the output is at least UFXR_STREAM_THRESHOLD bytes.
+    kUFXRStoreAuto,
+    // Write through the cache, the same as calling the operator directly.
+    kUFXRStoreCache,
+    // Write with non-temporal stores, which bypass the cache. This keeps a
+    // large output from evicting the rest of the working set, and avoids
+    // reading the output from memory before overwriting it.
+    kUFXRStoreStream,
+} ufxr_store;
+
+// Apply an elementwise operator, writing the output as selected by mode. When
+// streaming, the operator runs a block at a time into a buffer in L1 cache,
+// which is then copied to the output, followed by a store fence. The operator
+// must not depend on previous input, so ufxr_osc cannot be used.
+void ufxr_op_store(ufxr_store mode, ufxr_op op, int n, float *restrict outs,
+                   const float *restrict xs);
+
+// Q15 fixed-point number: a 16-bit signed integer, where 32768 represents 1.
+// Arrays of these have the same size and alignment requirements as float
+// arrays. On little-endian systems, an array of Q15 samples is the same as the
+// output of ufxr_to_les16, so it can be written to a 16-bit wave file without
+// conversion.
+//
+// Phase and frequency use a different scale: a full period is 65536, so phase
+// wraps around when it overflows. A frequency of 1 is 1/65536 cycles per
+// sample.
+typedef int16_t ufxr_q15;
+
+// Fixed-point versions of ufxr_osc, ufxr_tri, and ufxr_sin1_2. The error of
+// ufxr_tri_q15 is at most 1, and the error of ufxr_sin1_2_q15 is at most 2,
+// compared to the floating-point versions scaled to Q15.
+void ufxr_osc_q15(int n, ufxr_q15 *restrict outs, const ufxr_q15 *restrict xs);
+void ufxr_tri_q15(int n, ufxr_q15 *restrict outs, const ufxr_q15 *restrict xs);
+void ufxr_sin1_2_q15(int n, ufxr_q15 *restrict outs,
+                     const ufxr_q15 *restrict xs);
+
+// Compute out = x + y, saturating.
+void ufxr_mix_q15(int n, ufxr_q15 *restrict outs, const ufxr_q15 *restrict xs,
+                  const ufxr_q15 *restrict ys);
+
+// Compute out = x * y, rounded.
+void ufxr_multiply_q15(int n, ufxr_q15 *restrict outs,
+                       const ufxr_q15 *restrict xs,
+                       const ufxr_q15 *restrict ys);
+
+// Saved floating-point control state.
+struct ufxr_fpstate {
+    unsigned flags;
+};
+
+// Make floating-point math on the calling thread flush subnormal results to
+// zero and treat subnormal inputs as zero, and save the previous setting.
+// Subnormals appear in the decaying tails of filters and reverbs, and are
+// often many times slower than normal numbers.
+//
+// This sets FTZ and DAZ in MXCSR on x86, and FZ in FPCR on AArch64. On other
+// targets, it does nothing. The setting belongs to the calling thread, so this
+// can be called from any thread without affecting the others. Each call must
+// be followed by ufxr_fpstate_restore on the same thread, and nested calls must
+// be restored in reverse order.
+void ufxr_fpstate_ftz(struct ufxr_fpstate *restrict saved);
+
+// Restore the subnormal setting saved by ufxr_fpstate_ftz. Other state, like
+// the rounding mode and exception flags, is left as it is.
+void ufxr_fpstate_restore(const struct ufxr_fpstate *restrict saved);
@@ -0,0 +1,260 @@
+// q15.c - Fixed-point operators.
+#include "c/ops/impl.h"
+
+// Phase is a 16-bit integer where a full period is 65536, so it wraps around
+// with ordinary integer overflow. Arithmetic on the bit patterns is done with
+// unsigned integers, so overflow is defined.
+
+static inline ufxr_q15 q15_wrap(uint32_t x) {
+    x &= 0xffff;
+    return (ufxr_q15)((int32_t)x - (int32_t)((x & 0x8000) << 1));
+}
+
+static inline ufxr_q15 q15_sat(int32_t x) {
+    return x > 32767 ? 32767 : x < -32768 ? -32768 : x;
+}
+
+// Same as pmulhrsw.
+static inline ufxr_q15 q15_mulhrs(ufxr_q15 x, ufxr_q15 y) {
+    return q15_wrap((uint32_t)(((int32_t)x * y + 0x4000) >> 15));
+}
+
+static inline ufxr_q15 q15_tri(ufxr_q15 p) {
+    // Distance from the peak at a quarter period, from 0 to 32768.
+    int32_t d = q15_wrap((uint32_t)p - 0x4000);
+    d = d < 0 ? -d : d;
+    return q15_sat(2 * (0x4000 - d));
+}
+
+static inline ufxr_q15 q15_sin1_2(ufxr_q15 p) {
+    // With h = 2x, sin(2 pi x) ~ 4h(1 - |h|), and h is the phase as Q15.
+    const int32_t a = p < 0 ? -(int32_t)p : p;
+    const ufxr_q15 m = q15_mulhrs(p, q15_wrap(0x8000 - a));
+    return q15_sat(4 * m);
+}
+
+// AVX2 version.
+#if !HAVE_FUNC && USE_AVX2
+#define HAVE_FUNC 1
+#include <immintrin.h>
+void ufxr_osc_q15(int n, ufxr_q15 *restrict outs, const ufxr_q15 *restrict xs) {
+    CHECK2(n, outs, xs);
+    // Running phase, in every lane.
+    __m256i phase = _mm256_setzero_si256();
+    int i = 0;
+    for (; n - i >= 16; i += 16) {
+        // Prefix sum within each 128-bit half, then add the total of the low
+        // half to the high half.
+        __m256i x = _mm256_loadu_si256((const void *)(xs + i));
+        x = _mm256_add_epi16(x, _mm256_slli_si256(x, 2));
+        x = _mm256_add_epi16(x, _mm256_slli_si256(x, 4));
+        x = _mm256_add_epi16(x, _mm256_slli_si256(x, 8));
+        __m256i lo = _mm256_shufflehi_epi16(x, 0xff);
+        lo = _mm256_unpackhi_epi64(lo, lo);
+        x = _mm256_add_epi16(x, _mm256_permute2x128_si256(lo, lo, 0x08));
+        x = _mm256_add_epi16(x, phase);
+        _mm256_storeu_si256((void *)(outs + i), x);
+        __m256i hi = _mm256_shufflehi_epi16(x, 0xff);
+        hi = _mm256_unpackhi_epi64(hi, hi);
+        phase = _mm256_permute2x128_si256(hi, hi, 0x11);
+    }
+    uint32_t p = (uint16_t)_mm256_extract_epi16(phase, 0);
+    for (; i < n; i++) {
+        p += (uint16_t)xs[i];
+        outs[i] = q15_wrap(p);
+    }
+}
+
+void ufxr_tri_q15(int n, ufxr_q15 *restrict outs, const ufxr_q15 *restrict xs) {
+    CHECK2(n, outs, xs);
+    const __m256i quarter = _mm256_set1_epi16(0x4000);
+    int i = 0;
+    for (; n - i >= 16; i += 16) {
+        __m256i x = _mm256_loadu_si256((const void *)(xs + i));
+        x = _mm256_abs_epi16(_mm256_sub_epi16(x, quarter));
+        x = _mm256_sub_epi16(quarter, x);
+        _mm256_storeu_si256((void *)(outs + i), _mm256_adds_epi16(x, x));
+    }
+    for (; i < n; i++) {
+        outs[i] = q15_tri(xs[i]);
+    }
+}
+
+void ufxr_sin1_2_q15(int n, ufxr_q15 *restrict outs,
+                     const ufxr_q15 *restrict xs) {
+    CHECK2(n, outs, xs);
+    const __m256i half = _mm256_set1_epi16((short)0x8000);
+    int i = 0;
+    for (; n - i >= 16; i += 16) {
+        __m256i x = _mm256_loadu_si256((const void *)(xs + i));
+        __m256i g = _mm256_subs_epu16(half, _mm256_abs_epi16(x));
+        __m256i m = _mm256_mulhrs_epi16(x, g);
+        m = _mm256_adds_epi16(m, m);
+        _mm256_storeu_si256((void *)(outs + i), _mm256_adds_epi16(m, m));
+    }
+    for (; i < n; i++) {
+        outs[i] = q15_sin1_2(xs[i]);
+    }
+}
+
+void ufxr_mix_q15(int n, ufxr_q15 *restrict outs, const ufxr_q15 *restrict xs,
+                  const ufxr_q15 *restrict ys) {
+    CHECK3(n, outs, xs, ys);
+    int i = 0;
+    for (; n - i >= 16; i += 16) {
+        __m256i x = _mm256_loadu_si256((const void *)(xs + i));
+        __m256i y = _mm256_loadu_si256((const void *)(ys + i));
+        _mm256_storeu_si256((void *)(outs + i), _mm256_adds_epi16(x, y));
+    }
+    for (; i < n; i++) {
+        outs[i] = q15_sat((int32_t)xs[i] + ys[i]);
+    }
+}
+
+void ufxr_multiply_q15(int n, ufxr_q15 *restrict outs,
+                       const ufxr_q15 *restrict xs,
+                       const ufxr_q15 *restrict ys) {
+    CHECK3(n, outs, xs, ys);
+    int i = 0;
+    for (; n - i >= 16; i += 16) {
+        __m256i x = _mm256_loadu_si256((const void *)(xs + i));
+        __m256i y = _mm256_loadu_si256((const void *)(ys + i));
+        _mm256_storeu_si256((void *)(outs + i), _mm256_mulhrs_epi16(x, y));
+    }
+    for (; i < n; i++) {
+        outs[i] = q15_mulhrs(xs[i], ys[i]);
+    }
+}
+#endif
+
+// SSSE3 version.
+#if !HAVE_FUNC && USE_SSSE3
+#define HAVE_FUNC 1
+#include <tmmintrin.h>
+void ufxr_osc_q15(int n, ufxr_q15 *restrict outs, const ufxr_q15 *restrict xs) {
+    CHECK2(n, outs, xs);
+    // Running phase, in every lane.
+    __m128i phase = _mm_setzero_si128();
+    int i = 0;
+    for (; n - i >= 8; i += 8) {
+        __m128i x = _mm_load_si128((const void *)(xs + i));
+        x = _mm_add_epi16(x, _mm_slli_si128(x, 2));
+        x = _mm_add_epi16(x, _mm_slli_si128(x, 4));
+        x = _mm_add_epi16(x, _mm_slli_si128(x, 8));
+        x = _mm_add_epi16(x, phase);
+        _mm_store_si128((void *)(outs + i), x);
+        phase = _mm_shufflehi_epi16(x, 0xff);
+        phase = _mm_unpackhi_epi64(phase, phase);
+    }
+    uint32_t p = (uint16_t)_mm_extract_epi16(phase, 0);
+    for (; i < n; i++) {
+        p += (uint16_t)xs[i];
+        outs[i] = q15_wrap(p);
+    }
+}
+
+void ufxr_tri_q15(int n, ufxr_q15 *restrict outs, const ufxr_q15 *restrict xs) {
+    CHECK2(n, outs, xs);
+    const __m128i quarter = _mm_set1_epi16(0x4000);
+    int i = 0;
+    for (; n - i >= 8; i += 8) {
+        __m128i x = _mm_load_si128((const void *)(xs + i));
+        x = _mm_abs_epi16(_mm_sub_epi16(x, quarter));
+        x = _mm_sub_epi16(quarter, x);
+        _mm_store_si128((void *)(outs + i), _mm_adds_epi16(x, x));
+    }
+    for (; i < n; i++) {
+        outs[i] = q15_tri(xs[i]);
+    }
+}
+
+void ufxr_sin1_2_q15(int n, ufxr_q15 *restrict outs,
+                     const ufxr_q15 *restrict xs) {
+    CHECK2(n, outs, xs);
+    const __m128i half = _mm_set1_epi16((short)0x8000);
+    int i = 0;
+    for (; n - i >= 8; i += 8) {
+        __m128i x = _mm_load_si128((const void *)(xs + i));
+        __m128i g = _mm_subs_epu16(half, _mm_abs_epi16(x));
+        __m128i m = _mm_mulhrs_epi16(x, g);
+        m = _mm_adds_epi16(m, m);
+        _mm_store_si128((void *)(outs + i), _mm_adds_epi16(m, m));
+    }
+    for (; i < n; i++) {
+        outs[i] = q15_sin1_2(xs[i]);
+    }
+}
+
+void ufxr_mix_q15(int n, ufxr_q15 *restrict outs, const ufxr_q15 *restrict xs,
+                  const ufxr_q15 *restrict ys) {
+    CHECK3(n, outs, xs, ys);
+    int i = 0;
+    for (; n - i >= 8; i += 8) {
+        __m128i x = _mm_load_si128((const void *)(xs + i));
+        __m128i y = _mm_load_si128((const void *)(ys + i));
+        _mm_store_si128((void *)(outs + i), _mm_adds_epi16(x, y));
+    }
+    for (; i < n; i++) {
+        outs[i] = q15_sat((int32_t)xs[i] + ys[i]);
+    }
+}
+
+void ufxr_multiply_q15(int n, ufxr_q15 *restrict outs,
+                       const ufxr_q15 *restrict xs,
+                       const ufxr_q15 *restrict ys) {
+    CHECK3(n, outs, xs, ys);
+    int i = 0;
+    for (; n - i >= 8; i += 8) {
+        __m128i x = _mm_load_si128((const void *)(xs + i));
+        __m128i y = _mm_load_si128((const void *)(ys + i));
+        _mm_store_si128((void *)(outs + i), _mm_mulhrs_epi16(x, y));
+    }
+    for (; i < n; i++) {
+        outs[i] = q15_mulhrs(xs[i], ys[i]);
+    }
+}
+#endif
+
+// Scalar version.
+#if !HAVE_FUNC
+void ufxr_osc_q15(int n, ufxr_q15 *restrict outs, const ufxr_q15 *restrict xs) {
+    CHECK2(n, outs, xs);
+    uint32_t p = 0;
+    for (int i = 0; i < n; i++) {
+        p += (uint16_t)xs[i];
+        outs[i] = q15_wrap(p);
+    }
+}
+
+void ufxr_tri_q15(int n, ufxr_q15 *restrict outs, const ufxr_q15 *restrict xs) {
+    CHECK2(n, outs, xs);
+    for (int i = 0; i < n; i++) {
+        outs[i] = q15_tri(xs[i]);
+    }
+}
+
+void ufxr_sin1_2_q15(int n, ufxr_q15 *restrict outs,
+                     const ufxr_q15 *restrict xs) {
+    CHECK2(n, outs, xs);
+    for (int i = 0; i < n; i++) {
+        outs[i] = q15_sin1_2(xs[i]);
+    }
+}
+
+void ufxr_mix_q15(int n, ufxr_q15 *restrict outs, const ufxr_q15 *restrict xs,
+                  const ufxr_q15 *restrict ys) {
+    CHECK3(n, outs, xs, ys);
+    for (int i = 0; i < n; i++) {
+        outs[i] = q15_sat((int32_t)xs[i] + ys[i]);
+    }
+}
+
+void ufxr_multiply_q15(int n, ufxr_q15 *restrict outs,
+                       const ufxr_q15 *restrict xs,
+                       const ufxr_q15 *restrict ys) {
+    CHECK3(n, outs, xs, ys);
+    for (int i = 0; i < n; i++) {
+        outs[i] = q15_mulhrs(xs[i], ys[i]);
+    }
+}
+#endif
@@ -0,0 +1,62 @@
+// stream.c - Non-temporal output.
+#include "c/ops/impl.h"
+
+#include <stdbool.h>
+
+// Number of samples computed at a time before they are written to the output.
+// The block is kept in L1 cache.
+enum {
+    kStreamBlock = 1024,
+};
+
+// SSE2 version.
+#if !HAVE_FUNC && USE_SSE2
+#define HAVE_FUNC 1
+#include <emmintrin.h>
+static void op_stream(ufxr_op op, int n, float *restrict outs,
+                      const float *restrict xs) {
+    _Alignas(32) float y[kStreamBlock];
+    for (int i = 0; i < n; i += kStreamBlock) {
+        const int m = n - i < kStreamBlock ? n - i : kStreamBlock;
+        op(m, y, xs + i);
+        // Four stores fill a 64-byte line, so the write-combining buffer
+        // writes whole lines to memory without reading them first.
+        for (int j = 0; j < m; j += 4) {
+            _mm_stream_ps(outs + i + j, _mm_load_ps(y + j));
+        }
+    }
+    // Non-temporal stores are weakly ordered. Make sure they are visible before
+    // any stores which follow, so the output can be handed to another thread.
+    _mm_sfence();
+}
+#endif
+
+// Scalar version. This has no way to bypass the cache.
+#if !HAVE_FUNC
+static void op_stream(ufxr_op op, int n, float *restrict outs,
+                      const float *restrict xs) {
+    op(n, outs, xs);
+}
+#endif
+
+void ufxr_op_store(ufxr_store mode, ufxr_op op, int n, float *restrict outs,
+                   const float *restrict xs) {
+    CHECK2(n, outs, xs);
+    bool stream;
+    switch (mode) {
+    case kUFXRStoreCache:
+        stream = false;
+        break;
+    case kUFXRStoreStream:
+        stream = true;
+        break;
+    default:
+        stream = (size_t)n * sizeof(float) >= UFXR_STREAM_THRESHOLD;
+        break;
+    }
+    if (stream) {
+        op_stream(op, n, outs, xs);
+    } else {
+        op(n, outs, xs);
+    }
+}